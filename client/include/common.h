@@ -157,7 +157,7 @@ struct InferOptions {
   explicit InferOptions(const std::string& model_name)
       : model_name_(model_name), model_version_(""), request_id_(""),
         sequence_id_(0), sequence_start_(false), sequence_end_(false),
-        priority_(0), timeout_(0),partitioning_point_(-1)
+        priority_(0), timeout_(0),partitioning_point_(-1), deadline_(0)
   {
   }
   /// The name of the model to run inference.
@@ -198,6 +198,20 @@ struct InferOptions {
   uint64_t timeout_;
 
   int64_t partitioning_point_;
+  /// The time budget for the request, in microseconds, counted from
+  /// when the server queues the request. Used by servers that schedule
+  /// requests by deadline. Default value is 0 which means the request
+  /// has no deadline.
+  uint64_t deadline_;
+  /// The scale of an input sent in a smaller data type than the model
+  /// expects, which the server multiplies the input by when converting
+  /// it. Either a single value or one value per channel of the input.
+  /// Default value is empty which means the input is not scaled.
+  std::vector<float> input_scale_;
+  /// The encoding the input data is in, "sparse" or "lz", which the
+  /// server decodes. Default value is an empty string which means the
+  /// input data is sent as it is.
+  std::string input_encoding_;
 };
 
 //==============================================================================
@@ -262,6 +276,25 @@ class InferInput {
   /// \return Error object indicating success or failure.
   Error AppendRaw(const uint8_t* input, size_t input_byte_size);
 
+  /// A function that waits until the bytes of a buffer from 'offset' on
+  /// are at least partly written and returns how many of them are.
+  /// It must return a non-zero count for an offset within the buffer.
+  using ReadyFn = std::function<size_t(size_t offset)>;
+
+  /// Append tensor values for this input from a byte array that is
+  /// still being written when the request is sent, for example by an
+  /// asynchronous copy from the device. The array is not copied, as
+  /// with AppendRaw() above. 'ready' is called on the thread sending
+  /// the request before each part of the array is read, so that part
+  /// is sent while the rest of the array is written.
+  /// \param input The pointer to the array holding the tensor value.
+  /// \param input_byte_size The size of the array in bytes.
+  /// \param ready The function waiting until a part of the array is
+  /// written.
+  /// \return Error object indicating success or failure.
+  Error AppendRaw(
+      const uint8_t* input, size_t input_byte_size, ReadyFn ready);
+
   /// Set tensor values for this input by reference into a shared memory
   /// region. The values are not copied and so the shared memory region and
   /// its contents must not be modified or destroyed until this input is no
@@ -322,6 +355,11 @@ class InferInput {
   Error GetNext(
       uint8_t* buf, size_t size, size_t* input_bytes, bool* end_of_input);
   Error GetNext(const uint8_t** buf, size_t* input_bytes, bool* end_of_input);
+  // As above without waiting for the buffer to be written. 'ready' is
+  // set to the function waiting for it, or to nullptr if it is.
+  Error GetNext(
+      const uint8_t** buf, size_t* input_bytes, ReadyFn* ready,
+      bool* end_of_input);
 
   std::string name_;
   std::vector<int64_t> shape_;
@@ -331,6 +369,9 @@ class InferInput {
   size_t bufs_idx_, buf_pos_;
   std::vector<const uint8_t*> bufs_;
   std::vector<size_t> buf_byte_sizes_;
+  // The function waiting for each buffer to be written, nullptr for a
+  // buffer that is.
+  std::vector<ReadyFn> buf_ready_;
 
   // Used only for STRING type tensors set with SetFromString(). Hold
   // the "raw" serialization of the string values for each index
@@ -445,6 +486,21 @@ class InferResult {
 
   virtual Error ModelQueueNs(std::string* queuens) const = 0;
   virtual Error ModelInferNs(std::string* inferns) const = 0;
+
+  /// Get the time the server predicted the request would wait before
+  /// executing, returned when the server rejected the request because
+  /// it would miss its deadline.
+  /// \param wait_us Returns the predicted wait, in microseconds.
+  /// \return Error object indicating success or failure.
+  virtual Error PredictedWait(uint64_t* wait_us) const = 0;
+
+  /// Get the range of partitioning points the server recommends for
+  /// the next request, returned when the server is configured to
+  /// recommend one.
+  /// \param min_point Returns the earliest recommended point.
+  /// \param max_point Returns the latest recommended point.
+  /// \return Error object indicating success or failure.
+  virtual Error PartitionHint(int64_t* min_point, int64_t* max_point) const = 0;
   
   virtual Error ModelQueueContents(std::string* queue_contents) const = 0;
   virtual Error ModelNumOfBatch(std::string* num_of_batch) const = 0;
@@ -7,6 +7,10 @@
 #include <vector>
 #include <string>
 #include <numeric>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <algorithm>
 #include "util.h"
 extern "C" {
 #include<curl/curl.h>
@@ -30,22 +34,97 @@ enum {
 #include "Server.h"
 
 
-#define SERVER_STATUS_URL "http://210.107.197.107:8004"
-#define SERVER_STATUS_PATH "/status"
+#define DEFAULT_SERVER_URL "210.107.197.107:8000"
+#define SERVER_STATUS_PATH "/v2/load"
 
 static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
     ((std::string *) userp)->append((char *) contents, size * nmemb);
     return size * nmemb;
 }
 
+// The load is pushed at least every interval, and at most every min
+// interval when it changes. A pushed load older than the expiry is
+// not used.
+#define LOAD_STREAM_PATH "/v2/load/stream?interval_ms=1000&min_interval_ms=50"
+#define LOAD_STREAM_EXPIRY_MS 2000
+#define LOAD_STREAM_RETRY_MS 1000
+
+static int Base64Value(char c)
+{
+	if(c >= 'A' && c <= 'Z') return c - 'A';
+	if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if(c >= '0' && c <= '9') return c - '0' + 52;
+	if(c == '+') return 62;
+	if(c == '/') return 63;
+	return -1;
+}
+
+static std::string Base64Decode(const std::string& encoded)
+{
+	std::string decoded;
+	uint32_t bits = 0;
+	int bit_count = 0;
+	for(char c : encoded) {
+		int value = Base64Value(c);
+		if(value < 0) {
+			continue;
+		}
+		bits = (bits << 6) | value;
+		bit_count += 6;
+		if(bit_count >= 8) {
+			bit_count -= 8;
+			decoded.push_back((char)((bits >> bit_count) & 0xff));
+		}
+	}
+	return decoded;
+}
+
+static bool ParseLoadStatus(const std::string& buffer, ServerLoadStatus* load_status)
+{
+	if(buffer.size() != sizeof(*load_status)) {
+		std::cerr << "Unexpected server load of " << buffer.size() << " bytes" << std::endl;
+		return false;
+	}
+	memcpy(load_status, buffer.data(), sizeof(*load_status));
+	if(load_status->version != SERVER_LOAD_STATUS_VERSION) {
+		std::cerr << "Unsupported server load version " << load_status->version << std::endl;
+		return false;
+	}
+	return true;
+}
+
 ServerInfo::ServerInfo()
+	: ServerInfo(DEFAULT_SERVER_URL)
+{
+}
+
+ServerInfo::ServerInfo(const std::string& server_url)
+	: url(server_url)
 {
 	rtt = 0;
 	link_capacity = 100;
 	sf = 1;
 	queueing = 0;
 	server_information_refresh_time = 0;
+	server_information_send_time = 0;
+	server_information_update_time = 0;
+	hint_min_point = -1;
+	hint_max_point = -1;
+	hint_expiry_time = 0;
+	split_point_mask = ~(uint64_t)0;
+	status_curl = nullptr;
+	load_stream_exit = false;
+	streamed_time = 0;
 };
+
+ServerInfo::~ServerInfo()
+{
+	StopLoadStream();
+	if(status_curl != nullptr) {
+		curl_easy_cleanup(status_curl);
+	}
+}
+
 void ServerInfo::init()
 {
 	sf= 1;
@@ -69,60 +148,81 @@ void ServerInfo::RTTrefresh(double current_rtt)
 	rtt = std::accumulate(rtt_history.begin(), rtt_history.end(),0.0)/(double)rtt_history.size();
 
 }
-void ServerInfo::GetServerInfo()
+bool ServerInfo::FetchLoadStatus(ServerLoadStatus* load_status)
 {
 	std::string readBuffer;
 
-	CURL *ctx = curl_easy_init();
-	std::string status_url = std::string(SERVER_STATUS_URL)+std::string(SERVER_STATUS_PATH);
-	curl_easy_setopt(ctx, CURLOPT_URL, status_url.c_str());
-	curl_easy_setopt(ctx, CURLOPT_NOPROGRESS, OPTION_TRUE);
-	curl_easy_setopt(ctx, CURLOPT_WRITEFUNCTION, WriteCallback);
-	curl_easy_setopt(ctx, CURLOPT_WRITEDATA, (void *) &readBuffer);
-	curl_easy_setopt(ctx, CURLOPT_TCP_NODELAY, 1L);
+	std::lock_guard<std::mutex> lock(status_mtx);
+	if(status_curl == nullptr) {
+		status_curl = curl_easy_init();
+		std::string status_url = "http://"+url+std::string(SERVER_STATUS_PATH);
+		curl_easy_setopt(status_curl, CURLOPT_URL, status_url.c_str());
+		curl_easy_setopt(status_curl, CURLOPT_NOPROGRESS, OPTION_TRUE);
+		curl_easy_setopt(status_curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+		curl_easy_setopt(status_curl, CURLOPT_TCP_NODELAY, 1L);
+	}
+	curl_easy_setopt(status_curl, CURLOPT_WRITEDATA, (void *) &readBuffer);
 
 	std::chrono::steady_clock::time_point getstatus_start = std::chrono::steady_clock::now();
-	const CURLcode rc = curl_easy_perform(ctx);
+	const CURLcode rc = curl_easy_perform(status_curl);
 	std::chrono::steady_clock::time_point getstatus_end = std::chrono::steady_clock::now();
 
 	double current_rtt = std::chrono::duration_cast<std::chrono::microseconds>(getstatus_end - getstatus_start).count()/1000.0 /2; 
-	
-	RTTrefresh(current_rtt);
+	current_measured_rtt = current_rtt;
 	if (CURLE_OK != rc) {
 		std::cerr << "Error from cURL: " << curl_easy_strerror(rc) << std::endl;
+		return false;
 	}
 
-	// cleanup
-	curl_easy_cleanup(ctx);
-	curl_global_cleanup();
+	if(load_status != nullptr) {
+		RTTrefresh(current_rtt);
+		return ParseLoadStatus(readBuffer, load_status);
+	}
+	return true;
+}
 
-	std::string delimiter = ",";
-	std::vector<std::string> parsed;
-	size_t pos= 0;
-	std::string temp;
-	while ((pos = readBuffer.find(delimiter)) != std::string::npos) {
-		temp = readBuffer.substr(0, pos);
-		parsed.push_back(temp);
-		//std::string strtoken(queue_status);
-		readBuffer.erase(0, pos + delimiter.length());
+bool ServerInfo::StreamedLoadStatus(ServerLoadStatus* load_status)
+{
+	std::lock_guard<std::mutex> lock(load_stream_mtx);
+	if(streamed_time == 0 || streamed_time + LOAD_STREAM_EXPIRY_MS < get_current_unixtime()) {
+		return false;
 	}
-	
-	parsed.push_back(readBuffer);
+	*load_status = streamed_status;
+	return true;
+}
 
-	percentile.clear();
-	server_information_send_time = std::stol(parsed[0]);
-	server_information_update_time = std::stol(parsed[1]);
-	server_information_refresh_time = get_current_unixtime();
-	average_interval = std::stod(parsed[2]);
-	average_throughput = std::stod(parsed[3]);
-	average_batch = std::stod(parsed[4]);
-	average_infer_time = std::stod(parsed[5]);
-        average_queue_time = std::stod(parsed[6]);	
-	for(int i = 7; i < 17; i++)
-	{
-		percentile.push_back(std::stod(parsed[i]));
+void ServerInfo::GetServerInfo()
+{
+	// Use the streamed load while it is fresh, otherwise ask the
+	// server, which also refreshes the RTT.
+	ServerLoadStatus load_status;
+	if(!StreamedLoadStatus(&load_status) && !FetchLoadStatus(&load_status)) {
+		return;
 	}
-	CURRENT_SERVER_CAPACITY = std::stoi(parsed[17]);
+	ApplyLoadStatus(load_status);
+}
+
+void ServerInfo::ApplyLoadStatus(const ServerLoadStatus& load_status)
+{
+	server_information_send_time = load_status.status_us;
+	server_information_update_time = load_status.update_us;
+	server_information_refresh_time = get_current_unixtime();
+	average_interval = load_status.average_interval_ms;
+	average_throughput = load_status.average_throughput;
+	average_batch = load_status.average_batch_size;
+	average_infer_time = load_status.average_infer_ms;
+	average_queue_time = load_status.average_queue_ms;
+	percentile.assign(
+		load_status.queue_percentile_ms,
+		load_status.queue_percentile_ms + SERVER_LOAD_PERCENTILE_COUNT);
+	queue_depth.assign(
+		load_status.queue_depth,
+		load_status.queue_depth + SERVER_LOAD_MAX_POINTS);
+	queue_sketch.assign(
+		load_status.queue_time_sketch,
+		load_status.queue_time_sketch + SERVER_LOAD_SKETCH_BUCKETS);
+	CURRENT_SERVER_CAPACITY = (int)load_status.available_ingress_mbps;
+	split_point_mask = load_status.split_point_mask;
 	
 
 	if(isServerInfoExpired())
@@ -147,31 +247,139 @@ void ServerInfo::GetServerInfo()
 
 double ServerInfo::GetServerInfoNoRefresh()
 {
-	std::string readBuffer;
+	FetchLoadStatus(nullptr);
+	return current_measured_rtt;
+}
 
-	CURL *ctx = curl_easy_init();
-	std::string status_url = std::string(SERVER_STATUS_URL)+std::string(SERVER_STATUS_PATH);
-	curl_easy_setopt(ctx, CURLOPT_URL, status_url.c_str());
-	curl_easy_setopt(ctx, CURLOPT_NOPROGRESS, OPTION_TRUE);
-	curl_easy_setopt(ctx, CURLOPT_WRITEFUNCTION, WriteCallback);
-	curl_easy_setopt(ctx, CURLOPT_WRITEDATA, (void *) &readBuffer);
-	curl_easy_setopt(ctx, CURLOPT_TCP_NODELAY, 1L);
+struct LoadStreamContext {
+	std::string buffer;
+	std::function<void(const std::string&)> on_event;
+	std::atomic<bool>* exit;
+};
 
-	std::chrono::steady_clock::time_point getstatus_start = std::chrono::steady_clock::now();
-	const CURLcode rc = curl_easy_perform(ctx);
-	std::chrono::steady_clock::time_point getstatus_end = std::chrono::steady_clock::now();
-	double current_rtt = std::chrono::duration_cast<std::chrono::microseconds>(getstatus_end - getstatus_start).count()/1000.0 /2; 
-	current_measured_rtt = current_rtt;
-	return current_rtt;
+static size_t LoadStreamWriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+	LoadStreamContext* ctx = (LoadStreamContext*) userp;
+	ctx->buffer.append((char *) contents, size * nmemb);
+
+	// Events are separated by an empty line, the load is in the data
+	// line of the event.
+	size_t end;
+	while((end = ctx->buffer.find("\n\n")) != std::string::npos) {
+		std::string event = ctx->buffer.substr(0, end);
+		ctx->buffer.erase(0, end + 2);
+		size_t data = event.find("data: ");
+		if(data != std::string::npos) {
+			ctx->on_event(event.substr(data + 6));
+		}
+	}
+	return size * nmemb;
 }
 
+static int LoadStreamProgressCallback(void *userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	// Returning non-zero aborts the transfer.
+	return ((LoadStreamContext*) userp)->exit->load() ? 1 : 0;
+}
+
+void ServerInfo::StartLoadStream()
+{
+	if(load_stream_thread.joinable()) {
+		return;
+	}
+	load_stream_exit = false;
+	load_stream_thread = std::thread(&ServerInfo::LoadStreamLoop, this);
+}
+
+void ServerInfo::StopLoadStream()
+{
+	load_stream_exit = true;
+	if(load_stream_thread.joinable()) {
+		load_stream_thread.join();
+	}
+}
+
+void ServerInfo::LoadStreamLoop()
+{
+	LoadStreamContext ctx;
+	ctx.exit = &load_stream_exit;
+	ctx.on_event = [this](const std::string& data) {
+		ServerLoadStatus load_status;
+		if(ParseLoadStatus(Base64Decode(data), &load_status)) {
+			std::lock_guard<std::mutex> lock(load_stream_mtx);
+			streamed_status = load_status;
+			streamed_time = get_current_unixtime();
+		}
+	};
+
+	std::string stream_url = "http://"+url+std::string(LOAD_STREAM_PATH);
+	CURL *curl = curl_easy_init();
+	curl_easy_setopt(curl, CURLOPT_URL, stream_url.c_str());
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, LoadStreamWriteCallback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) &ctx);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, OPTION_FALSE);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, LoadStreamProgressCallback);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *) &ctx);
+	curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+	while(!load_stream_exit) {
+		ctx.buffer.clear();
+		const CURLcode rc = curl_easy_perform(curl);
+		if(load_stream_exit) {
+			break;
+		}
+		std::cerr << "Server load stream ended: " << curl_easy_strerror(rc) << std::endl;
+		std::this_thread::sleep_for(std::chrono::milliseconds(LOAD_STREAM_RETRY_MS));
+	}
+	curl_easy_cleanup(curl);
+}
 
+bool is_split_point(uint64_t split_point_mask, int point, int point_count)
+{
+	if(point >= point_count - 1) {
+		return true;
+	}
+	const int bit = std::min(std::max(point, 0), SERVER_LOAD_MAX_POINTS - 1);
+	return (split_point_mask >> bit) & 1;
+}
 
 void ServerInfo::ResetServerInfo()
 {
 	average_infer_time = 0;
 	average_queue_time = 0;
 	std::fill(percentile.begin(), percentile.end(), 0);
+	queue_sketch.clear();
+}
+
+double ServerInfo::QueueTimeCDF(double ms) const
+{
+	if(queue_sketch.empty()) {
+		return -1;
+	}
+	if(ms < 0) {
+		return 0;
+	}
+
+	// Bucket i holds times in (lower, upper], interpolate linearly in
+	// the bucket holding 'ms'.
+	double total = std::accumulate(queue_sketch.begin(), queue_sketch.end(), 0.0);
+	if(total <= 0) {
+		return 100;
+	}
+	double below = 0;
+	double lower = 0;
+	double upper = SERVER_LOAD_SKETCH_MIN_MS;
+	for(size_t i = 0; i < queue_sketch.size(); i++) {
+		if(ms <= upper || i == queue_sketch.size() - 1) {
+			double fraction = std::min(1.0, (ms - lower) / (upper - lower));
+			return (below + queue_sketch[i] * fraction) / total * 100;
+		}
+		below += queue_sketch[i];
+		lower = upper;
+		upper *= SERVER_LOAD_SKETCH_GAMMA;
+	}
+	return 100;
 }
 void ServerInfo::SetServerInfo(double a, double b, double c, double d, double e)
 {
@@ -182,7 +390,28 @@ void ServerInfo::SetServerInfo(double a, double b, double c, double d, double e)
 	average_queue_time = e;
 }
 
-bool ServerInfo::isMyInfoExpired()
+void ServerInfo::SetPartitionHint(int min_point, int max_point)
+{
+	hint_min_point = min_point;
+	hint_max_point = max_point;
+	// Seeded per thread, so the clients draw different expiries.
+	static thread_local std::mt19937 rng(std::random_device{}());
+	std::uniform_real_distribution<double> jitter(0.5, 1.5);
+	hint_expiry_time = get_current_unixtime() + (uint64_t)(PARTITION_HINT_EXPIRY_MS * jitter(rng));
+}
+
+bool ServerInfo::PartitionHint(int* min_point, int* max_point) const
+{
+	if(hint_min_point < 0 || hint_expiry_time < get_current_unixtime())
+	{
+		return false;
+	}
+	*min_point = hint_min_point;
+	*max_point = hint_max_point;
+	return true;
+}
+
+bool ServerInfo::isMyInfoExpired() const
 {
 	uint64_t current_time = get_current_unixtime();
 	if(server_information_refresh_time+1000 < current_time )
@@ -4,6 +4,46 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Mirrors TRITONSERVER_LoadStatus as returned by GET /v2/load.
+#define SERVER_LOAD_STATUS_VERSION 4
+#define SERVER_LOAD_PERCENTILE_COUNT 10
+#define SERVER_LOAD_MAX_POINTS 64
+#define SERVER_LOAD_SKETCH_BUCKETS 128
+#define SERVER_LOAD_SKETCH_MIN_MS 0.1
+#define SERVER_LOAD_SKETCH_GAMMA 1.105
+// A recommended range of partitioning points is followed for this
+// long, give or take half, so that the clients the server steered
+// together don't all return to deciding alone at once.
+#define PARTITION_HINT_EXPIRY_MS 1000
+struct ServerLoadStatus {
+	uint32_t version;
+	uint32_t batch_count;
+	uint64_t status_us;
+	uint64_t update_us;
+	double average_interval_ms;
+	double average_throughput;
+	double average_batch_size;
+	double average_infer_ms;
+	double average_queue_ms;
+	double queue_percentile_ms[SERVER_LOAD_PERCENTILE_COUNT];
+	double available_ingress_mbps;
+	uint64_t split_point_mask;
+	uint32_t queue_depth[SERVER_LOAD_MAX_POINTS];
+	float queue_time_sketch[SERVER_LOAD_SKETCH_BUCKETS];
+};
+static_assert(sizeof(ServerLoadStatus) == 928, "ServerLoadStatus layout must match the server");
+
+// Whether a request may start at 'point' of a model of 'point_count'
+// points on a server publishing 'split_point_mask'. The last point,
+// executing the whole model locally, always may.
+bool is_split_point(uint64_t split_point_mask, int point, int point_count);
 
 class ServerInfo{
 
@@ -25,9 +65,17 @@ class ServerInfo{
 		double queueing;
 		std::vector<double> rtt_history;
 		double rtt;
-		int link_capacity;
+		double link_capacity;
+		// The host:port of the server, as the inference requests are sent to.
+		std::string url;
 		ServerInfo();
+		explicit ServerInfo(const std::string& server_url);
+		~ServerInfo();
 		void GetServerInfo();
+		// Keep the latest server load pushed by GET /v2/load/stream so
+		// GetServerInfo() doesn't need a round trip while it is fresh.
+		void StartLoadStream();
+		void StopLoadStream();
 		void init();					
 		void RTTrefresh(double current_rtt);
 		void SetServerInfo(double a, double b, double c, double d, double e);
@@ -39,7 +87,7 @@ class ServerInfo{
 	//	std::vector<int> server_queue_status;
 	//	std::vector<int> server_arrival_rate;
 		
-		bool isMyInfoExpired();
+		bool isMyInfoExpired() const;
 		bool isServerInfoExpired();
 		double GetServerInfoNoRefresh();	
 		bool isServerInfoExpiredResult;
@@ -52,5 +100,35 @@ class ServerInfo{
 		double last_batch;
 		double last_server_infertime;
 		std::vector<double> percentile;
+		std::vector<uint32_t> queue_depth; // per partitioning point
+		std::vector<double> queue_sketch; // queueing time weight per sketch bucket
+		uint64_t split_point_mask; // bit i set if the server accepts point i
+		// Percentage of queueing times up to 'ms', or -1 without a sketch.
+		double QueueTimeCDF(double ms) const;
+		// Keep the range of partitioning points the server recommended
+		// in its latest response.
+		void SetPartitionHint(int min_point, int max_point);
+		// The recommended range, return false if there is none or it
+		// expired.
+		bool PartitionHint(int* min_point, int* max_point) const;
+		int hint_min_point;
+		int hint_max_point;
+		uint64_t hint_expiry_time;
+
+	private:
+		bool FetchLoadStatus(ServerLoadStatus* load_status);
+		bool StreamedLoadStatus(ServerLoadStatus* load_status);
+		void ApplyLoadStatus(const ServerLoadStatus& load_status);
+		void LoadStreamLoop();
+
+		// The handle reused to poll the server.
+		std::mutex status_mtx;
+		void *status_curl;
+
+		std::thread load_stream_thread;
+		std::atomic<bool> load_stream_exit;
+		std::mutex load_stream_mtx;
+		ServerLoadStatus streamed_status;
+		uint64_t streamed_time; // ms, 0 if nothing was streamed
 };
 #endif
@@ -0,0 +1,410 @@
+#include "activation_codec.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#define PROFILE_INTERVAL 32
+#define PROFILE_WEIGHT 0.2 // weight of a new sample in the profile
+
+#define LZ_HASH_LOG 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 5 // the block ends with at least these literals
+#define LZ_MATCH_LIMIT 12 // no match starts within these last bytes
+
+const char* encoding_name(Encoding encoding)
+{
+	switch(encoding)
+	{
+		case ENCODING_SPARSE:
+			return "sparse";
+		case ENCODING_LZ:
+			return "lz";
+		case ENCODING_JPEG:
+			return "jpeg";
+		default:
+			return "raw";
+	}
+}
+
+static bool is_zero(const uint8_t* element, size_t element_size)
+{
+	switch(element_size)
+	{
+		case 1:
+			return *element == 0;
+		case 2:
+		{
+			uint16_t v;
+			std::memcpy(&v, element, 2);
+			return v == 0;
+		}
+		case 4:
+		{
+			uint32_t v;
+			std::memcpy(&v, element, 4);
+			return v == 0;
+		}
+		default:
+			for(size_t i = 0; i < element_size; i++)
+				if(element[i] != 0)
+					return false;
+			return true;
+	}
+}
+
+void encode_sparse(const uint8_t* src, size_t byte_size, size_t element_size, std::vector<uint8_t>& out)
+{
+	size_t count = byte_size / element_size;
+	size_t bitmap_size = (count + 7) / 8;
+	out.assign(bitmap_size, 0);
+	out.reserve(byte_size + bitmap_size);
+	for(size_t i = 0; i < count; i++)
+	{
+		const uint8_t* element = src + i * element_size;
+		if(!is_zero(element, element_size))
+		{
+			out[i / 8] |= (uint8_t)(1 << (i % 8));
+			out.insert(out.end(), element, element + element_size);
+		}
+	}
+}
+
+bool decode_sparse(const uint8_t* src, size_t src_byte_size, size_t element_size, uint8_t* dst, size_t dst_byte_size)
+{
+	size_t count = dst_byte_size / element_size;
+	size_t bitmap_size = (count + 7) / 8;
+	if(src_byte_size < bitmap_size)
+		return false;
+
+	const uint8_t* values = src + bitmap_size;
+	const uint8_t* values_end = src + src_byte_size;
+	std::memset(dst, 0, dst_byte_size);
+	for(size_t byte = 0; byte < bitmap_size; byte++)
+	{
+		uint8_t bits = src[byte];
+		while(bits != 0)
+		{
+			size_t i = byte * 8 + __builtin_ctz(bits);
+			if(i >= count || (size_t)(values_end - values) < element_size)
+				return false;
+			std::memcpy(dst + i * element_size, values, element_size);
+			values += element_size;
+			bits &= bits - 1;
+		}
+	}
+	return values == values_end;
+}
+
+static void lz_put_length(std::vector<uint8_t>& out, size_t length)
+{
+	while(length >= 255)
+	{
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back((uint8_t)length);
+}
+
+static void lz_put_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length)
+{
+	size_t match_code = (match_length == 0) ? 0 : match_length - LZ_MIN_MATCH;
+	out.push_back((uint8_t)(((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15)));
+	if(literal_length >= 15)
+		lz_put_length(out, literal_length - 15);
+	out.insert(out.end(), literals, literals + literal_length);
+	if(match_length == 0)
+		return;
+	out.push_back((uint8_t)(offset & 0xff));
+	out.push_back((uint8_t)(offset >> 8));
+	if(match_code >= 15)
+		lz_put_length(out, match_code - 15);
+}
+
+static uint32_t lz_read32(const uint8_t* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+void encode_lz(const uint8_t* src, size_t byte_size, std::vector<uint8_t>& out)
+{
+	out.clear();
+	out.reserve(byte_size + byte_size / 255 + 16);
+
+	// Greedy matching of the latest position with the same 4 bytes
+	// hash. The search skips ahead faster the longer it finds nothing,
+	// so incompressible data is passed over quickly.
+	std::vector<uint32_t> table(1 << LZ_HASH_LOG, 0);
+	size_t anchor = 0;
+	size_t ip = 1;
+	size_t misses = 0;
+	if(byte_size > LZ_MATCH_LIMIT)
+	{
+		size_t limit = byte_size - LZ_MATCH_LIMIT;
+		while(ip < limit)
+		{
+			uint32_t sequence = lz_read32(src + ip);
+			uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_LOG);
+			size_t ref = table[hash];
+			table[hash] = (uint32_t)ip;
+			if(ref < ip && ip - ref <= LZ_MAX_OFFSET && lz_read32(src + ref) == sequence)
+			{
+				size_t length = LZ_MIN_MATCH;
+				size_t max_length = byte_size - LZ_LAST_LITERALS - ip;
+				while(length < max_length && src[ref + length] == src[ip + length])
+					length++;
+				lz_put_sequence(out, src + anchor, ip - anchor, ip - ref, length);
+				ip += length;
+				anchor = ip;
+				misses = 0;
+			}
+			else
+			{
+				ip += 1 + (misses++ >> 6);
+			}
+		}
+	}
+	lz_put_sequence(out, src + anchor, byte_size - anchor, 0, 0);
+}
+
+bool decode_lz(const uint8_t* src, size_t src_byte_size, uint8_t* dst, size_t dst_byte_size)
+{
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_byte_size;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_byte_size;
+	while(ip < iend)
+	{
+		uint8_t token = *ip++;
+		size_t literal_length = token >> 4;
+		if(literal_length == 15)
+		{
+			uint8_t extra;
+			do
+			{
+				if(ip >= iend)
+					return false;
+				extra = *ip++;
+				literal_length += extra;
+			} while(extra == 255);
+		}
+		if((size_t)(iend - ip) < literal_length || (size_t)(oend - op) < literal_length)
+			return false;
+		std::memcpy(op, ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		if(ip == iend)
+			break;
+
+		if(iend - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (size_t)(op - dst))
+			return false;
+		size_t match_length = token & 15;
+		if(match_length == 15)
+		{
+			uint8_t extra;
+			do
+			{
+				if(ip >= iend)
+					return false;
+				extra = *ip++;
+				match_length += extra;
+			} while(extra == 255);
+		}
+		match_length += LZ_MIN_MATCH;
+		if((size_t)(oend - op) < match_length)
+			return false;
+		const uint8_t* match = op - offset;
+		for(size_t i = 0; i < match_length; i++)
+			*op++ = *match++;
+	}
+	return op == oend;
+}
+
+CodecProfile& CodecProfile::Instance()
+{
+	static CodecProfile profile;
+	return profile;
+}
+
+CodecProfile::CodecProfile()
+	: enabled(false), image_enabled(false), revision(0)
+{
+	const char* env = std::getenv("DIAMOND_ACTIVATION_CODEC");
+	enabled = (env != nullptr) && (std::strcmp(env, "0") != 0);
+	env = std::getenv("DIAMOND_JPEG_INPUT");
+	image_enabled = (env != nullptr) && (std::strcmp(env, "0") != 0);
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void encode(Encoding encoding, const uint8_t* data, size_t byte_size, size_t element_size, std::vector<uint8_t>& encoded)
+{
+	if(encoding == ENCODING_SPARSE)
+		encode_sparse(data, byte_size, element_size, encoded);
+	else if(encoding == ENCODING_LZ)
+		encode_lz(data, byte_size, encoded);
+}
+
+void CodecProfile::Update(Cost& cost, double ratio, double encode_ms, double decode_ms)
+{
+	revision++;
+	if(!cost.valid)
+	{
+		cost.valid = true;
+		cost.ratio = ratio;
+		cost.encode_ms = encode_ms;
+		cost.decode_ms = decode_ms;
+	}
+	else
+	{
+		cost.ratio += PROFILE_WEIGHT * (ratio - cost.ratio);
+		cost.encode_ms += PROFILE_WEIGHT * (encode_ms - cost.encode_ms);
+		cost.decode_ms += PROFILE_WEIGHT * (decode_ms - cost.decode_ms);
+	}
+}
+
+CodecProfile::Point& CodecProfile::GetPoint(int point)
+{
+	auto it = points.find(point);
+	if(it == points.end())
+	{
+		it = points.emplace(point, Point()).first;
+		std::memset(&it->second, 0, sizeof(Point));
+		Cost& raw = it->second.cost[ENCODING_RAW];
+		raw.valid = true;
+		raw.ratio = 1;
+	}
+	return it->second;
+}
+
+void CodecProfile::Profile(Point& profile, const uint8_t* data, size_t byte_size, size_t element_size)
+{
+	std::vector<uint8_t> encoded;
+	std::vector<uint8_t> decoded(byte_size);
+	for(int e = ENCODING_SPARSE; e <= ENCODING_LZ; e++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		encode((Encoding)e, data, byte_size, element_size, encoded);
+		double encode_ms = elapsed_ms(start);
+
+		start = std::chrono::steady_clock::now();
+		if(e == ENCODING_SPARSE)
+			decode_sparse(encoded.data(), encoded.size(), element_size, decoded.data(), byte_size);
+		else
+			decode_lz(encoded.data(), encoded.size(), decoded.data(), byte_size);
+		double decode_ms = elapsed_ms(start);
+
+		double ratio = (byte_size == 0) ? 1 : (double)encoded.size() / byte_size;
+		Update(profile.cost[e], ratio, encode_ms, decode_ms);
+	}
+	profile.dense_byte_size = byte_size;
+}
+
+Encoding CodecProfile::Best(const Point& profile, double link, bool image) const
+{
+	Encoding best = ENCODING_RAW;
+	double best_cost = -1;
+	for(int e = ENCODING_RAW; e < ENCODING_COUNT; e++)
+	{
+		const Cost& cost = profile.cost[e];
+		if(!cost.valid || (e == ENCODING_JPEG && !image))
+			continue;
+		double bytes = cost.ratio * profile.dense_byte_size;
+		// Without a link estimate the transfer time is unknown, so the
+		// encoding sending the fewest bytes wins whatever its times.
+		double total;
+		if(link > 0)
+			total = cost.encode_ms + (bytes * 8) / (link * 1024 * 1024) * 1000 + cost.decode_ms;
+		else
+			total = bytes;
+		if(best_cost < 0 || total < best_cost)
+		{
+			best = (Encoding)e;
+			best_cost = total;
+		}
+	}
+	return best;
+}
+
+Encoding CodecProfile::Encode(int point, double link, const void* data, size_t byte_size, size_t element_size, std::vector<uint8_t>& encoded)
+{
+	if(!enabled)
+		return ENCODING_RAW;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	Encoding encoding;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Point& profile = GetPoint(point);
+		if(profile.count++ % PROFILE_INTERVAL == 0)
+			Profile(profile, bytes, byte_size, element_size);
+		// Called when the image isn't sent, even if it would win.
+		encoding = Best(profile, link, false);
+	}
+
+	encode(encoding, bytes, byte_size, element_size, encoded);
+	return encoding;
+}
+
+void CodecProfile::ProfileImage(uint64_t image_byte_size, uint64_t dense_byte_size, double encode_ms, double decode_ms)
+{
+	if(!image_enabled || dense_byte_size == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	Point& profile = GetPoint(0);
+	profile.dense_byte_size = dense_byte_size;
+	Update(profile.cost[ENCODING_JPEG], (double)image_byte_size / dense_byte_size, encode_ms, decode_ms);
+}
+
+bool CodecProfile::SendImage(int point, double link)
+{
+	if(!image_enabled || point != 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = points.find(point);
+	return it != points.end() && Best(it->second, link, true) == ENCODING_JPEG;
+}
+
+double CodecProfile::EncodedBytes(int point, uint64_t dense_byte_size, double link)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = points.find(point);
+	if(it == points.end())
+		return dense_byte_size;
+	return it->second.cost[Best(it->second, link, true)].ratio * dense_byte_size;
+}
+
+double CodecProfile::EncodeMs(int point, double link)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = points.find(point);
+	if(it == points.end())
+		return 0;
+	return it->second.cost[Best(it->second, link, true)].encode_ms;
+}
+
+double CodecProfile::DecodeMs(int point, double link)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = points.find(point);
+	if(it == points.end())
+		return 0;
+	return it->second.cost[Best(it->second, link, true)].decode_ms;
+}
+
+uint64_t CodecProfile::Revision()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return revision;
+}
@@ -0,0 +1,117 @@
+#ifndef ACTIVATION_CODEC_H
+#define ACTIVATION_CODEC_H
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// The encodings an activation can be sent in, decoded by the server
+// while it collects the batch. SPARSE is a bitmap with one bit per
+// element, set for the elements that are not zero, followed by those
+// elements. LZ is the LZ4 block format. JPEG is the image the input is
+// computed from, sent in place of the input at partitioning point 0.
+enum Encoding
+{
+	ENCODING_RAW,
+	ENCODING_SPARSE,
+	ENCODING_LZ,
+	ENCODING_JPEG,
+	ENCODING_COUNT
+};
+
+// The name of 'encoding' in the request, "raw", "sparse", "lz" or
+// "jpeg".
+const char* encoding_name(Encoding encoding);
+
+void encode_sparse(const uint8_t* src, size_t byte_size, size_t element_size, std::vector<uint8_t>& out);
+bool decode_sparse(const uint8_t* src, size_t src_byte_size, size_t element_size, uint8_t* dst, size_t dst_byte_size);
+void encode_lz(const uint8_t* src, size_t byte_size, std::vector<uint8_t>& out);
+bool decode_lz(const uint8_t* src, size_t src_byte_size, uint8_t* dst, size_t dst_byte_size);
+
+// Keeps, for each partitioning point, how well each encoding does on
+// the activation at that point. The encoding that wins depends on the
+// link, each server is on its own.
+// Enabled by the DIAMOND_ACTIVATION_CODEC environment variable, the
+// server must support the encodings. Otherwise every activation is
+// sent raw. Sending the image at point 0 is enabled by the
+// DIAMOND_JPEG_INPUT environment variable, the model on the server
+// must accept it.
+class CodecProfile
+{
+	public:
+		static CodecProfile& Instance();
+
+		bool Enabled() const { return enabled; }
+		bool ImageEnabled() const { return image_enabled; }
+
+		// Encode the 'byte_size' bytes at 'data', elements of
+		// 'element_size' bytes, activation at 'point', with the
+		// encoding chosen for the point on a link of 'link' Mbps, 0
+		// if there is no estimate. The first activation at a
+		// point and every PROFILE_INTERVAL-th are encoded, and
+		// decoded, with every encoding to update the profile. Return
+		// the encoding used, 'encoded' holds the encoded bytes unless
+		// it is ENCODING_RAW.
+		Encoding Encode(int point, double link, const void* data, size_t byte_size, size_t element_size, std::vector<uint8_t>& encoded);
+
+		// Update the profile of sending, at point 0, an image of
+		// 'image_byte_size' bytes in place of the input of
+		// 'dense_byte_size' bytes, taking 'encode_ms' to encode and
+		// 'decode_ms' to decode.
+		void ProfileImage(uint64_t image_byte_size, uint64_t dense_byte_size, double encode_ms, double decode_ms);
+
+		// Whether the image is sent in place of the activation at
+		// 'point' on a link of 'link' Mbps, rather than the activation
+		// encoded by Encode().
+		bool SendImage(int point, double link);
+
+		// The bytes sent for an activation of 'dense_byte_size' bytes
+		// at 'point', and the time, in ms, to encode and to decode it
+		// with the encoding that minimizes its encode, transfer and
+		// decode time on a link of 'link' Mbps. The client profiles
+		// every point at startup, a point it didn't is taken as sent
+		// raw.
+		double EncodedBytes(int point, uint64_t dense_byte_size, double link);
+		double EncodeMs(int point, double link);
+		double DecodeMs(int point, double link);
+
+		// Changes whenever the profile does, so the values above can
+		// be cached for a link until it does.
+		uint64_t Revision();
+
+	private:
+		CodecProfile();
+
+		struct Cost
+		{
+			bool valid;
+			double ratio; // encoded bytes per dense byte
+			double encode_ms;
+			// Timed on the client, the server decodes with the same
+			// code so its time is taken as an estimate of the server's.
+			double decode_ms;
+		};
+
+		struct Point
+		{
+			Cost cost[ENCODING_COUNT];
+			uint64_t dense_byte_size;
+			uint64_t count;
+		};
+
+		void Profile(Point& profile, const uint8_t* data, size_t byte_size, size_t element_size);
+		void Update(Cost& cost, double ratio, double encode_ms, double decode_ms);
+		Point& GetPoint(int point);
+		// The encoding of 'profile' that is fastest on 'link', among
+		// the ones Encode() applies unless 'image'. The one sending the
+		// fewest bytes if there is no link estimate, 'link' <= 0.
+		Encoding Best(const Point& profile, double link, bool image) const;
+
+		bool enabled;
+		bool image_enabled;
+		uint64_t revision;
+		std::mutex mtx;
+		std::map<int, Point> points;
+};
+#endif
@@ -0,0 +1,103 @@
+#include "bandwidth_estimator.h"
+#include <algorithm>
+#include <cmath>
+
+#define BYTE_PER_SECOND_TO_MBPS (8.0 / 1024 / 1024)
+
+BandwidthEstimator::BandwidthEstimator()
+{
+	Reset();
+}
+
+void BandwidthEstimator::Reset()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	samples.clear();
+	min_rtt_ms = 0;
+	min_rtt_time_ms = 0;
+	bytes_acked = 0;
+}
+
+void BandwidthEstimator::Expire(uint64_t now_ms)
+{
+	while(!samples.empty() && samples.front().time_ms + BANDWIDTH_WINDOW_MS < now_ms)
+		samples.pop_front();
+	if(min_rtt_time_ms + MIN_RTT_WINDOW_MS < now_ms)
+		min_rtt_ms = 0;
+}
+
+void BandwidthEstimator::AddRate(double mbps, bool app_limited, uint64_t now_ms)
+{
+	Expire(now_ms);
+	if(app_limited)
+	{
+		for(const Sample& sample : samples)
+		{
+			if(sample.mbps >= mbps)
+				return;
+		}
+	}
+	samples.push_back(Sample{mbps, now_ms});
+	if(samples.size() > BANDWIDTH_WINDOW_SAMPLES)
+		samples.pop_front();
+}
+
+void BandwidthEstimator::AddTcpInfo(const TcpDeliveryInfo& info, uint64_t now_ms)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	// Without new data acked the delivery rate is the one sampled
+	// already. The count restarts on a new connection.
+	if(info.tcpi_bytes_acked == bytes_acked)
+		return;
+	bytes_acked = info.tcpi_bytes_acked;
+
+	if(info.tcpi_min_rtt != 0)
+	{
+		double rtt_ms = info.tcpi_min_rtt / 1000.0;
+		if(min_rtt_ms == 0 || rtt_ms <= min_rtt_ms || min_rtt_time_ms + MIN_RTT_WINDOW_MS < now_ms)
+		{
+			min_rtt_ms = rtt_ms;
+			min_rtt_time_ms = now_ms;
+		}
+	}
+	if(info.tcpi_delivery_rate != 0)
+		AddRate(info.tcpi_delivery_rate * BYTE_PER_SECOND_TO_MBPS, info.AppLimited(), now_ms);
+}
+
+void BandwidthEstimator::AddTransfer(uint64_t bytes, double ms, uint64_t now_ms)
+{
+	if(bytes == 0 || ms <= 0)
+		return;
+	std::lock_guard<std::mutex> lock(mtx);
+	AddRate(bytes / (ms / 1000) * BYTE_PER_SECOND_TO_MBPS, false, now_ms);
+}
+
+bool BandwidthEstimator::GetEstimate(uint64_t now_ms, Estimate* estimate)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	Expire(now_ms);
+	if(samples.empty())
+		return false;
+
+	double max = 0;
+	double min = samples.front().mbps;
+	double sum = 0;
+	for(const Sample& sample : samples)
+	{
+		max = std::max(max, sample.mbps);
+		min = std::min(min, sample.mbps);
+		sum += sample.mbps;
+	}
+	double mean = sum / samples.size();
+	double variance = 0;
+	for(const Sample& sample : samples)
+		variance += (sample.mbps - mean) * (sample.mbps - mean);
+	double deviation = (samples.size() > 1) ? std::sqrt(variance / (samples.size() - 1)) : 0;
+
+	estimate->bandwidth_mbps = max;
+	estimate->lower_mbps = std::max(min, mean - BANDWIDTH_INTERVAL_Z * deviation);
+	estimate->upper_mbps = std::min(max, mean + BANDWIDTH_INTERVAL_Z * deviation);
+	estimate->min_rtt_ms = min_rtt_ms;
+	estimate->samples = samples.size();
+	return true;
+}
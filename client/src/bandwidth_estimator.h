@@ -0,0 +1,92 @@
+#ifndef BANDWIDTH_ESTIMATOR_H
+#define BANDWIDTH_ESTIMATOR_H
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+
+// The tcp_info of the kernel up to the delivery rate (Linux 4.9). The
+// fields glibc doesn't know follow its struct tcp_info.
+struct TcpDeliveryInfo
+{
+	struct tcp_info info;
+	uint64_t tcpi_pacing_rate;
+	uint64_t tcpi_max_pacing_rate;
+	uint64_t tcpi_bytes_acked;
+	uint64_t tcpi_bytes_received;
+	uint32_t tcpi_segs_out;
+	uint32_t tcpi_segs_in;
+	uint32_t tcpi_notsent_bytes;
+	uint32_t tcpi_min_rtt; // us
+	uint32_t tcpi_data_segs_in;
+	uint32_t tcpi_data_segs_out;
+	uint64_t tcpi_delivery_rate; // byte per second
+
+	// Whether the sender ran out of data during the delivery rate
+	// sample, in the byte glibc leaves as padding.
+	bool AppLimited() const { return (reinterpret_cast<const uint8_t*>(&info)[7] & 1) != 0; }
+};
+static_assert(offsetof(TcpDeliveryInfo, tcpi_pacing_rate) == 104, "TcpDeliveryInfo layout must match the kernel");
+static_assert(offsetof(TcpDeliveryInfo, tcpi_delivery_rate) == 160, "TcpDeliveryInfo layout must match the kernel");
+
+#define BANDWIDTH_WINDOW_SAMPLES 10
+#define BANDWIDTH_WINDOW_MS 10000
+#define MIN_RTT_WINDOW_MS 10000
+#define BANDWIDTH_INTERVAL_Z 1.645 // the central 90% of the delivery rates
+
+// Estimates the uplink to the server like BBR does, from the delivery
+// rate of the transfers: the bandwidth is the maximum delivery rate of
+// the latest samples and the RTT the minimum RTT of the latest 10 s.
+// A delivery rate sample of a sender that ran out of data only counts
+// if it is higher than the bandwidth. The delivery rates of the
+// samples give the interval the next transfer's falls in.
+class BandwidthEstimator
+{
+	public:
+		// Links are in Mbps of 1024 * 1024 bits, times in ms.
+		struct Estimate
+		{
+			double bandwidth_mbps;
+			double lower_mbps;
+			double upper_mbps;
+			double min_rtt_ms;
+			int samples;
+		};
+
+		BandwidthEstimator();
+
+		// Add the state of the connection after a transfer, at 'now_ms'.
+		void AddTcpInfo(const TcpDeliveryInfo& info, uint64_t now_ms);
+		// Add a transfer of 'bytes' that took 'ms', for when the kernel
+		// doesn't report the delivery rate.
+		void AddTransfer(uint64_t bytes, double ms, uint64_t now_ms);
+
+		// The estimate at 'now_ms'. Return false without a sample in
+		// the window.
+		bool GetEstimate(uint64_t now_ms, Estimate* estimate);
+
+		void Reset();
+
+	private:
+		struct Sample
+		{
+			double mbps;
+			uint64_t time_ms;
+		};
+
+		void AddRate(double mbps, bool app_limited, uint64_t now_ms);
+		void Expire(uint64_t now_ms);
+
+		std::mutex mtx;
+		std::deque<Sample> samples;
+		double min_rtt_ms; // 0 if unknown
+		uint64_t min_rtt_time_ms;
+		// The bytes acked on the connection at the latest sample, a
+		// sample without new ones doesn't tell anything new.
+		uint64_t bytes_acked;
+};
+#endif
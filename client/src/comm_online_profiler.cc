@@ -4,6 +4,9 @@
 #include <algorithm>
 #include <vector>
 #include "util.h"
+#include "send_request.h"
+#include "transfer_format.h"
+#include "activation_codec.h"
 
 /*Communication::Communication(struct tcp_info init)
   {
@@ -52,6 +55,8 @@ Communication::Communication(int bottleneck_bw)
 	SERVER_CAPACITY = MAX_SERVER_CAPACITY;
 
 	current_tcp_info.tcpi_snd_ssthresh = 99999999;
+	start_cwnd = init_cwnd;
+	warm_connection = false;
 }
 void Communication::Init(double rtt_ms)
 {
@@ -63,6 +68,25 @@ void Communication::set_tcp_info(struct tcp_info tcpinfo)
 {
 	current_tcp_info = tcpinfo;
 }
+void Communication::set_connection_state(struct tcp_info tcpinfo, uint64_t idle_ms, bool slow_start_after_idle)
+{
+	warm_connection = true;
+	start_cwnd = std::max((double)tcpinfo.tcpi_snd_cwnd, (double)init_cwnd);
+	if(!slow_start_after_idle || tcpinfo.tcpi_rto == 0)
+	{
+		return;
+	}
+
+	// Like the kernel, halve the window for each RTO the connection
+	// was idle, down to the initial window.
+	double rto_ms = tcpinfo.tcpi_rto / 1000.0;
+	double idle = idle_ms;
+	while(idle > rto_ms && start_cwnd > init_cwnd)
+	{
+		start_cwnd = std::max(start_cwnd / 2, (double)init_cwnd);
+		idle -= rto_ms;
+	}
+}
 void Communication::print_info(bool verbose)
 {
 	if(verbose){
@@ -79,7 +103,7 @@ void Communication::get_server_capacity(std::vector<std::vector<int64_t>> shapes
 	double ret=0;
 	for(int i = 0; i < shapes.size() ; i++)
 	{
-		int64_t s = vector_mul(shapes[i]) * 4 * 8 * 10;//bit
+		int64_t s = transfer_byte_size(shapes[i]) * 8 * 10;//bit
 		ret += s * arrival_rate[i]; 
 		std::cout << " s " << s << std::endl;
 	}
@@ -87,67 +111,6 @@ void Communication::get_server_capacity(std::vector<std::vector<int64_t>> shapes
 
 	std::cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>SERVER CAPACITY " << SERVER_CAPACITY << std::endl;
 }
-int Communication::get_LINK(int64_t datasize_as_byte, double comm_time)
-{
-	
-/*
-	//std::cout << "comm " << comm_time <<std::endl;
-	std::vector<double> y_list;
-	std::vector<bool> reach_to_max_rtt_list;
-	int reach_to_max_rtt_point = -1;
-	for(int i = 10; i < MAX_LINK;i++)
-	{
-		bool reach_to_max_rtt;
-		double y = expect_time_with_given_link(datasize_as_byte, i, &reach_to_max_rtt);
-		y_list.push_back(y);
-		reach_to_max_rtt_list.push_back(reach_to_max_rtt);
-		if(reach_to_max_rtt && reach_to_max_rtt_point != -1)
-		{
-			reach_to_max_rtt_point = i;
-		}
-		//std::cout << i << " " <<  y <<  " " << reach_to_max_rtt << std::endl;
-	}
-	std::vector<double> err_list;
-
-	for(int i = 0; i < y_list.size(); i++)
-	{
-		double err = std::abs(y_list[i]-comm_time); // ms
-		err_list.push_back(err);
-	}
-	
-	int min_index = std::min_element(err_list.begin(), err_list.end()) - err_list.begin();
-	if(reach_to_max_rtt_point != -1)
-	{
-		return LINK;
-	}
-	else
-	{
-		return min_index;
-	}	
-	return min_index+10;
-	
-*/
-	int ret = -1; 
-	for(int l = 10; l < 100; l++){
-		//std::cout << "cwnd " << current_tcp_info.tcpi_snd_cwnd << std::endl;
-		double myrtt = ((double)(current_tcp_info.tcpi_snd_cwnd*1448*8)/(double)(l*1024*1024))*1000.0; //XXX 1000*1024, 100*1024
-		double reported_rtt= current_tcp_info.tcpi_rtt / 1000.0; 
-		//std::cout << "my rtt , reported rtt " << myrtt << " " << reported_rtt << std::endl;
-		if(myrtt > reported_rtt)
-		{
-			ret = l;
-		//	std::cout << l << " WALL " << std::endl;
-		}
-	}
-	if(ret == -1)
-	{
-		return 99;
-	}
-	else
-	{
-		return ret;
-	}
-}
 double Communication::expect_time_with_given_link(int64_t datasize_as_byte, int link, bool *reach_to_max_rtt, double measured_rtt)
 {
 	if (datasize_as_byte == 0)
@@ -181,9 +144,9 @@ double Communication::expect_time_with_given_link(int64_t datasize_as_byte, int
 		//std::cout << "remein seg " << num_seg << std::endl;
 		if(count == 0) // Send the first data
 		{
-			sent = init_cwnd;
+			sent = start_cwnd;
 			num_seg = num_seg - sent;
-			current_step_cwnd = init_cwnd;
+			current_step_cwnd = start_cwnd;
 		}
 		else
 		{
@@ -280,24 +243,50 @@ double Communication::expect_time_with_given_link(int64_t datasize_as_byte, int
 //	ret_expected_latency += current_tcp_info.tcpi_rtt / 1000.0; //3way handshake
 //	ret_expected_latency += current_tcp_info.tcpi_rtt / 1000.0; //get result
 
+	// The result takes another round trip, and a new connection one
+	// more for its handshake.
 	ret_expected_latency += measured_rtt;
-ret_expected_latency += measured_rtt;
+	if(!warm_connection)
+	{
+		ret_expected_latency += measured_rtt;
+	}
 	
 	expect_cwnd = current_step_cwnd;
 	//std::cout << "\n" << datasize_as_byte << "  expected cwnd " << expect_cwnd << "count " << count << "ret " << ret_expected_latency << "rtt " << current_tcp_info.tcpi_rtt/1000.0 <<  std::endl;	
 	return ret_expected_latency;
 }
 
-std::vector<double> Communication::expect_time_shapes(std::vector<std::vector<int64_t>> shapes, double link, ServerInfo server_info)
+double Communication::refresh_connection_state(ServerInfo& server_info)
 {
-	std::vector<double> ret;
 	double measured_rtt = server_info.GetServerInfoNoRefresh();
-	std::cout << "measured rtt " << measured_rtt << std::endl;
 	current_measured_rtt = measured_rtt;
+
+	struct tcp_info connection_info;
+	uint64_t idle_ms = 0;
+	ConnectionManager& connections = ConnectionManager::Instance();
+	if(connections.TcpInfo(server_info.url, &connection_info, &idle_ms))
+	{
+		set_connection_state(connection_info, idle_ms, connections.SlowStartAfterIdle());
+	}
+	else
+	{
+		warm_connection = false;
+		start_cwnd = init_cwnd;
+	}
+	return measured_rtt;
+}
+
+std::vector<double> Communication::expect_time_shapes(std::vector<std::vector<int64_t>> shapes, double link, ServerInfo& server_info)
+{
+	std::vector<double> ret;
+	double measured_rtt = refresh_connection_state(server_info);
+	std::cout << "measured rtt " << measured_rtt << std::endl;
+	// Each activation is sent in the encoding that is fastest on 'link'.
+	CodecProfile& codec = CodecProfile::Instance();
 	for (int i = 0; i < shapes.size() ; i++)
 	{
 		bool reach_to_max_rtt;
-		double t = expect_time_with_given_link(vector_mul(shapes[i]) * 4 , link, &reach_to_max_rtt, measured_rtt);
+		double t = expect_time_with_given_link((int64_t)codec.EncodedBytes(i, transfer_byte_size(shapes[i]), link), link, &reach_to_max_rtt, measured_rtt);
 		ret.push_back(t);
 	}
 	return ret;
@@ -1,3 +1,5 @@
+#ifndef COMM_ONLINE_PROFILER_H
+#define COMM_ONLINE_PROFILER_H
 #include <iostream>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -35,22 +37,32 @@ class Communication
 		const int init_cwnd = 10;
 		const int MSS = 1448; // Byte
 		int MAX_LINK;
-		int LINK;
+		double LINK;
 		double naive_link_bps;
 		int MAX_SERVER_CAPACITY;
 		int SERVER_CAPACITY;
 		int MEAN_SERVER_CAPACITY;
 		double expect_cwnd;
 		struct tcp_info current_tcp_info;
+		// The congestion window the next transfer starts with, and
+		// whether it is sent on an open connection.
+		double start_cwnd;
+		bool warm_connection;
 		void print_info(bool verbose);
 		void set_tcp_info(struct tcp_info tcpinfo);
+		// Set the window the next transfer starts with from the state
+		// of its connection, 'idle_ms' after its latest request.
+		void set_connection_state(struct tcp_info tcpinfo, uint64_t idle_ms, bool slow_start_after_idle);
+		// Measure the RTT to 'server_info' and set the window the next
+		// transfer starts with from the connection to it. Return the RTT.
+		double refresh_connection_state(ServerInfo& server_info);
 		double expect_time(int64_t datasize_as_byte, bool verbose);
 		void Init(double rtt_ms);	
-		int get_LINK(int64_t datsize_as_byte, double comm_time);		
 		double expect_time_with_given_link(int64_t datasize_as_byte, int link, bool *reach_to_max_rtt, double measured_rtt);
 		
-		std::vector<double> expect_time_shapes(std::vector<std::vector<int64_t>> shapes, double link, ServerInfo server_info);
+		std::vector<double> expect_time_shapes(std::vector<std::vector<int64_t>> shapes, double link, ServerInfo& server_info);
 		void get_server_capacity(std::vector<std::vector<int64_t>> shapes, std::vector<int> arrival_rate);
 		
 		Communication(int bottleneck_bw);
 };
+#endif
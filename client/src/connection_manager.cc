@@ -0,0 +1,225 @@
+#include "connection_manager.h"
+#include <dirent.h>
+#include <netdb.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "util.h"
+
+#define SLOW_START_AFTER_IDLE_PATH "/proc/sys/net/ipv4/tcp_slow_start_after_idle"
+
+ConnectionManager& ConnectionManager::Instance()
+{
+	static ConnectionManager manager;
+	return manager;
+}
+
+ConnectionManager::ConnectionManager()
+	: slow_start_after_idle(true)
+{
+	ReadSlowStartAfterIdle();
+}
+
+void ConnectionManager::ReadSlowStartAfterIdle()
+{
+	int value = 1;
+	std::ifstream in(SLOW_START_AFTER_IDLE_PATH);
+	if(in >> value)
+		slow_start_after_idle = (value != 0);
+}
+
+ConnectionManager::Connection* ConnectionManager::GetConnection(const std::string& url)
+{
+	std::lock_guard<std::mutex> lock(connections_mtx);
+	std::unique_ptr<Connection>& connection = connections[url];
+	if(connection == nullptr)
+	{
+		connection.reset(new Connection);
+		connection->has_tcp_info = false;
+		connection->has_delivery_info = false;
+		connection->last_used = 0;
+		std::memset(&connection->tcp_info, 0, sizeof(connection->tcp_info));
+		std::memset(&connection->delivery_info, 0, sizeof(connection->delivery_info));
+	}
+	return connection.get();
+}
+
+nic::Error ConnectionManager::Infer(const std::string& url, nic::InferResult** result, const nic::InferOptions& options, const std::vector<nic::InferInput*>& inputs, const std::vector<const nic::InferRequestedOutput*>& outputs, const nic::Headers& headers, struct tcp_info* info)
+{
+	Connection* connection = GetConnection(url);
+	std::lock_guard<std::mutex> lock(connection->mtx);
+	nic::Error err = GetClient(url, connection);
+	if(!err.IsOk())
+		return err;
+
+	*result = nullptr;
+	*info = connection->client->Infer_with_tcpinfo(result, options, inputs, outputs, headers);
+	if(*result == nullptr)
+		return nic::Error("inference on " + url + " returned no result");
+	connection->tcp_info = *info;
+	connection->has_tcp_info = true;
+	connection->has_delivery_info = ReadDeliveryInfo(url, connection);
+	connection->last_used = get_current_unixtime();
+	return nic::Error::Success;
+}
+
+nic::Error ConnectionManager::AsyncInfer(const std::string& url, nic::InferenceServerHttpClient::OnCompleteFn callback, const nic::InferOptions& options, const std::vector<nic::InferInput*>& inputs, const std::vector<const nic::InferRequestedOutput*>& outputs, const nic::Headers& headers)
+{
+	Connection* connection = GetConnection(url);
+	nic::InferenceServerHttpClient* client;
+	{
+		std::lock_guard<std::mutex> lock(connection->mtx);
+		nic::Error err = GetClient(url, connection);
+		if(!err.IsOk())
+			return err;
+		client = connection->client.get();
+	}
+
+	// The lock isn't held while sending, the callback takes it on the
+	// thread of the client.
+	return client->AsyncInfer(
+			[this, url, connection, callback](nic::InferResult* result)
+			{
+				{
+					std::lock_guard<std::mutex> lock(connection->mtx);
+					connection->has_delivery_info = ReadDeliveryInfo(url, connection);
+					if(connection->has_delivery_info)
+					{
+						connection->tcp_info = connection->delivery_info.info;
+						connection->has_tcp_info = true;
+					}
+					connection->last_used = get_current_unixtime();
+				}
+				callback(result);
+			},
+			options, inputs, outputs, headers);
+}
+
+nic::Error ConnectionManager::GetClient(const std::string& url, Connection* connection)
+{
+	if(connection->client == nullptr)
+		return nic::InferenceServerHttpClient::Create(&connection->client, url, false);
+	return nic::Error::Success;
+}
+
+static bool same_address(const struct sockaddr_storage& a, const struct sockaddr_storage& b)
+{
+	if(a.ss_family != b.ss_family)
+		return false;
+	if(a.ss_family == AF_INET)
+	{
+		const struct sockaddr_in* a4 = (const struct sockaddr_in*)&a;
+		const struct sockaddr_in* b4 = (const struct sockaddr_in*)&b;
+		return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+	}
+	if(a.ss_family == AF_INET6)
+	{
+		const struct sockaddr_in6* a6 = (const struct sockaddr_in6*)&a;
+		const struct sockaddr_in6* b6 = (const struct sockaddr_in6*)&b;
+		return a6->sin6_port == b6->sin6_port && std::memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr)) == 0;
+	}
+	return false;
+}
+
+bool ConnectionManager::ReadDeliveryInfo(const std::string& url, Connection* connection)
+{
+	if(connection->peers.empty())
+	{
+		// 'url' is "host:port", possibly with a scheme.
+		std::string address = url;
+		size_t scheme = address.find("://");
+		if(scheme != std::string::npos)
+			address = address.substr(scheme + 3);
+		size_t colon = address.rfind(':');
+		std::string host = address.substr(0, colon);
+		std::string port = (colon == std::string::npos) ? "80" : address.substr(colon + 1);
+
+		struct addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		struct addrinfo* addresses;
+		if(getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0)
+			return false;
+		for(struct addrinfo* ai = addresses; ai != nullptr; ai = ai->ai_next)
+		{
+			struct sockaddr_storage peer;
+			std::memset(&peer, 0, sizeof(peer));
+			std::memcpy(&peer, ai->ai_addr, ai->ai_addrlen);
+			connection->peers.push_back(peer);
+		}
+		freeaddrinfo(addresses);
+	}
+
+	DIR* fds = opendir("/proc/self/fd");
+	if(fds == nullptr)
+		return false;
+	bool found = false;
+	struct dirent* entry;
+	while((entry = readdir(fds)) != nullptr)
+	{
+		if(entry->d_name[0] == '.')
+			continue;
+		int fd = std::atoi(entry->d_name);
+		if(fd == dirfd(fds))
+			continue;
+
+		struct sockaddr_storage peer;
+		socklen_t peer_len = sizeof(peer);
+		std::memset(&peer, 0, sizeof(peer));
+		if(getpeername(fd, (struct sockaddr*)&peer, &peer_len) != 0)
+			continue;
+		bool is_server = false;
+		for(const struct sockaddr_storage& server : connection->peers)
+			is_server |= same_address(peer, server);
+		if(!is_server)
+			continue;
+
+		// An older kernel fills less, without the delivery rate.
+		TcpDeliveryInfo info;
+		socklen_t info_len = sizeof(info);
+		std::memset(&info, 0, sizeof(info));
+		if(getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &info_len) != 0 || info_len < sizeof(info))
+			continue;
+		if(!found || info.tcpi_bytes_acked > connection->delivery_info.tcpi_bytes_acked)
+		{
+			connection->delivery_info = info;
+			found = true;
+		}
+	}
+	closedir(fds);
+	return found;
+}
+
+bool ConnectionManager::TcpInfo(const std::string& url, struct tcp_info* info, uint64_t* idle_ms)
+{
+	Connection* connection = GetConnection(url);
+	std::lock_guard<std::mutex> lock(connection->mtx);
+	if(!connection->has_tcp_info)
+		return false;
+
+	uint64_t now = get_current_unixtime();
+	*info = connection->tcp_info;
+	*idle_ms = (now > connection->last_used) ? now - connection->last_used : 0;
+	return true;
+}
+
+bool ConnectionManager::DeliveryInfo(const std::string& url, TcpDeliveryInfo* info)
+{
+	Connection* connection = GetConnection(url);
+	std::lock_guard<std::mutex> lock(connection->mtx);
+	if(!connection->has_delivery_info)
+		return false;
+
+	*info = connection->delivery_info;
+	return true;
+}
+
+void ConnectionManager::Reset(const std::string& url)
+{
+	Connection* connection = GetConnection(url);
+	std::lock_guard<std::mutex> lock(connection->mtx);
+	connection->client.reset();
+	connection->has_tcp_info = false;
+	connection->has_delivery_info = false;
+}
@@ -0,0 +1,97 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include "../include/http_client.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bandwidth_estimator.h"
+
+namespace nic = nvidia::inferenceserver::client;
+
+// Keeps one HTTP client per server for the lifetime of the process.
+// The client reuses its TCP connection for every request, so a
+// request doesn't pay a handshake and restart from the initial
+// congestion window like a new client does.
+class ConnectionManager
+{
+	public:
+		static ConnectionManager& Instance();
+
+		// Run an inference on the connection to 'url', creating it on
+		// first use. Requests on the same connection are serialized.
+		// 'info' is set to the tcp_info of the connection after the
+		// request.
+		nic::Error Infer(const std::string& url, nic::InferResult** result, const nic::InferOptions& options, const std::vector<nic::InferInput*>& inputs, const std::vector<const nic::InferRequestedOutput*>& outputs, const nic::Headers& headers, struct tcp_info* info);
+
+		// Send an inference on the connection to 'url' without waiting
+		// for it, creating the connection on first use. 'callback' is
+		// called on the thread of the client once the server answered,
+		// after the tcp_info of the connection is read.
+		nic::Error AsyncInfer(const std::string& url, nic::InferenceServerHttpClient::OnCompleteFn callback, const nic::InferOptions& options, const std::vector<nic::InferInput*>& inputs, const std::vector<const nic::InferRequestedOutput*>& outputs, const nic::Headers& headers = nic::Headers());
+
+		// The tcp_info of the connection to 'url' after its latest
+		// request and the time, in ms, the connection has been idle
+		// since. Return false if there was no request on it yet.
+		bool TcpInfo(const std::string& url, struct tcp_info* info, uint64_t* idle_ms);
+
+		// The tcp_info of the connection to 'url' up to the delivery
+		// rate, after its latest request. Return false if there was no
+		// request on it yet or the kernel doesn't report the delivery
+		// rate.
+		bool DeliveryInfo(const std::string& url, TcpDeliveryInfo* info);
+
+		// Whether the kernel shrinks the congestion window of a
+		// connection that has been idle for longer than its RTO.
+		bool SlowStartAfterIdle() const { return slow_start_after_idle; }
+
+		// Close the connection to 'url'. The next request opens a new one.
+		void Reset(const std::string& url);
+
+	private:
+		ConnectionManager();
+
+		struct Connection
+		{
+			std::mutex mtx;
+			std::unique_ptr<nic::InferenceServerHttpClient> client;
+			bool has_tcp_info;
+			struct tcp_info tcp_info;
+			bool has_delivery_info;
+			TcpDeliveryInfo delivery_info;
+			uint64_t last_used; // ms
+			// The addresses of the server, resolved on first use.
+			std::vector<struct sockaddr_storage> peers;
+		};
+
+		Connection* GetConnection(const std::string& url);
+		// The client of 'connection', created on first use. Called with
+		// the lock of the connection held.
+		nic::Error GetClient(const std::string& url, Connection* connection);
+
+		// The HTTP client doesn't expose its socket, so the socket of
+		// the connection is found among the ones of the process
+		// connected to the server, as the one that sent the most.
+		// Polling the load of the server sends little.
+		bool ReadDeliveryInfo(const std::string& url, Connection* connection);
+
+		// Linux has no socket option for slow start after idle, only
+		// the system-wide net.ipv4.tcp_slow_start_after_idle setting,
+		// which is left to the operator: run
+		// 'sysctl -w net.ipv4.tcp_slow_start_after_idle=0' on the
+		// client to keep the congestion window of an idle connection.
+		// The setting is only read, so the link model knows whether
+		// an idle connection restarts from its initial window.
+		void ReadSlowStartAfterIdle();
+
+		std::mutex connections_mtx;
+		std::map<std::string, std::unique_ptr<Connection>> connections;
+		bool slow_start_after_idle;
+};
+#endif
@@ -4,8 +4,11 @@
 //
 
 #include "image_processing.h"
+#include "local_execution.h"
+#include <chrono>
 #define IMAGE_SIZE 224
 #define CHANNELS 3
+#define JPEG_QUALITY 90
 
 
 bool tensor_transform(cv::Mat img_rgb_u8, torch::Tensor& input_tensor)
@@ -23,7 +26,7 @@ bool tensor_transform(cv::Mat img_rgb_u8, torch::Tensor& input_tensor)
 		input_tensor[ch].sub_(mean[ch]).div_(std[ch]);
 	}
 	input_tensor.unsqueeze_(0);
-	input_tensor = input_tensor.to(torch::kCUDA);
+	input_tensor = input_tensor.to(local_device());
 	return true;
 }
 
@@ -36,5 +39,22 @@ bool loadimage(std::string file_name, torch::Tensor& input_tensor, int width)
 
 	tensor_transform(img_rgb_u8, input_tensor);
 }
-	
 
+bool encode_image(std::string file_name, int width, std::vector<uint8_t>& image, double& encode_ms, double& decode_ms)
+{
+	cv::Mat img_bgr_u8 = cv::imread(file_name,cv::IMREAD_COLOR);
+	if(img_bgr_u8.empty())
+		return false;
+	cv::resize(img_bgr_u8, img_bgr_u8, cv::Size(width, width));
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, JPEG_QUALITY};
+	if(!cv::imencode(".jpg", img_bgr_u8, image, params))
+		return false;
+	encode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	cv::Mat decoded = cv::imdecode(image, cv::IMREAD_COLOR);
+	decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return !decoded.empty();
+}
@@ -43,4 +43,10 @@ FileToInputData(
 //bool loadimage(std::string file_name, cv::Mat& image);
 
 bool loadimage(std::string file_name, torch::Tensor& input_tensor, int width);
+
+// Load the image 'file_name' resized to 'width' x 'width' and encode it
+// as a JPEG into 'image', the frame as sent in place of the input.
+// 'encode_ms' is the time to encode it and 'decode_ms' the time to
+// decode it again, as the server does.
+bool encode_image(std::string file_name, int width, std::vector<uint8_t>& image, double& encode_ms, double& decode_ms);
 #endif //DIAMOND_CLIENT_IMAGE_PROCESSING_H
@@ -1,11 +1,28 @@
 #include "local_execution.h"
+#include <torch/cuda.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
-at::Tensor execute_local_parts(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape)
+torch::Device local_device()
+{
+	static const torch::Device device = [] {
+		const char* env = std::getenv("DIAMOND_DEVICE");
+		if((env != nullptr) && (std::strcmp(env, "cpu") == 0))
+			return torch::Device(torch::kCPU);
+		return torch::cuda::is_available() ? torch::Device(torch::kCUDA) : torch::Device(torch::kCPU);
+	}();
+	return device;
+}
+
+// Execute the layers of the model up to 'partitioning_point' and return
+// the output, on the local device, with its shape in 'serverside_shape'.
+static at::Tensor execute_local_layers(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape)
 {
 	std::vector<torch::jit::IValue> local_inputs;
 	local_inputs.push_back(input_tensor);	
 
-	at::Tensor indexTensor = torch::tensor(partitioning_point).to(torch::kCUDA);
+	at::Tensor indexTensor = torch::tensor(partitioning_point).to(local_device());
 	indexTensor = torch::reshape(indexTensor, {-1,1});
 	local_inputs.push_back(indexTensor);
 
@@ -17,8 +34,114 @@ at::Tensor execute_local_parts(torch::jit::script::Module model, torch::Tensor i
 		serverside_shape.push_back(local_output.size(i));
 	}
 	
-	local_output = local_output.flatten().to(torch::kCPU);
-	return local_output;
+	return local_output.flatten();
+}
+
+at::Tensor execute_local_parts(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape)
+{
+	at::Tensor local_output = execute_local_layers(model, input_tensor, partitioning_point, serverside_shape);
+	if(!local_output.is_cuda())
+		return local_output.contiguous();
+
+	// Copy the output into page-locked memory, which the device writes
+	// to directly and which is then sent from as it is, rather than
+	// through a pageable staging copy. The host allocator caches the
+	// pinned blocks, so this doesn't allocate for each frame.
+	at::Tensor host_output = torch::empty(local_output.sizes(),
+			torch::TensorOptions().dtype(local_output.dtype()).pinned_memory(true));
+	host_output.copy_(local_output);
+	return host_output;
 }	
+
+ChunkedHostCopy::ChunkedHostCopy(const at::Tensor& device_output)
+{
+	at::Tensor flat_output = device_output.flatten().contiguous();
+	host_output = torch::empty(flat_output.sizes(),
+			torch::TensorOptions().dtype(flat_output.dtype()).pinned_memory(true));
+	const int64_t numel = flat_output.numel();
+	const int64_t chunk_numel = std::max((int64_t)1, (int64_t)(ACTIVATION_CHUNK_BYTES / flat_output.element_size()));
+	chunk_bytes = chunk_numel * flat_output.element_size();
+	for(int64_t begin = 0; begin < numel; begin += chunk_numel)
+	{
+		int64_t length = std::min(chunk_numel, numel - begin);
+		host_output.narrow(0, begin, length).copy_(flat_output.narrow(0, begin, length), /*non_blocking=*/true);
+		events.emplace_back(new at::cuda::CUDAEvent());
+		events.back()->record();
+	}
+}
+
+size_t ChunkedHostCopy::Ready(size_t offset)
+{
+	const size_t byte_size = host_output.nbytes();
+	if(offset >= byte_size)
+		return 0;
+	const size_t chunk = offset / chunk_bytes;
+	events[chunk]->synchronize();
+	return std::min(byte_size, (chunk + 1) * chunk_bytes) - offset;
+}
+
+void ChunkedHostCopy::Wait()
+{
+	if(!events.empty())
+		events.back()->synchronize();
+}
+
+std::shared_ptr<ChunkedHostCopy> execute_local_parts_chunked(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape)
+{
+	at::Tensor local_output = execute_local_layers(model, input_tensor, partitioning_point, serverside_shape);
+	return std::make_shared<ChunkedHostCopy>(local_output);
+}
 	//////////////////////////LOCAL EXECUTION DONE//////////////////////////
 
+at::Tensor execute_remaining_parts(torch::jit::script::Module model, const at::Tensor& host_output, const std::vector<int64_t>& shape, int partitioning_point)
+{
+	// The layers are the children of the 'layers' module list of the
+	// client model, in order.
+	at::Tensor output = host_output.view(shape).to(local_device());
+	torch::jit::script::Module layers = model.attr("layers").toModule();
+	int i = 0;
+	for(torch::jit::script::Module layer : layers.children())
+	{
+		if(i++ < partitioning_point)
+			continue;
+		std::vector<torch::jit::IValue> layer_inputs;
+		layer_inputs.push_back(output);
+		output = layer.forward(layer_inputs).toTensor();
+	}
+	return output;
+}
+
+
+at::Tensor to_transfer_format(const at::Tensor& host_output, const std::vector<int64_t>& shape, std::vector<float>& scale)
+{
+	scale.clear();
+	switch(transfer_type())
+	{
+		case TRANSFER_FP16:
+			return host_output.to(torch::kHalf).contiguous();
+
+		case TRANSFER_INT8:
+		{
+			// Symmetric quantization, the largest magnitude maps to 127.
+			float max_abs = host_output.abs().max().item<float>();
+			float s = (max_abs > 0) ? max_abs / 127 : 1;
+			scale.push_back(s);
+			return host_output.div(s).round_().clamp_(-127, 127).to(torch::kChar).contiguous();
+		}
+
+		case TRANSFER_INT8_CHANNEL:
+		{
+			// As above, with the largest magnitude of each channel.
+			int64_t batch = (shape.size() > 0) ? shape[0] : 1;
+			int64_t channels = (shape.size() > 1) ? shape[1] : 1;
+			at::Tensor channel_view = host_output.reshape({batch, channels, -1});
+			at::Tensor max_abs = std::get<0>(channel_view.abs().transpose(0, 1).reshape({channels, -1}).max(1));
+			at::Tensor s = torch::where(max_abs > 0, max_abs / 127, torch::ones_like(max_abs)).contiguous();
+			scale.assign(s.data_ptr<float>(), s.data_ptr<float>() + channels);
+			return channel_view.div(s.view({1, channels, 1})).round_().clamp_(-127, 127).to(torch::kChar).flatten().contiguous();
+		}
+
+		default:
+			return host_output;
+	}
+}
@@ -1,3 +1,58 @@
+#include <ATen/cuda/CUDAEvent.h>
+#include <memory>
+#include <vector>
 #include "image_processing.h"
+#include "transfer_format.h"
+
+// The device the local parts of the model execute on. CUDA if it is
+// available, unless the DIAMOND_DEVICE environment variable is "cpu".
+torch::Device local_device();
 
 at::Tensor execute_local_parts(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape);
+
+// The size of the chunks a ChunkedHostCopy copies, in bytes.
+#define ACTIVATION_CHUNK_BYTES (256 * 1024)
+
+// The copy of an activation from the device into page-locked memory,
+// issued as chunks that are each followed by an event. The part of the
+// activation already on the host can be sent while the rest is copied.
+class ChunkedHostCopy
+{
+	public:
+		// Issue the copy of 'device_output', flattened, on the current
+		// stream, after the work that computes it.
+		ChunkedHostCopy(const at::Tensor& device_output);
+
+		// The host tensor, written as the copy goes.
+		const at::Tensor& Host() const { return host_output; }
+
+		// Wait until the bytes of the host tensor from 'offset' on are
+		// at least partly copied and return how many of them are. Used
+		// as the nic::InferInput::ReadyFn of the request.
+		size_t Ready(size_t offset);
+
+		// Wait until the whole activation is copied.
+		void Wait();
+
+	private:
+		at::Tensor host_output;
+		size_t chunk_bytes;
+		std::vector<std::unique_ptr<at::cuda::CUDAEvent>> events;
+};
+
+// As execute_local_parts(), with the output copied to the host by a
+// ChunkedHostCopy that is returned without waiting for it. Requires
+// the local device to be CUDA.
+std::shared_ptr<ChunkedHostCopy> execute_local_parts_chunked(torch::jit::script::Module model, torch::Tensor input_tensor, int partitioning_point, std::vector<int64_t> &serverside_shape);
+
+// Execute the layers of the model from 'partitioning_point' on, from
+// 'host_output', the host output of execute_local_parts() up to the
+// point for an activation of 'shape'. Used to finish a request the
+// server rejected without executing the local part again.
+at::Tensor execute_remaining_parts(torch::jit::script::Module model, const at::Tensor& host_output, const std::vector<int64_t>& shape, int partitioning_point);
+
+// Convert 'host_output', the host output of execute_local_parts() for
+// an activation of 'shape', to the format set by transfer_type(). The
+// returned tensor is contiguous and 'scale' is set to the scale the
+// server multiplies it by, or left empty if it is not scaled.
+at::Tensor to_transfer_format(const at::Tensor& host_output, const std::vector<int64_t>& shape, std::vector<float>& scale);
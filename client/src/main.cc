@@ -9,9 +9,14 @@
 #include "Server.h"
 #include "comm_online_profiler.h"
 #include "partitioner.h"
+#include "server_set.h"
 #include <mutex>
 #include <thread>
 #include "server_profiler.h"
+#include "stream_pipeline.h"
+extern "C" {
+#include<curl/curl.h>
+}
 extern std::string material_path;
 int  layer_length;
 std::vector<int> myhistory;
@@ -47,9 +52,8 @@ void manage_history(uint64_t refresh_time)
 }
 */
 bool done = false;
-Communication comm(91);
 bool wakeup = false;
-void baseline_get_serverinfo(ModelInfo *model_info, ServerInfo *server_info, int run_policy)
+void baseline_get_serverinfo(ModelInfo *model_info, ServerCandidate *server, int run_policy)
 {
 	if(run_policy !=4 && run_policy !=5)
 	{
@@ -68,6 +72,7 @@ void baseline_get_serverinfo(ModelInfo *model_info, ServerInfo *server_info, int
 			return;
 		}
 		std::cout << "RUN BACKGROUND!!!!!<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" << std::endl;
+		ServerInfo *server_info = &server->info;
 		int partitioning_point = 0;
 		std::vector<int64_t> serverside_shape = model_info->shapes[partitioning_point];
 		std::vector<float> serverside_input(vector_mul(serverside_shape), 1.0);
@@ -75,7 +80,7 @@ void baseline_get_serverinfo(ModelInfo *model_info, ServerInfo *server_info, int
 		struct diamond_results return_diamond_result;
 
 		auto remote_start = get_current_unixtime();
-		struct tcp_info	ret_tcp_info = send_infer(model_info->model_name, serverside_input, partitioning_point, serverside_shape, return_diamond_result, *server_info);
+		struct tcp_info	ret_tcp_info = send_infer(model_info->model_name, serverside_input, partitioning_point, 0, serverside_shape, return_diamond_result, *server_info);
 
 		auto remote_end = get_current_unixtime();
 
@@ -93,7 +98,7 @@ void baseline_get_serverinfo(ModelInfo *model_info, ServerInfo *server_info, int
 		std::cout << "before sf " << server_info->sf << std::endl;
 		std::cout << "before link " << server_info->link_capacity << std::endl;
 
-		comm.LINK = expected_LINK;
+		server->comm.LINK = expected_LINK;
 		server_info->sf =  (infer_ms + queue_ms) / model_info->server_inference_time_ms[partitioning_point];
 
 		server_info->link_capacity = expected_LINK;
@@ -106,6 +111,58 @@ void baseline_get_serverinfo(ModelInfo *model_info, ServerInfo *server_info, int
 	}
 
 }
+// Process 'frame_count' copies of 'input_tensor' as a camera stream
+// with at most 'max_in_flight' frames in flight, deciding the
+// partitioning point of each frame with 'policy'. 'input_image', if
+// set, is the frame as a JPEG. The server of each frame is decided
+// with its point among 'servers', the baselines use the first one.
+void run_stream(torch::jit::script::Module model, torch::Tensor input_tensor, std::shared_ptr<const std::vector<uint8_t>> input_image, ModelInfo &model_info, ServerSet &servers, int policy, double SLO, int confidence_threshold, int frame_count, int max_in_flight, std::string path)
+{
+	std::ofstream fp;
+	fp.open(path+"_stream_"+std::to_string(policy)+"_"+std::to_string(max_in_flight)+".csv");
+	fp << "frame, point, submit, total, local, remote, queue, infer, rejected, top1\n";
+
+	// Every server is refreshed on a cold start, after a frame that
+	// executed locally.
+	int previous_point = 0;
+	auto decide = [&](uint64_t frame_id, size_t* target) {
+		int point = 0;
+		if(policy == 0 || policy == 1 || policy == 6 || policy == 7)
+		{
+			point = servers.Decide(policy, SLO, confidence_threshold, previous_point == model_info.layer_length-1, target).partitioning_point;
+		}
+		else if(policy == 4 || policy == 5)
+		{
+			ServerCandidate &server = servers.Get(0);
+			*target = 0;
+			server.decided_link = server.comm.LINK;
+			point = get_partitioning_point_baseline(server.comm.LINK, model_info, server.info, policy, SLO).partitioning_point;
+		}
+		previous_point = point;
+		return point;
+	};
+	auto deliver = [&](const FrameResult& frame) {
+		fp << frame.frame_id << "," << frame.partitioning_point << "," << frame.submit_time << ","
+			<< frame.remote_end - frame.submit_time << "," << frame.local_end - frame.submit_time << ","
+			<< frame.remote_end - frame.local_end << ","
+			<< (frame.local_execution ? 0 : frame.result.queue_ms) << "," << (frame.local_execution ? 0 : frame.result.infer_ms) << ","
+			<< frame.result.rejected << "," << frame.result.top1 << std::endl;
+	};
+
+	uint64_t stream_start = get_current_unixtime();
+	{
+		FramePipeline pipeline(model, model_info.model_name, model_info.layer_length-1, &servers, &mu, decide, deliver, max_in_flight);
+		for(int i = 0; i < frame_count; i++)
+		{
+			pipeline.Submit(input_tensor, input_image);
+		}
+		pipeline.Flush();
+	}
+	uint64_t stream_end = get_current_unixtime();
+	std::cout << "stream of " << frame_count << " frames: " << frame_count * 1000.0 / std::max((uint64_t)1, stream_end - stream_start) << " fps" << std::endl;
+	fp.close();
+}
+
 double harmonic_mean(std::vector<double> v){
 	double sum = 0;
 	for (int i = 0; i <v.size(); i++)
@@ -138,39 +195,72 @@ int main(int argc, char** argv)
 	material_path = std::string(argv[3]);
 	std::string model_name = argv[1];	
 	torch::jit::script::Module model = torch::jit::load(argv[2]);
-	ServerInfo server_info;
+	// libcurl is set up once for the process, before any thread uses
+	// it, and cleaned up on exit after the servers are gone.
+	curl_global_init(CURL_GLOBAL_ALL);
+	atexit(curl_global_cleanup);
 	ModelInfo model_info(model_name); 
-	std::thread t1(baseline_get_serverinfo, &model_info , &server_info , run_policy );		
+	// The baselines run on the first server.
+	ServerSet servers(model_info, 91);
+	std::thread t1(baseline_get_serverinfo, &model_info , &servers.Get(0) , run_policy );		
 	t1.detach();
 	bool local_execution;
-	server_info.GetServerInfo();
-	comm.Init(server_info.rtt);
+	servers.Start();
 
 	layer_length =  model_info.layer_length;
-	model.to(torch::kCUDA); model.eval();
+	model.to(local_device()); model.eval();
 	//Communication comm(atoi(argv[2]));
 	loadimagenetlabel(material_path+"/imagenet_label", model_info.labels);
 
 	torch::Tensor input_tensor;
 	loadimage(material_path + "/zebra.jpg", input_tensor, 224);
+	// The frame as a JPEG, sent in place of the input at point 0 when
+	// that is cheaper.
+	std::shared_ptr<std::vector<uint8_t>> input_image;
+	if(CodecProfile::Instance().ImageEnabled())
+	{
+		double encode_ms, decode_ms;
+		input_image = std::make_shared<std::vector<uint8_t>>();
+		if(encode_image(material_path + "/zebra.jpg", 224, *input_image, encode_ms, decode_ms))
+			CodecProfile::Instance().ProfileImage(input_image->size(), transfer_byte_size(model_info.shapes[0]), encode_ms, decode_ms);
+		else
+			input_image.reset();
+	}
 
 	/*	std::chrono::steady_clock::time_point local_start = std::chrono::steady_clock::now();
 		std::chrono::steady_clock::time_point remote_start = std::chrono::steady_clock::now();
 		std::chrono::steady_clock::time_point remote_end = std::chrono::steady_clock::now();
 		*/
+	// argv[11] = number of frames to process as a stream, argv[12] = frames in flight
+	if(argc > 11)
+	{
+		int max_in_flight = (argc > 12) ? atoi(argv[12]) : 4;
+		run_stream(model, input_tensor, input_image, model_info, servers, run_policy, max_SLO / 100.0, min_confidence, atoi(argv[11]), max_in_flight, std::string(argv[4]));
+		done = true;
+		wakeup = true;
+		cv_.notify_one();
+		return 0;
+	}
+
 	myhistory.resize(layer_length, 0);
 	uint64_t task_start = 0;
 	uint64_t local_start = 0;
 	uint64_t remote_start = 0;
 	uint64_t remote_end = 0;
 	int previous_partitioning_point = 0;
-	std::vector<double> LINK_history;
 	for(int i = 0; i < model_info.shapes.size(); i++)
 	{
 		std::vector<int64_t> serverside_shape = model_info.shapes[i];
 		at::Tensor local_output = execute_local_parts(model, input_tensor, i, serverside_shape);
-		std::vector<float> serverside_input(local_output.data_ptr<float>(), local_output.data_ptr<float>() + local_output.numel());
-
+		// Profile the encodings on the activation at every point, so a
+		// decision knows their costs before a request is sent at it.
+		if(CodecProfile::Instance().Enabled() && i < model_info.shapes.size() - 1)
+		{
+			std::vector<float> scale;
+			std::vector<uint8_t> encoded;
+			at::Tensor transfer_input = to_transfer_format(local_output, model_info.shapes[i], scale);
+			CodecProfile::Instance().Encode(i, 0, transfer_input.data_ptr(), transfer_input.nbytes(), transfer_input.element_size(), encoded);
+		}
 	}
 	for(int concurrency =0; concurrency <1+max_concurrency; concurrency = concurrency+50){
 		std::cout << "pkill -9 perf_client" << std::endl;
@@ -199,7 +289,7 @@ int main(int argc, char** argv)
 				{
 
 					struct diamond_results return_diamond_result;
-					struct tcp_info	ret_tcp_info = send_infer(model_name, serverside_input, 1, serverside_shape, return_diamond_result, server_info);
+					struct tcp_info	ret_tcp_info = send_infer(model_name, serverside_input, 1, 0, serverside_shape, return_diamond_result, server_info);
 				}
 			}
 			*/
@@ -255,25 +345,13 @@ int main(int argc, char** argv)
 							
 							struct partitioner_result r;
 							task_start = get_current_unixtime(); 
+							size_t target = 0;
 							if(policy == 0 || policy == 1 || policy ==6 || policy == 7)
 							{
-
-								if(previous_partitioning_point == model_info.layer_length-1 || server_info.isMyInfoExpired()) // cold start
-								{
-									std::cout << "info update " << std::endl;
-									server_info.GetServerInfo();
-									comm.Init(server_info.rtt);
-									LINK_history.clear();
-									comm.LINK = std::min( (double)comm.MAX_LINK, (double)server_info.CURRENT_SERVER_CAPACITY );
-									server_info.link_capacity = comm.LINK;
-									server_info.last_batch = 0;
-									server_info.last_server_infertime = 0;
-								}
+								// The server is decided with the point, every
+								// server is refreshed on a cold start.
 								local_execution = false;
-								std::vector<double> estimated_comm = comm.expect_time_shapes(model_info.shapes, comm.LINK, server_info);
-
-
-								r = get_partitioning_point(estimated_comm, model_info, server_info, policy, SLO, confidence_threshold);
+								r = servers.Decide(policy, SLO, confidence_threshold, previous_partitioning_point == model_info.layer_length-1, &target);
 							}
 							else if(policy == 3)
 							{
@@ -292,7 +370,8 @@ int main(int argc, char** argv)
 								
 								wakeup = false;
 								mu.lock();
-								r = get_partitioning_point_baseline(comm.LINK, model_info, server_info, policy, SLO);
+								servers.Get(0).decided_link = servers.Get(0).comm.LINK;
+								r = get_partitioning_point_baseline(servers.Get(0).comm.LINK, model_info, servers.Get(0).info, policy, SLO);
 								mu.unlock();
 								if(r.partitioning_point  == model_info.layer_length-1)
 								{
@@ -306,6 +385,11 @@ int main(int argc, char** argv)
 									wakeup = false;
 								}
 															}	
+							ServerCandidate& server = servers.Get(target);
+							ServerInfo& server_info = server.info;
+							Communication& comm = server.comm;
+							if(servers.Size() > 1)
+								std::cout << "server " << server_info.url << std::endl;
 							int partitioning_point = r.partitioning_point;
 							/*
 								if(i < 10) partitioning_point = 0;	
@@ -316,8 +400,21 @@ int main(int argc, char** argv)
 							//local_start = std::chrono::steady_clock::now();
 							local_start = get_current_unixtime();
 							std::vector<int64_t> serverside_shape;
-							at::Tensor local_output = execute_local_parts(model, input_tensor, partitioning_point, serverside_shape);
-							std::vector<float> serverside_input(local_output.data_ptr<float>(), local_output.data_ptr<float>() + local_output.numel());
+							// The output is sent from the host tensor as it is, it
+							// has to outlive the request. An output sent raw is sent
+							// while it is copied from the device, in chunks.
+							bool send_chunked = !local_execution && local_device().is_cuda() && transfer_type() == TRANSFER_FP32 && !CodecProfile::Instance().Enabled() && !(input_image != nullptr && CodecProfile::Instance().SendImage(partitioning_point, server.decided_link));
+							std::shared_ptr<ChunkedHostCopy> chunked_output;
+							at::Tensor local_output;
+							if(send_chunked)
+							{
+								chunked_output = execute_local_parts_chunked(model, input_tensor, partitioning_point, serverside_shape);
+								local_output = chunked_output->Host();
+							}
+							else
+							{
+								local_output = execute_local_parts(model, input_tensor, partitioning_point, serverside_shape);
+							}
 	/*	
 							std::vector<int64_t> serverside_shape = model_info.shapes[partitioning_point];
 							std::vector<float> serverside_input(vector_mul(serverside_shape), 1.0);
@@ -333,71 +430,134 @@ int main(int argc, char** argv)
 
 
 								//RUN
-									
-								remote_start = get_current_unixtime();
-								struct tcp_info	ret_tcp_info = send_infer(model_name, serverside_input, partitioning_point, serverside_shape, return_diamond_result, server_info);
-								std::cout << "cwnd " << ret_tcp_info.tcpi_snd_cwnd << std::endl;
-								server_info.isServerInfoExpiredResult = false;
-								//std::cout << server_info.average_interval<< " " << server_info.average_throughput << " " <<
-								//	server_info.average_batch << " " << server_info.average_infer_time << " " <<
-								//	server_info.average_queue_time << std::endl;
-
-								remote_end = get_current_unixtime();
-								//server_info.server_queue_status = parseStrToIntVec(return_diamond_result.queue_contents);
-								//server_info.server_arrival_rate = parseStrToIntVec(return_diamond_result.arrival_rate);
-								server_info.server_information_refresh_time = remote_end;
-
-								//std::cout << "server_queue_status size " << server_info.server_queue_status.size() << " " << "server arrival_rate size " <<  server_info.server_arrival_rate.size() << std::endl;
-								//remote_end = std::chrono::steady_clock::now();	
-							
-									queue_ms = return_diamond_result.queue_ms;
-								infer_ms = return_diamond_result.infer_ms;
-								//	local_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_start - local_start).count();
-								//	remote_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_end - remote_start).count();
-								//	total_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_end - local_start).count();
-								local_elapsed_time = remote_start - local_start;
-								remote_elapsed_time = remote_end - remote_start;
-								total_elapsed_time = remote_end - local_start;
-
-								comm_ms = remote_elapsed_time - queue_ms - infer_ms;	
-								std::cout << "comm time " << comm_ms << std::endl;
-								point_history.push_back( partitioning_point );
-								send_history.push_back( remote_start + comm_ms );
-							
-								server_info.RTTrefresh((double)ret_tcp_info.tcpi_rtt/1000.0);
-								ret_tcp_info.tcpi_rtt = server_info.rtt*1000;
-								comm.set_tcp_info(ret_tcp_info);
-								int expected_LINK;
-
-								if(policy == 0 || policy == 1){
-									expected_LINK = comm.get_LINK(vector_mul(serverside_shape)*4 , comm_ms);
-									std::cout << "expected link " <<expected_LINK << std::endl;
+
+								// The activation is converted and encoded before it is
+								// sent, the time this takes counts as local time. At point
+								// 0 the image may be sent instead, the server computes the
+								// input from it.
+								std::vector<float> scale;
+								at::Tensor transfer_input;
+								std::vector<uint8_t> encoded;
+								Encoding encoding;
+								const void* sent_data;
+								size_t sent_bytes;
+								std::string sent_datatype;
+								nic::InferInput::ReadyFn ready;
+								if(input_image != nullptr && CodecProfile::Instance().SendImage(partitioning_point, server.decided_link))
+								{
+									encoding = ENCODING_JPEG;
+									sent_data = input_image->data();
+									sent_bytes = input_image->size();
+									sent_datatype = "FP32";
 								}
-								else if(policy == 3 || policy == 4 || policy == 5 || policy == 6 || policy == 7)
+								else if(chunked_output != nullptr)
 								{
-									expected_LINK =( (vector_mul(serverside_shape)*4*8)/(comm_ms/1000))/1024/1024;
-									std::cout << "expected link " <<expected_LINK << std::endl;
+									encoding = ENCODING_RAW;
+									sent_data = local_output.data_ptr();
+									sent_bytes = local_output.nbytes();
+									sent_datatype = transfer_datatype();
+									ready = [chunked_output](size_t offset) { return chunked_output->Ready(offset); };
 								}
-
-
-								if(LINK_history.size() == 10){
-									LINK_history.erase(LINK_history.begin());
+								else
+								{
+									transfer_input = to_transfer_format(local_output, serverside_shape, scale);
+									encoding = CodecProfile::Instance().Encode(partitioning_point, server.decided_link, transfer_input.data_ptr(), transfer_input.nbytes(), transfer_input.element_size(), encoded);
+									sent_data = (encoding == ENCODING_RAW) ? transfer_input.data_ptr() : (const void*)encoded.data();
+									sent_bytes = (encoding == ENCODING_RAW) ? transfer_input.nbytes() : encoded.size();
+									sent_datatype = transfer_datatype();
 								}
-								LINK_history.push_back((double)expected_LINK);
-
+									
+								remote_start = get_current_unixtime();
 
-								double average_link_history = std::accumulate(LINK_history.begin(), LINK_history.end(), 0)/(double)LINK_history.size();
-								//double average_link_history = harmonic_mean(LINK_history);
-								comm.LINK = std::min( (double)average_link_history, std::stod(return_diamond_result.server_capacity));
-																server_info.queueing = queue_ms;
+								// Time left for the server once the input arrives: the SLO
+								// minus what was spent locally and the expected uplink time.
+								double expected_comm_ms = (policy == 0 || policy == 1 || policy == 6 || policy == 7) ? r.ex_comm : 0;
+								double budget_ms = SLO*model_info.local_only_time - (double)(remote_start - task_start) - expected_comm_ms;
+								uint64_t deadline_us = (uint64_t)std::max(1.0, budget_ms * 1000);
 
-								mu.lock();
-								//manage_history(server_info.server_information_refresh_time);
-								server_info.link_capacity = comm.LINK;
-								server_info.sf = (infer_ms+queue_ms) / model_info.server_inference_time_ms[partitioning_point];
+								struct tcp_info	ret_tcp_info;
+								nic::Error err = send_infer(model_name, sent_data, sent_bytes, sent_datatype, scale, encoding, partitioning_point, deadline_us, serverside_shape, return_diamond_result, server_info, &ret_tcp_info, ready);
+								if(!err.IsOk())
+								{
+									// The server couldn't be reached or failed the request.
+									// The rest of the model runs locally and the server is
+									// held off, so the next decisions go to another server
+									// while it recovers.
+									std::cerr << "error: unable to run inference on " << server_info.url << ": " << err << std::endl;
+									if(chunked_output != nullptr)
+										chunked_output->Wait();
+									execute_remaining_parts(model, local_output, serverside_shape, partitioning_point);
+									r.isPolicyFailed = true;
+									servers.HoldOff(target, get_current_unixtime());
+									remote_end = get_current_unixtime();
+									local_elapsed_time = remote_end - local_start;
+									total_elapsed_time = local_elapsed_time;
+								}
+								else if(return_diamond_result.rejected)
+								{
+									// The server predicted the request would miss its deadline
+									// and didn't queue it, so run the rest of the model locally
+									// from the activation already computed. The next decision
+									// assumes no request waits less than predicted.
+									if(chunked_output != nullptr)
+										chunked_output->Wait();
+									execute_remaining_parts(model, local_output, serverside_shape, partitioning_point);
+									r.isPolicyFailed = true;
+									for(int j = 0; j < server_info.percentile.size(); j++)
+									{
+										server_info.percentile[j] = std::max(server_info.percentile[j], return_diamond_result.predicted_wait_ms);
+									}
+									// The predicted wait supersedes the streamed sketch until the next update.
+									server_info.queue_sketch.clear();
+									servers.HoldOff(target, get_current_unixtime());
+									remote_end = get_current_unixtime();
+									local_elapsed_time = remote_end - local_start;
+									total_elapsed_time = local_elapsed_time;
+								}
+								else
+								{
+									std::cout << "cwnd " << ret_tcp_info.tcpi_snd_cwnd << std::endl;
+									server_info.isServerInfoExpiredResult = false;
+									//std::cout << server_info.average_interval<< " " << server_info.average_throughput << " " <<
+									//	server_info.average_batch << " " << server_info.average_infer_time << " " <<
+									//	server_info.average_queue_time << std::endl;
+
+									remote_end = get_current_unixtime();
+									//server_info.server_queue_status = parseStrToIntVec(return_diamond_result.queue_contents);
+									//server_info.server_arrival_rate = parseStrToIntVec(return_diamond_result.arrival_rate);
+									server_info.server_information_refresh_time = remote_end;
+
+									//std::cout << "server_queue_status size " << server_info.server_queue_status.size() << " " << "server arrival_rate size " <<  server_info.server_arrival_rate.size() << std::endl;
+									//remote_end = std::chrono::steady_clock::now();	
+							
+										queue_ms = return_diamond_result.queue_ms;
+									infer_ms = return_diamond_result.infer_ms;
+									//	local_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_start - local_start).count();
+									//	remote_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_end - remote_start).count();
+									//	total_elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(remote_end - local_start).count();
+									local_elapsed_time = remote_start - local_start;
+									remote_elapsed_time = remote_end - remote_start;
+									total_elapsed_time = remote_end - local_start;
+
+									comm_ms = remote_elapsed_time - queue_ms - infer_ms;	
+									std::cout << "comm time " << comm_ms << std::endl;
+									point_history.push_back( partitioning_point );
+									send_history.push_back( remote_start + comm_ms );
+							
+									server_info.RTTrefresh((double)ret_tcp_info.tcpi_rtt/1000.0);
+									ret_tcp_info.tcpi_rtt = server_info.rtt*1000;
+									comm.set_tcp_info(ret_tcp_info);
+									server.AddTransfer(sent_bytes, comm_ms, std::stod(return_diamond_result.server_capacity), remote_end);
+																	server_info.queueing = queue_ms;
+
+									mu.lock();
+									//manage_history(server_info.server_information_refresh_time);
+									server_info.link_capacity = comm.LINK;
+									server_info.sf = (infer_ms+queue_ms) / model_info.server_inference_time_ms[partitioning_point];
 
 
-								mu.unlock();
+									mu.unlock();
+								}
 
 
 							}
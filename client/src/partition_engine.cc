@@ -0,0 +1,573 @@
+#include "partition_engine.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include "Model.h"
+#include "Server.h"
+#include "activation_codec.h"
+#include "transfer_format.h"
+
+#define SEGMENT_BYTES 1448 // MSS
+// expect_time_with_given_link() takes an unknown ssthresh as 30.
+#define DEFAULT_SSTHRESH 30
+
+ServerState::ServerState()
+	: expired(false), last_batch(0), last_server_infertime(0), average_infer_time(0), split_point_mask(~(uint64_t)0)
+{
+}
+
+ServerState::ServerState(const ServerInfo& server_info)
+{
+	Assign(server_info);
+}
+
+void ServerState::Assign(const ServerInfo& server_info)
+{
+	expired = server_info.isServerInfoExpiredResult;
+	last_batch = server_info.last_batch;
+	last_server_infertime = server_info.last_server_infertime;
+	split_point_mask = server_info.split_point_mask;
+	percentile.assign(server_info.percentile.begin(), server_info.percentile.end());
+	if(expired)
+	{
+		average_infer_time = 0;
+		std::fill(percentile.begin(), percentile.end(), 0);
+		queue_sketch.clear();
+	}
+	else
+	{
+		average_infer_time = server_info.average_infer_time;
+		queue_sketch.assign(server_info.queue_sketch.begin(), server_info.queue_sketch.end());
+	}
+}
+
+bool ServerState::operator==(const ServerState& other) const
+{
+	return expired == other.expired && last_batch == other.last_batch &&
+		last_server_infertime == other.last_server_infertime &&
+		average_infer_time == other.average_infer_time &&
+		percentile == other.percentile && queue_sketch == other.queue_sketch &&
+		split_point_mask == other.split_point_mask;
+}
+
+bool PartitionEngine::LinkState::operator==(const LinkState& other) const
+{
+	return link == other.link && slow_start == other.slow_start &&
+		rtt_ms == other.rtt_ms && bdp_rtt_ms == other.bdp_rtt_ms &&
+		start_cwnd == other.start_cwnd &&
+		ssthresh == other.ssthresh && warm_connection == other.warm_connection;
+}
+
+PartitionEngine::PartitionEngine(const ModelInfo& model_info)
+	: model_local_ms(model_info.local_inference_time_ms),
+	model_server_ms(model_info.server_inference_time_ms),
+	local_J(model_info.local_power_consumption_J)
+{
+	for(size_t i = 0; i < model_info.shapes.size(); i++)
+	{
+		dense_bytes.push_back(transfer_byte_size(model_info.shapes[i]));
+	}
+	Init();
+}
+
+PartitionEngine::PartitionEngine(const std::vector<uint64_t>& dense_bytes, const std::vector<double>& local_ms, const std::vector<double>& server_ms, const std::vector<double>& local_J)
+	: dense_bytes(dense_bytes), model_local_ms(local_ms), model_server_ms(server_ms), local_J(local_J)
+{
+	Init();
+}
+
+void PartitionEngine::Init()
+{
+	point_count = model_local_ms.size();
+	if(point_count == 0 || dense_bytes.size() != (size_t)point_count || model_server_ms.size() != (size_t)point_count - 1)
+	{
+		std::cout << "model size wrong " << point_count << " " << dense_bytes.size() << " " << model_server_ms.size() << std::endl;
+		exit(-1);
+	}
+	// The local only point has no server time.
+	model_server_ms.push_back(0);
+	// The power profile of some models misses the last points, only
+	// the policies that minimize the energy read it.
+	has_power = local_J.size() >= (size_t)point_count;
+	local_J.resize(point_count, 0);
+
+	local_only_time = model_local_ms[point_count-1];
+	for(int i = 0; i < TARGET_TIME_COUNT; i++)
+	{
+		target_ms[i] = local_only_time * ((double)(5 * (i+1)) / 100);
+	}
+
+	has_link = false;
+	codec_revision = 0;
+	local_ms = model_local_ms;
+	server_ms = model_server_ms;
+	comm_ms.assign(point_count, 0);
+	power_J = local_J;
+
+	has_server = false;
+	sketch_total = 0;
+
+	times_stale = true;
+	infer_ms.assign(point_count, 0);
+	without_queue_ms.assign(point_count, 0);
+}
+
+void PartitionEngine::SetLink(double link)
+{
+	LinkState state;
+	state.link = link;
+	state.slow_start = false;
+	state.rtt_ms = 0;
+	state.bdp_rtt_ms = 0;
+	state.start_cwnd = 0;
+	state.ssthresh = 0;
+	state.warm_connection = true;
+	UpdateLink(state);
+}
+
+void PartitionEngine::SetLink(double link, double rtt_ms, double bdp_rtt_ms, double start_cwnd, double ssthresh, bool warm_connection)
+{
+	LinkState state;
+	state.link = link;
+	state.slow_start = true;
+	state.rtt_ms = rtt_ms;
+	state.bdp_rtt_ms = bdp_rtt_ms;
+	state.start_cwnd = start_cwnd;
+	state.ssthresh = ssthresh;
+	state.warm_connection = warm_connection;
+	UpdateLink(state);
+}
+
+void PartitionEngine::UpdateLink(const LinkState& state)
+{
+	// The encodings are chosen for the link, and their cost changes
+	// as they are profiled.
+	CodecProfile& codec = CodecProfile::Instance();
+	if(has_link && state == link_state && codec.Revision() == codec_revision)
+	{
+		return;
+	}
+	codec_revision = codec.Revision();
+	link_state = state;
+	has_link = true;
+	times_stale = true;
+
+	double link_bps = state.link * 1024 * 1024;
+	std::vector<double> sent_bytes(point_count);
+	for(int i = 0; i < point_count; i++)
+	{
+		sent_bytes[i] = codec.EncodedBytes(i, dense_bytes[i], state.link);
+
+		// The local only point sends nothing to encode or decode.
+		double encode_ms = 0;
+		double decode_ms = 0;
+		if(i < point_count - 1)
+		{
+			encode_ms = codec.EncodeMs(i, state.link);
+			decode_ms = codec.DecodeMs(i, state.link);
+		}
+		local_ms[i] = model_local_ms[i] + encode_ms;
+		server_ms[i] = model_server_ms[i] + decode_ms;
+	}
+
+	if(state.slow_start)
+	{
+		// expect_time_with_given_link() takes the link in whole Mbps
+		// and the bandwidth delay product over the RTT in whole ms.
+		round_tables.clear();
+		link_bits = (double)(int)state.link * 1024 * 1024;
+		bdp_cwnd = (double)(uint64_t)(link_bits * state.bdp_rtt_ms) / 8 / SEGMENT_BYTES;
+	}
+	// Like expect_time_shapes(), the points are sent one after the
+	// other from the ssthresh the previous one left.
+	double ssthresh = state.ssthresh;
+	for(int i = 0; i < point_count; i++)
+	{
+		int64_t bytes = (int64_t)sent_bytes[i];
+		if(!state.slow_start)
+		{
+			comm_ms[i] = (sent_bytes[i] * 8) / link_bps * 1000;
+		}
+		else if(bytes == 0)
+		{
+			comm_ms[i] = 0;
+		}
+		else
+		{
+			if(ssthresh == 0)
+			{
+				ssthresh = DEFAULT_SSTHRESH;
+			}
+			// The result takes another round trip, and a new
+			// connection one more for its handshake.
+			comm_ms[i] = SlowStartMs((double)(bytes / SEGMENT_BYTES + 1), &ssthresh) + state.rtt_ms;
+			if(!state.warm_connection)
+			{
+				comm_ms[i] += state.rtt_ms;
+			}
+		}
+		power_J[i] = comm_power(sent_bytes[i] * 8, comm_ms[i]) + local_J[i];
+	}
+	end_ssthresh = ssthresh;
+}
+
+PartitionEngine::RoundTable& PartitionEngine::Rounds(double ssthresh, double segments)
+{
+	size_t i = 0;
+	while(i < round_tables.size() && round_tables[i].start_ssthresh != ssthresh)
+	{
+		i++;
+	}
+	if(i == round_tables.size())
+	{
+		round_tables.emplace_back();
+		RoundTable& table = round_tables.back();
+		table.start_ssthresh = ssthresh;
+		table.sent = 0;
+		table.ms = 0;
+	}
+	RoundTable& table = round_tables[i];
+	while(table.sent < segments)
+	{
+		AddRound(table);
+	}
+	return table;
+}
+
+void PartitionEngine::AddRound(RoundTable& table)
+{
+	double window;
+	double sent;
+	double slow_start_cwnd = 0;
+	double ssthresh;
+	if(table.cwnd.empty())
+	{
+		// The first round sends the window the transfer starts with,
+		// at least a segment.
+		ssthresh = table.start_ssthresh;
+		window = std::max(link_state.start_cwnd, 1.0);
+		sent = window;
+	}
+	else
+	{
+		double cwnd = table.cwnd.back();
+		ssthresh = table.ssthresh_after.back();
+		if((int)cwnd < (int)ssthresh)
+		{
+			// Slow start doubles the window up to ssthresh, which
+			// drops to the window that fills the link once the
+			// window reaches it.
+			window = std::min(cwnd * 2, ssthresh);
+			if(!(bdp_cwnd > window))
+			{
+				ssthresh = (double)(uint32_t)bdp_cwnd;
+			}
+			slow_start_cwnd = window;
+			sent = window;
+		}
+		else
+		{
+			// Congestion avoidance sends a segment for each growth
+			// of the window by 1/cwnd, until it grows by a segment.
+			double next = cwnd;
+			sent = 0;
+			do
+			{
+				next = next + 1 / next;
+				sent += 1;
+			} while((int)next <= cwnd);
+			window = next;
+		}
+	}
+	window = std::ceil(window);
+
+	table.sent_before.push_back(table.sent);
+	table.ms_before.push_back(table.ms);
+	table.cwnd.push_back(window);
+	table.slow_start_cwnd.push_back(slow_start_cwnd);
+	table.ssthresh_after.push_back(ssthresh);
+	table.sent += sent;
+	// A round takes a round trip, or longer if the window doesn't fit
+	// in one on the link.
+	table.ms += std::max(link_state.rtt_ms, ((window * SEGMENT_BYTES * 8) / link_bits) * 1000);
+}
+
+double PartitionEngine::SlowStartMs(double segments, double* ssthresh)
+{
+	RoundTable& table = Rounds(*ssthresh, segments);
+	// The last round is the first that sends the last segment, in
+	// slow start it sends no more than the segments left.
+	size_t round = std::lower_bound(table.sent_before.begin(), table.sent_before.end(), segments) - table.sent_before.begin() - 1;
+	double left = segments - table.sent_before[round];
+	double window = table.cwnd[round];
+	if(table.slow_start_cwnd[round] > left)
+	{
+		window = std::ceil(left);
+	}
+	*ssthresh = table.ssthresh_after[round];
+	return table.ms_before[round] + std::max(link_state.rtt_ms, ((window * SEGMENT_BYTES * 8) / link_bits) * 1000);
+}
+
+void PartitionEngine::SetServer(const ServerInfo& server_info)
+{
+	pending_state.Assign(server_info);
+	SetServer(pending_state);
+}
+
+void PartitionEngine::SetServer(const ServerState& state)
+{
+	if(has_server && state == server_state)
+	{
+		return;
+	}
+	server_state = state;
+	has_server = true;
+	times_stale = true;
+
+	// Bucket i of the sketch holds the times in the bounds of
+	// QueueTimeCDF().
+	const std::vector<double>& sketch = server_state.queue_sketch;
+	sketch_upper.resize(sketch.size());
+	sketch_below.resize(sketch.size());
+	double upper = SERVER_LOAD_SKETCH_MIN_MS;
+	double below = 0;
+	for(size_t i = 0; i < sketch.size(); i++)
+	{
+		sketch_upper[i] = upper;
+		sketch_below[i] = below;
+		upper *= SERVER_LOAD_SKETCH_GAMMA;
+		below += sketch[i];
+	}
+	sketch_total = std::accumulate(sketch.begin(), sketch.end(), 0.0);
+}
+
+double PartitionEngine::CDF(double ms) const
+{
+	if(ms < 0)
+	{
+		return 0;
+	}
+	const std::vector<double>& sketch = server_state.queue_sketch;
+	if(!sketch.empty())
+	{
+		if(sketch_total <= 0)
+		{
+			return 100;
+		}
+		int i = std::lower_bound(sketch_upper.begin(), sketch_upper.end(), ms) - sketch_upper.begin();
+		i = std::min(i, (int)sketch.size() - 1);
+		double lower = (i == 0) ? 0 : sketch_upper[i-1];
+		double fraction = std::min(1.0, (ms - lower) / (sketch_upper[i] - lower));
+		return (sketch_below[i] + sketch[i] * fraction) / sketch_total * 100;
+	}
+
+	// Interpolate between the percentiles, which are sorted.
+	const std::vector<double>& percentile = server_state.percentile;
+	int end = std::upper_bound(percentile.begin(), percentile.end(), ms) - percentile.begin();
+	if(end == 0)
+	{
+		return 0;
+	}
+	if(end == (int)percentile.size())
+	{
+		return 100;
+	}
+	int start = end - 1;
+	return (start+1)*10 + (ms-percentile[start])/((percentile[end]-percentile[start])/10);
+}
+
+void PartitionEngine::UpdateTimes()
+{
+	for(int j = 0; j < point_count - 1; j++)
+	{
+		// The server takes at least the time of the point, or as long
+		// as its latest batch, or its average batch on a cold start.
+		double infer = server_ms[j];
+		if(!server_state.expired)
+		{
+			if(server_state.last_batch == 0)
+			{
+				infer = std::max(infer, server_state.average_infer_time);
+			}
+			else if(server_state.last_batch != 1)
+			{
+				infer = std::max(infer, server_state.last_server_infertime);
+			}
+		}
+		infer_ms[j] = infer;
+		without_queue_ms[j] = local_ms[j] + comm_ms[j] + infer;
+	}
+	infer_ms[point_count-1] = 0;
+	without_queue_ms[point_count-1] = local_only_time;
+	times_stale = false;
+}
+
+double PartitionEngine::Prob(int target, int point) const
+{
+	if(point == point_count - 1)
+	{
+		return (target_ms[target] < local_only_time) ? 0 : 100;
+	}
+	return CDF(target_ms[target] - without_queue_ms[point]);
+}
+
+int PartitionEngine::FirstTarget(int point, int targets, double prob_threshold, double* prob) const
+{
+	// The probability grows with the target time.
+	int lo = 0;
+	int hi = targets;
+	while(lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		double p = Prob(mid, point);
+		if(p >= prob_threshold)
+		{
+			hi = mid;
+			*prob = p;
+		}
+		else
+		{
+			lo = mid + 1;
+		}
+	}
+	return lo;
+}
+
+struct partitioner_result PartitionEngine::DecideFastest(double prob_threshold, int first, int last)
+{
+	// The point that meets the threshold in the shortest target time,
+	// the most likely to among the points that do.
+	int best_target = TARGET_TIME_COUNT;
+	int best_point = -1;
+	int best_prob = 0;
+	for(int j = first; j <= last; j++)
+	{
+		if(!is_split_point(server_state.split_point_mask, j, point_count))
+		{
+			continue;
+		}
+		// Only a target time up to the best one so far can win.
+		double prob = 0;
+		int targets = std::min(best_target + 1, TARGET_TIME_COUNT);
+		int target = FirstTarget(j, targets, prob_threshold, &prob);
+		if(target == targets)
+		{
+			continue;
+		}
+		if(target < best_target || (int)prob > best_prob)
+		{
+			best_target = target;
+			best_point = j;
+			best_prob = (int)prob;
+		}
+	}
+
+	struct partitioner_result r;
+	r.isPolicyFailed = false;
+	if(best_point == -1)
+	{
+		best_point = point_count - 1;
+		best_target = TARGET_TIME_COUNT - 1;
+		r.isPolicyFailed = true;
+	}
+	r.partitioning_point = best_point;
+	r.ex_comm = comm_ms[best_point];
+	r.ex_infer = infer_ms[best_point];
+	r.ex_time = target_ms[best_target];
+	r.ex_queue = r.ex_time - r.ex_infer - r.ex_comm;
+	return r;
+}
+
+struct partitioner_result PartitionEngine::DecideMinPower(double SLO, double prob_threshold, int first, int last)
+{
+	// The point that takes the least energy among the ones that meet
+	// the threshold in the longest target time within the deadline.
+	double deadline = local_only_time * SLO;
+	int target = TARGET_TIME_COUNT - 1;
+	while(target >= 0 && target_ms[target] > deadline)
+	{
+		target--;
+	}
+	int point = -1;
+	if(target >= 0)
+	{
+		for(int j = first; j <= last; j++)
+		{
+			if(!is_split_point(server_state.split_point_mask, j, point_count))
+			{
+				continue;
+			}
+			if((point == -1 || power_J[j] < power_J[point]) && Prob(target, j) >= prob_threshold)
+			{
+				point = j;
+			}
+		}
+	}
+
+	struct partitioner_result r;
+	if(point == -1)
+	{
+		r = DecideFastest(prob_threshold, first, last);
+		r.isPolicyFailed = true;
+		return r;
+	}
+	r.partitioning_point = point;
+	r.ex_comm = comm_ms[point];
+	r.ex_infer = server_state.average_infer_time;
+	r.ex_time = target_ms[target];
+	r.ex_queue = r.ex_time - r.ex_infer - r.ex_comm;
+	r.isPolicyFailed = false;
+	return r;
+}
+
+struct partitioner_result PartitionEngine::Decide(int policy, double SLO, double prob_threshold)
+{
+	struct partitioner_result r;
+	if(policy == 0 || policy == 6 || policy == 1 || policy == 7)
+	{
+		if((policy == 1 || policy == 7) && !has_power)
+		{
+			std::cout << "model power size wrong, policy " << policy << " needs the energy of all " << point_count << " points" << std::endl;
+			exit(-1);
+		}
+		if(times_stale)
+		{
+			UpdateTimes();
+		}
+		r = (policy == 0 || policy == 6) ? DecideFastest(prob_threshold, 0, point_count - 1) : DecideMinPower(SLO, prob_threshold, 0, point_count - 1);
+	}
+	else
+	{
+		r.partitioning_point = 0;
+		r.ex_comm = 0;
+		r.ex_queue = 0;
+		r.ex_infer = 0;
+		r.ex_time = 0;
+		r.isPolicyFailed = false;
+	}
+	r.slo_time = local_only_time * SLO;
+	return r;
+}
+
+struct partitioner_result PartitionEngine::Decide(int policy, double SLO, double prob_threshold, int min_point, int max_point)
+{
+	struct partitioner_result r = Decide(policy, SLO, prob_threshold);
+	min_point = std::max(min_point, 0);
+	max_point = std::min(max_point, point_count - 1);
+	if((policy != 0 && policy != 6 && policy != 1 && policy != 7) || min_point > max_point ||
+			(r.partitioning_point >= min_point && r.partitioning_point <= max_point))
+	{
+		return r;
+	}
+	// A point of the range is taken if it meets the policy within the
+	// SLO on the link and the queueing times this client sees.
+	struct partitioner_result hinted = (policy == 0 || policy == 6) ? DecideFastest(prob_threshold, min_point, max_point) : DecideMinPower(SLO, prob_threshold, min_point, max_point);
+	if(hinted.isPolicyFailed || hinted.ex_time > r.slo_time)
+	{
+		return r;
+	}
+	hinted.slo_time = r.slo_time;
+	return hinted;
+}
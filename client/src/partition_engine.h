@@ -0,0 +1,183 @@
+#ifndef PARTITION_ENGINE_H
+#define PARTITION_ENGINE_H
+
+#include <stdint.h>
+#include <vector>
+#include "partitioner.h"
+
+// The target times of a decision are 5% to 100% of the local only time.
+#define TARGET_TIME_COUNT 20
+
+class ModelInfo;
+class ServerInfo;
+
+// The server load a decision depends on, as get_partitioning_point()
+// reads it from ServerInfo.
+struct ServerState
+{
+	ServerState();
+	// The state of 'server_info', reset like ResetServerInfo() does if
+	// it is expired.
+	explicit ServerState(const ServerInfo& server_info);
+	void Assign(const ServerInfo& server_info);
+	bool operator==(const ServerState& other) const;
+
+	bool expired;
+	double last_batch;
+	double last_server_infertime;
+	double average_infer_time;
+	std::vector<double> percentile;
+	std::vector<double> queue_sketch;
+	uint64_t split_point_mask;
+};
+
+// Decides the partitioning point like get_partitioning_point() for
+// policies 0, 1, 6 and 7, without copying the model or the server
+// and without estimating what didn't change since the last decision.
+// The cost of each point is kept in flat arrays, built once for the
+// model. The time to send each activation is looked up in a table of
+// the rounds of TCP slow start, built when the link changes, and the
+// queueing time distribution when the server load changes. Not thread
+// safe.
+class PartitionEngine
+{
+	public:
+		explicit PartitionEngine(const ModelInfo& model_info);
+		// A model with 'point_count' points, the last one executing
+		// the whole model locally. 'dense_bytes' is the size, in the
+		// transfer format, of the activation at each point and
+		// 'server_ms' the server time of every point but the last.
+		// 'local_J' may miss the energy of the last points, policies
+		// 1 and 7 need all of it.
+		PartitionEngine(const std::vector<uint64_t>& dense_bytes, const std::vector<double>& local_ms, const std::vector<double>& server_ms, const std::vector<double>& local_J);
+
+		// Send activations on a link of 'link' Mbps, taking their bits
+		// over the link, as get_partitioning_point() does for policies
+		// 6 and 7.
+		void SetLink(double link);
+		// Send activations on a link of 'link' Mbps with a round trip
+		// of 'rtt_ms', starting from a congestion window of
+		// 'start_cwnd' segments that grows in slow start up to
+		// 'ssthresh' segments, like expect_time_shapes() does.
+		// 'bdp_rtt_ms' is the RTT of the connection in whole ms,
+		// ssthresh drops to the bandwidth delay product over it once
+		// the window reaches it. 'warm_connection' is false if the
+		// connection needs a handshake.
+		void SetLink(double link, double rtt_ms, double bdp_rtt_ms, double start_cwnd, double ssthresh, bool warm_connection);
+		void SetServer(const ServerState& server_state);
+		void SetServer(const ServerInfo& server_info);
+
+		// Decide the point with 'policy' for an 'SLO' relative to the
+		// local only time and a probability threshold, in percent.
+		// Policies 0, 1, 6 and 7 need a link and a server set.
+		struct partitioner_result Decide(int policy, double SLO, double prob_threshold);
+		// Decide like Decide() but take a point in ['min_point',
+		// 'max_point'], the range the server recommends, if one meets
+		// the policy within the SLO.
+		struct partitioner_result Decide(int policy, double SLO, double prob_threshold, int min_point, int max_point);
+
+		// The expected time, in ms, to send the activation at 'point'
+		// on the current link.
+		double CommMs(int point) const { return comm_ms[point]; }
+		// The energy, in J, the device spends on 'point' on the
+		// current link.
+		double PowerJ(int point) const { return power_J[point]; }
+		// The ssthresh expect_time_shapes() leaves the connection with
+		// on the current link.
+		double EndSsthresh() const { return end_ssthresh; }
+
+	private:
+		struct LinkState
+		{
+			double link;
+			bool slow_start;
+			double rtt_ms;
+			double bdp_rtt_ms;
+			double start_cwnd;
+			double ssthresh;
+			bool warm_connection;
+			bool operator==(const LinkState& other) const;
+		};
+
+		// The rounds of slow start from one ssthresh.
+		struct RoundTable
+		{
+			double start_ssthresh;
+			// Per round: the segments sent and the time taken before
+			// it, the window it sends, the window slow start grows to,
+			// cut to the segments left in the last round, 0 out of
+			// slow start, and ssthresh after it.
+			std::vector<double> sent_before;
+			std::vector<double> ms_before;
+			std::vector<double> cwnd;
+			std::vector<double> slow_start_cwnd;
+			std::vector<double> ssthresh_after;
+			// After the last round.
+			double sent;
+			double ms;
+		};
+
+		void Init();
+		void UpdateTimes();
+		void UpdateLink(const LinkState& link_state);
+		// The rounds of slow start from 'ssthresh', as many as sending
+		// 'segments' takes.
+		RoundTable& Rounds(double ssthresh, double segments);
+		void AddRound(RoundTable& table);
+		// The time, in ms, to send 'segments' from 'ssthresh', which
+		// is updated like expect_time_with_given_link() does.
+		double SlowStartMs(double segments, double* ssthresh);
+		// The percentage of queueing times up to 'ms'.
+		double CDF(double ms) const;
+		// The probability, in percent, that 'point' completes within
+		// the target time 'target'.
+		double Prob(int target, int point) const;
+		// The first of the first 'targets' target times 'point' meets
+		// the threshold in, with its probability. 'targets' if none.
+		int FirstTarget(int point, int targets, double prob_threshold, double* prob) const;
+		// Decide among the points from 'first' to 'last' the server
+		// accepts.
+		struct partitioner_result DecideFastest(double prob_threshold, int first, int last);
+		struct partitioner_result DecideMinPower(double SLO, double prob_threshold, int first, int last);
+
+		int point_count;
+		bool has_power;
+		double local_only_time;
+		double target_ms[TARGET_TIME_COUNT];
+
+		// Per point, from the model.
+		std::vector<uint64_t> dense_bytes;
+		std::vector<double> model_local_ms;
+		std::vector<double> model_server_ms;
+		std::vector<double> local_J;
+
+		// Per point, from the link and the encoding chosen for it.
+		bool has_link;
+		LinkState link_state;
+		uint64_t codec_revision;
+		std::vector<double> local_ms;
+		std::vector<double> server_ms;
+		std::vector<double> comm_ms;
+		std::vector<double> power_J;
+		// The rounds of slow start on the current link, one table for
+		// each ssthresh a point starts from.
+		std::vector<RoundTable> round_tables;
+		double link_bits; // the link in bits per second
+		double bdp_cwnd; // the window that fills the link, in segments
+		double end_ssthresh;
+
+		// From the server.
+		bool has_server;
+		ServerState server_state;
+		ServerState pending_state;
+		std::vector<double> sketch_below; // weight of the buckets before each
+		std::vector<double> sketch_upper; // upper bound of each bucket
+		double sketch_total;
+
+		// Per point, from the link and the server, stale once either
+		// changes.
+		bool times_stale;
+		std::vector<double> infer_ms;
+		std::vector<double> without_queue_ms;
+};
+#endif
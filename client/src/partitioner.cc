@@ -2,19 +2,48 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <limits>
 #include "Model.h"
 #include "util.h"
 #include "Server.h"
 #include <cmath>
 #include "partitioner.h"
+#include "transfer_format.h"
+#include "activation_codec.h"
 
 //policy 0 - fastest policy 1 - Min battery policy 2 - Min server computation
 //
 
 #define MAXVALUE 99999
 
-double CDF(ServerInfo server_info, double x)
+// The bits sent for the activation at point 'i', in the encoding
+// chosen for the point on a link of 'link' Mbps.
+static double sent_bits(const ModelInfo& model_info, int i, double link)
 {
+	return CodecProfile::Instance().EncodedBytes(i, transfer_byte_size(model_info.shapes[i]), link) * 8;
+}
+
+// Count the time to encode the activation at each point as local time
+// and the time to decode it as server time.
+static void add_codec_time(ModelInfo& model_info, double link)
+{
+	CodecProfile& codec = CodecProfile::Instance();
+	for(int i = 0; i < model_info.server_inference_time_ms.size(); i++)
+	{
+		model_info.local_inference_time_ms[i] += codec.EncodeMs(i, link);
+		model_info.server_inference_time_ms[i] += codec.DecodeMs(i, link);
+	}
+}
+
+double CDF(const ServerInfo& server_info, double x)
+{
+	// An expired load is decided on as reset by ResetServerInfo(), with
+	// no queueing.
+	if(server_info.isServerInfoExpiredResult)
+		return (x < 0 || server_info.percentile.empty()) ? 0 : 100;
+	double sketch_cdf = server_info.QueueTimeCDF(x);
+	if(sketch_cdf >= 0)
+		return sketch_cdf;
 	if(x< 0)
 		return 0;
 	int start = 0;
@@ -36,7 +65,7 @@ double CDF(ServerInfo server_info, double x)
 	}
 	return ret;
 }
-std::vector<std::vector<double>> gen_probs(std::vector<double> communication_time_ms, ModelInfo model_info, ServerInfo server_info, std::vector<double>& ex_infer)
+std::vector<std::vector<double>> gen_probs(std::vector<double> communication_time_ms, ModelInfo model_info, const ServerInfo& server_info, std::vector<double>& ex_infer)
 {
 
 	std::vector<std::vector<double>> probs;
@@ -120,9 +149,10 @@ double comm_power(double datasize_bit, double time)
 	return ((283.17*th+132.86)*time) / 1000000; //j
 }
 
-struct partitioner_result get_partitioning_point_baseline(int link, ModelInfo model_info, ServerInfo server_info, int policy, double SLO)
+struct partitioner_result get_partitioning_point_baseline(double link, ModelInfo model_info, ServerInfo& server_info, int policy, double SLO)
 {
 	server_info.GetServerInfoNoRefresh();
+	add_codec_time(model_info, link);
 	std::vector<double> comm_time;
 	std::vector<double> server_time;
 	std::vector<double> expected_inference_time;
@@ -132,7 +162,7 @@ struct partitioner_result get_partitioning_point_baseline(int link, ModelInfo mo
 	
 	for(int i = 0; i < model_info.shapes.size(); i++)
 	{
-		double datasize_bits = vector_mul(model_info.shapes[i]) *4 *8;
+		double datasize_bits = sent_bits(model_info, i, link);
 		double expected_comm = datasize_bits / ((double)link * 1024 * 1024);
 		comm_time.push_back(expected_comm * 1000);
 	}
@@ -159,8 +189,11 @@ struct partitioner_result get_partitioning_point_baseline(int link, ModelInfo mo
 	for(int i = 0; i < comm_time.size(); i++)
 	{
 		double expected_time = comm_time[i] + server_time[i] + model_info.local_inference_time_ms[i];
+		// A point the server rejects is never chosen.
+		if(!is_split_point(server_info.split_point_mask, i, comm_time.size()))
+			expected_time = std::numeric_limits<double>::infinity();
 	//	std::cout << i << " " << comm_time[i] << "  " <<  server_time[i] << " " << model_info.local_inference_time_ms[i] << " " << expected_time <<  " " << link <<std::endl;
-		double sum = comm_power(vector_mul(model_info.shapes[i])*4*8, comm_time[i]) + model_info.local_power_consumption_J[i];
+		double sum = comm_power(sent_bits(model_info, i, link), comm_time[i]) + model_info.local_power_consumption_J[i];
 		power_estimation.push_back(sum);
  
 		expected_inference_time.push_back(expected_time);
@@ -202,31 +235,30 @@ struct partitioner_result get_partitioning_point_baseline(int link, ModelInfo mo
 
 	return r;
 }
-struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, ModelInfo model_info, ServerInfo server_info,  int policy, double SLO, double prob_threshold)
+struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, double link, ModelInfo model_info, const ServerInfo& server_info,  int policy, double SLO, double prob_threshold)
 {
-	if(server_info.isServerInfoExpiredResult)
-	{
-		server_info.ResetServerInfo();
-	}
-	
 	std::vector<double> comm_time;	
 	std::vector<std::vector<double>> probs;
 	
 
+	// The communication times given are for the encodings chosen for
+	// the link they were estimated with.
 	if (policy == 0 || policy == 1 || policy ==2)
 	{
 		comm_time.assign(communication_time_ms.begin(), communication_time_ms.end());
 	}
 	else
 	{
+		link = server_info.link_capacity;
 		for(int i = 0; i < model_info.shapes.size(); i++)
 		{
-			double datasize_bits = vector_mul(model_info.shapes[i]) *4 *8;
+			double datasize_bits = sent_bits(model_info, i, link);
 			double expected_comm = datasize_bits / ((double)server_info.link_capacity * 1024 * 1024);
 			comm_time.push_back(expected_comm * 1000);
 		}
 
 	}	
+	add_codec_time(model_info, link);
 	std::vector<double> ex_infer;	
 	probs 	= gen_probs(comm_time, model_info , server_info, ex_infer);
 	
@@ -281,7 +313,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 			std::vector<int> satisfied_partitioning_prob;
 			for(int j = 0; j < prob.size(); j++)
 			{
-				if(prob[j] >= prob_threshold)
+				if(prob[j] >= prob_threshold && is_split_point(server_info.split_point_mask, j, prob.size()))
 				{
 					satisfied_partitioning_point.push_back(j);
 					satisfied_partitioning_prob.push_back(prob[j]);
@@ -335,7 +367,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 
 		for(int i = 0 ; i < model_info.local_power_consumption_J.size() ; i++)
 		{
-			double sum = comm_power(vector_mul(model_info.shapes[i])*4*8, comm_time[i]) + model_info.local_power_consumption_J[i];
+			double sum = comm_power(sent_bits(model_info, i, link), comm_time[i]) + model_info.local_power_consumption_J[i];
 			power_estimation.push_back(sum);
 		}
 
@@ -354,7 +386,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 			prob.assign(probs[i].begin(), probs[i].end());
 			for(int j = 0; j < prob.size(); j++)
 			{
-				if(prob[j] >= prob_threshold)
+				if(prob[j] >= prob_threshold && is_split_point(server_info.split_point_mask, j, prob.size()))
 				{
 					satisfied_partitioning_point.push_back(j);
 					satisfied_partitioning_point_time.push_back(target_times[i]);
@@ -378,12 +410,12 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 		{
 			std::cout << "RUN POLICY 0" << std::endl;
 			if(policy == 1){
-			r = get_partitioning_point(communication_time_ms, model_info, server_info, 0, SLO, prob_threshold);
+			r = get_partitioning_point(communication_time_ms, link, model_info, server_info, 0, SLO, prob_threshold);
 		        r.isPolicyFailed = 1;}
 			else if(policy == 7)
 			{
 				
-			r = get_partitioning_point(communication_time_ms, model_info, server_info, 6, SLO, prob_threshold);
+			r = get_partitioning_point(communication_time_ms, link, model_info, server_info, 6, SLO, prob_threshold);
 
 		        r.isPolicyFailed = 1;}
 			return r;
@@ -394,7 +426,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 		//partitioning_point = 48;
 		r.partitioning_point = point;
 		r.ex_comm = comm_time[r.partitioning_point];
-		r.ex_infer = server_info.average_infer_time;
+		r.ex_infer = server_info.isServerInfoExpiredResult ? 0 : server_info.average_infer_time;
 		r.isPolicyFailed = 0;
 		
 		r.ex_time = expected_time;
@@ -411,7 +443,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 
 }
 /*
-struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, ModelInfo model_info, ServerInfo server_info,  int policy, double SLO, double queue_factor)
+struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, ModelInfo model_info, const ServerInfo& server_info,  int policy, double SLO, double queue_factor)
 {
 	std::vector<double> time_estimation;
 	std::vector<double> power_estimation;
@@ -485,7 +517,7 @@ struct partitioner_result get_partitioning_point(std::vector<double> communicati
 
 	for(int i = 0 ; i < model_info.local_power_consumption_J.size() ; i++)
 	{
-		double sum = comm_power(vector_mul(model_info.shapes[i])*4*8, communication_time_ms[i]) + model_info.local_power_consumption_J[i];
+		double sum = comm_power(sent_bits(model_info, i), communication_time_ms[i]) + model_info.local_power_consumption_J[i];
 		power_estimation.push_back(sum);
 	}
 	
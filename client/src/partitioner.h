@@ -3,6 +3,9 @@
 
 #include <vector>
 
+class ModelInfo;
+class ServerInfo;
+
 struct partitioner_result{
 
 	int partitioning_point;
@@ -14,7 +17,11 @@ struct partitioner_result{
 	bool isPolicyFailed;
 };
 
-struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, ModelInfo model_info, ServerInfo server_info,  int policy, double SLO, double queue_factor);
+// 'communication_time_ms' is estimated on a link of 'link' Mbps.
+struct partitioner_result get_partitioning_point(std::vector<double> communication_time_ms, double link, ModelInfo model_info, const ServerInfo& server_info,  int policy, double SLO, double queue_factor);
+
+// The energy, in J, to send 'datasize_bit' bits in 'time' ms.
+double comm_power(double datasize_bit, double time);
 
-struct partitioner_result get_partitioning_point_baseline(int link, ModelInfo model_info, ServerInfo server_info, int policy, double SLO);
+struct partitioner_result get_partitioning_point_baseline(double link, ModelInfo model_info, ServerInfo& server_info, int policy, double SLO);
 #endif
@@ -2,32 +2,40 @@
 #include "Server.h"
 
 struct tcp_info send_infer(std::string model_name, std::vector<float> serverside_input, int partitioning_point, 
-		std::vector<int64_t> serverside_shape, struct diamond_results &diamond_result, ServerInfo &server_info)
+		uint64_t deadline_us, std::vector<int64_t> serverside_shape, struct diamond_results &diamond_result, ServerInfo &server_info)
 {
-	nic::Headers http_headers;
-	std::unique_ptr<nic::InferenceServerHttpClient> client;
+	struct tcp_info ret;
 	FAIL_IF_ERR(
-			nic::InferenceServerHttpClient::Create(&client, URL, false),
-			"unable to create http client");
+			send_infer(model_name, serverside_input.data(), serverside_input.size() * sizeof(float), "FP32", std::vector<float>(), ENCODING_RAW, partitioning_point, deadline_us, serverside_shape, diamond_result, server_info, &ret),
+			"unable to run inference");
+	return ret;
+}
+
+nic::Error send_infer(std::string model_name, const void* serverside_input, size_t serverside_input_byte_size, const std::string& datatype, const std::vector<float>& scale, Encoding encoding, int partitioning_point, 
+		uint64_t deadline_us, std::vector<int64_t> serverside_shape, struct diamond_results &diamond_result, ServerInfo &server_info, struct tcp_info* tcp_info, nic::InferInput::ReadyFn ready)
+{
+	nic::Headers http_headers;
 	nic::InferInput* input;
 
-	FAIL_IF_ERR(nic::InferInput::Create(&input, "INPUT__0", serverside_shape, "FP32"),"unable to get INPUT0");
+	FAIL_IF_ERR(nic::InferInput::Create(&input, "INPUT__0", serverside_shape, datatype),"unable to get INPUT0");
 	std::shared_ptr<nic::InferInput> input_ptr;
 	input_ptr.reset(input);
 
 	//FAIL_IF_ERR(input_ptr->AppendRaw(serverside_input), "unable to set data for INPUT0"); // for uint8 vector
 
+	// The client library reads the input from the buffer while sending
+	// the request, it doesn't keep a copy.
 	FAIL_IF_ERR(
 			input_ptr->AppendRaw(
-				reinterpret_cast<uint8_t*>(&serverside_input[0]),
-				serverside_input.size() * sizeof(int32_t)),
+				reinterpret_cast<const uint8_t*>(serverside_input),
+				serverside_input_byte_size, ready),
 			"unable to set data for INPUT0");
 
 	// Generate the outputs to be requested.
 	nic::InferRequestedOutput* output;
 
 	FAIL_IF_ERR(
-			nic::InferRequestedOutput::Create(&output, "OUTPUT__0"),
+			nic::InferRequestedOutput::Create(&output, "OUTPUT__0", TOPK_CLASSES),
 			"unable to get 'OUTPUT0'");
 	std::shared_ptr<nic::InferRequestedOutput> output_ptr;
 	output_ptr.reset(output);
@@ -35,17 +43,55 @@ struct tcp_info send_infer(std::string model_name, std::vector<float> serverside
 	// The inference settings. Will be using default for now.
 	nic::InferOptions options(model_name);
 	options.partitioning_point_ = partitioning_point;
+	options.deadline_ = deadline_us;
+	options.input_scale_ = scale;
+	if(encoding != ENCODING_RAW)
+		options.input_encoding_ = encoding_name(encoding);
 
 	std::vector<nic::InferInput*> inputs = {input_ptr.get()};
 	std::vector<const nic::InferRequestedOutput*> outputs = {output_ptr.get()};
 
+	// The connection to the server is kept across requests.
 	nic::InferResult* results;
-	struct tcp_info ret = client->Infer_with_tcpinfo(&results, options, inputs, outputs, http_headers);
+	nic::Error err = ConnectionManager::Instance().Infer(server_info.url, &results, options, inputs, outputs, http_headers, tcp_info);
+	if(!err.IsOk())
+	{
+		return err;
+	}
 
 	uint64_t end = get_current_unixtime();
 
 	std::shared_ptr<nic::InferResult> results_ptr;
 	results_ptr.reset(results);
+	err = read_infer_result(results_ptr.get(), diamond_result, server_info);
+	if(!err.IsOk() || diamond_result.rejected)
+	{
+		return err;
+	}
+
+	uint64_t before_return = get_current_unixtime();
+	
+	std::cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>result snd_cwnd " <<tcp_info->tcpi_snd_cwnd << "rtt " << tcp_info->tcpi_rtt<< "sstshresh" << tcp_info->tcpi_snd_ssthresh<< std::endl;
+	return nic::Error::Success;
+}
+
+nic::Error read_infer_result(nic::InferResult* results_ptr, struct diamond_results &diamond_result, ServerInfo &server_info)
+{
+	diamond_result.rejected = false;
+	diamond_result.predicted_wait_ms = 0;
+	diamond_result.hint_min_point = -1;
+	diamond_result.hint_max_point = -1;
+	if(!results_ptr->RequestStatus().IsOk())
+	{
+		uint64_t wait_us = 0;
+		if(results_ptr->PredictedWait(&wait_us).IsOk())
+		{
+			diamond_result.rejected = true;
+			diamond_result.predicted_wait_ms = wait_us / 1000.0;
+			return nic::Error::Success;
+		}
+		return results_ptr->RequestStatus();
+	}
 
 	std::string queue_ns;
 	std::string infer_ns;
@@ -87,39 +133,50 @@ struct tcp_info send_infer(std::string model_name, std::vector<float> serverside
 		server_info.last_batch = c;
 	server_info.last_server_infertime = infer_ms;
 
+	int64_t hint_min_point, hint_max_point;
+	if(results_ptr->PartitionHint(&hint_min_point, &hint_max_point).IsOk() && hint_min_point >= 0)
+	{
+		diamond_result.hint_min_point = hint_min_point;
+		diamond_result.hint_max_point = hint_max_point;
+		server_info.SetPartitionHint(hint_min_point, hint_max_point);
+	}
+
 	// Get pointers to the result returned...
 	
 	//struct tcp_info info;
         //memcpy(&info, &results_ptr->info, sizeof(struct tcp_info));	
 	//std::cout << "rtt : " << info.tcpi_rtt << std::endl;
 	
-	float* output_data;
+	// The server selects the top classes, each is a 4 byte length
+	// followed by "score:index" or "score:index:label", best first.
+	const uint8_t* output_data;
 	size_t output_byte_size;
-	FAIL_IF_ERR(
-			results_ptr->RawData(
-				"OUTPUT__0", (const uint8_t**)&output_data, &output_byte_size),
-			"unable to get result data for 'OUTPUT0'");
-
-
-	int max = 0;
-	for(int i = 0; i < (int)output_byte_size/4 ;i=i+4)
+	nic::Error err = results_ptr->RawData("OUTPUT__0", &output_data, &output_byte_size);
+	if(!err.IsOk())
 	{
-		float value = 0;
-		int index = i;
-		unsigned char b[] = { (const uint8_t)output_data[index], (const uint8_t)output_data[index + 1], (const uint8_t)output_data[index + 2], (const uint8_t) output_data[index + 3] }; //4byte
-		memcpy(&value, &b, sizeof(float));
+		return err;
+	}
 
-		if(output_data[i] >= output_data[max])
-		{
-			max = i;
-		}
+	diamond_result.topk.clear();
+	size_t pos = 0;
+	while(pos + sizeof(uint32_t) <= output_byte_size)
+	{
+		uint32_t len;
+		memcpy(&len, output_data + pos, sizeof(len));
+		pos += sizeof(len);
+		if(len > output_byte_size - pos)
+			break;
+		std::string cls(reinterpret_cast<const char*>(output_data + pos), len);
+		pos += len;
+
+		size_t colon = cls.find(':');
+		if(colon == std::string::npos)
+			continue;
+		diamond_result.topk.emplace_back(atoi(cls.c_str() + colon + 1), strtof(cls.c_str(), nullptr));
 	}
-	
-	diamond_result.top1 = max;
-	uint64_t before_return = get_current_unixtime();
-	
-	std::cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>result snd_cwnd " <<ret.tcpi_snd_cwnd << "rtt " << ret.tcpi_rtt<< "sstshresh" << ret.tcpi_snd_ssthresh<< std::endl;
-	return ret;
+
+	diamond_result.top1 = diamond_result.topk.empty() ? 0 : diamond_result.topk[0].first;
+	return nic::Error::Success;
 }
 
 void infer_result_analysis(struct diamond_results return_diamond_result, double *queue_ms, double *infer_ms, int *top1, std::string &queue_contents, std::string &num_of_batch, std::string &arrival_rate, std::string &last_batch_size, std::string &last_partitioning_point, std::string &last_inference_start, std::string &current_inference_start, std::string &request_enqueue_time, int *server_capacity)
@@ -10,7 +10,11 @@
 #include <sys/socket.h>
 #include <string>
 #include "Server.h"
+#include "connection_manager.h"
+#include "activation_codec.h"
 #define URL "210.107.197.107:8000"
+// The number of top classes the server returns in place of the output.
+#define TOPK_CLASSES 5
 namespace nic = nvidia::inferenceserver::client;
 namespace ni = nvidia::inferenceserver;
 
@@ -18,6 +22,8 @@ namespace ni = nvidia::inferenceserver;
 struct diamond_results
 {
 	int top1;
+	// The top TOPK_CLASSES classes, index and score, best first.
+	std::vector<std::pair<int, float>> topk;
 	
 	double queue_ms;
 	double infer_ms;
@@ -33,9 +39,36 @@ struct diamond_results
 	
 	std::string request_enqueue_time;
 	std::string server_capacity; 
+
+	// Set if the server rejected the request because it would miss its
+	// deadline, with the queueing time the server predicted.
+	bool rejected;
+	double predicted_wait_ms;
+
+	// The range of partitioning points the server recommends for the
+	// next request, -1 if it doesn't recommend one.
+	int hint_min_point;
+	int hint_max_point;
 };
 
-struct tcp_info send_infer(std::string model_name, std::vector<float> serverside_input, int partitioning_point, std::vector<int64_t> serverside_shape, struct diamond_results &result, ServerInfo &server_info);
+// 'deadline_us' is the time left for the server to answer, 0 for no deadline.
+struct tcp_info send_infer(std::string model_name, std::vector<float> serverside_input, int partitioning_point, uint64_t deadline_us, std::vector<int64_t> serverside_shape, struct diamond_results &result, ServerInfo &server_info);
+
+// As above, but the 'serverside_input_byte_size' bytes at
+// 'serverside_input' are borrowed and sent as they are, without being
+// copied first. 'datatype' is the protocol name of their data type,
+// 'scale', if not empty, the scale the server multiplies them by and
+// 'encoding' the encoding they are in. 'ready', if set, waits until a
+// part of them is written, they are then sent as they are written.
+// The state of the connection is returned in 'tcp_info'. Returns the
+// error if the request couldn't be sent, got no answer or failed on
+// the server for another reason than the server rejecting it.
+nic::Error send_infer(std::string model_name, const void* serverside_input, size_t serverside_input_byte_size, const std::string& datatype, const std::vector<float>& scale, Encoding encoding, int partitioning_point, uint64_t deadline_us, std::vector<int64_t> serverside_shape, struct diamond_results &result, ServerInfo &server_info, struct tcp_info* tcp_info, nic::InferInput::ReadyFn ready = nullptr);
+
+// Read 'results' into 'result' and the server load reported with it
+// into 'server_info'. Returns the error if the request failed for
+// another reason than the server rejecting it.
+nic::Error read_infer_result(nic::InferResult* results, struct diamond_results &result, ServerInfo &server_info);
 		
 void infer_result_analysis(struct diamond_results return_diamond_result, double *queue_ms, double *infer_ms, int *top1, std::string &queue_contents, std::string &num_of_batch, std::string &arrival_rate, std::string &last_batch_size, std::string &last_partitioning_point, std::string &last_inference_start, std::string &current_inference_start, std::string &request_enqueue_time, int *server_capacity);
 
@@ -8,7 +8,7 @@
 #include "util.h"
 
 
-double servertime_estimation(ServerInfo server_info, ModelInfo model_info)
+double servertime_estimation(const ServerInfo& server_info, ModelInfo model_info)
 {
 
 	double R = 1/server_info.average_throughput * server_info.average_batch + server_info.average_queue_time/1000;
@@ -1 +1 @@
-double servertime_estimation(ServerInfo server_info, ModelInfo model_info);
+double servertime_estimation(const ServerInfo& server_info, ModelInfo model_info);
@@ -0,0 +1,190 @@
+#include "server_set.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Model.h"
+#include "util.h"
+#include "send_request.h"
+#include "connection_manager.h"
+
+ServerCandidate::ServerCandidate(const std::string& url, const ModelInfo& model_info, int max_link)
+	: info(url), comm(max_link), model_info(model_info)
+{
+	decided_link = max_link;
+	queue_baseline_ms = 0;
+	queue_report_us = 0;
+	holdoff_until = 0;
+}
+
+struct partitioner_result ServerCandidate::Decide(int policy, double SLO, double prob_threshold)
+{
+	if(!engine)
+		engine.reset(new PartitionEngine(model_info));
+	if(policy == 6 || policy == 7)
+	{
+		decided_link = info.link_capacity;
+		engine->SetLink(decided_link);
+	}
+	else
+	{
+		double measured_rtt = comm.refresh_connection_state(info);
+		decided_link = comm.LINK;
+		engine->SetLink(decided_link, measured_rtt, comm.current_tcp_info.tcpi_rtt / 1000, comm.start_cwnd, comm.current_tcp_info.tcpi_snd_ssthresh, comm.warm_connection);
+		// The estimate lowers ssthresh to the window that fills the
+		// link for the decisions after it, as expect_time_shapes() does.
+		comm.current_tcp_info.tcpi_snd_ssthresh = engine->EndSsthresh();
+	}
+	engine->SetServer(info);
+	// Follow the range of points the server recommends when one of them
+	// suits this client, so that clients spread over the points.
+	int hint_min_point, hint_max_point;
+	if(info.PartitionHint(&hint_min_point, &hint_max_point))
+		return engine->Decide(policy, SLO, prob_threshold, hint_min_point, hint_max_point);
+	return engine->Decide(policy, SLO, prob_threshold);
+}
+
+void ServerCandidate::Refresh()
+{
+	std::cout << "info update " << info.url << std::endl;
+	info.GetServerInfo();
+	comm.Init(info.rtt);
+	link_estimator.Reset();
+	comm.LINK = std::min( (double)comm.MAX_LINK, (double)info.CURRENT_SERVER_CAPACITY );
+	info.link_capacity = comm.LINK;
+	info.last_batch = 0;
+	info.last_server_infertime = 0;
+}
+
+void ServerCandidate::AddTransfer(uint64_t sent_bytes, double comm_ms, double server_capacity, uint64_t now_ms)
+{
+	// Estimate the link from the delivery rate the kernel sampled, or
+	// from the time of the transfer on a kernel that doesn't report it.
+	TcpDeliveryInfo delivery_info;
+	if(ConnectionManager::Instance().DeliveryInfo(info.url, &delivery_info))
+		link_estimator.AddTcpInfo(delivery_info, now_ms);
+	else
+		link_estimator.AddTransfer(sent_bytes, comm_ms, now_ms);
+	BandwidthEstimator::Estimate link_estimate;
+	if(link_estimator.GetEstimate(now_ms, &link_estimate))
+	{
+		std::cout << "expected link " << link_estimate.bandwidth_mbps << " (" << link_estimate.lower_mbps << " - " << link_estimate.upper_mbps << ", " << link_estimate.samples << " samples)" << std::endl;
+		// Decide on the lower end of the interval, a point that meets
+		// its target there still does when the link drops within it.
+		comm.LINK = std::min(link_estimate.lower_mbps, server_capacity);
+	}
+}
+
+ServerSet::ServerSet(const ModelInfo& model_info, int max_link)
+{
+	const char* env = std::getenv("DIAMOND_SERVERS");
+	if(env != nullptr)
+	{
+		std::stringstream servers(env);
+		std::string url;
+		while(std::getline(servers, url, ','))
+		{
+			url.erase(0, url.find_first_not_of(" \t"));
+			url.erase(url.find_last_not_of(" \t") + 1);
+			if(!url.empty())
+				candidates.emplace_back(new ServerCandidate(url, model_info, max_link));
+		}
+	}
+	if(candidates.empty())
+		candidates.emplace_back(new ServerCandidate(URL, model_info, max_link));
+	first = getpid() % candidates.size();
+}
+
+void ServerSet::Start()
+{
+	for(auto& candidate : candidates)
+	{
+		candidate->info.StartLoadStream();
+		candidate->info.GetServerInfo();
+		candidate->comm.Init(candidate->info.rtt);
+	}
+}
+
+void ServerSet::HoldOff(size_t index, uint64_t now_ms)
+{
+	candidates[index]->holdoff_until = now_ms + SERVER_HOLDOFF_MS;
+}
+
+bool ServerSet::Available(const ServerCandidate& candidate, uint64_t now_ms)
+{
+	// The load is refreshed before the decision, so a server whose
+	// load is still expired didn't answer.
+	return now_ms >= candidate.holdoff_until && !candidate.info.isMyInfoExpired();
+}
+
+void ServerSet::CheckQueue(ServerCandidate& candidate, uint64_t now_ms)
+{
+	// The same report is seen by every decision until the next one, it
+	// counts once.
+	if(candidate.info.server_information_update_time == candidate.queue_report_us)
+		return;
+	candidate.queue_report_us = candidate.info.server_information_update_time;
+	double queue_ms = candidate.info.average_queue_time;
+	if(candidate.queue_baseline_ms > 0 && queue_ms > QUEUE_SPIKE_MIN_MS && queue_ms > QUEUE_SPIKE_FACTOR * candidate.queue_baseline_ms)
+	{
+		std::cout << "queue spike " << candidate.info.url << " " << queue_ms << " ms" << std::endl;
+		candidate.holdoff_until = now_ms + SERVER_HOLDOFF_MS;
+	}
+	// The usual queueing time follows a load that stays.
+	if(candidate.queue_baseline_ms == 0)
+		candidate.queue_baseline_ms = queue_ms;
+	else
+		candidate.queue_baseline_ms += QUEUE_BASELINE_WEIGHT * (queue_ms - candidate.queue_baseline_ms);
+}
+
+bool ServerSet::Better(int policy, const ServerCandidate& a, const struct partitioner_result& ra, const ServerCandidate& b, const struct partitioner_result& rb)
+{
+	if(ra.isPolicyFailed != rb.isPolicyFailed)
+		return !ra.isPolicyFailed;
+	if(policy == 1 || policy == 7)
+	{
+		double power_a = a.engine->PowerJ(ra.partitioning_point);
+		double power_b = b.engine->PowerJ(rb.partitioning_point);
+		if(power_a != power_b)
+			return power_a < power_b;
+	}
+	if(ra.ex_time != rb.ex_time)
+		return ra.ex_time < rb.ex_time;
+	// The target times are the same on every server, the one that
+	// leaves more of it for queueing meets it more surely.
+	if(ra.ex_queue != rb.ex_queue)
+		return ra.ex_queue > rb.ex_queue;
+	return a.info.average_queue_time < b.info.average_queue_time;
+}
+
+struct partitioner_result ServerSet::Decide(int policy, double SLO, double prob_threshold, bool cold_start, size_t* target)
+{
+	uint64_t now_ms = get_current_unixtime();
+	bool any_available = false;
+	for(auto& candidate : candidates)
+	{
+		if(cold_start || candidate->info.isMyInfoExpired())
+			candidate->Refresh();
+		CheckQueue(*candidate, now_ms);
+		any_available = any_available || Available(*candidate, now_ms);
+	}
+
+	struct partitioner_result best_result;
+	size_t best = candidates.size();
+	for(size_t i = 0; i < candidates.size(); i++)
+	{
+		size_t index = (first + i) % candidates.size();
+		ServerCandidate& candidate = *candidates[index];
+		if(any_available && !Available(candidate, now_ms))
+			continue;
+		struct partitioner_result result = candidate.Decide(policy, SLO, prob_threshold);
+		if(best == candidates.size() || Better(policy, candidate, result, *candidates[best], best_result))
+		{
+			best = index;
+			best_result = result;
+		}
+	}
+	*target = best;
+	return best_result;
+}
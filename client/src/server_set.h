@@ -0,0 +1,99 @@
+#ifndef SERVER_SET_H
+#define SERVER_SET_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Server.h"
+#include "comm_online_profiler.h"
+#include "bandwidth_estimator.h"
+#include "partition_engine.h"
+#include "partitioner.h"
+
+class ModelInfo;
+
+// A server whose mean queueing time jumps past this many times the one
+// it usually reports, and past QUEUE_SPIKE_MIN_MS, gets no request for
+// SERVER_HOLDOFF_MS. So does a server that rejects a request.
+#define QUEUE_SPIKE_FACTOR 3
+#define QUEUE_SPIKE_MIN_MS 5
+#define QUEUE_BASELINE_WEIGHT 0.1 // weight of a new report in the usual queueing time
+#define SERVER_HOLDOFF_MS 1000
+
+// A server the client can send requests to, with what the client knows
+// of it: its load, the connection to it and the link on the way.
+struct ServerCandidate
+{
+	ServerCandidate(const std::string& url, const ModelInfo& model_info, int max_link);
+
+	// Decide the partitioning point on this server with policy 0, 1, 6
+	// or 7, on its link and load.
+	struct partitioner_result Decide(int policy, double SLO, double prob_threshold);
+	// Fetch the load of the server and forget the link estimate, as on
+	// a cold start.
+	void Refresh();
+	// Estimate the link from a transfer of 'sent_bytes' that took
+	// 'comm_ms', up to the 'server_capacity' the server reported.
+	void AddTransfer(uint64_t sent_bytes, double comm_ms, double server_capacity, uint64_t now_ms);
+
+	ServerInfo info;
+	Communication comm;
+	BandwidthEstimator link_estimator;
+	const ModelInfo& model_info;
+	// Built by the first decision, the policies that don't decide on
+	// the server don't need it.
+	std::unique_ptr<PartitionEngine> engine;
+	// The link the latest decision sent activations on, in Mbps. The
+	// activations sent to the server are encoded for it.
+	double decided_link;
+	// The mean queueing time the server usually reports, in ms. 0 until
+	// it reported one.
+	double queue_baseline_ms;
+	// The update time, in us, of the load report the queueing time was
+	// last checked in.
+	uint64_t queue_report_us;
+	// No request is sent to the server until then, in ms.
+	uint64_t holdoff_until;
+};
+
+// The servers the client can send requests to, from the DIAMOND_SERVERS
+// environment variable, a comma separated list of host:port. The
+// server of URL if it isn't set. The point and the server of a request
+// are decided together: each server available gets the point that is
+// best on it and the best of them wins. A server is not available
+// while its load is stale or it is held off, and all of them are if
+// none is.
+class ServerSet
+{
+	public:
+		ServerSet(const ModelInfo& model_info, int max_link);
+
+		size_t Size() const { return candidates.size(); }
+		ServerCandidate& Get(size_t index) { return *candidates[index]; }
+
+		// Start the load stream of each server and fetch its load.
+		void Start();
+
+		// Decide the server and the partitioning point with policy 0,
+		// 1, 6 or 7. 'cold_start' refreshes every server first. The
+		// server is returned in 'target'.
+		struct partitioner_result Decide(int policy, double SLO, double prob_threshold, bool cold_start, size_t* target);
+
+		// Send no request to server 'index' for a while.
+		void HoldOff(size_t index, uint64_t now_ms);
+
+	private:
+		bool Available(const ServerCandidate& candidate, uint64_t now_ms);
+		// Hold the server off if its queueing time spikes in a load
+		// report it didn't check yet.
+		void CheckQueue(ServerCandidate& candidate, uint64_t now_ms);
+		// Whether 'a' with its point 'ra' is better than 'b' with 'rb'.
+		bool Better(int policy, const ServerCandidate& a, const struct partitioner_result& ra, const ServerCandidate& b, const struct partitioner_result& rb);
+
+		std::vector<std::unique_ptr<ServerCandidate>> candidates;
+		// Ties go to the first server from this one, which differs
+		// between clients so they don't all pick the same server.
+		size_t first;
+};
+#endif
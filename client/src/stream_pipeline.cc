@@ -0,0 +1,291 @@
+#include "stream_pipeline.h"
+#include <algorithm>
+#include <iostream>
+#include "util.h"
+#include "connection_manager.h"
+
+FramePipeline::FramePipeline(torch::jit::script::Module model, const std::string& model_name, int local_only_point, ServerSet* servers, std::mutex* server_info_mtx, DecideFn decide, DeliverFn deliver, size_t max_in_flight)
+	: model(model), model_name(model_name), local_only_point(local_only_point),
+	servers(servers), server_info_mtx(server_info_mtx), decide(decide),
+	deliver(deliver), max_in_flight(std::max((size_t)1, max_in_flight)),
+	exiting(false), next_frame_id(0), next_delivery_id(0), delivered_count(0),
+	upload_queues(servers->Size()), uploading(servers->Size(), false)
+{
+	local_thread = std::thread(&FramePipeline::LocalLoop, this);
+	deliver_thread = std::thread(&FramePipeline::DeliverLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		exiting = true;
+	}
+	cv.notify_all();
+	local_thread.join();
+	deliver_thread.join();
+}
+
+void FramePipeline::Submit(torch::Tensor input, std::shared_ptr<const std::vector<uint8_t>> image)
+{
+	std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+	frame->input = input;
+	frame->image = image;
+	frame->done = false;
+	frame->result.local_execution = false;
+	frame->result.submit_time = get_current_unixtime();
+
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [this] { return in_flight.size() < max_in_flight; });
+		frame->result.frame_id = next_frame_id++;
+		in_flight[frame->result.frame_id] = frame;
+		local_queue.push_back(frame);
+	}
+	cv.notify_all();
+}
+
+void FramePipeline::Flush()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	cv.wait(lock, [this] { return delivered_count == next_frame_id; });
+}
+
+void FramePipeline::LocalLoop()
+{
+	while(1)
+	{
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			cv.wait(lock, [this] { return exiting || !local_queue.empty(); });
+			if(local_queue.empty())
+			{
+				return;
+			}
+			frame = local_queue.front();
+			local_queue.pop_front();
+		}
+
+		int partitioning_point;
+		double link;
+		{
+			std::lock_guard<std::mutex> lock(*server_info_mtx);
+			frame->target = 0;
+			partitioning_point = decide(frame->result.frame_id, &frame->target);
+			link = servers->Get(frame->target).decided_link;
+		}
+		frame->result.partitioning_point = partitioning_point;
+
+		// The output is copied to the host before it is uploaded.
+		at::Tensor local_output = execute_local_parts(model, frame->input, partitioning_point, frame->serverside_shape);
+		frame->result.local_end = get_current_unixtime();
+		frame->result.result.rejected = false;
+
+		if(partitioning_point == local_only_point)
+		{
+			frame->result.local_execution = true;
+			frame->result.result.top1 = local_output.argmax().item<int64_t>();
+			frame->result.remote_end = frame->result.local_end;
+			Complete(frame);
+			continue;
+		}
+		frame->local_output = local_output;
+
+		if(frame->image != nullptr && CodecProfile::Instance().SendImage(partitioning_point, link))
+		{
+			frame->encoding = ENCODING_JPEG;
+		}
+		else
+		{
+			frame->serverside_input = to_transfer_format(local_output, frame->serverside_shape, frame->scale);
+			frame->encoding = CodecProfile::Instance().Encode(partitioning_point, link, frame->serverside_input.data_ptr(), frame->serverside_input.nbytes(), frame->serverside_input.element_size(), frame->encoded);
+		}
+		Upload(frame);
+	}
+}
+
+void FramePipeline::Upload(std::shared_ptr<Frame> frame)
+{
+	// The client sends concurrent requests on connections of their
+	// own, so a frame waits for the one before it to be answered.
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if(uploading[frame->target])
+		{
+			upload_queues[frame->target].push_back(frame);
+			return;
+		}
+		uploading[frame->target] = true;
+	}
+	Send(frame);
+}
+
+void FramePipeline::SendNext(size_t target)
+{
+	std::shared_ptr<Frame> frame;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if(upload_queues[target].empty())
+		{
+			uploading[target] = false;
+			return;
+		}
+		frame = upload_queues[target].front();
+		upload_queues[target].pop_front();
+	}
+	Send(frame);
+}
+
+void FramePipeline::Send(std::shared_ptr<Frame> frame)
+{
+	// The image is decoded by the server into the input, which is FP32.
+	const uint8_t* data;
+	size_t byte_size;
+	if(frame->encoding == ENCODING_JPEG)
+	{
+		data = frame->image->data();
+		byte_size = frame->image->size();
+	}
+	else if(frame->encoding == ENCODING_RAW)
+	{
+		data = reinterpret_cast<const uint8_t*>(frame->serverside_input.data_ptr());
+		byte_size = frame->serverside_input.nbytes();
+	}
+	else
+	{
+		data = frame->encoded.data();
+		byte_size = frame->encoded.size();
+	}
+
+	nic::InferInput* input;
+	FAIL_IF_ERR(nic::InferInput::Create(&input, "INPUT__0", frame->serverside_shape, (frame->encoding == ENCODING_JPEG) ? "FP32" : transfer_datatype()), "unable to get INPUT0");
+	frame->input_ptr.reset(input);
+	FAIL_IF_ERR(frame->input_ptr->AppendRaw(data, byte_size), "unable to set data for INPUT0");
+
+	nic::InferRequestedOutput* output;
+	FAIL_IF_ERR(
+			nic::InferRequestedOutput::Create(&output, "OUTPUT__0", TOPK_CLASSES),
+			"unable to get 'OUTPUT0'");
+	frame->output_ptr.reset(output);
+
+	nic::InferOptions options(model_name);
+	options.partitioning_point_ = frame->result.partitioning_point;
+	options.input_scale_ = frame->scale;
+	if(frame->encoding != ENCODING_RAW)
+		options.input_encoding_ = encoding_name(frame->encoding);
+
+	std::vector<nic::InferInput*> inputs = {frame->input_ptr.get()};
+	std::vector<const nic::InferRequestedOutput*> outputs = {frame->output_ptr.get()};
+
+	// The request is sent on the connection kept to the server, idle
+	// as no other frame is in flight, and waited for by the client's
+	// own thread, which calls back once the server answered.
+	frame->sent_bytes = byte_size;
+	frame->upload_start = get_current_unixtime();
+	nic::Error err = ConnectionManager::Instance().AsyncInfer(servers->Get(frame->target).info.url,
+			[this, frame](nic::InferResult* result)
+			{
+				frame->infer_result.reset(result);
+				frame->result.remote_end = get_current_unixtime();
+				Complete(frame);
+				SendNext(frame->target);
+			},
+			options, inputs, outputs);
+	if(!err.IsOk())
+	{
+		frame->send_error = err;
+		frame->result.remote_end = get_current_unixtime();
+		Complete(frame);
+		SendNext(frame->target);
+	}
+}
+
+void FramePipeline::FinishLocally(std::shared_ptr<Frame> frame)
+{
+	at::Tensor output = execute_remaining_parts(model, frame->local_output, frame->serverside_shape, frame->result.partitioning_point);
+	frame->result.local_execution = true;
+	frame->result.result.top1 = output.argmax().item<int64_t>();
+	frame->result.remote_end = get_current_unixtime();
+}
+
+void FramePipeline::Complete(std::shared_ptr<Frame> frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		frame->done = true;
+	}
+	cv.notify_all();
+}
+
+void FramePipeline::DeliverLoop()
+{
+	while(1)
+	{
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			cv.wait(lock, [this] {
+				auto it = in_flight.find(next_delivery_id);
+				return (exiting && in_flight.empty()) || (it != in_flight.end() && it->second->done);
+			});
+			auto it = in_flight.find(next_delivery_id);
+			if(it == in_flight.end())
+			{
+				return;
+			}
+			frame = it->second;
+			in_flight.erase(it);
+			next_delivery_id++;
+		}
+		cv.notify_all();
+
+		if(!frame->result.local_execution)
+		{
+			bool failed;
+			{
+				std::lock_guard<std::mutex> lock(*server_info_mtx);
+				ServerCandidate* server = &servers->Get(frame->target);
+				struct diamond_results& result = frame->result.result;
+				nic::Error err = frame->send_error;
+				if(err.IsOk())
+					err = read_infer_result(frame->infer_result.get(), result, server->info);
+				failed = !err.IsOk() || result.rejected;
+				if(!err.IsOk())
+				{
+					std::cerr << "error: unable to run inference on " << server->info.url << ": " << err << std::endl;
+				}
+				else if(result.rejected)
+				{
+					// The next decision assumes no request waits less than
+					// predicted, as for a request on its own.
+					for(size_t j = 0; j < server->info.percentile.size(); j++)
+						server->info.percentile[j] = std::max(server->info.percentile[j], result.predicted_wait_ms);
+					server->info.queue_sketch.clear();
+				}
+				else
+				{
+					// The link is estimated as for a request on its own, from
+					// the delivery rate of the connection when the kernel
+					// reports it.
+					double comm_ms = std::max(0.0, (frame->result.remote_end - frame->upload_start) - result.queue_ms - result.infer_ms);
+					server->AddTransfer(frame->sent_bytes, comm_ms, std::stod(result.server_capacity), frame->result.remote_end);
+					server->info.link_capacity = server->comm.LINK;
+				}
+				// The next frames go to another server while it recovers.
+				if(failed)
+					servers->HoldOff(frame->target, get_current_unixtime());
+			}
+			if(failed)
+				FinishLocally(frame);
+		}
+		deliver(frame->result);
+
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			delivered_count++;
+		}
+		cv.notify_all();
+	}
+}
@@ -0,0 +1,145 @@
+#ifndef STREAM_PIPELINE_H
+#define STREAM_PIPELINE_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "local_execution.h"
+#include "send_request.h"
+#include "server_set.h"
+
+// The outcome of a frame. Times are in ms.
+struct FrameResult
+{
+	uint64_t frame_id;
+	int partitioning_point;
+	// Whether the rest of the model executed locally, because the
+	// frame was decided local only or the server rejected or failed
+	// it, in which case only 'result.top1' and 'result.rejected' are
+	// set.
+	bool local_execution;
+	struct diamond_results result;
+	uint64_t submit_time;
+	// The local part is executed and its output copied to the host.
+	uint64_t local_end;
+	// The server answered, or the rest of the model executed locally.
+	uint64_t remote_end;
+};
+
+// Executes a stream of frames as a pipeline. The local part of a frame
+// executes on a thread of its own while earlier frames are uploaded
+// and executed by the server, so a stream is bound by its slowest stage
+// rather than by the sum of the stages. Results are delivered in the
+// order the frames were submitted.
+class FramePipeline
+{
+	public:
+		// Decide the partitioning point of a frame and the server it
+		// is sent to, returned in 'target'. Called on the local thread,
+		// with the server info lock held.
+		using DecideFn = std::function<int(uint64_t frame_id, size_t* target)>;
+		// Deliver the result of a frame. Called on the delivery thread.
+		// A frame the server rejected or failed is finished locally
+		// from the output of its local part, and the server is held
+		// off.
+		using DeliverFn = std::function<void(const FrameResult& frame)>;
+
+		// 'local_only_point' is the partitioning point at which the
+		// whole model executes locally. The frames are sent to the
+		// server of 'servers' decided for them, one at a time to each
+		// server, so that each is sent on the connection kept to it
+		// and the state of that connection estimates the link. The
+		// load and link of the server are updated with each result.
+		// 'server_info_mtx' guards 'servers'.
+		FramePipeline(torch::jit::script::Module model, const std::string& model_name, int local_only_point, ServerSet* servers, std::mutex* server_info_mtx, DecideFn decide, DeliverFn deliver, size_t max_in_flight);
+		~FramePipeline();
+
+		// Submit 'input' as the next frame. Blocks while
+		// 'max_in_flight' frames are submitted but not delivered.
+		// 'image', if set, is the frame as a JPEG, sent in place of
+		// the input when that is cheaper at point 0.
+		void Submit(torch::Tensor input, std::shared_ptr<const std::vector<uint8_t>> image = nullptr);
+
+		// Wait until every submitted frame is delivered.
+		void Flush();
+
+	private:
+		struct Frame
+		{
+			torch::Tensor input;
+			std::shared_ptr<const std::vector<uint8_t>> image;
+			// The host output of the local part, the frame is finished
+			// from it if the server doesn't execute the rest.
+			torch::Tensor local_output;
+			// The index of the server the frame is sent to.
+			size_t target;
+			// The host output of the local part in its transfer format,
+			// sent as it is.
+			torch::Tensor serverside_input;
+			std::vector<float> scale;
+			// The input as sent, unless the encoding is ENCODING_RAW
+			// or ENCODING_JPEG, which sends 'image'.
+			Encoding encoding;
+			std::vector<uint8_t> encoded;
+			std::vector<int64_t> serverside_shape;
+			// Held until the request completes, the client doesn't copy
+			// the input data.
+			std::shared_ptr<nic::InferInput> input_ptr;
+			std::shared_ptr<nic::InferRequestedOutput> output_ptr;
+			std::shared_ptr<nic::InferResult> infer_result;
+			// Set if the request couldn't be sent or got no answer.
+			nic::Error send_error;
+			// The size of the request and when it was sent, in ms.
+			size_t sent_bytes;
+			uint64_t upload_start;
+			FrameResult result;
+			bool done;
+		};
+
+		void LocalLoop();
+		// Send 'frame' once the frames uploaded before it are answered.
+		void Upload(std::shared_ptr<Frame> frame);
+		void Send(std::shared_ptr<Frame> frame);
+		// Send the next frame waiting for upload to server 'target', if
+		// any.
+		void SendNext(size_t target);
+		// Run the rest of the model from the host output of 'frame'.
+		void FinishLocally(std::shared_ptr<Frame> frame);
+		void Complete(std::shared_ptr<Frame> frame);
+		void DeliverLoop();
+
+		torch::jit::script::Module model;
+		const std::string model_name;
+		const int local_only_point;
+		ServerSet* servers;
+		std::mutex* server_info_mtx;
+		DecideFn decide;
+		DeliverFn deliver;
+		const size_t max_in_flight;
+
+		std::mutex mtx;
+		std::condition_variable cv;
+		bool exiting;
+		uint64_t next_frame_id;
+		uint64_t next_delivery_id;
+		uint64_t delivered_count;
+		// Submitted frames waiting for the local thread.
+		std::deque<std::shared_ptr<Frame>> local_queue;
+		// Per server, the frames waiting for the frame being uploaded
+		// to it to be answered, and whether there is one.
+		std::vector<std::deque<std::shared_ptr<Frame>>> upload_queues;
+		std::vector<bool> uploading;
+		// Frames submitted but not delivered yet, by id.
+		std::map<uint64_t, std::shared_ptr<Frame>> in_flight;
+
+		std::thread local_thread;
+		std::thread deliver_thread;
+};
+#endif
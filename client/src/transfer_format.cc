@@ -0,0 +1,51 @@
+#include "transfer_format.h"
+#include <cstdlib>
+#include <cstring>
+#include "util.h"
+
+TransferType transfer_type()
+{
+	static const TransferType type = [] {
+		const char* env = std::getenv("DIAMOND_TRANSFER_TYPE");
+		if(env == nullptr)
+			return TRANSFER_FP32;
+		if(std::strcmp(env, "fp16") == 0)
+			return TRANSFER_FP16;
+		if(std::strcmp(env, "int8") == 0)
+			return TRANSFER_INT8;
+		if(std::strcmp(env, "int8_channel") == 0)
+			return TRANSFER_INT8_CHANNEL;
+		return TRANSFER_FP32;
+	}();
+	return type;
+}
+
+const char* transfer_datatype()
+{
+	switch(transfer_type())
+	{
+		case TRANSFER_FP16:
+			return "FP16";
+		case TRANSFER_INT8:
+		case TRANSFER_INT8_CHANNEL:
+			return "INT8";
+		default:
+			return "FP32";
+	}
+}
+
+uint64_t transfer_byte_size(const std::vector<int64_t>& shape)
+{
+	uint64_t count = vector_mul(shape);
+	switch(transfer_type())
+	{
+		case TRANSFER_FP16:
+			return count * 2;
+		case TRANSFER_INT8:
+			return count + sizeof(float);
+		case TRANSFER_INT8_CHANNEL:
+			return count + ((shape.size() > 1) ? shape[1] : 1) * sizeof(float);
+		default:
+			return count * sizeof(float);
+	}
+}
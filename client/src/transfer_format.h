@@ -0,0 +1,28 @@
+#ifndef TRANSFER_FORMAT_H
+#define TRANSFER_FORMAT_H
+
+#include <stdint.h>
+#include <vector>
+
+// The format activations are sent to the server in, set by the
+// DIAMOND_TRANSFER_TYPE environment variable: "fp16", "int8" with a
+// single scale or "int8_channel" with a scale per channel. FP32 if it
+// is not set. The server model must list the data type in its
+// partitioning transfer_data_type.
+enum TransferType
+{
+	TRANSFER_FP32,
+	TRANSFER_FP16,
+	TRANSFER_INT8,
+	TRANSFER_INT8_CHANNEL
+};
+
+TransferType transfer_type();
+
+// The protocol name of the data type activations are sent in.
+const char* transfer_datatype();
+
+// The number of bytes sent for an activation of 'shape', including
+// its scale. The first dimension of 'shape' is the batch dimension.
+uint64_t transfer_byte_size(const std::vector<int64_t>& shape);
+#endif
@@ -0,0 +1,95 @@
+// Microbenchmark of PartitionEngine, with Google Benchmark. Built by
+// client/test/CMakeLists.txt.
+// The model and the server load are synthetic, nothing is read from
+// the material path or the server.
+#include <benchmark/benchmark.h>
+#include <random>
+#include "Server.h"
+#include "partition_engine.h"
+
+#define BENCH_POINTS 50
+
+static PartitionEngine make_engine()
+{
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<uint64_t> dense_bytes;
+	std::vector<double> local_ms, server_ms, local_J;
+	double local = 0;
+	for(int i = 0; i < BENCH_POINTS; i++)
+	{
+		local += uniform(rng) * 2;
+		local_ms.push_back(local);
+		local_J.push_back(local * 0.01);
+		dense_bytes.push_back((uint64_t)(uniform(rng) * 800000));
+		if(i < BENCH_POINTS - 1)
+			server_ms.push_back(uniform(rng) * 5);
+	}
+	return PartitionEngine(dense_bytes, local_ms, server_ms, local_J);
+}
+
+static ServerState make_server_state(double scale)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	ServerState state;
+	state.last_batch = 2;
+	state.last_server_infertime = 3 * scale;
+	state.average_infer_time = 3 * scale;
+	double p = 0;
+	for(int i = 0; i < SERVER_LOAD_PERCENTILE_COUNT; i++)
+	{
+		p += uniform(rng) * scale;
+		state.percentile.push_back(p);
+	}
+	for(int i = 0; i < SERVER_LOAD_SKETCH_BUCKETS; i++)
+		state.queue_sketch.push_back((uniform(rng) < 0.5) ? 0 : uniform(rng) * scale);
+	return state;
+}
+
+// A decision on an unchanged link and server load, the common case.
+static void BM_Decide(benchmark::State& state)
+{
+	PartitionEngine engine = make_engine();
+	ServerState server_state = make_server_state(1);
+	int policy = state.range(0);
+	for(auto _ : state)
+	{
+		engine.SetLink(50, 10, 10, 10, 30, true);
+		engine.SetServer(server_state);
+		benchmark::DoNotOptimize(engine.Decide(policy, 0.8, 90));
+	}
+}
+BENCHMARK(BM_Decide)->Arg(0)->Arg(1)->Arg(6)->Arg(7);
+
+// A decision after the server load changed.
+static void BM_DecideServerChange(benchmark::State& state)
+{
+	PartitionEngine engine = make_engine();
+	ServerState server_states[2] = {make_server_state(1), make_server_state(2)};
+	engine.SetLink(50, 10, 10, 10, 30, true);
+	int i = 0;
+	for(auto _ : state)
+	{
+		engine.SetServer(server_states[i++ % 2]);
+		benchmark::DoNotOptimize(engine.Decide(0, 0.8, 90));
+	}
+}
+BENCHMARK(BM_DecideServerChange);
+
+// A decision after the link changed, which rebuilds the slow start
+// rounds and the time to send each activation.
+static void BM_DecideLinkChange(benchmark::State& state)
+{
+	PartitionEngine engine = make_engine();
+	engine.SetServer(make_server_state(1));
+	int i = 0;
+	for(auto _ : state)
+	{
+		engine.SetLink(20 + (i++ % 2) * 30, 10, 10, 10, 30, true);
+		benchmark::DoNotOptimize(engine.Decide(0, 0.8, 90));
+	}
+}
+BENCHMARK(BM_DecideLinkChange);
+
+BENCHMARK_MAIN();
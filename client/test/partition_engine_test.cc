@@ -0,0 +1,118 @@
+// Tests of PartitionEngine against the estimates it replaces, with
+// Google Test. Built by client/test/CMakeLists.txt and run from
+// client/test, the models are read from ../material.
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "Model.h"
+#include "comm_online_profiler.h"
+#include "partition_engine.h"
+#include "transfer_format.h"
+
+extern std::string material_path;
+
+static const char* test_models[] = {"b0", "b1", "b2", "b3", "b4", "b5", "b6", "resnet101", "resnet152", "vgg16"};
+
+struct LinkCase
+{
+	double link;
+	double rtt_ms;
+	uint32_t tcpi_rtt_us;
+	double start_cwnd;
+	uint32_t ssthresh;
+	bool warm_connection;
+};
+
+static const LinkCase link_cases[] = {
+	{91, 10, 10000, 10, 99999999, false},
+	{91, 10, 10400, 10, 0, true},
+	{20.7, 35, 35000, 12.5, 30, true},
+	{500, 2, 2000, 40, 20, true},
+	{5, 80, 80000, 10, 7, false},
+	{1000, 0.5, 500, 10, 0, true},
+	{50, 20, 19000, 64, 2147483647, true},
+};
+
+class PartitionEngineTest : public ::testing::TestWithParam<const char*>
+{
+	protected:
+		static void SetUpTestCase() { material_path = "../material"; }
+};
+
+// Each point takes the time expect_time_with_given_link() estimates for
+// it when expect_time_shapes() estimates the points in order, and the
+// connection is left with the same ssthresh.
+TEST_P(PartitionEngineTest, SlowStartMatchesCommunication)
+{
+	ModelInfo model_info(GetParam());
+	ASSERT_FALSE(model_info.shapes.empty());
+	PartitionEngine engine(model_info);
+	for(const LinkCase& c : link_cases)
+	{
+		Communication comm((int)c.link);
+		comm.current_tcp_info.tcpi_rtt = c.tcpi_rtt_us;
+		comm.current_tcp_info.tcpi_snd_ssthresh = c.ssthresh;
+		comm.start_cwnd = c.start_cwnd;
+		comm.warm_connection = c.warm_connection;
+
+		engine.SetLink(c.link, c.rtt_ms, comm.current_tcp_info.tcpi_rtt / 1000, c.start_cwnd, c.ssthresh, c.warm_connection);
+		for(size_t i = 0; i < model_info.shapes.size(); i++)
+		{
+			bool reach_to_max_rtt;
+			double expected = comm.expect_time_with_given_link((int64_t)transfer_byte_size(model_info.shapes[i]), (int)c.link, &reach_to_max_rtt, c.rtt_ms);
+			EXPECT_DOUBLE_EQ(expected, engine.CommMs(i)) << "link " << c.link << " point " << i;
+		}
+		EXPECT_EQ((double)comm.current_tcp_info.tcpi_snd_ssthresh, engine.EndSsthresh()) << "link " << c.link;
+	}
+}
+
+// The policies that don't minimize the energy decide on a model whose
+// power profile misses points.
+TEST_P(PartitionEngineTest, DecidesWithoutFullPowerProfile)
+{
+	ModelInfo model_info(GetParam());
+	ASSERT_FALSE(model_info.shapes.empty());
+	model_info.local_power_consumption_J.resize(model_info.shapes.size() - 1);
+	PartitionEngine engine(model_info);
+	engine.SetLink(91, 10, 10, 10, 30, true);
+	engine.SetServer(ServerState());
+	struct partitioner_result r = engine.Decide(0, 1, 90);
+	EXPECT_GE(r.partitioning_point, 0);
+	EXPECT_LT(r.partitioning_point, (int)model_info.shapes.size());
+	EXPECT_EXIT(engine.Decide(1, 1, 90), ::testing::ExitedWithCode(255), "");
+}
+
+// A point the server doesn't accept is never decided, even in the
+// range the server recommends.
+TEST_P(PartitionEngineTest, DecidesOnlySplitPoints)
+{
+	ModelInfo model_info(GetParam());
+	ASSERT_FALSE(model_info.shapes.empty());
+	PartitionEngine engine(model_info);
+	engine.SetLink(500, 10, 10, 10, 30, true);
+	ServerState server_state;
+	server_state.percentile.assign(10, 0);
+	int last = (int)model_info.shapes.size() - 1;
+	for(int policy : {0, 6})
+	{
+		server_state.split_point_mask = ~(uint64_t)0;
+		engine.SetServer(server_state);
+		int point = engine.Decide(policy, 1, 90).partitioning_point;
+		if(point == last)
+		{
+			continue;
+		}
+		server_state.split_point_mask = ~((uint64_t)1 << point);
+		engine.SetServer(server_state);
+		EXPECT_NE(point, engine.Decide(policy, 1, 90).partitioning_point) << "policy " << policy;
+		EXPECT_NE(point, engine.Decide(policy, 1, 90, point, point).partitioning_point) << "policy " << policy;
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(Material, PartitionEngineTest, ::testing::ValuesIn(test_models));
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
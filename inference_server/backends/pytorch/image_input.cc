@@ -0,0 +1,110 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/backends/pytorch/image_input.h"
+
+#include <stdint.h>
+
+#ifdef TRITON_ENABLE_IMAGE_INPUT
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#endif  // TRITON_ENABLE_IMAGE_INPUT
+
+namespace nvidia { namespace inferenceserver {
+
+Status
+DecodeImageInput(
+    const ModelPartitioning::ImageInput& image_input, const char* src,
+    const size_t src_byte_size, const std::vector<int64_t>& shape,
+    float* dst)
+{
+#ifndef TRITON_ENABLE_IMAGE_INPUT
+  return Status(
+      Status::Code::UNSUPPORTED,
+      "image input is not supported, the server was built without "
+      "TRITON_ENABLE_IMAGE_INPUT");
+#else
+  if ((shape.size() != 3) || (shape[0] != 3)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "image input must have shape [3, height, width]");
+  }
+  const int height = shape[1];
+  const int width = shape[2];
+
+  cv::Mat image;
+  try {
+    image = cv::imdecode(
+        cv::Mat(1, src_byte_size, CV_8UC1, const_cast<char*>(src)),
+        cv::IMREAD_COLOR);
+    if (!image.empty() && ((image.rows != height) || (image.cols != width))) {
+      cv::resize(
+          image, image, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+    }
+  }
+  catch (const cv::Exception& ex) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        std::string("unable to decode image input: ") + ex.what());
+  }
+  if (image.empty()) {
+    return Status(Status::Code::INVALID_ARG, "unable to decode image input");
+  }
+
+  // (v / 255 - mean) / std is a single multiply-add per value.
+  float scale[3];
+  float bias[3];
+  for (int c = 0; c < 3; ++c) {
+    const float mean =
+        (image_input.mean_size() == 0) ? 0 : image_input.mean(c);
+    const float std = (image_input.std_size() == 0) ? 1 : image_input.std(c);
+    scale[c] = 1 / (255 * std);
+    bias[c] = -mean / std;
+  }
+
+  // OpenCV decodes to interleaved BGR, the input is planar RGB. Each
+  // row is split into the planes with no dependency between pixels, so
+  // the inner loop is vectorized by the compiler.
+  const size_t plane = (size_t)height * width;
+  float* __restrict__ r = dst;
+  float* __restrict__ g = dst + plane;
+  float* __restrict__ b = dst + 2 * plane;
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* __restrict__ bgr = image.ptr<uint8_t>(y);
+    const size_t row = (size_t)y * width;
+    for (int x = 0; x < width; ++x) {
+      b[row + x] = bgr[3 * x] * scale[2] + bias[2];
+      g[row + x] = bgr[3 * x + 1] * scale[1] + bias[1];
+      r[row + x] = bgr[3 * x + 2] * scale[0] + bias[0];
+    }
+  }
+
+  return Status::Success;
+#endif  // TRITON_ENABLE_IMAGE_INPUT
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -24,18 +24,25 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <unistd.h>
 
 
 #include "src/backends/pytorch/libtorch_backend.h"
 #include <fstream>
 #include <stdint.h>
+#include <algorithm>
+#include <cstring>
 #include <exception>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include "src/backends/pytorch/image_input.h"
+#include "src/core/activation_codec.h"
 #include "src/core/constants.h"
+#include "src/core/load_telemetry.h"
 #include "src/core/logging.h"
 #include "src/core/metrics.h"
 #include "src/core/model_config_cuda.h"
@@ -74,11 +81,9 @@ LibTorchBackend::Context::Context(
     : BackendContext(
           name, gpu_device, max_batch_size, enable_pinned_input,
           enable_pinned_output, std::move(metric_reporter)),
-      device_(torch::Device(torch::kCPU))
+      device_(torch::Device(torch::kCPU)), late_join_(false), layer_count_(0),
+      intra_op_thread_count_(0)
 {
-	share_server_status.setKey(1991);
-	share_server_status.setupSharedMemory(500*sizeof(char));
-
 }
 
 LibTorchBackend::Context::~Context()
@@ -160,6 +165,95 @@ ConvertTorchTypeToDataType(const torch::ScalarType& ttype)
   }
 }
 
+namespace {
+
+// Parse a list of CPUs such as "0-3,8" into 'cpus'.
+Status
+ParseCpuList(const std::string& list, std::vector<int>* cpus)
+{
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    try {
+      const size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash));
+      const int last = (dash == std::string::npos)
+                           ? first
+                           : std::stoi(range.substr(dash + 1));
+      if ((first < 0) || (last < first) || (last >= CPU_SETSIZE)) {
+        throw std::invalid_argument(range);
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus->push_back(cpu);
+      }
+    }
+    catch (const std::exception& ex) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "invalid CPU range '" + range + "' in CPU_AFFINITY '" + list + "'");
+    }
+  }
+
+  return Status::Success;
+}
+
+// Get the CPU thread settings of the instance at 'instance_idx' from
+// the model parameters:
+//   INTRA_OP_THREAD_COUNT: threads used within an operation.
+//   INTER_OP_THREAD_COUNT: threads running independent operations,
+//     shared by all models in the process.
+//   CPU_AFFINITY: ';'-separated CPU lists, one for each instance in
+//     the order the instances are created, reused if there are fewer
+//     lists than instances.
+Status
+GetThreadParameters(
+    const ModelConfig& config, const size_t instance_idx,
+    int64_t* intra_op_thread_count, int64_t* inter_op_thread_count,
+    std::vector<int>* cpu_affinity)
+{
+  *intra_op_thread_count = 0;
+  *inter_op_thread_count = 0;
+  cpu_affinity->clear();
+
+  const auto& parameters = config.parameters();
+  auto itr = parameters.find("INTRA_OP_THREAD_COUNT");
+  if (itr != parameters.end()) {
+    RETURN_IF_ERROR(ParseLongLongParameter(
+        itr->first, itr->second.string_value(), intra_op_thread_count));
+  }
+  itr = parameters.find("INTER_OP_THREAD_COUNT");
+  if (itr != parameters.end()) {
+    RETURN_IF_ERROR(ParseLongLongParameter(
+        itr->first, itr->second.string_value(), inter_op_thread_count));
+  }
+  itr = parameters.find("CPU_AFFINITY");
+  if (itr != parameters.end()) {
+    std::vector<std::string> lists;
+    std::stringstream ss(itr->second.string_value());
+    std::string list;
+    while (std::getline(ss, list, ';')) {
+      lists.push_back(list);
+    }
+    if (!lists.empty()) {
+      RETURN_IF_ERROR(
+          ParseCpuList(lists[instance_idx % lists.size()], cpu_affinity));
+    }
+  }
+
+  if ((*intra_op_thread_count < 0) || (*inter_op_thread_count < 0)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "thread counts must be non-negative for '" + config.name() + "'");
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
 Status
 LibTorchBackend::CreateExecutionContexts(
     const std::unordered_map<std::string, std::string>& models)
@@ -188,11 +282,28 @@ LibTorchBackend::CreateExecutionContexts(
     }
   }
 
+  if (Config().partitioning().has_pipeline()) {
+    RETURN_IF_ERROR(Pipeline::Create(this, &pipeline_));
+  }
+
+  // Requests are rejected at a point that isn't a split point, so let
+  // the clients know which points are.
+  if (!Config().partitioning().split_point().empty()) {
+    std::vector<int64_t> split_points;
+    for (const auto& split_point : Config().partitioning().split_point()) {
+      split_points.push_back(split_point.layer());
+    }
+    LoadTelemetry::PublishSplitPoints(split_points);
+  }
+
   // Create a scheduler with one thread for each context available for
   // this model. Each runner is exclusively tied to the context.
   RETURN_IF_ERROR(SetConfiguredScheduler(
       total_context_cnt,
-      [](uint32_t runner_idx) -> Status { return Status::Success; },
+      [this](uint32_t runner_idx) -> Status {
+        return static_cast<Context*>(contexts_[runner_idx].get())
+            ->InitThread();
+      },
       [this](
           uint32_t runner_idx,
           std::vector<std::unique_ptr<InferenceRequest>>&& requests) {
@@ -272,6 +383,37 @@ LibTorchBackend::CreateExecutionContext(
 
   RETURN_IF_ERROR(context->CreateCudaStream());
 
+  context->late_join_ = Config().has_dynamic_batching() &&
+                        Config().dynamic_batching().allow_late_join();
+#ifndef TRITON_ENABLE_IMAGE_INPUT
+  if (Config().partitioning().has_image_input()) {
+    return Status(
+        Status::Code::UNSUPPORTED,
+        "partitioning image_input of model '" + Name() +
+            "' requires a server built with TRITON_ENABLE_IMAGE_INPUT");
+  }
+#endif  // TRITON_ENABLE_IMAGE_INPUT
+  context->image_input_ = Config().partitioning().image_input();
+
+  int64_t inter_op_thread_count;
+  RETURN_IF_ERROR(GetThreadParameters(
+      Config(), contexts_.size() - 1, &context->intra_op_thread_count_,
+      &inter_op_thread_count, &context->cpu_affinity_));
+
+  // The inter-op thread pool is shared by the whole process and can
+  // only be sized once, before it is first used.
+  if (inter_op_thread_count > 0) {
+    static std::once_flag inter_op_flag;
+    std::call_once(inter_op_flag, [inter_op_thread_count] {
+      try {
+        at::set_num_interop_threads(inter_op_thread_count);
+      }
+      catch (const std::exception& ex) {
+        LOG_WARNING << "unable to set inter-op thread count: " << ex.what();
+      }
+    });
+  }
+
   if (gpu_device == Context::NO_GPU_DEVICE) {
     context->device_ = torch::Device(torch::kCPU);
   } else {
@@ -296,6 +438,7 @@ LibTorchBackend::CreateExecutionContext(
     RETURN_IF_ERROR(
         context->ValidateControlInputs(Config().sequence_batching()));
   }
+  RETURN_IF_ERROR(context->ValidatePartitioning(Config()));
   return Status::Success;
 }
 
@@ -324,6 +467,7 @@ LibTorchBackend::Context::ValidateInputs(
         }
         ip_index = std::atoi(name.substr(start_pos + 2).c_str());
         input_index_map_[name] = ip_index;
+        input_dtype_map_[name] = io.data_type();
       }
       catch (std::exception& ex) {
         return Status(
@@ -404,6 +548,316 @@ LibTorchBackend::Context::ValidateOutputs(
 
   return Status::Success;
 }
+
+Status
+LibTorchBackend::Context::InitThread()
+{
+  // Operations executed by this thread use the intra-op thread count
+  // of the instance. Threads it starts inherit its affinity.
+  if (intra_op_thread_count_ > 0) {
+    at::set_num_threads(intra_op_thread_count_);
+  }
+
+  if (!cpu_affinity_.empty()) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (const int cpu : cpu_affinity_) {
+      CPU_SET(cpu, &cpuset);
+    }
+    const int err =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    if (err != 0) {
+      return Status(
+          Status::Code::INTERNAL, "unable to set CPU affinity of instance '" +
+                                      name_ + "': " + strerror(err));
+    }
+  }
+
+  LOG_VERBOSE(1) << "Instance " << name_ << " uses " << at::get_num_threads()
+                 << " intra-op threads on "
+                 << (cpu_affinity_.empty()
+                         ? std::string("any CPU")
+                         : std::to_string(cpu_affinity_.size()) + " CPUs");
+  return Status::Success;
+}
+
+void
+LibTorchBackend::Context::Synchronize()
+{
+  // Operations on the CPU are complete when they return.
+#ifdef TRITON_ENABLE_GPU
+  if (device_.is_cuda()) {
+    cudaDeviceSynchronize();
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+Status
+LibTorchBackend::Context::ValidatePartitioning(const ModelConfig& config)
+{
+  const auto& partitioning = config.partitioning();
+
+  // The model is executed segment by segment so it must know its
+  // number of layers, which is also the end of the last segment. A
+  // configuration that doesn't give it, as those written before it
+  // existed, leaves it to the TorchScript module.
+  layer_count_ = partitioning.layer_count();
+  try {
+    if (layer_count_ == 0) {
+      if (torch_model_->hasattr("layer_count")) {
+        layer_count_ = torch_model_->attr("layer_count").toInt();
+      } else if (torch_model_->hasattr("layers")) {
+        layer_count_ =
+            torch_model_->attr("layers").toModule().children().size();
+      }
+      if (layer_count_ == 0) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning layer_count must be specified for LibTorch model '" +
+                name_ + "', which has neither a layer_count attribute nor "
+                        "a layers module list");
+      }
+      LOG_VERBOSE(1) << "LibTorch model '" << name_ << "' has "
+                     << layer_count_ << " layers";
+    } else if (torch_model_->hasattr("layer_count")) {
+      const int64_t model_layer_count =
+          torch_model_->attr("layer_count").toInt();
+      if (model_layer_count != layer_count_) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning layer_count " + std::to_string(layer_count_) +
+                " does not match layer_count " +
+                std::to_string(model_layer_count) + " of LibTorch model '" +
+                name_ + "'");
+      }
+    }
+
+    RETURN_IF_ERROR(LoadSegments(partitioning));
+
+    // Execute each segment whose input and output activation shapes
+    // are both specified on a single zero sample and check the shape
+    // of the activation it produces.
+    const auto dtype = ConvertDataTypeToTorchType(
+        (config.input_size() > 0) ? config.input(0).data_type() : TYPE_FP32);
+    torch::NoGradGuard no_grad;
+    for (int idx = 0; idx + 1 < partitioning.split_point().size(); ++idx) {
+      const auto& split_point = partitioning.split_point(idx);
+      const auto& next_point = partitioning.split_point(idx + 1);
+      if (split_point.activation_dims().empty() ||
+          next_point.activation_dims().empty()) {
+        continue;
+      }
+
+      std::vector<int64_t> shape{1};
+      shape.insert(
+          shape.end(), split_point.activation_dims().begin(),
+          split_point.activation_dims().end());
+      const auto activation =
+          ExecuteLayers(
+              torch::zeros(
+                  shape,
+                  torch::TensorOptions().dtype(dtype.second).device(device_)),
+              split_point.layer(), next_point.layer())
+              .toTensor();
+      std::vector<int64_t> expected{1};
+      expected.insert(
+          expected.end(), next_point.activation_dims().begin(),
+          next_point.activation_dims().end());
+      if (activation.sizes().vec() != expected) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "LibTorch model '" + name_ + "' produces activation of shape " +
+                DimsListToString(activation.sizes().vec()) + " at layer " +
+                std::to_string(next_point.layer()) + ", expected " +
+                DimsListToString(expected));
+      }
+    }
+
+    // The executor specializes and fuses a segment for the input
+    // shapes it sees in its first runs, so run each segment with
+    // every batch size it is expected to execute.
+    std::set<int> batch_sizes{1};
+    if (max_batch_size_ != NO_BATCHING) {
+      batch_sizes.insert(max_batch_size_);
+      if (config.has_dynamic_batching()) {
+        batch_sizes.insert(
+            config.dynamic_batching().preferred_batch_size().begin(),
+            config.dynamic_batching().preferred_batch_size().end());
+      }
+    }
+    for (const auto& split_point : partitioning.split_point()) {
+      const auto it = segments_.find(split_point.layer());
+      if ((it == segments_.end()) || split_point.activation_dims().empty()) {
+        continue;
+      }
+      for (const int batch_size : batch_sizes) {
+        std::vector<int64_t> shape{batch_size};
+        shape.insert(
+            shape.end(), split_point.activation_dims().begin(),
+            split_point.activation_dims().end());
+        const auto input = torch::zeros(
+            shape, torch::TensorOptions().dtype(dtype.second).device(device_));
+        for (int run = 0; run < SEGMENT_WARMUP_RUNS; ++run) {
+          it->second.module_.forward({input});
+        }
+      }
+    }
+
+    // Allocate an activation buffer of the maximum batch size for
+    // each split point of known shape. A batch reaching the point is
+    // assembled in the buffer instead of being concatenated.
+    activation_buffers_.clear();
+    if (max_batch_size_ != NO_BATCHING) {
+      for (const auto& split_point : partitioning.split_point()) {
+        if (split_point.activation_dims().empty()) {
+          continue;
+        }
+        std::vector<int64_t> shape{max_batch_size_};
+        shape.insert(
+            shape.end(), split_point.activation_dims().begin(),
+            split_point.activation_dims().end());
+        activation_buffers_.emplace(
+            split_point.layer(),
+            torch::empty(
+                shape,
+                torch::TensorOptions().dtype(dtype.second).device(device_)));
+      }
+    }
+  }
+  catch (const std::exception& ex) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "failed to validate partitioning of LibTorch model '" + name_ +
+            "': " + ex.what());
+  }
+
+  return Status::Success;
+}
+
+Status
+LibTorchBackend::Context::LoadSegments(const ModelPartitioning& partitioning)
+{
+  segments_.clear();
+
+  // The segments are children of a 'segments' submodule, named
+  // '<start>_<end>' after the layers they execute.
+  std::unordered_map<std::string, torch::jit::script::Module> modules;
+  for (const auto& child : torch_model_->named_children()) {
+    if (child.name == "segments") {
+      for (const auto& segment : child.value.named_children()) {
+        modules.emplace(segment.name, segment.value);
+      }
+    }
+  }
+  if (modules.empty()) {
+    return Status::Success;
+  }
+
+  if (partitioning.split_point().empty()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "partitioning split_point must be specified to use the segments of "
+        "LibTorch model '" +
+            name_ + "'");
+  }
+
+  for (int idx = 0; idx < partitioning.split_point().size(); ++idx) {
+    const uint32_t start = partitioning.split_point(idx).layer();
+    const uint32_t end = (idx + 1 < partitioning.split_point().size())
+                             ? partitioning.split_point(idx + 1).layer()
+                             : layer_count_;
+    const std::string segment_name =
+        std::to_string(start) + "_" + std::to_string(end);
+    const auto it = modules.find(segment_name);
+    if (it == modules.end()) {
+      segments_.clear();
+      return Status(
+          Status::Code::INVALID_ARG,
+          "LibTorch model '" + name_ + "' has no segment '" + segment_name +
+              "' for partitioning split_point " + std::to_string(start));
+    }
+    segments_.emplace(start, Segment{end, it->second});
+  }
+
+  LOG_VERBOSE(1) << "Using " << segments_.size() << " segments of '" << name_
+                 << "'";
+  return Status::Success;
+}
+
+torch::jit::IValue
+LibTorchBackend::Context::ExecuteLayers(
+    const torch::Tensor& input, const uint32_t start, const uint32_t end)
+{
+  if (segments_.empty()) {
+    std::vector<torch::jit::IValue> inputs;
+    inputs.push_back(input);
+    inputs.push_back(
+        torch::reshape(torch::tensor((int)start).to(device_), {-1, 1}));
+    inputs.push_back(
+        torch::reshape(torch::tensor((int)end).to(device_), {-1, 1}));
+    return torch_model_->forward(inputs);
+  }
+
+  torch::jit::IValue activation(input);
+  uint32_t layer = start;
+  while (layer < end) {
+    const auto it = segments_.find(layer);
+    if (it == segments_.end()) {
+      throw std::invalid_argument(
+          "no segment starts at layer " + std::to_string(layer));
+    }
+    activation = it->second.module_.forward({activation});
+    layer = it->second.end_;
+  }
+  if (layer != end) {
+    throw std::invalid_argument(
+        "layer " + std::to_string(end) + " is not a segment boundary");
+  }
+
+  return activation;
+}
+
+torch::Tensor
+LibTorchBackend::Context::ActivationRows(
+    const uint32_t point, const int64_t offset, const int64_t rows)
+{
+  const auto it = activation_buffers_.find(point);
+  if ((it == activation_buffers_.end()) ||
+      ((offset + rows) > it->second.size(0))) {
+    return torch::Tensor();
+  }
+
+  return it->second.narrow(0, offset, rows);
+}
+
+torch::Tensor
+LibTorchBackend::Context::AppendActivation(
+    const uint32_t point, const torch::Tensor& batch,
+    const torch::Tensor& group)
+{
+  const int64_t batch_rows = batch.size(0);
+  const int64_t group_rows = group.size(0);
+  torch::Tensor rows = ActivationRows(point, 0, batch_rows + group_rows);
+  if (!rows.defined() || (batch.scalar_type() != rows.scalar_type()) ||
+      (group.scalar_type() != rows.scalar_type()) ||
+      (batch.sizes().slice(1) != rows.sizes().slice(1)) ||
+      (group.sizes().slice(1) != rows.sizes().slice(1))) {
+    return torch::cat({batch, group}, 0);
+  }
+
+  // The group is usually already in place, it was collected into the
+  // rows following the batch. If requests joined the batch while it
+  // was executing the group may have been moved, or collected at a
+  // different offset within the buffer, so copy it through a clone
+  // when it overlaps its destination.
+  torch::Tensor group_rows_view = rows.narrow(0, batch_rows, group_rows);
+  if (group.data_ptr() != group_rows_view.data_ptr()) {
+    group_rows_view.copy_(group.is_alias_of(rows) ? group.clone() : group);
+  }
+  rows.narrow(0, 0, batch_rows).copy_(batch);
+
+  return rows;
+}
 /*
 Status
 LibTorchBackend::Context::RequestToTensor(
@@ -492,12 +946,13 @@ LibTorchBackend::Context::SetInputTensors(
     std::vector<std::unique_ptr<InferenceResponse>>* responses,
     BackendInputCollector* collector,
     std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
-    std::vector<torch::jit::IValue>* inputs, bool* cuda_copy)
+    std::vector<torch::jit::IValue>* inputs, bool* cuda_copy,
+    const torch::Tensor& destination)
 {
   // All requests must have equally-sized input tensors so use any
   // request as the representative for the input tensors.
+  const bool single_input = (requests[0]->ImmutableInputs().size() == 1);
   for (const auto& pr : requests[0]->ImmutableInputs()) {
-
     const std::string& input_name = pr.first;
     const auto& repr_input = pr.second;
     const auto& batch1_shape = repr_input->Shape();
@@ -513,6 +968,32 @@ LibTorchBackend::Context::SetInputTensors(
     const DataType datatype = repr_input->DType();
 
     int ip_index = input_index_map_[input_name];
+
+    // Requests may send the input in a transfer data type of the model
+    // instead of its own, or encoded, it is then converted while
+    // collected.
+    const auto dtype_it = input_dtype_map_.find(input_name);
+    if (dtype_it != input_dtype_map_.end()) {
+      bool transferred = false;
+      for (const auto& request : requests) {
+        const InferenceRequest::Input* input;
+        if (request->ImmutableInput(input_name, &input).IsOk() &&
+            ((input->DType() != dtype_it->second) ||
+             (request->InputEncoding() != ActivationEncoding::RAW))) {
+          transferred = true;
+          break;
+        }
+      }
+      if (transferred) {
+        torch::Tensor input_tensor;
+        RETURN_IF_ERROR(SetTransferredInputTensor(
+            input_name, dtype_it->second, batchn_shape, requests, responses,
+            input_buffers, single_input ? destination : torch::Tensor(),
+            &input_tensor));
+        (*inputs)[ip_index] = input_tensor;
+        continue;
+      }
+    }
     const auto torch_dtype = ConvertDataTypeToTorchType(datatype);
     if (!torch_dtype.first) {
       return Status(
@@ -520,23 +1001,34 @@ LibTorchBackend::Context::SetInputTensors(
                                       DataType_Name(datatype) +
                                       "' to Torch datatype");
     }
+
     // Checked at initialization time to make sure that STRING is not
     // being used for an input, so can just assume fixed-sized here.
     const size_t total_byte_size = GetByteSize(datatype, batchn_shape);
 
     // The entire input tensor must be delivered as a single
-    // contiguous chunk so create a buffer large enough to hold the
-    // entire dynamic batched input.
-    input_buffers->emplace_back(new AllocatedMemory(
-        total_byte_size,
-        (gpu_device_ == NO_GPU_DEVICE) ? TRITONSERVER_MEMORY_CPU_PINNED
-                                       : TRITONSERVER_MEMORY_GPU,
-        (gpu_device_ == NO_GPU_DEVICE) ? 0 : gpu_device_));
-
+    // contiguous chunk. Use 'destination' if it can hold the input,
+    // otherwise create a buffer large enough to hold the entire
+    // dynamic batched input.
     TRITONSERVER_MemoryType memory_type;
     int64_t memory_type_id;
-    auto input_buffer =
-        input_buffers->back()->MutableBuffer(&memory_type, &memory_type_id);
+    char* input_buffer;
+    if (single_input && destination.defined() &&
+        (destination.scalar_type() == torch_dtype.second) &&
+        (destination.nbytes() == total_byte_size)) {
+      input_buffer = static_cast<char*>(destination.data_ptr());
+      memory_type = destination.is_cuda() ? TRITONSERVER_MEMORY_GPU
+                                          : TRITONSERVER_MEMORY_CPU;
+      memory_type_id = destination.is_cuda() ? destination.get_device() : 0;
+    } else {
+      input_buffers->emplace_back(new AllocatedMemory(
+          total_byte_size,
+          (gpu_device_ == NO_GPU_DEVICE) ? TRITONSERVER_MEMORY_CPU_PINNED
+                                         : TRITONSERVER_MEMORY_GPU,
+          (gpu_device_ == NO_GPU_DEVICE) ? 0 : gpu_device_));
+      input_buffer =
+          input_buffers->back()->MutableBuffer(&memory_type, &memory_type_id);
+    }
 
     collector->ProcessTensor(
         input_name, datatype, batch1_shape, input_buffer, total_byte_size,
@@ -565,6 +1057,271 @@ LibTorchBackend::Context::SetInputTensors(
   return Status::Success;
 }
 
+Status
+LibTorchBackend::Context::SetTransferredInputTensor(
+    const std::string& input_name, const DataType datatype,
+    const std::vector<int64_t>& batchn_shape,
+    const std::vector<std::unique_ptr<InferenceRequest>>& requests,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses,
+    std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+    const torch::Tensor& destination, torch::Tensor* input_tensor)
+{
+  const auto torch_dtype = ConvertDataTypeToTorchType(datatype);
+  if (!torch_dtype.first) {
+    return Status(
+        Status::Code::INTERNAL, "Failed to convert DataType '" +
+                                    DataType_Name(datatype) +
+                                    "' to Torch datatype");
+  }
+
+  if (destination.defined() &&
+      (destination.scalar_type() == torch_dtype.second) &&
+      (destination.sizes() == torch::IntArrayRef(batchn_shape))) {
+    *input_tensor = destination;
+  } else {
+    *input_tensor = torch::empty(
+        batchn_shape,
+        torch::TensorOptions().dtype(torch_dtype.second).device(device_));
+  }
+
+  // View the input as rows of requests, also without batching in
+  // which case there is a single request.
+  torch::Tensor batch_rows = (max_batch_size_ == NO_BATCHING)
+                                 ? input_tensor->unsqueeze(0)
+                                 : *input_tensor;
+  const std::vector<int64_t> row_shape(
+      batch_rows.sizes().begin() + 1, batch_rows.sizes().end());
+
+  size_t idx = 0;
+  int64_t row = 0;
+  while (idx < requests.size()) {
+    // Find the run of requests starting at 'idx' that share the data
+    // type and the scale size of the input.
+    const InferenceRequest::Input* input;
+    RETURN_IF_ERROR(requests[idx]->ImmutableInput(input_name, &input));
+    const DataType run_datatype = input->DType();
+    const size_t run_scale_size =
+        std::max((size_t)1, requests[idx]->InputScale().size());
+    size_t run_end = idx;
+    int64_t run_rows = 0;
+    bool scaled = false;
+    while (run_end < requests.size()) {
+      RETURN_IF_ERROR(requests[run_end]->ImmutableInput(input_name, &input));
+      const auto& scale = requests[run_end]->InputScale();
+      if ((input->DType() != run_datatype) ||
+          (std::max((size_t)1, scale.size()) != run_scale_size)) {
+        break;
+      }
+      scaled |= !scale.empty();
+      run_rows += std::max(1U, requests[run_end]->BatchSize());
+      ++run_end;
+    }
+
+    const auto run_torch_dtype = ConvertDataTypeToTorchType(run_datatype);
+    if (!run_torch_dtype.first) {
+      return Status(
+          Status::Code::INTERNAL, "Failed to convert DataType '" +
+                                      DataType_Name(run_datatype) +
+                                      "' to Torch datatype");
+    }
+
+    std::vector<int64_t> run_shape{run_rows};
+    run_shape.insert(run_shape.end(), row_shape.begin(), row_shape.end());
+    const size_t row_byte_size = GetByteSize(run_datatype, row_shape);
+
+    std::vector<float> scales;
+    if (scaled) {
+      scales.reserve(run_rows * run_scale_size);
+    }
+
+    // Stage the input of the run decoded, in pinned memory so that it
+    // is copied to the device asynchronously. If the rows of the run
+    // are host memory of the data type it was sent in, they are the
+    // staging and the input is decoded straight into them.
+    torch::Tensor rows = batch_rows.narrow(0, row, run_rows);
+    const bool in_place = !scaled && rows.device().is_cpu() &&
+                          rows.is_contiguous() &&
+                          (rows.scalar_type() == run_torch_dtype.second);
+    TRITONSERVER_MemoryType staging_memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t staging_memory_type_id = 0;
+    char* staging;
+    if (in_place) {
+      staging = static_cast<char*>(rows.data_ptr());
+    } else {
+      input_buffers->emplace_back(new AllocatedMemory(
+          row_byte_size * run_rows, TRITONSERVER_MEMORY_CPU_PINNED, 0));
+      staging = input_buffers->back()->MutableBuffer(
+          &staging_memory_type, &staging_memory_type_id);
+    }
+
+    size_t offset = 0;
+    bool cuda_used = false;
+    for (size_t ridx = idx; ridx < run_end; ++ridx) {
+      const auto& request = requests[ridx];
+      const size_t request_rows = std::max(1U, request->BatchSize());
+      const size_t request_byte_size = row_byte_size * request_rows;
+      const ActivationEncoding encoding = request->InputEncoding();
+      RETURN_IF_ERROR(request->ImmutableInput(input_name, &input));
+
+      // A raw input is copied into the staging as it is. An encoded
+      // input is decoded into it, from its buffer if it has a single
+      // one in host memory and gathered into one otherwise.
+      Status status;
+      size_t copied = 0;
+      bool decoded = false;
+      std::vector<char> encoded;
+      bool encoded_cuda_used = false;
+      for (size_t bidx = 0;
+           status.IsOk() && (bidx < input->DataBufferCount()); ++bidx) {
+        const void* buffer;
+        size_t buffer_byte_size;
+        TRITONSERVER_MemoryType memory_type;
+        int64_t memory_type_id;
+        status = input->DataBuffer(
+            bidx, &buffer, &buffer_byte_size, &memory_type, &memory_type_id);
+        if (!status.IsOk()) {
+          break;
+        }
+
+        bool buffer_cuda_used = false;
+        if (encoding == ActivationEncoding::RAW) {
+          if ((copied + buffer_byte_size) <= request_byte_size) {
+            status = CopyBuffer(
+                input_name, memory_type, memory_type_id, staging_memory_type,
+                staging_memory_type_id, buffer_byte_size, buffer,
+                staging + offset + copied, stream_, &buffer_cuda_used);
+            cuda_used |= buffer_cuda_used;
+          }
+        } else if (
+            (input->DataBufferCount() == 1) &&
+            (memory_type != TRITONSERVER_MEMORY_GPU)) {
+          status = DecodeInput(
+              encoding, static_cast<const char*>(buffer), buffer_byte_size,
+              run_datatype, row_shape, request_rows, staging + offset,
+              request_byte_size);
+          decoded = true;
+        } else {
+          encoded.resize(copied + buffer_byte_size);
+          status = CopyBuffer(
+              input_name, memory_type, memory_type_id,
+              TRITONSERVER_MEMORY_CPU, 0, buffer_byte_size, buffer,
+              &encoded[copied], stream_, &buffer_cuda_used);
+          encoded_cuda_used |= buffer_cuda_used;
+        }
+        copied += buffer_byte_size;
+      }
+
+      if (status.IsOk() && (encoding != ActivationEncoding::RAW) &&
+          !decoded) {
+#ifdef TRITON_ENABLE_GPU
+        if (encoded_cuda_used) {
+          cudaStreamSynchronize(stream_);
+        }
+#endif  // TRITON_ENABLE_GPU
+        status = DecodeInput(
+            encoding, encoded.data(), encoded.size(), run_datatype,
+            row_shape, request_rows, staging + offset, request_byte_size);
+      } else if (
+          status.IsOk() && (encoding == ActivationEncoding::RAW) &&
+          (copied != request_byte_size)) {
+        status = Status(
+            Status::Code::INVALID_ARG,
+            "unexpected size " + std::to_string(copied) +
+                " for inference input '" + input_name + "', expecting " +
+                std::to_string(request_byte_size));
+      }
+      if (!status.IsOk()) {
+        std::memset(staging + offset, 0, request_byte_size);
+        if ((*responses)[ridx] != nullptr) {
+          LOG_STATUS_ERROR(
+              InferenceResponse::SendWithStatus(
+                  std::move((*responses)[ridx]), status),
+              "error sending LibTorch response");
+        }
+      }
+
+      if (scaled) {
+        const auto& scale = request->InputScale();
+        for (size_t r = 0; r < request_rows; ++r) {
+          if (scale.empty()) {
+            scales.insert(scales.end(), run_scale_size, 1.0f);
+          } else {
+            scales.insert(scales.end(), scale.begin(), scale.end());
+          }
+        }
+      }
+      offset += request_byte_size;
+    }
+
+#ifdef TRITON_ENABLE_GPU
+    // Inputs held in device memory are staged on 'stream_', which
+    // LibTorch doesn't order its own copy after.
+    if (cuda_used) {
+      cudaStreamSynchronize(stream_);
+    }
+#endif  // TRITON_ENABLE_GPU
+
+    // Convert the run into its rows of the input with a single copy,
+    // and scale it with a single multiplication that broadcasts the
+    // scale of each row over its channels.
+    try {
+      if (!in_place) {
+        torch::Tensor staged = torch::from_blob(
+            staging, run_shape,
+            torch::TensorOptions().dtype(run_torch_dtype.second));
+        rows.copy_(staged, true /* non_blocking */);
+      }
+      if (scaled) {
+        std::vector<int64_t> scale_shape(run_shape.size(), 1);
+        scale_shape[0] = run_rows;
+        if (scale_shape.size() > 1) {
+          scale_shape[1] = run_scale_size;
+        }
+        rows.mul_(torch::from_blob(
+                      scales.data(), scale_shape,
+                      torch::TensorOptions().dtype(torch::kFloat32))
+                      .to(rows.device(), rows.scalar_type()));
+      }
+    }
+    catch (const std::exception& ex) {
+      return Status(
+          Status::Code::INTERNAL, "failed to convert inference input '" +
+                                      input_name + "': " + ex.what());
+    }
+
+    row += run_rows;
+    idx = run_end;
+  }
+
+  return Status::Success;
+}
+
+Status
+LibTorchBackend::Context::DecodeInput(
+    const ActivationEncoding encoding, const char* src,
+    const size_t src_byte_size, const DataType datatype,
+    const std::vector<int64_t>& row_shape, const size_t rows, char* dst,
+    const size_t dst_byte_size)
+{
+  if (encoding != ActivationEncoding::JPEG) {
+    return DecodeActivation(
+        encoding, src, src_byte_size, GetDataTypeByteSize(datatype), dst,
+        dst_byte_size);
+  }
+
+  // Each request sends the image of a single input.
+  if ((datatype != TYPE_FP32) || (rows != 1)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "input encoding 'jpeg' requires a single TYPE_FP32 input for "
+        "model '" +
+            name_ + "'");
+  }
+  return DecodeImageInput(
+      image_input_, src, src_byte_size, row_shape,
+      reinterpret_cast<float*>(dst));
+}
+
 Status
 LibTorchBackend::Context::ReadOutputTensors(
     const InferenceBackend* base, size_t total_batch_size,
@@ -648,33 +1405,7 @@ LibTorchBackend::Context::GetOutputTensor(
 
   return Status::Success;
 }
-template <typename A, typename B>
-void zip(
-	const std::vector<A> &a,
-	const std::vector<B> &b,
-	std::vector<std::pair<A, B>> &zipped)
-{
-	for (size_t i = 0; i < a.size(); ++i)
-	{
-		zipped.push_back(std::make_pair(a[i], b[i]));
-	}
-}
 
-// Write the first and second element of the pairs in 
-// the given zipped vector into a and b. (This assumes 
-// that the vectors have equal length)
-template <typename A, typename B>
-void unzip(
-	const std::vector<std::pair<A, B>> &zipped,
-	std::vector<A> &a,
-	std::vector<B> &b)
-{
-	for (size_t i = 0; i < a.size(); i++)
-	{
-		a[i] = zipped[i].first;
-		b[i] = zipped[i].second;
-	}
-}
 /*
 double harmonic_mean(std::vector<double> v) {
 	double sum = 0;
@@ -699,10 +1430,12 @@ LibTorchBackend::Context::Run(
   // execution. The batch-size, number of inputs, and size of each
   // input has already been checked so don't need to do that here.
   size_t total_batch_size = 0;
+  std::vector<double> queue_ms;
+  queue_ms.reserve(requests.size());
   for (auto& request : requests) {
+	  request->join_ns = compute_start_ns;
 	  
-	  if( queue_times.size() == 1000) queue_times.erase(queue_times.begin());
-	  queue_times.push_back((double)(compute_start_ns - request->QueueStartNs())/1000000.0);
+	  queue_ms.push_back((double)(compute_start_ns - request->QueueStartNs())/1000000.0);
           
 
 	  	  sum_queue += (double)(compute_start_ns - request->QueueStartNs())/1000000.0;
@@ -724,33 +1457,12 @@ LibTorchBackend::Context::Run(
     repr_input_request = request.get();
   }
 
-  std::string percentile_str = "";
-if(queue_times.size() > 2)
-	  {
-	  	  std::vector<double> temp;
-		  temp.assign(queue_times.begin(), queue_times.end());
-		  auto start_sort = get_current_unixtime();
-		  std::sort(temp.begin(), temp.end());
-		  for(uint32_t i = 1; i < 10 ; i++)
-		  {
-			  //std::cout << i << " " << temp[(uint32_t)(temp.size()*i/10)] << std::endl;
-		  	percentile_str += std::to_string(temp[(uint32_t)(temp.size()*i/10)]);
-			percentile_str += ",";
-		  }
-		  percentile_str += std::to_string(temp[temp.size()-1]);
-		 std::cout << "string " << percentile_str << std::endl;
-		  auto end_sort = get_current_unixtime();
-		  std::cout << "sorting " << queue_times.size() << " "  << end_sort - start_sort << "ms" << std::endl;
-	  }
-else
-{
-for(uint32_t i = 0; i < 9; i++)
-{
-	percentile_str += std::to_string(0);
-	percentile_str += ",";
-}
-percentile_str += std::to_string(0);
-}
+  LoadTelemetry::RecordQueueTimes(queue_ms);
+
+  // The queueing time percentiles are estimated off this thread, so
+  // report the latest published ones.
+  TRITONSERVER_LoadStatus published_status;
+  LoadTelemetry::Read(&published_status);
 
 
 
@@ -778,101 +1490,32 @@ percentile_str += std::to_string(0);
     return;
   }
 
- std::vector<uint32_t> request_index_vector;
-  std::vector<uint32_t> request_order;
-  
-  for (uint32_t request_idx = 0; request_idx < requests.size(); request_idx++)
-  {
-	request_index_vector.push_back(requests[request_idx]->partitioning_point);
-  	request_order.push_back(request_idx);
-  }
-  std::vector<std::pair<uint32_t, uint32_t>> zipped;
-  zip(request_order, request_index_vector, zipped);
-  std::sort(std::begin(zipped), std::end(zipped),
-		  [&](const auto& a, const auto& b)
-		  {
-		  return a.second < b.second;
-		  });
-  unzip(zipped, request_order, request_index_vector);
-  
-  std::vector<std::unique_ptr<InferenceRequest>> temp(requests.size());
-  
-    for(uint32_t request_idx = 0; request_idx < requests.size(); request_idx++)
-  {
-//	std::cout << "move request["<<request_order[request_idx]<<"](" <<requests[request_order[request_idx]]->partitioning_point << ") to temp[" << request_idx << "]" << std::endl;
-  	temp[request_idx] = std::move(requests[request_order[request_idx]]);
-  }
-  
-  for(uint32_t request_idx = 0; request_idx < requests.size(); request_idx++)
-  {
-	  requests[request_idx] = std::move(temp[request_idx]);
+  // The dynamic batcher hands over the requests already grouped by
+  // partitioning point. Other schedulers may not, so only sort if needed.
+  const auto by_point = [](const std::unique_ptr<InferenceRequest>& a,
+                           const std::unique_ptr<InferenceRequest>& b) {
+    return a->partitioning_point < b->partitioning_point;
+  };
+  if (!std::is_sorted(requests.begin(), requests.end(), by_point)) {
+    std::stable_sort(requests.begin(), requests.end(), by_point);
   }
+  const size_t scheduled_count = requests.size();
 
+  // The start layer of each group of requests and the size of the group.
   std::vector<uint32_t> unique;
-
-  for (uint32_t request_idx = 0; request_idx < requests.size(); request_idx++)
-  {
-	unique.push_back(requests[request_idx]->partitioning_point);
-  }
-  unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
-  
   std::vector<uint32_t> counts;
-
-  for (uint32_t i = 0; i < unique.size(); i++)
-  {
-	 counts.push_back( std::count(request_index_vector.begin(), request_index_vector.end(), unique[i]));
+  for (const auto& request : requests) {
+    if (unique.empty() || (unique.back() != (uint32_t)request->partitioning_point)) {
+      unique.push_back(request->partitioning_point);
+      counts.push_back(0);
+    }
+    counts.back()++;
   }
   
 
-if(name_.find("b0") != std::string::npos)
-{
-	unique.push_back(24);
-}
-else if(name_.find("b1") != std::string::npos)
-{
-	unique.push_back(31);
-}
-else if(name_.find("b2") != std::string::npos)
-{
-	unique.push_back(31);
-}
-else if(name_.find("b3") != std::string::npos)
-{
-	unique.push_back(34);
-}
-else if(name_.find("b4") != std::string::npos)
-{
-	unique.push_back(41);
-}
-else if (name_.find("b5") != std::string::npos) {
-
-	unique.push_back(47);
-}
-else if(name_.find("b6") != std::string::npos)
-{
-	unique.push_back(53);
-}
-else if(name_.find("resnet50") != std::string::npos)
-{
-	unique.push_back(22);
-}
-else if(name_.find("resnet152") != std::string::npos)
-{
-	unique.push_back(56);
-}
-else if(name_.find("resnet101") != std::string::npos)
-{
-	unique.push_back(42);
-}
-else if(name_.find("vgg16") != std::string::npos)
-{
-	unique.push_back(41);
-}
+  // The last entry is the end of the last segment.
+  unique.push_back(layer_count_);
 
-else
-{
-	std::cout << "backend unsupported model" << std::endl;
-}
 // requests are sorted...
 
 
@@ -920,11 +1563,16 @@ else
   
   std::vector<std::vector<torch::jit::IValue>> batch_inputs_(counts.size());
 
+  // With a pipeline the groups are executed by its stages while later
+  // batches are collected, so they can't share the activation buffers.
+  // The input buffers of each group are kept with the group instead.
+  Pipeline* pipeline = static_cast<LibTorchBackend*>(base)->pipeline_.get();
+  std::vector<size_t> input_buffer_ends;
+
 
   uint32_t progress = 0;
   for (uint32_t batch_index = 0; batch_index < counts.size() ; batch_index ++)
   {
-	  std::vector<std::unique_ptr<AllocatedMemory>> input_buffers_temp;
 	  std::vector<torch::jit::IValue> batch_input_(input_count);
 	  std::vector<std::unique_ptr<InferenceRequest>> temp_request(counts[batch_index]);
 	  std::vector<std::unique_ptr<InferenceResponse>> temp_response(counts[batch_index]);
@@ -940,9 +1588,15 @@ else
 
 
 
+	  // Collect the group directly into the rows of the activation
+	  // buffer that follow the rows of the preceding groups.
 	  SetInputTensors(
-			  counts[batch_index], temp_request, &temp_response, &collector_temp, &input_buffers_temp,
-			  &batch_input_, &cuda_copy);
+			  counts[batch_index], temp_request, &temp_response, &collector_temp, &input_buffers,
+			  &batch_input_, &cuda_copy,
+			  (pipeline == nullptr)
+				  ? ActivationRows(unique[batch_index], progress, counts[batch_index])
+				  : torch::Tensor());
+	  input_buffer_ends.push_back(input_buffers.size());
 	  for(uint32_t request_index = progress; request_index < progress+counts[batch_index]; request_index++)
 	  {
 
@@ -992,6 +1646,29 @@ else
   */
   INFER_STATS_DECL_TIMESTAMP(compute_input_end_ns);
 
+  // Each group enters the pipeline at its partitioning point and is
+  // responded to by the last stage.
+  if (pipeline != nullptr) {
+    size_t offset = 0;
+    for (size_t group = 0; group < counts.size(); ++group) {
+      std::unique_ptr<PipelineBatch> batch(new PipelineBatch);
+      batch->layer_ = unique[group];
+      batch->activation_ = batch_inputs_[group][0].toTensor();
+      for (size_t idx = offset; idx < offset + counts[group]; ++idx) {
+        batch->requests_.emplace_back(std::move(requests[idx]));
+        batch->responses_.emplace_back(std::move(responses[idx]));
+        batch->compute_input_end_ns_.push_back(compute_input_end_ns);
+      }
+      for (size_t idx = (group == 0) ? 0 : input_buffer_ends[group - 1];
+           idx < input_buffer_ends[group]; ++idx) {
+        batch->input_buffers_.emplace_back(std::move(input_buffers[idx]));
+      }
+      offset += counts[group];
+      pipeline->Enqueue(std::move(batch));
+    }
+    return;
+  }
+
 //  std::ofstream logging;
 //  logging.open("/logging/inbackend", std::ios_base::app);
   
@@ -999,8 +1676,21 @@ else
 //  std::cout << "times size " << times.size() << std::endl; 
   std::vector<uint32_t> each_time;
   FAIL_ALL_AND_RETURN_IF_ERROR(
-      requests, responses, metric_reporter_.get(), FreeBatchExecute(batch_inputs_, &outputs_, unique, each_time),
+      requests, responses, metric_reporter_.get(),
+      FreeBatchExecute(
+          base, &requests, &responses, &input_buffers, &batch_inputs_,
+          &outputs_, &unique, &counts, each_time),
       "error running LibTorch model");
+
+  // Requests may have joined the batch while it was executing.
+  if (requests.size() != scheduled_count) {
+    total_batch_size = 0;
+    sum_queue = 0;
+    for (const auto& request : requests) {
+      total_batch_size += std::max(1U, request->BatchSize());
+      sum_queue += (double)(request->join_ns - request->QueueStartNs()) / 1000000.0;
+    }
+  }
   //XXX 
   // Run...
 /*  FAIL_ALL_AND_RETURN_IF_ERROR(
@@ -1019,7 +1709,6 @@ else
   if(!info_time.empty())
  if( compute_output_start_ns - info_time[info_time.size()-1] > 1000000000)
  {
-	 queue_times.clear();
 	 throughputs.clear();
 	 batches.clear();
 	 infer_ms_vector.clear();
@@ -1108,14 +1797,17 @@ else
   for (size_t i = 0; i < requests.size(); ++i) {
     auto& request = requests[i];
     request->ReportStatistics(
-        metric_reporter_.get(), (responses[i] != nullptr), compute_start_ns,
-        compute_input_end_ns, compute_output_start_ns, compute_end_ns);
+        metric_reporter_.get(), (responses[i] != nullptr), request->join_ns,
+        std::max(compute_input_end_ns, request->join_ns),
+        compute_output_start_ns, compute_end_ns);
 
 #ifdef TRITON_ENABLE_TRACING
     if (request->Trace() != nullptr) {
       auto& trace = request->Trace();
-      trace->Report(TRITONSERVER_TRACE_COMPUTE_START, compute_start_ns);
-      trace->Report(TRITONSERVER_TRACE_COMPUTE_INPUT_END, compute_input_end_ns);
+      trace->Report(TRITONSERVER_TRACE_COMPUTE_START, request->join_ns);
+      trace->Report(
+          TRITONSERVER_TRACE_COMPUTE_INPUT_END,
+          std::max(compute_input_end_ns, request->join_ns));
       trace->Report(
           TRITONSERVER_TRACE_COMPUTE_OUTPUT_START, compute_output_start_ns);
       trace->Report(TRITONSERVER_TRACE_COMPUTE_END, compute_end_ns);
@@ -1132,6 +1824,7 @@ else
  //uint64_t queue_start_ns = 0;
  
  std::vector<uint64_t> queue_start_ns;
+ std::vector<uint64_t> join_ns;
  uint32_t last_batch_size = 0;
  uint32_t last_partitioning_point = 0 ;
  int64_t partitioning_point = -1;
@@ -1150,6 +1843,7 @@ else
   
    last_inference_start_vec.push_back(request->last_inference_start);
    queue_start_ns.push_back(request->QueueStartNs());
+   join_ns.push_back(request->join_ns);
    request_enqueue_times.push_back(request->request_enqueue_time);
    last_batch_size = request->last_batch_size;
    last_partitioning_point = request->last_partitioning_point;
@@ -1179,8 +1873,8 @@ else
   std::cout << "backend 769 : point : " << requests[0]->partitioning_point << std::endl;
   */
   for (auto& response : responses) {
-	  response->infer_ns = compute_end_ns - compute_start_ns;
-	  response->queue_ns = compute_start_ns - queue_start_ns[request_count];
+	  response->infer_ns = compute_end_ns - join_ns[request_count];
+	  response->queue_ns = join_ns[request_count] - queue_start_ns[request_count];
 	  response->last_batch_size = last_batch_size; //XXX 
 	  response->last_partitioning_point = last_partitioning_point; //XXX
 	  response->partitioning_point = partitioning_point_vec[request_count];
@@ -1188,11 +1882,17 @@ else
 	  response->throughput = throughput;
 	  response->request_rate = request_rate ;
 	  response->num_of_batch = requests.size(); // num_of_batch;
-	  response->queue_contents = percentile_str;//queue_contents_vec[request_count];
+	  std::copy(
+	      std::begin(published_status.queue_percentile_ms),
+	      std::end(published_status.queue_percentile_ms),
+	      response->queue_percentile_ms);//queue_contents_vec[request_count];
 	  response->arrival_rate = request_arrival_vec[request_count];
 	  response->last_inference_start = average_infer_ms;
 	  response->current_inference_start = average_queue_ms;
 	  response->request_enqueue_time = request_enqueue_times[request_count];
+	  response->SetPartitionHint(
+	      requests[request_count]->HintMinPoint(),
+	      requests[request_count]->HintMaxPoint());
 	  request_count ++;
           //response->current_inference_start = current_inference_start_vec[request_count];
 	  //response->last_inference_start = last_inference_start_vec[request_count];
@@ -1205,25 +1905,13 @@ else
 
 
 
-	share_server_status.attachSharedMemory();
-	char dummy[500];
-	memset(dummy, 42, sizeof(char)*500);
-	const auto p1 = std::chrono::system_clock::now();
-	uint64_t current_time = std::chrono::duration_cast<std::chrono::microseconds>(p1.time_since_epoch()).count();
-
-	std::string server_status = std::to_string(current_time) + "," +
-				    std::to_string(rho) + "," +
-				    std::to_string(throughput) + "," +
-				    std::to_string(num_of_batch) + "," +
-				    std::to_string(average_infer_ms) + "," +
-				    std::to_string(average_queue_ms) + "," +
-				    percentile_str;
-	//std::cout << server_status << std::endl;
-	share_server_status.copyToSharedMemory(dummy);
-	share_server_status.copyToSharedMemory(server_status.c_str());
-
-	share_server_status.detach();
-	//share_server_status.close();
+	TRITONSERVER_LoadStatus load_status;
+	load_status.average_interval_ms = rho;
+	load_status.average_throughput = throughput;
+	load_status.average_batch_size = num_of_batch;
+	load_status.average_infer_ms = average_infer_ms;
+	load_status.average_queue_ms = average_queue_ms;
+	LoadTelemetry::PublishBatch(load_status);
 
 
 
@@ -1236,10 +1924,152 @@ else
   }
 }
 
+void
+LibTorchBackend::Context::JoinLateRequests(
+    InferenceBackend* base, const size_t segment,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses,
+    std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+    std::vector<std::vector<torch::jit::IValue>>* batch_inputs_,
+    std::vector<uint32_t>* unique, std::vector<uint32_t>* counts)
+{
+  if (!late_join_ || (max_batch_size_ == NO_BATCHING)) {
+    return;
+  }
+
+  size_t total_batch_size = 0;
+  for (const auto& request : *requests) {
+    total_batch_size += std::max(1U, request->BatchSize());
+  }
+  if (total_batch_size >= (size_t)max_batch_size_) {
+    return;
+  }
+
+  // The last entry of 'unique' is the exit layer, requests starting
+  // there have nothing left to compute.
+  std::vector<std::unique_ptr<InferenceRequest>> joined;
+  Scheduler* scheduler = static_cast<LibTorchBackend*>(base)->BackendScheduler();
+  if ((scheduler == nullptr) ||
+      (scheduler->JoinInFlightBatch(
+           (*unique)[segment], unique->back(),
+           max_batch_size_ - total_batch_size, &joined) == 0)) {
+    return;
+  }
+
+  INFER_STATS_DECL_TIMESTAMP(join_ns);
+  std::stable_sort(
+      joined.begin(), joined.end(),
+      [](const std::unique_ptr<InferenceRequest>& a,
+         const std::unique_ptr<InferenceRequest>& b) {
+        return a->partitioning_point < b->partitioning_point;
+      });
+
+  const size_t input_count = joined[0]->ImmutableInputs().size();
+  size_t begin = 0;
+  while (begin < joined.size()) {
+    const uint32_t point = joined[begin]->partitioning_point;
+    size_t end = begin;
+    size_t run_batch_size = 0;
+    while ((end < joined.size()) &&
+           ((uint32_t)joined[end]->partitioning_point == point)) {
+      run_batch_size += std::max(1U, joined[end]->BatchSize());
+      ++end;
+    }
+
+    std::vector<std::unique_ptr<InferenceRequest>> run_requests;
+    std::vector<std::unique_ptr<InferenceResponse>> run_responses;
+    std::vector<double> queue_ms;
+    for (size_t idx = begin; idx < end; idx++) {
+      joined[idx]->join_ns = join_ns;
+      queue_ms.push_back(
+          (double)(join_ns - joined[idx]->QueueStartNs()) / 1000000.0);
+
+      std::unique_ptr<InferenceResponse> response;
+      Status status = joined[idx]->ResponseFactory().CreateResponse(&response);
+      if (!status.IsOk()) {
+        InferenceRequest::RespondIfError(joined[idx], status);
+        response.reset();
+      }
+      run_requests.emplace_back(std::move(joined[idx]));
+      run_responses.emplace_back(std::move(response));
+    }
+    LoadTelemetry::RecordQueueTimes(queue_ms);
+    begin = end;
+
+    bool cuda_copy = false;
+    std::vector<torch::jit::IValue> batch_input(input_count);
+    BackendInputCollector collector(
+        run_requests, &run_responses, enable_pinned_input_, stream_);
+    Status status = SetInputTensors(
+        run_batch_size, run_requests, &run_responses, &collector,
+        input_buffers, &batch_input, &cuda_copy);
+#ifdef TRITON_ENABLE_GPU
+    if (cuda_copy) {
+      cudaStreamSynchronize(stream_);
+    }
+#endif  // TRITON_ENABLE_GPU
+    if (!status.IsOk()) {
+      LOG_ERROR << "failed to join requests to executing batch for '" << name_
+                << "': " << status.Message();
+      for (auto& response : run_responses) {
+        if (response != nullptr) {
+          LOG_STATUS_ERROR(
+              InferenceResponse::SendWithStatus(std::move(response), status),
+              "error sending LibTorch response");
+        }
+      }
+      for (auto& request : run_requests) {
+        InferenceRequest::Release(std::move(request));
+      }
+      continue;
+    }
+
+    // Find the group starting at 'point', or the position of a new
+    // group if no request in the batch starts there.
+    size_t group = segment;
+    while ((group < counts->size()) && ((*unique)[group] < point)) {
+      ++group;
+    }
+    size_t offset = 0;
+    for (size_t g = 0; g < group; g++) {
+      offset += (*counts)[g];
+    }
+
+    if ((*unique)[group] == point) {
+      // Append to the rows of the existing group.
+      auto& group_input = (*batch_inputs_)[group];
+      for (size_t ip = 0; ip < input_count; ip++) {
+        group_input[ip] = torch::cat(
+            {group_input[ip].toTensor(), batch_input[ip].toTensor()}, 0);
+      }
+      offset += (*counts)[group];
+      (*counts)[group] += run_requests.size();
+    } else {
+      unique->insert(unique->begin() + group, point);
+      counts->insert(counts->begin() + group, run_requests.size());
+      batch_inputs_->insert(batch_inputs_->begin() + group, batch_input);
+    }
+
+    requests->insert(
+        requests->begin() + offset,
+        std::make_move_iterator(run_requests.begin()),
+        std::make_move_iterator(run_requests.end()));
+    responses->insert(
+        responses->begin() + offset,
+        std::make_move_iterator(run_responses.begin()),
+        std::make_move_iterator(run_responses.end()));
+  }
+}
+
 Status
 LibTorchBackend::Context::FreeBatchExecute(
-    std::vector<std::vector<torch::jit::IValue>> batch_inputs_,
-    std::vector<torch::Tensor>* outputs_, std::vector<uint32_t> unique, std::vector<uint32_t>& each_time)
+    InferenceBackend* base,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses,
+    std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+    std::vector<std::vector<torch::jit::IValue>>* batch_inputs_,
+    std::vector<torch::Tensor>* outputs_, std::vector<uint32_t>* unique,
+    std::vector<uint32_t>* counts, std::vector<uint32_t>& each_time)
 {
   const auto p1 = std::chrono::system_clock::now();
   //current_inference_start = std::chrono::duration_cast<std::chrono::microseconds>(p1.time_since_epoch()).count(); 
@@ -1248,54 +2078,45 @@ LibTorchBackend::Context::FreeBatchExecute(
   torch::jit::IValue model_outputs_;
 
 
-  for (uint32_t batch_index = 0 ; batch_index < unique.size()-1 ; batch_index ++)
+  for (uint32_t batch_index = 0 ; batch_index < unique->size()-1 ; batch_index ++)
   {
 
-	  std::vector<torch::jit::IValue> inputs;
-	  at::Tensor batch = batch_inputs_[0][0].toTensor().to(torch::kCUDA);
+	  at::Tensor batch = (*batch_inputs_)[0][0].toTensor().to(device_);
 
 	  //	  for (uint32_t b = 1; b <= batch_index; b++)
 	  //	  {
 	  //		 std::cout << "batch index " << batch_index <<  " " << b <<  std::endl;
 	  if (batch_index != 0)
 	  {
-		  at::Tensor current_step_tensor = batch_inputs_[batch_index][0].toTensor();
-		  batch = torch::cat({batch, current_step_tensor}, 0);
+		  // The batch has reached layer unique[batch_index], let queued
+		  // requests starting at or after it join before the next group
+		  // is concatenated.
+		  JoinLateRequests(
+				  base, batch_index, requests, responses, input_buffers,
+				  batch_inputs_, unique, counts);
+		  at::Tensor current_step_tensor = (*batch_inputs_)[batch_index][0].toTensor();
+		  batch = AppendActivation((*unique)[batch_index], batch, current_step_tensor);
 	  }
 
 	  //std::cout << "input size " << batch.sizes() << "start " << (int)unique[batch_index] << " end " << (int)unique[batch_index+1] << std::endl;	
 	  //	  }
-	  inputs.push_back(batch);
-
 
 	  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-	  at::Tensor startTensor = torch::tensor((int)unique[batch_index]).to(torch::kCUDA);
-	  startTensor = torch::reshape(startTensor, {-1,1});
-	  inputs.push_back(startTensor);
-	  at::Tensor endTensor = torch::tensor((int)unique[batch_index+1]).to(torch::kCUDA);
-	  endTensor = torch::reshape(endTensor, {-1,1});
-	  inputs.push_back(endTensor);
-
+	  try {
+		  model_outputs_ = ExecuteLayers(
+				  batch, (*unique)[batch_index], (*unique)[batch_index + 1]);
+	  }
+	  catch (const std::exception& ex) {
+		  return Status(
+				  Status::Code::INTERNAL,
+				  "failed to run model '" + name_ + "': " + ex.what());
+	  }
+	  Synchronize();
 	  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-
 	  auto remote_elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
-	  
-	  //std::cout << unique.size()-1 << " " << "set start and end tensor :" << remote_elapsed_time << std::endl; 
-	  //	  at::Tensor temp = inputs[0].toTensor();
 
-	  //std::cout << unique[batch_index] << " " << unique[batch_index+1] << " " << temp.sizes() << std::endl;
-	  
-	  begin = std::chrono::steady_clock::now();
-	  model_outputs_ = torch_model_->forward(inputs);
-	  cudaDeviceSynchronize();
-	  
-	  end = std::chrono::steady_clock::now();
-	  
-	  remote_elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
-	  //std::cout << unique.size()-1 << " " << "compute tensor :" << remote_elapsed_time << std::endl; 
-	
 	  begin = std::chrono::steady_clock::now();
-	  batch_inputs_[0][0] = model_outputs_;
+	  (*batch_inputs_)[0][0] = model_outputs_;
 	  end = std::chrono::steady_clock::now();
 	  remote_elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
 	  //std::cout << unique.size()-1 << " " << "change output :" << remote_elapsed_time << std::endl; 
@@ -1324,6 +2145,460 @@ LibTorchBackend::Context::FreeBatchExecute(
 }
 
 
+Status
+LibTorchBackend::Pipeline::Create(
+    LibTorchBackend* backend, std::unique_ptr<Pipeline>* pipeline)
+{
+  const auto& config = backend->Config();
+  if (config.max_batch_size() <= 0) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "partitioning pipeline requires max_batch_size > 0 for '" +
+            config.name() + "'");
+  }
+  if (backend->contexts_.empty()) {
+    return Status(
+        Status::Code::INTERNAL,
+        "partitioning pipeline requires at least one instance for '" +
+            config.name() + "'");
+  }
+
+  const auto& settings = config.partitioning().pipeline();
+  std::unique_ptr<Pipeline> local_pipeline(new Pipeline(
+      backend, (settings.queue_depth() == 0) ? 2 : settings.queue_depth()));
+
+  // The last stage ends at the number of layers the instances
+  // resolved, which the configuration may leave to the model.
+  const uint32_t layer_count =
+      static_cast<Context*>(backend->contexts_.front().get())->layer_count_;
+  std::vector<uint32_t> boundaries{0};
+  boundaries.insert(
+      boundaries.end(), settings.stage_boundary().begin(),
+      settings.stage_boundary().end());
+  boundaries.push_back(layer_count);
+  for (size_t idx = 0; idx + 1 < boundaries.size(); ++idx) {
+    if (boundaries[idx] >= boundaries[idx + 1]) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning pipeline stage_boundary must be in increasing order "
+          "and between 0 and layer_count " +
+              std::to_string(layer_count) + ", exclusive, for '" +
+              config.name() + "'");
+    }
+  }
+
+  for (size_t idx = 0; idx + 1 < boundaries.size(); ++idx) {
+    std::unique_ptr<Stage> stage(new Stage);
+    stage->start_ = boundaries[idx];
+    stage->end_ = boundaries[idx + 1];
+    RETURN_IF_ERROR(CreateStageContext(
+        backend,
+        *static_cast<Context*>(
+            backend->contexts_[idx % backend->contexts_.size()].get()),
+        idx, &stage->context_));
+    stage->exit_ = false;
+    local_pipeline->stages_.emplace_back(std::move(stage));
+  }
+
+  Pipeline* raw = local_pipeline.get();
+  for (size_t idx = 0; idx < raw->stages_.size(); ++idx) {
+    Stage* stage = raw->stages_[idx].get();
+    Stage* next_stage = (idx + 1 < raw->stages_.size())
+                            ? raw->stages_[idx + 1].get()
+                            : nullptr;
+    stage->thread_.reset(new std::thread(
+        [raw, stage, next_stage]() { raw->StageThread(stage, next_stage); }));
+    LOG_INFO << "Pipeline stage " << idx << " of '" << config.name()
+             << "' executes layers [" << stage->start_ << ", " << stage->end_
+             << ") on " << stage->context_->name_;
+  }
+
+  *pipeline = std::move(local_pipeline);
+  return Status::Success;
+}
+
+Status
+LibTorchBackend::Pipeline::CreateStageContext(
+    LibTorchBackend* backend, const Context& instance, const size_t stage_idx,
+    std::unique_ptr<Context>* context)
+{
+  const auto& config = backend->Config();
+
+  std::unique_ptr<MetricModelReporter> metric_reporter;
+#ifdef TRITON_ENABLE_METRICS
+  if (Metrics::Enabled()) {
+    metric_reporter.reset(new MetricModelReporter(
+        backend->Name(), backend->Version(), instance.gpu_device_,
+        config.metric_tags()));
+  }
+#endif  // TRITON_ENABLE_METRICS
+
+  std::unique_ptr<Context> local_context(new Context(
+      instance.name_ + "_stage" + std::to_string(stage_idx),
+      instance.gpu_device_, instance.max_batch_size_,
+      instance.enable_pinned_input_, instance.enable_pinned_output_,
+      std::move(metric_reporter)));
+  RETURN_IF_ERROR(local_context->CreateCudaStream());
+
+  local_context->device_ = instance.device_;
+  local_context->torch_model_ = instance.torch_model_;
+  local_context->late_join_ = instance.late_join_;
+  local_context->image_input_ = instance.image_input_;
+  local_context->intra_op_thread_count_ = instance.intra_op_thread_count_;
+  local_context->cpu_affinity_ = instance.cpu_affinity_;
+
+  RETURN_IF_ERROR(local_context->ValidateInputs(config.input()));
+  RETURN_IF_ERROR(local_context->ValidateOutputs(config.output()));
+  RETURN_IF_ERROR(local_context->ValidatePartitioning(config));
+
+  *context = std::move(local_context);
+  return Status::Success;
+}
+
+LibTorchBackend::Pipeline::Pipeline(
+    LibTorchBackend* backend, const size_t queue_depth)
+    : backend_(backend), queue_depth_(queue_depth)
+{
+}
+
+LibTorchBackend::Pipeline::~Pipeline()
+{
+  // Stop the stages in order so each one drains the batches handed
+  // over by the previous stage before it exits.
+  for (auto& stage : stages_) {
+    {
+      std::lock_guard<std::mutex> lock(stage->mu_);
+      stage->exit_ = true;
+    }
+    stage->cv_.notify_all();
+    if ((stage->thread_ != nullptr) && stage->thread_->joinable()) {
+      stage->thread_->join();
+    }
+  }
+}
+
+void
+LibTorchBackend::Pipeline::Enqueue(std::unique_ptr<PipelineBatch>&& batch)
+{
+  // The last stage starting at or before the layer of the batch. A
+  // batch entering at the last layer passes through the last stage.
+  Stage* stage = stages_.front().get();
+  for (const auto& candidate : stages_) {
+    if (candidate->start_ <= batch->layer_) {
+      stage = candidate.get();
+    }
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(stage->mu_);
+    stage->cv_.wait(
+        lock, [this, stage]() { return stage->queue_.size() < queue_depth_; });
+    stage->queue_.emplace_back(std::move(batch));
+  }
+  stage->cv_.notify_all();
+}
+
+void
+LibTorchBackend::Pipeline::StageThread(Stage* stage, Stage* next_stage)
+{
+  Context* context = stage->context_.get();
+  LOG_STATUS_ERROR(
+      context->InitThread(),
+      "failed to initialize pipeline stage thread of '" + context->name_ +
+          "'");
+
+  while (true) {
+    // Take the waiting batches, oldest first, as long as they fit in
+    // the maximum batch size.
+    std::vector<std::unique_ptr<PipelineBatch>> batches;
+    {
+      std::unique_lock<std::mutex> lock(stage->mu_);
+      stage->cv_.wait(
+          lock, [stage]() { return stage->exit_ || !stage->queue_.empty(); });
+      if (stage->queue_.empty()) {
+        break;
+      }
+
+      int64_t batch_size = 0;
+      while (!stage->queue_.empty()) {
+        const int64_t rows = stage->queue_.front()->activation_.size(0);
+        if (!batches.empty() &&
+            ((batch_size + rows) > context->max_batch_size_)) {
+          break;
+        }
+        batch_size += rows;
+        batches.emplace_back(std::move(stage->queue_.front()));
+        stage->queue_.pop_front();
+      }
+    }
+    stage->cv_.notify_all();
+
+    torch::jit::IValue stage_outputs;
+    std::unique_ptr<PipelineBatch> batch =
+        ExecuteStage(stage, std::move(batches), &stage_outputs);
+    if (batch == nullptr) {
+      continue;
+    }
+
+    if (next_stage == nullptr) {
+      Complete(context, std::move(batch), stage_outputs);
+      continue;
+    }
+
+    try {
+      batch->activation_ = stage_outputs.toTensor();
+    }
+    catch (const std::exception& ex) {
+      Fail(
+          std::move(batch),
+          Status(
+              Status::Code::INTERNAL,
+              "model '" + context->name_ +
+                  "' must produce a single tensor at pipeline stage "
+                  "boundary " +
+                  std::to_string(stage->end_)));
+      continue;
+    }
+    batch->layer_ = stage->end_;
+    Enqueue(std::move(batch));
+  }
+}
+
+std::unique_ptr<LibTorchBackend::PipelineBatch>
+LibTorchBackend::Pipeline::ExecuteStage(
+    Stage* stage, std::vector<std::unique_ptr<PipelineBatch>>&& batches,
+    torch::jit::IValue* stage_outputs)
+{
+  std::stable_sort(
+      batches.begin(), batches.end(),
+      [](const std::unique_ptr<PipelineBatch>& a,
+         const std::unique_ptr<PipelineBatch>& b) {
+        return a->layer_ < b->layer_;
+      });
+
+  // The rows of the merged batch are in the order the batches join,
+  // so keep the requests in that order too.
+  std::unique_ptr<PipelineBatch> merged(new PipelineBatch);
+  merged->layer_ = stage->end_;
+  std::vector<std::pair<uint32_t, torch::Tensor>> activations;
+  for (auto& batch : batches) {
+    activations.emplace_back(batch->layer_, batch->activation_);
+    merged->requests_.insert(
+        merged->requests_.end(),
+        std::make_move_iterator(batch->requests_.begin()),
+        std::make_move_iterator(batch->requests_.end()));
+    merged->responses_.insert(
+        merged->responses_.end(),
+        std::make_move_iterator(batch->responses_.begin()),
+        std::make_move_iterator(batch->responses_.end()));
+    merged->compute_input_end_ns_.insert(
+        merged->compute_input_end_ns_.end(),
+        batch->compute_input_end_ns_.begin(),
+        batch->compute_input_end_ns_.end());
+    merged->input_buffers_.insert(
+        merged->input_buffers_.end(),
+        std::make_move_iterator(batch->input_buffers_.begin()),
+        std::make_move_iterator(batch->input_buffers_.end()));
+  }
+
+  // As in FreeBatchExecute(), the running batch executes up to the
+  // layer of the next batch before the rows of that batch are
+  // appended.
+  Context* context = stage->context_.get();
+  try {
+    torch::NoGradGuard no_grad;
+    torch::Tensor activation;
+    uint32_t layer = activations.front().first;
+    for (const auto& entry : activations) {
+      if (activation.defined() && (entry.first > layer)) {
+        activation =
+            context->ExecuteLayers(activation, layer, entry.first).toTensor();
+        layer = entry.first;
+      }
+      const torch::Tensor rows = entry.second.to(context->device_);
+      activation =
+          activation.defined() ? torch::cat({activation, rows}, 0) : rows;
+    }
+    *stage_outputs =
+        (layer < stage->end_)
+            ? context->ExecuteLayers(activation, layer, stage->end_)
+            : torch::jit::IValue(activation);
+    context->Synchronize();
+  }
+  catch (const std::exception& ex) {
+    Fail(
+        std::move(merged),
+        Status(
+            Status::Code::INTERNAL,
+            "failed to run model '" + context->name_ + "': " + ex.what()));
+    return nullptr;
+  }
+
+  return merged;
+}
+
+void
+LibTorchBackend::Pipeline::Complete(
+    Context* context, std::unique_ptr<PipelineBatch>&& batch,
+    const torch::jit::IValue& model_outputs)
+{
+  INFER_STATS_DECL_TIMESTAMP(compute_output_start_ns);
+
+  std::vector<torch::Tensor> outputs;
+  if (model_outputs.isTuple()) {
+    for (const auto& m_op : model_outputs.toTuple()->elements()) {
+      outputs.push_back(m_op.toTensor());
+    }
+  } else if (model_outputs.isTensor()) {
+    outputs.push_back(model_outputs.toTensor());
+  } else {
+    Fail(
+        std::move(batch),
+        Status(
+            Status::Code::INTERNAL,
+            "failed to run model '" + context->name_ + "'"));
+    return;
+  }
+
+  for (const auto& output : backend_->Config().output()) {
+    const int op_index = context->output_index_map_[output.name()];
+    if ((op_index < 0) || (op_index >= (int)outputs.size())) {
+      Fail(
+          std::move(batch),
+          Status(
+              Status::Code::INVALID_ARG,
+              "The output " + output.name() +
+                  " in the model configuration refers to an output index "
+                  "which doesn't exist. This model has " +
+                  std::to_string(outputs.size()) + " outputs"));
+      return;
+    }
+  }
+
+  auto& requests = batch->requests_;
+  auto& responses = batch->responses_;
+  size_t total_batch_size = 0;
+  for (const auto& request : requests) {
+    total_batch_size += std::max(1U, request->BatchSize());
+  }
+
+  Status status = context->ReadOutputTensors(
+      backend_, total_batch_size, requests, &responses, &outputs,
+      &context->output_index_map_);
+  if (!status.IsOk()) {
+    Fail(std::move(batch), status);
+    return;
+  }
+
+  INFER_STATS_DECL_TIMESTAMP(compute_end_ns);
+
+  uint64_t compute_start_ns = compute_end_ns;
+  uint64_t compute_input_end_ns = 0;
+  double sum_queue_ms = 0;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    compute_start_ns = std::min(compute_start_ns, requests[i]->join_ns);
+    compute_input_end_ns =
+        std::max(compute_input_end_ns, batch->compute_input_end_ns_[i]);
+    sum_queue_ms +=
+        (double)(requests[i]->join_ns - requests[i]->QueueStartNs()) /
+        1000000.0;
+  }
+
+#ifdef TRITON_ENABLE_STATS
+  for (size_t i = 0; i < requests.size(); ++i) {
+    auto& request = requests[i];
+    request->ReportStatistics(
+        context->metric_reporter_.get(), (responses[i] != nullptr),
+        request->join_ns, batch->compute_input_end_ns_[i],
+        compute_output_start_ns, compute_end_ns);
+
+#ifdef TRITON_ENABLE_TRACING
+    if (request->Trace() != nullptr) {
+      auto& trace = request->Trace();
+      trace->Report(TRITONSERVER_TRACE_COMPUTE_START, request->join_ns);
+      trace->Report(
+          TRITONSERVER_TRACE_COMPUTE_INPUT_END,
+          batch->compute_input_end_ns_[i]);
+      trace->Report(
+          TRITONSERVER_TRACE_COMPUTE_OUTPUT_START, compute_output_start_ns);
+      trace->Report(TRITONSERVER_TRACE_COMPUTE_END, compute_end_ns);
+    }
+#endif  // TRITON_ENABLE_TRACING
+  }
+
+  backend_->MutableStatsAggregator()->UpdateInferBatchStats(
+      context->metric_reporter_.get(), total_batch_size, compute_start_ns,
+      compute_input_end_ns, compute_output_start_ns, compute_end_ns);
+#endif  // TRITON_ENABLE_STATS
+
+  // The load reported with the responses is that of this batch, the
+  // stages execute several batches at once so there is no meaningful
+  // per-instance history to average over.
+  TRITONSERVER_LoadStatus load_status;
+  LoadTelemetry::Read(&load_status);
+  const double infer_ms =
+      (double)(compute_end_ns - compute_start_ns) / 1000000.0;
+  load_status.average_interval_ms = requests.back()->rho;
+  load_status.average_batch_size = requests.size();
+  load_status.average_infer_ms = infer_ms;
+  load_status.average_queue_ms = sum_queue_ms / (double)requests.size();
+  load_status.average_throughput =
+      (infer_ms > 0) ? (requests.size() * 1000.0 / infer_ms) : 0;
+
+  for (size_t i = 0; i < responses.size(); ++i) {
+    auto& request = requests[i];
+    auto& response = responses[i];
+    if (response == nullptr) {
+      continue;
+    }
+    response->infer_ns = compute_end_ns - request->join_ns;
+    response->queue_ns = request->join_ns - request->QueueStartNs();
+    response->last_batch_size = request->last_batch_size;
+    response->last_partitioning_point = request->last_partitioning_point;
+    response->partitioning_point = request->partitioning_point;
+    response->rho = request->rho;
+    response->throughput = load_status.average_throughput;
+    response->request_rate = request->request_rate;
+    response->num_of_batch = requests.size();
+    std::copy(
+        std::begin(load_status.queue_percentile_ms),
+        std::end(load_status.queue_percentile_ms),
+        response->queue_percentile_ms);
+    response->arrival_rate = request->arrival_rate;
+    response->last_inference_start = load_status.average_infer_ms;
+    response->current_inference_start = load_status.average_queue_ms;
+    response->request_enqueue_time = request->request_enqueue_time;
+    response->SetPartitionHint(
+        request->HintMinPoint(), request->HintMaxPoint());
+    LOG_STATUS_ERROR(
+        InferenceResponse::Send(std::move(response)),
+        "failed to send LibTorch backend response");
+  }
+
+  LoadTelemetry::PublishBatch(load_status);
+
+  for (auto& request : requests) {
+    InferenceRequest::Release(std::move(request));
+  }
+}
+
+void
+LibTorchBackend::Pipeline::Fail(
+    std::unique_ptr<PipelineBatch>&& batch, const Status& status)
+{
+  LOG_ERROR << "pipeline failed to execute batch: " << status.Message();
+  for (auto& response : batch->responses_) {
+    if (response != nullptr) {
+      LOG_STATUS_ERROR(
+          InferenceResponse::SendWithStatus(std::move(response), status),
+          "error sending LibTorch response");
+    }
+  }
+  for (auto& request : batch->requests_) {
+    InferenceRequest::Release(std::move(request));
+  }
+}
+
 Status
 LibTorchBackend::Context::Execute(
     std::vector<torch::jit::IValue>* inputs_,
@@ -26,8 +26,13 @@
 #pragma once
 
 #include <torch/script.h>  // One-stop header.
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include "src/core/backend.h"
@@ -38,22 +43,6 @@
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
-class CSharedMemory
-{
-	private : 
-		int m_shmid;
-		key_t m_key; 
-		void *m_shared_memory; 
-	public : 
-		void setShmId( int key ); 
-		int getShmId(); 
-		void setKey( key_t key ); 
-		void setupSharedMemory( int size ); 
-		void attachSharedMemory(); 
-		void copyToSharedMemory( std::string str ); 
-		void detach();
-		void close();	
-}; 
 namespace nvidia { namespace inferenceserver {
 
 class AllocatedMemory;
@@ -98,6 +87,41 @@ class LibTorchBackend : public InferenceBackend {
         const ::google::protobuf::RepeatedPtrField<ModelOutput>& ios);
     Status ValidateControlInputs(const ModelSequenceBatching& ios);
 
+    // Apply the thread settings of the instance to the calling
+    // thread, which is the thread that executes the instance.
+    Status InitThread();
+
+    // Wait for the operations issued on the device of the instance to
+    // complete.
+    void Synchronize();
+
+    // Validate the partitioning settings of 'config' against the
+    // loaded model and prepare its segments for execution.
+    Status ValidatePartitioning(const ModelConfig& config);
+
+    // Find the precompiled submodule of each segment described by
+    // 'partitioning'. Models that don't provide them are executed
+    // with forward(X, start, end) instead.
+    Status LoadSegments(const ModelPartitioning& partitioning);
+
+    // Execute the layers in ['start', 'end') of the model on 'input'.
+    // Throws if the model fails to execute.
+    torch::jit::IValue ExecuteLayers(
+        const torch::Tensor& input, const uint32_t start, const uint32_t end);
+
+    // Return a view of 'rows' rows, starting at row 'offset', of the
+    // activation buffer of split point 'point'. Return an undefined
+    // tensor if there is no buffer for 'point' or it is too small.
+    torch::Tensor ActivationRows(
+        const uint32_t point, const int64_t offset, const int64_t rows);
+
+    // Return the activation at 'point' of 'batch' followed by the rows
+    // of 'group', assembled in the activation buffer of 'point' if
+    // possible and concatenated otherwise.
+    torch::Tensor AppendActivation(
+        const uint32_t point, const torch::Tensor& batch,
+        const torch::Tensor& group);
+
     // Set the meta data of an input from payloads.
     Status SetInputMetaData(
         const std::string& name, const DataType datatype,
@@ -109,13 +133,41 @@ class LibTorchBackend : public InferenceBackend {
         std::vector<std::unique_ptr<InferenceRequest>>&& requests) override;
 
     // Helper function to set an input buffer from one or more payloads.
+    // If the model has a single input and 'destination' has the size
+    // and type of the input tensor, the input is collected into the
+    // memory of 'destination' instead of a new buffer.
     Status SetInputTensors(
         size_t total_batch_size,
         const std::vector<std::unique_ptr<InferenceRequest>>& requests,
         std::vector<std::unique_ptr<InferenceResponse>>* responses,
         BackendInputCollector* collector,
         std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
-        std::vector<torch::jit::IValue>* inputs, bool* cuda_copy);
+        std::vector<torch::jit::IValue>* inputs, bool* cuda_copy,
+        const torch::Tensor& destination = torch::Tensor());
+
+    // Collect input 'input_name' of 'requests', some of which sent it
+    // in a transfer data type or encoded, into '*input_tensor' of data
+    // type 'datatype'. The input of each request is staged decoded and
+    // converted, and scaled, by consecutive runs of requests sharing a
+    // data type and scale size. 'destination' is used as in
+    // SetInputTensors().
+    Status SetTransferredInputTensor(
+        const std::string& input_name, const DataType datatype,
+        const std::vector<int64_t>& batchn_shape,
+        const std::vector<std::unique_ptr<InferenceRequest>>& requests,
+        std::vector<std::unique_ptr<InferenceResponse>>* responses,
+        std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+        const torch::Tensor& destination, torch::Tensor* input_tensor);
+
+    // Decode the 'src_byte_size' bytes at 'src', the input of a request
+    // of 'rows' rows of 'row_shape' and 'datatype', sent with
+    // 'encoding', into the 'dst_byte_size' bytes at 'dst'. An image is
+    // turned into the input as described by 'image_input_'.
+    Status DecodeInput(
+        const ActivationEncoding encoding, const char* src,
+        const size_t src_byte_size, const DataType datatype,
+        const std::vector<int64_t>& row_shape, const size_t rows, char* dst,
+        const size_t dst_byte_size);
 
     // Read an output tensor into one or more payloads.
     Status ReadOutputTensors(
@@ -140,24 +192,161 @@ class LibTorchBackend : public InferenceBackend {
 
 Status
 FreeBatchExecute(
-    std::vector<std::vector<torch::jit::IValue>> batch_inputs_,
-    std::vector<torch::Tensor>* outputs_, std::vector<uint32_t> unique, std::vector<uint32_t> &each_time);
+    InferenceBackend* base,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses,
+    std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+    std::vector<std::vector<torch::jit::IValue>>* batch_inputs_,
+    std::vector<torch::Tensor>* outputs_, std::vector<uint32_t>* unique,
+    std::vector<uint32_t>* counts, std::vector<uint32_t> &each_time);
+
+    // Pull queued requests whose partitioning point is at or past the
+    // layer reached by the running batch, i.e. 'unique[segment]', and
+    // merge them into the groups that have not been concatenated yet.
+    // 'requests', 'responses', 'batch_inputs_', 'unique' and 'counts'
+    // are kept in the group order expected by ReadOutputTensors().
+    void JoinLateRequests(
+        InferenceBackend* base, const size_t segment,
+        std::vector<std::unique_ptr<InferenceRequest>>* requests,
+        std::vector<std::unique_ptr<InferenceResponse>>* responses,
+        std::vector<std::unique_ptr<AllocatedMemory>>* input_buffers,
+        std::vector<std::vector<torch::jit::IValue>>* batch_inputs_,
+        std::vector<uint32_t>* unique, std::vector<uint32_t>* counts);
 
 
     std::shared_ptr<torch::jit::script::Module> torch_model_;
     torch::Device device_;
     std::unordered_map<std::string, int> input_index_map_;
+    // The data type of each input in the model configuration.
+    std::unordered_map<std::string, DataType> input_dtype_map_;
     std::unordered_map<std::string, int> output_index_map_;
     std::vector<double> throughputs;
     std::vector<double> batches;
     std::vector<double> infer_ms_vector;
     std::vector<double> queue_ms_vector;
     std::vector<uint64_t> info_time;
-    std::vector<double> queue_times;
 
-    CSharedMemory share_server_status;
+    // Whether queued requests may join the batch at segment boundaries.
+    bool late_join_;
+
+    // How an image sent in place of the model input is turned into it.
+    ModelPartitioning::ImageInput image_input_;
+
+    // The number of layers of the model, the end of the last segment.
+    uint32_t layer_count_;
+
+    // A precompiled submodule executing the layers from its start
+    // layer up to 'end_'.
+    struct Segment {
+      uint32_t end_;
+      torch::jit::script::Module module_;
+    };
+
+    // The number of runs with each batch size used to specialize a
+    // segment when the model is loaded.
+    static constexpr int SEGMENT_WARMUP_RUNS = 2;
+
+    // The segments keyed by their start layer, empty if the model
+    // doesn't provide segments.
+    std::map<uint32_t, Segment> segments_;
+
+    // The number of threads used within an operation, 0 to use the
+    // default.
+    int64_t intra_op_thread_count_;
 
+    // The CPUs the instance executes on, empty to not restrict them.
+    std::vector<int> cpu_affinity_;
+
+    // Activation buffer of the maximum batch size for each split
+    // point whose activation shape is known, keyed by its layer.
+    std::map<uint32_t, torch::Tensor> activation_buffers_;
+
+  };
+
+  // A batch of requests in the pipeline together with the activation
+  // of its rows entering layer 'layer_'. The requests, responses and
+  // rows are in the same order.
+  struct PipelineBatch {
+    uint32_t layer_;
+    torch::Tensor activation_;
+    std::vector<std::unique_ptr<InferenceRequest>> requests_;
+    std::vector<std::unique_ptr<InferenceResponse>> responses_;
+
+    // The time the inputs of each request were collected.
+    std::vector<uint64_t> compute_input_end_ns_;
+
+    // The buffers holding the inputs of the requests.
+    std::vector<std::unique_ptr<AllocatedMemory>> input_buffers_;
+  };
+
+  // Executes batches as a pipeline of stages, each executing a
+  // contiguous range of layers in a thread of its own. A stage merges
+  // the batches waiting in its queue, whatever layer they enter at,
+  // the same way FreeBatchExecute() merges the groups of a batch.
+  struct Pipeline {
+    // Create a pipeline executing the stages described by the model
+    // configuration of 'backend' on its contexts.
+    static Status Create(
+        LibTorchBackend* backend, std::unique_ptr<Pipeline>* pipeline);
+    ~Pipeline();
+
+    // Hand 'batch' over to the stage executing its layer. Blocks
+    // while the queue of that stage is full.
+    void Enqueue(std::unique_ptr<PipelineBatch>&& batch);
+
+   private:
+    struct Stage {
+      // The range of layers, ['start_', 'end_'), executed by the stage.
+      uint32_t start_;
+      uint32_t end_;
+
+      // The context of the stage, which shares the model of an instance
+      // but has a stream and output state of its own so that it doesn't
+      // race with the runner of that instance.
+      std::unique_ptr<Context> context_;
+
+      std::mutex mu_;
+      std::condition_variable cv_;
+      std::deque<std::unique_ptr<PipelineBatch>> queue_;
+      bool exit_;
+      std::unique_ptr<std::thread> thread_;
+    };
+
+    Pipeline(LibTorchBackend* backend, const size_t queue_depth);
+
+    // Create the context '*context' of stage 'stage_idx', executing the
+    // model loaded by 'instance'.
+    static Status CreateStageContext(
+        LibTorchBackend* backend, const Context& instance,
+        const size_t stage_idx, std::unique_ptr<Context>* context);
+
+    void StageThread(Stage* stage, Stage* next_stage);
+
+    // Merge 'batches' and execute the layers of 'stage' on them,
+    // setting 'stage_outputs' to the result. Return the merged batch,
+    // or nullptr if the execution failed in which case the requests
+    // have been responded to.
+    std::unique_ptr<PipelineBatch> ExecuteStage(
+        Stage* stage, std::vector<std::unique_ptr<PipelineBatch>>&& batches,
+        torch::jit::IValue* stage_outputs);
+
+    // Send the responses of a batch that completed the last stage.
+    void Complete(
+        Context* context, std::unique_ptr<PipelineBatch>&& batch,
+        const torch::jit::IValue& model_outputs);
+
+    // Send 'status' as the response of each request of 'batch' and
+    // release the requests.
+    void Fail(std::unique_ptr<PipelineBatch>&& batch, const Status& status);
+
+    LibTorchBackend* backend_;
+    const size_t queue_depth_;
+    std::vector<std::unique_ptr<Stage>> stages_;
   };
+
+  // The pipeline executing the model, nullptr if each context
+  // executes a whole batch.
+  std::unique_ptr<Pipeline> pipeline_;
 };
 
 std::ostream& operator<<(std::ostream& out, const LibTorchBackend& pb);
@@ -0,0 +1,244 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/activation_codec.h"
+
+#include <cstring>
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+Status
+DecodeSparse(
+    const char* src, const size_t src_byte_size, const size_t element_size,
+    char* dst, const size_t dst_byte_size)
+{
+  if ((element_size == 0) || ((dst_byte_size % element_size) != 0)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "sparse activation must hold whole elements of " +
+            std::to_string(element_size) + " bytes");
+  }
+
+  const size_t element_count = dst_byte_size / element_size;
+  const size_t bitmap_byte_size = (element_count + 7) / 8;
+  if (src_byte_size < bitmap_byte_size) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "sparse activation of " + std::to_string(src_byte_size) +
+            " bytes is smaller than its bitmap");
+  }
+
+  const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(src);
+  const char* values = src + bitmap_byte_size;
+  const char* values_end = src + src_byte_size;
+
+  // Runs of zero elements are skipped a bitmap byte at a time, they
+  // make up most of a post-ReLU activation.
+  std::memset(dst, 0, dst_byte_size);
+  for (size_t byte = 0; byte < bitmap_byte_size; ++byte) {
+    uint8_t bits = bitmap[byte];
+    while (bits != 0) {
+      const size_t bit = __builtin_ctz(bits);
+      const size_t element = byte * 8 + bit;
+      if ((element >= element_count) ||
+          ((values_end - values) < (ptrdiff_t)element_size)) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "sparse activation has fewer values than its bitmap sets");
+      }
+      std::memcpy(dst + element * element_size, values, element_size);
+      values += element_size;
+      bits &= bits - 1;
+    }
+  }
+
+  if (values != values_end) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "sparse activation has more values than its bitmap sets");
+  }
+
+  return Status::Success;
+}
+
+Status
+DecodeLZ(
+    const char* src, const size_t src_byte_size, char* dst,
+    const size_t dst_byte_size)
+{
+  const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* const iend = ip + src_byte_size;
+  char* op = dst;
+  char* const oend = dst + dst_byte_size;
+
+  const Status corrupt(
+      Status::Code::INVALID_ARG, "LZ activation is corrupted");
+
+  while (ip < iend) {
+    const uint8_t token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15) {
+      uint8_t extra;
+      do {
+        if (ip >= iend) {
+          return corrupt;
+        }
+        extra = *ip++;
+        literal_length += extra;
+      } while (extra == 255);
+    }
+    if (((size_t)(iend - ip) < literal_length) ||
+        ((size_t)(oend - op) < literal_length)) {
+      return corrupt;
+    }
+    std::memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    // The last sequence has only literals.
+    if (ip == iend) {
+      break;
+    }
+
+    if ((iend - ip) < 2) {
+      return corrupt;
+    }
+    const size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if ((offset == 0) || (offset > (size_t)(op - dst))) {
+      return corrupt;
+    }
+
+    size_t match_length = token & 15;
+    if (match_length == 15) {
+      uint8_t extra;
+      do {
+        if (ip >= iend) {
+          return corrupt;
+        }
+        extra = *ip++;
+        match_length += extra;
+      } while (extra == 255);
+    }
+    match_length += 4;
+    if ((size_t)(oend - op) < match_length) {
+      return corrupt;
+    }
+
+    // The match may overlap the bytes it produces.
+    const char* match = op - offset;
+    if (offset >= match_length) {
+      std::memcpy(op, match, match_length);
+      op += match_length;
+    } else {
+      for (size_t i = 0; i < match_length; ++i) {
+        *op++ = *match++;
+      }
+    }
+  }
+
+  if (op != oend) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "LZ activation decodes to " + std::to_string(op - dst) +
+            " bytes, expecting " + std::to_string(dst_byte_size));
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
+Status
+ParseActivationEncoding(const std::string& name, ActivationEncoding* encoding)
+{
+  if (name == "raw") {
+    *encoding = ActivationEncoding::RAW;
+  } else if (name == "sparse") {
+    *encoding = ActivationEncoding::SPARSE;
+  } else if (name == "lz") {
+    *encoding = ActivationEncoding::LZ;
+  } else if (name == "jpeg") {
+    *encoding = ActivationEncoding::JPEG;
+  } else {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unknown activation encoding '" + name +
+            "', expecting raw, sparse, lz or jpeg");
+  }
+
+  return Status::Success;
+}
+
+const char*
+ActivationEncodingString(const ActivationEncoding encoding)
+{
+  switch (encoding) {
+    case ActivationEncoding::SPARSE:
+      return "sparse";
+    case ActivationEncoding::LZ:
+      return "lz";
+    case ActivationEncoding::JPEG:
+      return "jpeg";
+    default:
+      return "raw";
+  }
+}
+
+Status
+DecodeActivation(
+    const ActivationEncoding encoding, const char* src,
+    const size_t src_byte_size, const size_t element_size, char* dst,
+    const size_t dst_byte_size)
+{
+  switch (encoding) {
+    case ActivationEncoding::SPARSE:
+      return DecodeSparse(
+          src, src_byte_size, element_size, dst, dst_byte_size);
+    case ActivationEncoding::LZ:
+      return DecodeLZ(src, src_byte_size, dst, dst_byte_size);
+    case ActivationEncoding::JPEG:
+      return Status(
+          Status::Code::INTERNAL,
+          "jpeg input must be decoded by the backend");
+    default:
+      break;
+  }
+
+  if (src_byte_size != dst_byte_size) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unexpected size " + std::to_string(src_byte_size) +
+            " for activation, expecting " + std::to_string(dst_byte_size));
+  }
+  std::memcpy(dst, src, dst_byte_size);
+  return Status::Success;
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,65 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string>
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// The encodings a request may send its activation input in.
+//
+// RAW sends the elements as they are.
+//
+// SPARSE sends a bitmap with one bit per element, the least
+// significant bit of the first byte for the first element, set for
+// each element that is not all zero bytes, followed by the elements
+// whose bit is set.
+//
+// LZ sends the elements compressed in the LZ4 block format.
+//
+// JPEG sends, at partitioning point 0, the image the model input is
+// computed from as described by the 'image_input' of the model
+// partitioning. It is decoded by the backend, not by
+// DecodeActivation().
+enum class ActivationEncoding { RAW, SPARSE, LZ, JPEG };
+
+// Return the encoding named 'name', "raw", "sparse", "lz" or "jpeg".
+Status ParseActivationEncoding(
+    const std::string& name, ActivationEncoding* encoding);
+
+const char* ActivationEncodingString(const ActivationEncoding encoding);
+
+// Decode the 'src_byte_size' bytes at 'src' encoded with 'encoding'
+// into the 'dst_byte_size' bytes at 'dst', elements of 'element_size'
+// bytes. Fail if the encoded data doesn't decode to exactly
+// 'dst_byte_size' bytes, or if the encoding is JPEG.
+Status DecodeActivation(
+    const ActivationEncoding encoding, const char* src,
+    const size_t src_byte_size, const size_t element_size, char* dst,
+    const size_t dst_byte_size);
+
+}}  // namespace nvidia::inferenceserver
@@ -259,7 +259,12 @@ InferenceBackend::SetConfiguredScheduler(
         config_.dynamic_batching().max_queue_delay_microseconds(),
         config_.dynamic_batching().default_queue_policy(),
         config_.dynamic_batching().priority_levels(),
-        config_.dynamic_batching().priority_queue_policy(), &scheduler));
+        config_.dynamic_batching().priority_queue_policy(),
+        config_.dynamic_batching().allow_late_join(),
+        config_.dynamic_batching().queue_order(),
+        config_.dynamic_batching().admission_control(),
+        config_.dynamic_batching().partition_hints(), config_.partitioning(),
+        config_.max_batch_size(), &scheduler));
   } else {
     // Default scheduler. Use dynamic batch scheduler (with batching
     // disabled) as the default scheduler.
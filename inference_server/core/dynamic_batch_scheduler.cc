@@ -34,6 +34,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include "src/core/constants.h"
+#include "src/core/load_telemetry.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.h"
 #include "src/core/nvtx.h"
@@ -43,69 +44,8 @@
 #include <cmath>
 
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <unistd.h>
 
-class CSharedMemory
-{
-	private : 
-		int m_shmid;
-		key_t m_key; 
-		void *m_shared_memory; 
-	public : 
-		void setShmId( int key ); 
-		int getShmId(); 
-		void setKey( key_t key ); 
-		void setupSharedMemory( int size ); 
-		void attachSharedMemory(); 
-		void copyToSharedMemory( std::string str ); 
-		void detach();
-		void close();	
-}; 
-void CSharedMemory::setShmId( int id ) 
-{
-	m_shmid = id; 
-} 
-void CSharedMemory::setKey( key_t key ) 
-{ 
-	m_key = key; 
-} 
-void CSharedMemory::setupSharedMemory( int size ) 
-{ 
-	// Setup shared memory, 11 is the size 
-	if ( ( m_shmid = shmget(m_key, size , IPC_CREAT | 0666)) < 0 ) 
-	{
-		printf("Error getting shared memory id"); 
-		exit( 1 ); 
-	}
-}
-void CSharedMemory::attachSharedMemory() 
-{ 
-	// Attached shared memory 
-	if ( ( m_shared_memory = shmat( m_shmid , NULL , 0 ) ) == (void*)-1) 
-	{ 
-		printf("Error attaching shared memory id"); 
-		exit(1); 
-	} 
-} 
-void CSharedMemory::copyToSharedMemory( std::string str ) 
-{ // copy string to shared memory 
-	memcpy( m_shared_memory, str.c_str() , str.size() ); 
-} 
-
-void CSharedMemory::detach() 
-{ 
-	// Detach and remove shared memory 
-	shmdt( m_shared_memory ); 
-	//	shmctl( m_shmid , IPC_RMID, NULL ); 
-}
-void CSharedMemory::close() 
-{ 
-	// Detach and remove shared memory 
-	shmctl( m_shmid , IPC_RMID, NULL ); 
-}
-
 namespace nvidia { namespace inferenceserver {
 
 	uint32_t idle_instances;
@@ -114,6 +54,20 @@ namespace nvidia { namespace inferenceserver {
 	uint64_t previous_request_arrive = 0;
 	std::vector<uint64_t> previous_request_arrives;
 
+	// Weight of a new interval in the mean time between arrivals.
+	constexpr double kArrivalIntervalWeight = 0.05;
+	// The share of the runners' time the recommended partitioning points
+	// use, the time within which they work off the backlog, and the
+	// least share of a request's allowance the latest recommended point
+	// uses.
+	constexpr double kHintUtilization = 0.8;
+	constexpr double kHintDrainUs = 500000;
+	constexpr double kHintMinShare = 0.25;
+	// How far the allowance of successive ranges is spread, as a
+	// fraction of it.
+	constexpr double kHintSpread = 0.3;
+	constexpr double kGoldenRatio = 0.6180339887498949;
+
 
 	DynamicBatchScheduler::DynamicBatchScheduler(
 			const uint32_t runner_id_start, const uint32_t runner_cnt,
@@ -124,17 +78,36 @@ namespace nvidia { namespace inferenceserver {
 			const std::set<int32_t>& preferred_batch_sizes,
 			const uint64_t max_queue_delay_microseconds,
 			const ModelQueuePolicy& default_queue_policy,
-			const uint32_t priority_levels, const ModelQueuePolicyMap& queue_policy_map)
+			const uint32_t priority_levels, const ModelQueuePolicyMap& queue_policy_map,
+			const bool allow_late_join,
+			const ModelDynamicBatching::QueueOrder queue_order,
+			const bool admission_control, const bool partition_hints,
+			std::unique_ptr<PartitionCostModel>&& cost_model)
 		: OnInit_(OnInit), OnWarmup_(OnWarmup), OnSchedule_(OnSchedule),
 		dynamic_batching_enabled_(dynamic_batching_enabled),
-		scheduler_thread_cnt_(runner_cnt), idle_scheduler_thread_cnt_(0),
-		queue_(default_queue_policy, priority_levels, queue_policy_map),
+		scheduler_thread_cnt_(runner_cnt), runner_id_start_(runner_id_start),
+		idle_scheduler_thread_cnt_(0),
+		queue_(
+				default_queue_policy, priority_levels, queue_policy_map,
+				(queue_order == ModelDynamicBatching::EARLIEST_DEADLINE_FIRST)
+				? RequestOrderKeyFn([this](const InferenceRequest& request) {
+					return LatestStartNs(request);
+					})
+				: RequestOrderKeyFn()),
 		preferred_batch_sizes_(preferred_batch_sizes),
 		pending_batch_delay_ns_(max_queue_delay_microseconds * 1000),
 		pending_batch_size_(0), queued_batch_size_(0),
 		next_preferred_batch_size_(0),
 		enforce_equal_shape_tensors_(enforce_equal_shape_tensors),
-		preserve_ordering_(preserve_ordering)
+		preserve_ordering_(preserve_ordering), allow_late_join_(allow_late_join),
+		cost_model_(std::move(cost_model)),
+		earliest_deadline_first_(
+				queue_order == ModelDynamicBatching::EARLIEST_DEADLINE_FIRST),
+		admission_control_(admission_control),
+		partition_hints_(partition_hints), arrival_interval_ns_(0),
+		last_arrival_ns_(0), hint_count_(0),
+		runner_busy_until_ns_(runner_cnt, 0),
+		pending_latest_start_ns_(UINT64_MAX)
 	{
 
 		//for request interval
@@ -170,7 +143,10 @@ namespace nvidia { namespace inferenceserver {
 					runner_id_start, runner_cnt, nice, OnInit, OnWarmup, OnSchedule,
 					dynamic_batching_enabled, enforce_equal_shape_tensors, preserve_ordering,
 					preferred_batch_sizes, max_queue_delay_microseconds, ModelQueuePolicy(),
-					0, ModelQueuePolicyMap(), scheduler);
+					0, ModelQueuePolicyMap(), false /* allow_late_join */,
+					ModelDynamicBatching::FIFO, false /* admission_control */,
+					false /* partition_hints */, ModelPartitioning(),
+					0 /* max_batch_size */, scheduler);
 		}
 
 	Status
@@ -184,13 +160,22 @@ namespace nvidia { namespace inferenceserver {
 				const uint64_t max_queue_delay_microseconds,
 				const ModelQueuePolicy& default_queue_policy,
 				const uint32_t priority_levels, const ModelQueuePolicyMap& queue_policy_map,
+				const bool allow_late_join,
+				const ModelDynamicBatching::QueueOrder queue_order,
+				const bool admission_control, const bool partition_hints,
+				const ModelPartitioning& partitioning, const int max_batch_size,
 				std::unique_ptr<Scheduler>* scheduler)
 		{
+			std::unique_ptr<PartitionCostModel> cost_model;
+			RETURN_IF_ERROR(
+					PartitionCostModel::Create(partitioning, max_batch_size, &cost_model));
+
 			DynamicBatchScheduler* dyna_sched = new DynamicBatchScheduler(
 					runner_id_start, runner_cnt, OnInit, OnWarmup, OnSchedule,
 					dynamic_batching_enabled, enforce_equal_shape_tensors, preserve_ordering,
 					preferred_batch_sizes, max_queue_delay_microseconds, default_queue_policy,
-					priority_levels, queue_policy_map);
+					priority_levels, queue_policy_map, allow_late_join, queue_order,
+					admission_control, partition_hints, std::move(cost_model));
 			std::unique_ptr<DynamicBatchScheduler> sched(dyna_sched);
 
 			// Create one scheduler thread for each requested runner. Associate
@@ -295,7 +280,30 @@ namespace nvidia { namespace inferenceserver {
 				previous_request_arrive = micro_current_time2;
 				//XXX
 				
+				uint64_t wait_us = 0;
+				if (!AdmitRequest(*request, &wait_us)) {
+					request->SetPredictedWaitMicroseconds(wait_us);
+					return Status(
+							Status::Code::DEADLINE_EXCEEDED,
+							"Request is predicted to miss its deadline, predicted wait " +
+							std::to_string(wait_us) + " us");
+				}
+
+				const uint64_t arrival_ns = request->QueueStartNs();
 				RETURN_IF_ERROR(queue_.Enqueue(request->Priority(), request));
+				PublishQueueDepth();
+				if (partition_hints_) {
+					if (last_arrival_ns_ != 0) {
+						const double interval_ns =
+							(arrival_ns > last_arrival_ns_) ? (arrival_ns - last_arrival_ns_) : 0;
+						arrival_interval_ns_ =
+							(arrival_interval_ns_ == 0)
+							? interval_ns
+							: arrival_interval_ns_ +
+							kArrivalIntervalWeight * (interval_ns - arrival_interval_ns_);
+					}
+					last_arrival_ns_ = arrival_ns;
+				}
 				// If there are any idle runners and the queued batch size is greater or
 				// equal to next preferred batch size, then wake one up to service this
 				// request. We do the actual wake outside of the lock to avoid having the
@@ -324,6 +332,59 @@ namespace nvidia { namespace inferenceserver {
 			return Status::Success;
 		}
 
+	size_t
+		DynamicBatchScheduler::JoinInFlightBatch(
+				const int64_t min_point, const int64_t max_point,
+				const size_t max_batch_size,
+				std::vector<std::unique_ptr<InferenceRequest>>* requests)
+		{
+			if (!allow_late_join_ || !dynamic_batching_enabled_ ||
+					(max_batch_size == 0)) {
+				return 0;
+			}
+
+			const size_t initial_count = requests->size();
+			size_t joined_batch_size = 0;
+			{
+				std::lock_guard<std::mutex> lock(mu_);
+				joined_batch_size = queue_.DequeuePointRange(
+						min_point, max_point, max_batch_size, requests);
+				if (joined_batch_size == 0) {
+					return 0;
+				}
+
+				// The removed requests may have been part of the pending
+				// batch, so the next GetDynamicBatch() must start over.
+				queued_batch_size_ -= joined_batch_size;
+				queue_.ResetCursor();
+				pending_batch_size_ = 0;
+				pending_points_.clear();
+				pending_latest_start_ns_ = UINT64_MAX;
+				required_equal_inputs_.clear();
+				next_preferred_batch_size_ = 0;
+				PublishQueueDepth();
+
+				if (preserve_ordering_) {
+					std::lock_guard<std::mutex> lock(completion_queue_mtx_);
+					for (size_t idx = initial_count; idx < requests->size(); ++idx) {
+						completion_queue_.emplace_back();
+						auto queue_slot = &completion_queue_.back();
+						(*requests)[idx]->SetResponseDelegator(
+								[this,
+								queue_slot](std::unique_ptr<InferenceResponse>&& response) {
+								{
+								std::lock_guard<std::mutex> lock(completion_queue_mtx_);
+								(*queue_slot) = std::move(response);
+								}
+								FinalizeResponses();
+								});
+					}
+				}
+			}
+
+			return joined_batch_size;
+		}
+
 	void
 		DynamicBatchScheduler::SchedulerThread(
 				const uint32_t runner_id, const int nice,
@@ -335,22 +396,6 @@ namespace nvidia { namespace inferenceserver {
 			// XXX: THREAD
 
 
-			CSharedMemory share_queue_status;
-
-			CSharedMemory share_arrival_rate;
-
-			share_queue_status.setKey(7777);
-			share_queue_status.setupSharedMemory(500*sizeof(char));
-			share_queue_status.attachSharedMemory();
-
-			share_arrival_rate.setKey(2819);
-			share_arrival_rate.setupSharedMemory(500*sizeof(char));
-			share_arrival_rate.attachSharedMemory();
-			char dummy[500];
-			memset(dummy, 48, sizeof(char)*500);
-			share_queue_status.copyToSharedMemory(dummy); 
-			share_arrival_rate.copyToSharedMemory(dummy);
-
 			if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice) == 0) {
 				LOG_VERBOSE(1) << "Starting dynamic-batch scheduler thread " << runner_id
 					<< " at nice " << nice << "...";
@@ -457,21 +502,17 @@ namespace nvidia { namespace inferenceserver {
 						//pending_batch_queue_cnt = 1;
 						if ((wait_microseconds == 0) && (pending_batch_queue_cnt != 0)) {
 							requests.reserve(pending_batch_queue_cnt);
-							for (size_t idx = 0; idx < pending_batch_queue_cnt; ++idx) {
-								std::unique_ptr<InferenceRequest> request;
-								auto status = queue_.Dequeue(&request);
-								if (status.IsOk()) {
-									requests.emplace_back(std::move(request));
-								} else {
-									// The queue is empty which conflicts with pending batch count.
-									// Send the current batch if any and reset related variables.
-									LOG_ERROR << "Failed to retrieve request from scheduler queue: "
-										<< status.Message();
-									queue_.ResetCursor();
-									queued_batch_size_ = 0;
-									pending_batch_size_ = 0;
-									break;
-								}
+							auto status = queue_.DequeuePendingBatch(&requests);
+							if (!status.IsOk()) {
+								// The queue conflicts with pending batch count. Send the
+								// current batch if any and reset related variables.
+								LOG_ERROR << "Failed to retrieve request from scheduler queue: "
+									<< status.Message();
+								queue_.ResetCursor();
+								queued_batch_size_ = 0;
+								pending_batch_size_ = 0;
+								pending_points_.clear();
+								pending_latest_start_ns_ = UINT64_MAX;
 							}
 
 							if (preserve_ordering_ && !requests.empty()) {
@@ -491,6 +532,13 @@ namespace nvidia { namespace inferenceserver {
 								}
 							}
 							queued_batch_size_ -= pending_batch_size_;
+							if (cost_model_ != nullptr) {
+								struct timespec now;
+								clock_gettime(CLOCK_MONOTONIC, &now);
+								runner_busy_until_ns_[runner_id - runner_id_start_] =
+									TIMESPEC_TO_NANOS(now) +
+									cost_model_->BatchCost(pending_points_) * 1000;
+							}
 							// Set next preferred to be 0 so that enqueue thread will wake up
 							// runners when new request arrives. In the case where the queue
 							// becomes empty, this helps the runners to set up proper wait time
@@ -499,6 +547,8 @@ namespace nvidia { namespace inferenceserver {
 							next_preferred_batch_size_ = 0;
 
 							pending_batch_size_ = 0;
+							pending_points_.clear();
+							pending_latest_start_ns_ = UINT64_MAX;
 							required_equal_inputs_.clear();
 
 							// If there are still requests in the queue after removing
@@ -541,6 +591,11 @@ namespace nvidia { namespace inferenceserver {
 						}
 					}
 
+					if (!requests.empty() || (rejected_requests != nullptr)) {
+						PublishQueueDepth();
+					}
+					SetPartitionHints(&requests);
+
 					// If no requests are to be handled, wait for notification or
 					// for the specified timeout before checking the queue again.
 					if (wait_microseconds > 0) {
@@ -607,14 +662,150 @@ namespace nvidia { namespace inferenceserver {
 				// while loop will exit) and the logging below uses only local
 				// variables... so this code is ok.
 			}  // end runner loop
-			share_queue_status.detach();
-			share_queue_status.close();
-			share_arrival_rate.detach();
-			share_arrival_rate.close();
 			LOG_VERBOSE(1) << "Stopping dynamic-batch scheduler thread " << runner_id
 				<< "...";
 		}
 
+	uint64_t
+		DynamicBatchScheduler::LatestStartNs(const InferenceRequest& request) const
+		{
+			const uint64_t deadline_ns = request.DeadlineNs();
+			if (deadline_ns == 0) {
+				return UINT64_MAX;
+			}
+
+			uint64_t remaining_ns = 0;
+			if (cost_model_ != nullptr) {
+				remaining_ns = cost_model_->SegmentCost(
+						request.partitioning_point, cost_model_->LayerCount(), 1) *
+					1000;
+			}
+
+			return (deadline_ns > remaining_ns) ? (deadline_ns - remaining_ns) : 0;
+		}
+
+	bool
+		DynamicBatchScheduler::AdmitRequest(
+				const InferenceRequest& request, uint64_t* wait_us)
+		{
+			*wait_us = 0;
+			const uint64_t deadline_ns = request.DeadlineNs();
+			if (!admission_control_ || (cost_model_ == nullptr) ||
+					(deadline_ns == 0)) {
+				return true;
+			}
+
+			// The request can't start before a runner is free and before the
+			// requests already queued are executed. All queued requests are
+			// counted, so with earliest-deadline-first ordering the wait of an
+			// urgent request is over-estimated.
+			const uint64_t now_ns = request.QueueStartNs();
+			uint64_t free_ns = UINT64_MAX;
+			for (const auto busy_until_ns : runner_busy_until_ns_) {
+				free_ns = std::min(
+						free_ns, (busy_until_ns > now_ns) ? (busy_until_ns - now_ns) : 0);
+			}
+			if (free_ns == UINT64_MAX) {
+				free_ns = 0;
+			}
+
+			std::map<int64_t, size_t> points(queue_.PointDepths());
+			const double runner_cnt = std::max((size_t)1, runner_busy_until_ns_.size());
+			const double queued_us = cost_model_->QueueCost(points) / runner_cnt;
+			points[request.partitioning_point] += 1;
+			const double completion_us = cost_model_->QueueCost(points) / runner_cnt;
+
+			*wait_us = free_ns / 1000 + (uint64_t)queued_us;
+			return (now_ns + free_ns + (uint64_t)(completion_us * 1000)) <=
+				deadline_ns;
+		}
+
+	void
+		DynamicBatchScheduler::PublishQueueDepth()
+		{
+			LoadTelemetry::PublishQueueDepth(queue_.PointDepths());
+		}
+
+	void
+		DynamicBatchScheduler::SetPartitionHints(
+				std::vector<std::unique_ptr<InferenceRequest>>* requests)
+		{
+			if (!partition_hints_ || (cost_model_ == nullptr) || requests->empty()) {
+				return;
+			}
+
+			// The local-only point, 'layer_count', runs the whole model on
+			// the client. No request is split there but it may end a hint.
+			const int64_t local_point = cost_model_->LayerCount();
+			if (arrival_interval_ns_ == 0) {
+				for (auto& request : *requests) {
+					request->SetPartitionHint(0, local_point);
+				}
+				return;
+			}
+
+			// The backlog is the work left of the executing batches and the
+			// work of the queued requests.
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			const uint64_t now_ns = TIMESPEC_TO_NANOS(now);
+			double backlog_us = 0;
+			for (const auto busy_until_ns : runner_busy_until_ns_) {
+				if (busy_until_ns > now_ns) {
+					backlog_us += (busy_until_ns - now_ns) / 1000.0;
+				}
+			}
+			const std::map<int64_t, size_t>& points = queue_.PointDepths();
+			const double queued_us = cost_model_->QueueCost(points);
+			backlog_us += queued_us;
+
+			// The work a request may add so that the runners are busy
+			// 'kHintUtilization' of the time at the current arrival rate
+			// and the backlog is worked off within 'kHintDrainUs'.
+			const double runner_cnt =
+				std::max((size_t)1, runner_busy_until_ns_.size());
+			const double allowance_us =
+				(arrival_interval_ns_ / 1000.0) *
+				(runner_cnt * kHintUtilization - backlog_us / kHintDrainUs);
+
+			// The work a request adds at each point, less where it batches
+			// with the requests queued at the same point.
+			std::vector<double> added_us;
+			cost_model_->AddedQueueCost(points, &added_us);
+
+			for (auto& request : *requests) {
+				// Successive ranges are spread around the allowance so that
+				// the clients given them don't all move to the same point.
+				const double spread =
+					2 * std::fmod(hint_count_++ * kGoldenRatio, 1.0) - 1;
+				const double allowance = allowance_us * (1 + kHintSpread * spread);
+
+				int64_t min_point, max_point;
+				PartitionHintRange(
+						added_us, allowance, kHintMinShare, &min_point, &max_point);
+				request->SetPartitionHint(min_point, max_point);
+			}
+		}
+
+	bool
+		DynamicBatchScheduler::ShouldJoinPendingBatch(
+				const int64_t partitioning_point, const size_t batch_size)
+		{
+			// Adding the request delays every request in the pending batch
+			// by the increase of the batch execution time. Skipping it makes
+			// the request wait for the pending batch and then run on its own.
+			// Join only if that adds less latency in total.
+			const double pending_cost = cost_model_->BatchCost(pending_points_);
+			std::map<int64_t, size_t> joined_points(pending_points_);
+			joined_points[partitioning_point] += batch_size;
+			const double joined_cost = cost_model_->BatchCost(joined_points);
+			const double alone_cost =
+				cost_model_->BatchCost({{partitioning_point, batch_size}});
+
+			return ((pending_batch_size_ + batch_size) * (joined_cost - pending_cost)) <=
+				alone_cost;
+		}
+
 	uint64_t
 		DynamicBatchScheduler::GetDynamicBatch(const int64_t runner_id)
 		{
@@ -630,6 +821,8 @@ namespace nvidia { namespace inferenceserver {
 			if (!queue_.IsCursorValid()) {
 				queue_.ResetCursor();
 				pending_batch_size_ = 0;
+				pending_points_.clear();
+				pending_latest_start_ns_ = UINT64_MAX;
 			}
 			size_t best_preferred_batch_size = 0;
 			queued_batch_size_ -= queue_.ApplyPolicyAtCursor();
@@ -666,16 +859,29 @@ namespace nvidia { namespace inferenceserver {
 						send_now = true;
 						break;
 					}
-					// cursor encounters another partitioning point request!! XXX
-					//if () // TODO
-					//{
-					//	      send_now = true;
-					//	      break;
-					//  }
+					// The request may start at a different partitioning point
+					// than the pending batch, which costs the batch extra
+					// segments. Leave it in the queue, at its position, for a
+					// later batch if joining is more expensive than waiting.
+					if ((cost_model_ != nullptr) &&
+							!ShouldJoinPendingBatch(
+								queue_.RequestAtCursor()->partitioning_point, batch_size)) {
+						queue_.SkipCursor();
+						queued_batch_size_ -= queue_.ApplyPolicyAtCursor();
+						continue;
+					}
 				}
 
 				//std::cout << "Pending batch_size" << batch_size  << std::endl;
 				pending_batch_size_ += batch_size;
+				if (cost_model_ != nullptr) {
+					pending_points_[queue_.RequestAtCursor()->partitioning_point] +=
+						batch_size;
+				}
+				if (earliest_deadline_first_) {
+					pending_latest_start_ns_ = std::min(
+							pending_latest_start_ns_, LatestStartNs(*queue_.RequestAtCursor()));
+				}
 				queue_.AdvanceCursor();
 				queued_batch_size_ -= queue_.ApplyPolicyAtCursor();
 
@@ -720,6 +926,12 @@ namespace nvidia { namespace inferenceserver {
 				return 0;
 			}
 
+			// Don't wait for more requests past the time the most urgent
+			// request in the pending batch must start.
+			if (earliest_deadline_first_ && (now_ns >= pending_latest_start_ns_)) {
+				return 0;
+			}
+
 			// Set the next preferred batch size given the pending batch size
 			auto next_preferred_batch_size_it =
 				preferred_batch_sizes_.upper_bound(pending_batch_size_);
@@ -731,6 +943,9 @@ namespace nvidia { namespace inferenceserver {
 			}
 
 			uint64_t wait_ns = pending_batch_delay_ns_ - delay_ns;
+			if (earliest_deadline_first_) {
+				wait_ns = std::min(pending_latest_start_ns_ - now_ns, wait_ns);
+			}
 			// Note that taking request timeout into consideration allows us to reset
 			// pending batch as soon as it is invalidated. But the cost is that in edge
 			// case where the timeout will be expired one by one, the thread will be
@@ -775,7 +990,6 @@ namespace nvidia { namespace inferenceserver {
 					completion_queue_.pop_front();
 				}
 			}
-			std::string r = queue_.GetQueueContents(0);
 			for (auto& response : responses) {
 				InferenceResponse::Send(std::move(response));
 			}
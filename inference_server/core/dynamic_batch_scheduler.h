@@ -37,6 +37,7 @@
 #include <thread>
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
+#include "src/core/partition_cost_model.h"
 #include "src/core/scheduler.h"
 #include "src/core/scheduler_utils.h"
 #include "src/core/status.h"
@@ -61,6 +62,15 @@ class DynamicBatchScheduler : public Scheduler {
   // Create a scheduler to support a given number of runners and a run
   // function to call when a request is scheduled. And the scheduler also
   // supports different queue policies for different priority levels.
+  // If 'allow_late_join' is true, queued requests can be handed to a
+  // batch that is already executing, see JoinInFlightBatch(). If
+  // 'partitioning' provides layer costs, requests are added to a batch
+  // only if their partitioning point doesn't make the batch too costly.
+  // 'queue_order' selects the order in which queued requests are
+  // batched. If 'admission_control' is true, requests that are
+  // predicted to miss their deadline are rejected by Enqueue(). If
+  // 'partition_hints' is true, each request is given the range of
+  // partitioning points recommended for the next request of its client.
   static Status Create(
       const uint32_t runner_id_start, const uint32_t runner_cnt, const int nice,
       const StandardInitFunc& OnInit, const StandardWarmupFunc& OnWarmup,
@@ -71,7 +81,10 @@ class DynamicBatchScheduler : public Scheduler {
       const uint64_t max_queue_delay_microseconds,
       const ModelQueuePolicy& default_queue_policy,
       const uint32_t priority_level,
-      const ModelQueuePolicyMap& queue_policy_map,
+      const ModelQueuePolicyMap& queue_policy_map, const bool allow_late_join,
+      const ModelDynamicBatching::QueueOrder queue_order,
+      const bool admission_control, const bool partition_hints,
+      const ModelPartitioning& partitioning, const int max_batch_size,
       std::unique_ptr<Scheduler>* scheduler);
 
   ~DynamicBatchScheduler();
@@ -79,6 +92,12 @@ class DynamicBatchScheduler : public Scheduler {
   // \see Scheduler::Enqueue()
   Status Enqueue(std::unique_ptr<InferenceRequest>& request) override;
 
+  // \see Scheduler::JoinInFlightBatch()
+  size_t JoinInFlightBatch(
+      const int64_t min_point, const int64_t max_point,
+      const size_t max_batch_size,
+      std::vector<std::unique_ptr<InferenceRequest>>* requests) override;
+
  private:
   DynamicBatchScheduler(
       const uint32_t runner_id_start, const uint32_t runner_cnt,
@@ -90,12 +109,38 @@ class DynamicBatchScheduler : public Scheduler {
       const uint64_t max_queue_delay_microseconds,
       const ModelQueuePolicy& default_queue_policy,
       const uint32_t priority_levels,
-      const ModelQueuePolicyMap& queue_policy_map);
+      const ModelQueuePolicyMap& queue_policy_map, const bool allow_late_join,
+      const ModelDynamicBatching::QueueOrder queue_order,
+      const bool admission_control, const bool partition_hints,
+      std::unique_ptr<PartitionCostModel>&& cost_model);
   void SchedulerThread(
       const uint32_t runner_id, const int nice,
       const std::shared_ptr<std::atomic<bool>>& rthread_exit,
       std::promise<bool>* is_initialized);
   uint64_t GetDynamicBatch(const int64_t runner_id);
+  bool ShouldJoinPendingBatch(
+      const int64_t partitioning_point, const size_t batch_size);
+
+  // Return the latest time 'request' can start executing and still
+  // meet its deadline, or UINT64_MAX if it has no deadline.
+  uint64_t LatestStartNs(const InferenceRequest& request) const;
+
+  // Return true if 'request' is predicted to complete before its
+  // deadline when queued now. 'wait_us' returns the predicted time
+  // before the request starts executing. Must be called with 'mu_'
+  // held.
+  bool AdmitRequest(const InferenceRequest& request, uint64_t* wait_us);
+
+  // Publish the queue depth of each partitioning point to the load
+  // telemetry. Must be called with 'mu_' held.
+  void PublishQueueDepth();
+
+  // Set the range of partitioning points recommended for the next
+  // request of the client of each of 'requests', from the arrival rate,
+  // the queued requests and the executing batches. Must be called with
+  // 'mu_' held.
+  void SetPartitionHints(
+      std::vector<std::unique_ptr<InferenceRequest>>* requests);
   void FinalizeResponses();
 
   // Function the scheduler will call to initialize a runner.
@@ -110,8 +155,9 @@ class DynamicBatchScheduler : public Scheduler {
   // True if dynamic batching is enabled.
   const bool dynamic_batching_enabled_;
 
-  // The number of scheduler threads.
+  // The number of scheduler threads and the runner id of the first.
   const uint32_t scheduler_thread_cnt_;
+  const uint32_t runner_id_start_;
 
   // The number of scheduler threads currently idle.
   uint32_t idle_scheduler_thread_cnt_;
@@ -149,6 +195,47 @@ class DynamicBatchScheduler : public Scheduler {
   // even when there are multiple scheduler threads.
   const bool preserve_ordering_;
 
+  // If true queued requests may join a batch that is already
+  // executing at one of its segment boundaries.
+  const bool allow_late_join_;
+
+  // Estimates the execution time of a batch from the partitioning
+  // points of its requests. nullptr if the model doesn't provide the
+  // layer costs.
+  const std::unique_ptr<PartitionCostModel> cost_model_;
+
+  // True if requests are batched in order of their latest start time.
+  const bool earliest_deadline_first_;
+
+  // True if requests that would miss their deadline are rejected on
+  // arrival. Only effective if 'cost_model_' is set.
+  const bool admission_control_;
+
+  // True if requests are given a recommended range of partitioning
+  // points. Only effective if 'cost_model_' is set.
+  const bool partition_hints_;
+
+  // The mean time between the arrivals of admitted requests, 0 until
+  // two arrived, and the arrival of the latest. Only maintained if
+  // 'partition_hints_' is true.
+  double arrival_interval_ns_;
+  uint64_t last_arrival_ns_;
+
+  // The number of recommended ranges given so far.
+  uint64_t hint_count_;
+
+  // For each runner, the time its current batch is predicted to
+  // complete. Only maintained if 'cost_model_' is set.
+  std::vector<uint64_t> runner_busy_until_ns_;
+
+  // The earliest latest start time of the requests in the pending
+  // batch. Only maintained if 'earliest_deadline_first_' is true.
+  uint64_t pending_latest_start_ns_;
+
+  // The total batch size of the pending batch at each partitioning
+  // point. Only maintained if 'cost_model_' is set.
+  std::map<int64_t, size_t> pending_points_;
+
   // Per completion-id queues to store the ready requests
   std::deque<std::unique_ptr<InferenceResponse>> completion_queue_;
   // Lock to protect the completion_queues_
@@ -26,6 +26,7 @@
 
 #include "src/core/infer_request.h"
 
+#include <algorithm>
 #include <deque>
 #include "src/core/backend.h"
 #include "src/core/logging.h"
@@ -504,6 +505,35 @@ InferenceRequest::Normalize()
     }
   }
 
+  // If the model describes how it can be split make sure the request
+  // starts at one of its split points. The local-only point,
+  // 'layer_count', leaves nothing to execute on the server.
+  const auto& partitioning = model_config.partitioning();
+  if (partitioning.layer_count() != 0) {
+    if (partitioning_point == partitioning.layer_count()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning point " + std::to_string(partitioning_point) +
+              " is the local-only point of model '" + ModelName() +
+              "', the whole model executes on the client");
+    }
+    bool valid_point = (partitioning_point >= 0) &&
+                       (partitioning_point < partitioning.layer_count());
+    if (valid_point && !partitioning.split_point().empty()) {
+      valid_point = std::any_of(
+          partitioning.split_point().begin(), partitioning.split_point().end(),
+          [this](const ModelPartitioning::SplitPoint& split_point) {
+            return split_point.layer() == partitioning_point;
+          });
+    }
+    if (!valid_point) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning point " + std::to_string(partitioning_point) +
+              " is not a split point of model '" + ModelName() + "'");
+    }
+  }
+
   // Make sure that the request is providing the same number of inputs
   // as is expected by the model.
   if (original_inputs_.size() != (size_t)model_config.input_size()) {
@@ -514,6 +544,26 @@ InferenceRequest::Normalize()
             " inputs for model '" + ModelName() + "'");
   }
 
+  // Only the activation input of a single input model can be encoded.
+  if ((input_encoding_ != ActivationEncoding::RAW) &&
+      (model_config.input_size() != 1)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        std::string("input encoding '") +
+            ActivationEncodingString(input_encoding_) +
+            "' requires a single input for model '" + ModelName() + "'");
+  }
+
+  // An image is only sent in place of the input of the whole model.
+  if ((input_encoding_ == ActivationEncoding::JPEG) &&
+      (!partitioning.has_image_input() || (partitioning_point != 0))) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "input encoding 'jpeg' requires partitioning point 0 and an "
+        "image_input for model '" +
+            ModelName() + "'");
+  }
+
   // Determine the batch size and shape of each input.
   if (model_config.max_batch_size() == 0) {
     // Model does not support Triton-style batching so set as
@@ -584,7 +634,29 @@ InferenceRequest::Normalize()
     auto& input = pr.second;
     auto shape = input.MutableShape();
 
-    if (input.DType() != input_config->data_type()) {
+    // The input may be sent in one of the transfer data types of the
+    // model, the backend converts it to the data type of the input.
+    const auto& transfer_dtypes =
+        backend_raw_->Config().partitioning().transfer_data_type();
+    const bool transferred =
+        (input.DType() != input_config->data_type()) &&
+        (std::find(
+             transfer_dtypes.begin(), transfer_dtypes.end(), input.DType()) !=
+         transfer_dtypes.end());
+    if (!input_scale_.empty() &&
+        (!transferred ||
+         ((input_scale_.size() != 1) &&
+          (shape->empty() ||
+           ((int64_t)input_scale_.size() != (*shape)[0]))))) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "inference input '" + pr.first +
+              "' scale must have 1 or one value per channel and is only "
+              "allowed with a transfer data type for '" +
+              ModelName() + "'");
+    }
+
+    if ((input.DType() != input_config->data_type()) && !transferred) {
       return Status(
           Status::Code::INVALID_ARG,
           "inference input data-type is '" +
@@ -789,6 +861,14 @@ operator<<(std::ostream& out, const InferenceRequest& request)
       << ", batch size: " << request.BatchSize()
       << ", priority: " << request.Priority()
       << ", timeout (us): " << request.TimeoutMicroseconds() << std::endl;
+  out << "deadline (us): " << request.DeadlineMicroseconds() << std::endl;
+  if (request.InputEncoding() != ActivationEncoding::RAW) {
+    out << "input encoding: "
+        << ActivationEncodingString(request.InputEncoding()) << std::endl;
+  }
+  if (!request.InputScale().empty()) {
+    out << "input scale count: " << request.InputScale().size() << std::endl;
+  }
 
   out << "original inputs:" << std::endl;
   for (const auto& itr : request.OriginalInputs()) {
@@ -29,6 +29,7 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "src/core/activation_codec.h"
 #include "src/core/infer_response.h"
 #include "src/core/infer_stats.h"
 #include "src/core/infer_trace.h"
@@ -159,9 +160,14 @@ class InferenceRequest {
       InferenceBackend* backend, const int64_t requested_model_version)
       : needs_normalization_(true), backend_raw_(backend),
         requested_model_version_(requested_model_version), flags_(0),
-        correlation_id_(0), batch_size_(0), timeout_us_(0), collect_stats_(true)
+        correlation_id_(0), batch_size_(0), timeout_us_(0), deadline_us_(0),
+        predicted_wait_us_(0), hint_min_point_(-1), hint_max_point_(-1),
+        input_encoding_(ActivationEncoding::RAW),
+        collect_stats_(true)
   {
     SetPriority(0);
+    partitioning_point = 0;
+    join_ns = 0;
   }
 
   const std::string& ModelName() const;
@@ -191,6 +197,49 @@ class InferenceRequest {
   uint64_t TimeoutMicroseconds() const { return timeout_us_; }
   void SetTimeoutMicroseconds(uint64_t t) { timeout_us_ = t; }
 
+  // The time budget of the request, in microseconds, counted from
+  // when the request is enqueued. 0 indicates no deadline.
+  uint64_t DeadlineMicroseconds() const { return deadline_us_; }
+  void SetDeadlineMicroseconds(uint64_t d) { deadline_us_ = d; }
+
+  // Return the deadline of the request in the same clock as
+  // QueueStartNs(), or 0 if the request has no deadline. Only valid
+  // after the request has been enqueued.
+  uint64_t DeadlineNs() const
+  {
+    return (deadline_us_ == 0) ? 0 : (queue_start_ns_ + deadline_us_ * 1000);
+  }
+
+  // The time, in microseconds, the scheduler predicted the request
+  // would wait before executing. Set when the request is rejected
+  // because it would miss its deadline, 0 otherwise.
+  uint64_t PredictedWaitMicroseconds() const { return predicted_wait_us_; }
+  void SetPredictedWaitMicroseconds(uint64_t w) { predicted_wait_us_ = w; }
+
+  // The range of partitioning points the scheduler recommends for the
+  // next request of the client, set when the request is scheduled. -1
+  // if the scheduler doesn't recommend one.
+  int64_t HintMinPoint() const { return hint_min_point_; }
+  int64_t HintMaxPoint() const { return hint_max_point_; }
+  void SetPartitionHint(int64_t min_point, int64_t max_point)
+  {
+    hint_min_point_ = min_point;
+    hint_max_point_ = max_point;
+  }
+
+  // The scale of an input sent in a transfer data type of the model,
+  // either a single value or one value per channel. Empty if the
+  // input is not scaled.
+  const std::vector<float>& InputScale() const { return input_scale_; }
+  void SetInputScale(const float* scale, size_t count)
+  {
+    input_scale_.assign(scale, scale + count);
+  }
+
+  // The encoding the input is sent in.
+  ActivationEncoding InputEncoding() const { return input_encoding_; }
+  void SetInputEncoding(ActivationEncoding e) { input_encoding_ = e; }
+
 #ifdef TRITON_ENABLE_TRACING
   const std::unique_ptr<InferenceTrace>& Trace() const { return trace_; }
   std::unique_ptr<InferenceTrace>* MutableTrace() { return &trace_; }
@@ -450,6 +499,9 @@ class InferenceRequest {
 
  int64_t partitioning_point;
  int64_t num_of_batch;
+ // Timestamp when the request entered the executing batch. Equal to
+ // the batch compute start unless the request joined late.
+ uint64_t join_ns;
  std::string queue_contents;
  std::string arrival_rate;
  
@@ -490,6 +542,12 @@ class InferenceRequest {
   uint32_t batch_size_;
   uint32_t priority_;
   uint64_t timeout_us_;
+  uint64_t deadline_us_;
+  uint64_t predicted_wait_us_;
+  int64_t hint_min_point_;
+  int64_t hint_max_point_;
+  std::vector<float> input_scale_;
+  ActivationEncoding input_encoding_;
 
   std::unordered_map<std::string, Input> original_inputs_;
   std::unordered_map<std::string, std::shared_ptr<Input>> override_inputs_;
@@ -110,6 +110,20 @@ InferenceResponse::AddOutput(
   return Status::Success;
 }
 
+std::string
+InferenceResponse::QueueContents() const
+{
+  std::string queue_contents;
+  for (size_t i = 0; i < TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT; ++i) {
+    if (i != 0) {
+      queue_contents += ",";
+    }
+    queue_contents += std::to_string(queue_percentile_ms[i]);
+  }
+
+  return queue_contents;
+}
+
 Status
 InferenceResponse::ClassificationLabel(
     const InferenceResponse::Output& output, const uint32_t class_index,
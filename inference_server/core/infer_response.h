@@ -25,8 +25,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <algorithm>
 #include <deque>
 #include <functional>
+#include <iterator>
 #include <string>
 #include <vector>
 #include "src/core/constants.h"
@@ -121,7 +123,9 @@ class InferenceResponse {
    double request_rate; // XXX
    int64_t num_of_batch;
    int64_t partitioning_point;
-   std::string queue_contents;
+   // The published queueing time percentiles, in ms. QueueContents()
+   // formats them when the response is read.
+   double queue_percentile_ms[TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT];
    std::string arrival_rate;
    class Output {
    public:
@@ -225,8 +229,11 @@ class InferenceResponse {
           delegator)
       : backend_(backend), id_(id), allocator_(allocator),
         alloc_userp_(alloc_userp), response_fn_(response_fn),
-        response_userp_(response_userp), response_delegator_(delegator)
+        response_userp_(response_userp), response_delegator_(delegator),
+        hint_min_point_(-1), hint_max_point_(-1)
   {
+    std::fill(
+        std::begin(queue_percentile_ms), std::end(queue_percentile_ms), 0);
   }
 
   const std::string& Id() const { return id_; }
@@ -234,6 +241,19 @@ class InferenceResponse {
   int64_t ActualModelVersion() const;
   const Status& ResponseStatus() const { return status_; }
 
+  // The range of partitioning points the server recommends for the
+  // next request of the client, -1 if it doesn't recommend one.
+  int64_t HintMinPoint() const { return hint_min_point_; }
+  int64_t HintMaxPoint() const { return hint_max_point_; }
+  void SetPartitionHint(int64_t min_point, int64_t max_point)
+  {
+    hint_min_point_ = min_point;
+    hint_max_point_ = max_point;
+  }
+
+  // The queueing time percentiles as a comma-separated list.
+  std::string QueueContents() const;
+
   const std::deque<Output>& Outputs() const { return outputs_; }
 
   // Add an output to the response. If 'output' is non-null
@@ -298,6 +318,10 @@ class InferenceResponse {
 
   // Delegator to be invoked on sending responses.
   std::function<void(std::unique_ptr<InferenceResponse>&&)> response_delegator_;
+
+  // The recommended range of partitioning points.
+  int64_t hint_min_point_;
+  int64_t hint_max_point_;
 };
 
 std::ostream& operator<<(std::ostream& out, const InferenceResponse& response);
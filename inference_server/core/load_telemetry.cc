@@ -0,0 +1,388 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/load_telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <numeric>
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+uint64_t
+WallClockMicroseconds()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// The number of one second samples the available ingress bandwidth
+// is averaged over.
+constexpr size_t kIngressSampleCount = 10;
+
+// The link capacity assumed if the interface doesn't report one.
+constexpr double kDefaultLinkMbps = 1000;
+
+// Queueing times are aggregated every kQueueTimePeriod into windows
+// of kQueueTimeWindow. The sketch weights the last kQueueTimeWindowCount
+// windows, each older window by kQueueTimeDecay less.
+constexpr std::chrono::milliseconds kQueueTimePeriod(100);
+constexpr std::chrono::milliseconds kQueueTimeWindow(1000);
+constexpr size_t kQueueTimeWindowCount = 10;
+constexpr double kQueueTimeDecay = 0.7;
+
+}  // namespace
+
+LoadTelemetry::LoadTelemetry()
+    : sequence_(0), sampler_exit_(false), queue_time_exit_(false)
+{
+  TRITONSERVER_LoadStatus status;
+  memset(&status, 0, sizeof(status));
+  status.version = TRITONSERVER_LOAD_STATUS_VERSION;
+  status.split_point_mask = ~(uint64_t)0;
+  Store(status);
+}
+
+LoadTelemetry::~LoadTelemetry()
+{
+  {
+    std::lock_guard<std::mutex> lock(sampler_mu_);
+    sampler_exit_ = true;
+  }
+  sampler_cv_.notify_all();
+  if (sampler_thread_ != nullptr) {
+    sampler_thread_->join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queue_time_mu_);
+    queue_time_exit_ = true;
+  }
+  queue_time_cv_.notify_all();
+  if (queue_time_thread_ != nullptr) {
+    queue_time_thread_->join();
+  }
+}
+
+LoadTelemetry*
+LoadTelemetry::GetSingleton()
+{
+  static LoadTelemetry singleton;
+  return &singleton;
+}
+
+void
+LoadTelemetry::Load(TRITONSERVER_LoadStatus* status) const
+{
+  uint64_t words[kWordCount];
+  for (size_t i = 0; i < kWordCount; ++i) {
+    words[i] = words_[i].load(std::memory_order_relaxed);
+  }
+  memcpy(status, words, sizeof(words));
+}
+
+void
+LoadTelemetry::Store(const TRITONSERVER_LoadStatus& status)
+{
+  uint64_t words[kWordCount];
+  memcpy(words, &status, sizeof(words));
+  for (size_t i = 0; i < kWordCount; ++i) {
+    words_[i].store(words[i], std::memory_order_relaxed);
+  }
+}
+
+template <typename UpdateFn>
+void
+LoadTelemetry::Write(UpdateFn update)
+{
+  uint64_t sequence;
+  while (true) {
+    sequence = sequence_.load(std::memory_order_relaxed);
+    if (((sequence & 1) == 0) &&
+        sequence_.compare_exchange_weak(
+            sequence, sequence + 1, std::memory_order_acquire,
+            std::memory_order_relaxed)) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  TRITONSERVER_LoadStatus status;
+  Load(&status);
+  update(&status);
+  Store(status);
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void
+LoadTelemetry::PublishBatch(const TRITONSERVER_LoadStatus& status)
+{
+  const uint64_t now_us = WallClockMicroseconds();
+  GetSingleton()->Write([&status, now_us](TRITONSERVER_LoadStatus* current) {
+    current->batch_count++;
+    current->update_us = now_us;
+    current->average_interval_ms = status.average_interval_ms;
+    current->average_throughput = status.average_throughput;
+    current->average_batch_size = status.average_batch_size;
+    current->average_infer_ms = status.average_infer_ms;
+    current->average_queue_ms = status.average_queue_ms;
+  });
+}
+
+void
+LoadTelemetry::RecordQueueTimes(const std::vector<double>& queue_ms)
+{
+  LoadTelemetry* singleton = GetSingleton();
+  std::lock_guard<std::mutex> lock(singleton->queue_time_mu_);
+  singleton->recorded_queue_ms_.insert(
+      singleton->recorded_queue_ms_.end(), queue_ms.begin(), queue_ms.end());
+  if (singleton->queue_time_thread_ == nullptr) {
+    singleton->queue_time_thread_.reset(
+        new std::thread([singleton]() { singleton->AggregateQueueTimes(); }));
+  }
+}
+
+void
+LoadTelemetry::AggregateQueueTimes()
+{
+  // The most recent window is first.
+  std::deque<QueueTimeSketch> windows(1);
+  auto window_start = std::chrono::steady_clock::now();
+  std::vector<double> queue_ms;
+
+  std::unique_lock<std::mutex> lock(queue_time_mu_);
+  while (!queue_time_exit_) {
+    queue_time_cv_.wait_for(lock, kQueueTimePeriod);
+    if (queue_time_exit_) {
+      break;
+    }
+    queue_ms.swap(recorded_queue_ms_);
+    lock.unlock();
+
+    bool changed = !queue_ms.empty();
+    const auto now = std::chrono::steady_clock::now();
+    while (now - window_start >= kQueueTimeWindow) {
+      windows.emplace_front();
+      if (windows.size() > kQueueTimeWindowCount) {
+        windows.pop_back();
+      }
+      window_start += kQueueTimeWindow;
+      changed = true;
+    }
+
+    for (const double ms : queue_ms) {
+      windows.front().Add(ms);
+    }
+    queue_ms.clear();
+
+    if (changed) {
+      QueueTimeSketch sketch;
+      double weight = 1;
+      for (const auto& window : windows) {
+        sketch.Merge(window, weight);
+        weight *= kQueueTimeDecay;
+      }
+
+      Write([&sketch](TRITONSERVER_LoadStatus* current) {
+        for (size_t i = 0; i < TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT; ++i) {
+          current->queue_percentile_ms[i] = sketch.Quantile(
+              (double)(i + 1) / TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT);
+        }
+        std::copy(
+            sketch.Buckets().begin(), sketch.Buckets().end(),
+            std::begin(current->queue_time_sketch));
+      });
+    }
+
+    lock.lock();
+  }
+}
+
+void
+LoadTelemetry::PublishQueueDepth(const std::map<int64_t, size_t>& depths)
+{
+  uint32_t queue_depth[TRITONSERVER_LOAD_STATUS_MAX_POINTS] = {};
+  for (const auto& depth : depths) {
+    const int64_t point = std::min(
+        std::max(depth.first, (int64_t)0),
+        (int64_t)TRITONSERVER_LOAD_STATUS_MAX_POINTS - 1);
+    queue_depth[point] += depth.second;
+  }
+
+  GetSingleton()->Write([&queue_depth](TRITONSERVER_LoadStatus* current) {
+    std::copy(
+        std::begin(queue_depth), std::end(queue_depth),
+        std::begin(current->queue_depth));
+  });
+}
+
+void
+LoadTelemetry::PublishSplitPoints(const std::vector<int64_t>& points)
+{
+  uint64_t mask = 0;
+  for (const int64_t point : points) {
+    const int64_t bit = std::min(
+        std::max(point, (int64_t)0),
+        (int64_t)TRITONSERVER_LOAD_STATUS_MAX_POINTS - 1);
+    mask |= (uint64_t)1 << bit;
+  }
+
+  GetSingleton()->Write([mask](TRITONSERVER_LoadStatus* current) {
+    current->split_point_mask = mask;
+  });
+}
+
+void
+LoadTelemetry::Read(TRITONSERVER_LoadStatus* status)
+{
+  const LoadTelemetry* singleton = GetSingleton();
+  while (true) {
+    const uint64_t before = singleton->sequence_.load(std::memory_order_acquire);
+    if ((before & 1) == 0) {
+      singleton->Load(status);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (singleton->sequence_.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+    std::this_thread::yield();
+  }
+
+  status->status_us = WallClockMicroseconds();
+}
+
+Status
+LoadTelemetry::StartIngressSampler(const std::string& interface)
+{
+  LoadTelemetry* singleton = GetSingleton();
+  std::lock_guard<std::mutex> lock(singleton->sampler_mu_);
+  if (singleton->sampler_thread_ != nullptr) {
+    return Status(
+        Status::Code::ALREADY_EXISTS, "ingress sampler is already running");
+  }
+
+  std::ifstream rx_bytes(
+      "/sys/class/net/" + interface + "/statistics/rx_bytes");
+  if (!rx_bytes.is_open()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unable to sample network interface '" + interface + "'");
+  }
+
+  singleton->sampler_exit_ = false;
+  singleton->sampler_thread_.reset(new std::thread(
+      [singleton, interface]() { singleton->SampleIngress(interface); }));
+
+  return Status::Success;
+}
+
+void
+LoadTelemetry::StopIngressSampler()
+{
+  LoadTelemetry* singleton = GetSingleton();
+  std::unique_ptr<std::thread> thread;
+  {
+    std::lock_guard<std::mutex> lock(singleton->sampler_mu_);
+    singleton->sampler_exit_ = true;
+    thread = std::move(singleton->sampler_thread_);
+  }
+
+  if (thread != nullptr) {
+    singleton->sampler_cv_.notify_all();
+    thread->join();
+  }
+}
+
+void
+LoadTelemetry::SampleIngress(const std::string& interface)
+{
+  const std::string path = "/sys/class/net/" + interface;
+
+  double link_mbps = kDefaultLinkMbps;
+  {
+    std::ifstream speed(path + "/speed");
+    double mbps = 0;
+    if ((speed >> mbps) && (mbps > 0)) {
+      link_mbps = mbps;
+    }
+  }
+
+  LOG_VERBOSE(1) << "Sampling ingress of '" << interface << "', link capacity "
+                 << link_mbps << " Mbps";
+
+  std::deque<double> samples;
+  uint64_t previous_bytes = 0;
+  auto previous_time = std::chrono::steady_clock::now();
+  bool has_previous = false;
+
+  std::unique_lock<std::mutex> lock(sampler_mu_);
+  while (!sampler_exit_) {
+    sampler_cv_.wait_for(lock, std::chrono::seconds(1));
+    if (sampler_exit_) {
+      break;
+    }
+
+    uint64_t bytes = 0;
+    std::ifstream rx_bytes(path + "/statistics/rx_bytes");
+    if (!(rx_bytes >> bytes)) {
+      continue;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (has_previous && (bytes >= previous_bytes)) {
+      const double seconds =
+          std::chrono::duration<double>(now - previous_time).count();
+      // Decimal megabits, the unit /sys reports the link speed in.
+      const double rx_mbps = (bytes - previous_bytes) * 8 / 1e6 / seconds;
+      if (samples.size() == kIngressSampleCount) {
+        samples.pop_front();
+      }
+      samples.push_back(std::max(0.0, link_mbps - rx_mbps));
+
+      const double available_mbps =
+          std::accumulate(samples.begin(), samples.end(), 0.0) /
+          samples.size();
+      Write([available_mbps](TRITONSERVER_LoadStatus* current) {
+        current->available_ingress_mbps = available_mbps;
+      });
+    }
+
+    previous_bytes = bytes;
+    previous_time = now;
+    has_previous = true;
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
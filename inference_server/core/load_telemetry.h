@@ -0,0 +1,118 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/core/queue_time_sketch.h"
+#include "src/core/status.h"
+#include "src/core/tritonserver.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// Publishes the load of the server for clients that decide how much
+// of a model to offload. The load is kept in a fixed-layout
+// TRITONSERVER_LoadStatus protected by a sequence lock, so writers
+// don't allocate or format anything and readers never block writers.
+class LoadTelemetry {
+ public:
+  // Publish the statistics of a completed batch. Only the average_*
+  // fields of 'status' are published.
+  static void PublishBatch(const TRITONSERVER_LoadStatus& status);
+
+  // Record the queueing times, in milliseconds, of the requests of a
+  // batch. The times are added to the queueing time sketch by a
+  // separate thread so the caller only pays for a copy.
+  static void RecordQueueTimes(const std::vector<double>& queue_ms);
+
+  // Publish the number of queued requests at each partitioning
+  // point.
+  static void PublishQueueDepth(const std::map<int64_t, size_t>& depths);
+
+  // Publish the partitioning points a request may start at, so that
+  // clients don't choose one the model can't be split at.
+  static void PublishSplitPoints(const std::vector<int64_t>& points);
+
+  // Read a consistent snapshot of the load into 'status'.
+  static void Read(TRITONSERVER_LoadStatus* status);
+
+  // Start sampling the receive rate of network 'interface' once a
+  // second to publish the available ingress bandwidth. Sampling
+  // stops when the server exits or StopIngressSampler() is called.
+  static Status StartIngressSampler(const std::string& interface);
+  static void StopIngressSampler();
+
+ private:
+  static constexpr size_t kWordCount =
+      sizeof(TRITONSERVER_LoadStatus) / sizeof(uint64_t);
+  static_assert(
+      sizeof(TRITONSERVER_LoadStatus) % sizeof(uint64_t) == 0,
+      "TRITONSERVER_LoadStatus must be a whole number of 64-bit words");
+
+  LoadTelemetry();
+  ~LoadTelemetry();
+  static LoadTelemetry* GetSingleton();
+
+  // Apply 'update' to the published status. Concurrent writers are
+  // serialized by spinning on an odd sequence number.
+  template <typename UpdateFn>
+  void Write(UpdateFn update);
+  void Load(TRITONSERVER_LoadStatus* status) const;
+  void Store(const TRITONSERVER_LoadStatus& status);
+
+  void SampleIngress(const std::string& interface);
+  void AggregateQueueTimes();
+
+  // Odd while a write is in progress.
+  std::atomic<uint64_t> sequence_;
+
+  // The words of the published TRITONSERVER_LoadStatus. Accessed
+  // with relaxed atomics so a torn read is detected by the sequence
+  // number instead of being a data race.
+  std::atomic<uint64_t> words_[kWordCount];
+
+  std::mutex sampler_mu_;
+  std::condition_variable sampler_cv_;
+  bool sampler_exit_;
+  std::unique_ptr<std::thread> sampler_thread_;
+
+  // Queueing times recorded since the last aggregation. The
+  // aggregation thread is started by the first recorded times.
+  std::mutex queue_time_mu_;
+  std::condition_variable queue_time_cv_;
+  bool queue_time_exit_;
+  std::vector<double> recorded_queue_ms_;
+  std::unique_ptr<std::thread> queue_time_thread_;
+};
+
+}}  // namespace nvidia::inferenceserver
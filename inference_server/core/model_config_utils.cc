@@ -26,6 +26,7 @@
 
 #include "src/core/model_config_utils.h"
 
+#include <algorithm>
 #include <deque>
 #include <set>
 #include "src/core/autofill.h"
@@ -685,6 +686,14 @@ GetNormalizedModelConfig(
     }
   }
 
+  // If the number of layers is not specified it is given by the
+  // layer costs.
+  if ((config->partitioning().layer_count() == 0) &&
+      !config->partitioning().layer_cost().empty()) {
+    config->mutable_partitioning()->set_layer_count(
+        config->partitioning().layer_cost().size());
+  }
+
   // If sequence batching is specified...
   if (config->has_sequence_batching()) {
     // Set default idle is not specified.
@@ -904,6 +913,58 @@ ValidateModelConfig(
     }
   }
 
+  status = ValidateModelPartitioning(config.partitioning());
+  if (!status.IsOk()) {
+    return Status(
+        status.StatusCode(), status.Message() + " for " + config.name());
+  }
+
+  // An activation can only be sent in a transfer data type when it is
+  // the only input and is converted to TYPE_FP32.
+  for (const auto dtype : config.partitioning().transfer_data_type()) {
+    if ((dtype != DataType::TYPE_FP16) && (dtype != DataType::TYPE_INT8)) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning transfer_data_type must be TYPE_FP16 or TYPE_INT8 "
+          "for " +
+              config.name());
+    }
+    if ((config.input_size() != 1) ||
+        (config.input(0).data_type() != DataType::TYPE_FP32)) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning transfer_data_type requires a single TYPE_FP32 "
+          "input for " +
+              config.name());
+    }
+  }
+
+  // An image is only sent in place of a single TYPE_FP32 input holding
+  // the 3 channels of the image.
+  if (config.partitioning().has_image_input()) {
+    const auto& image_input = config.partitioning().image_input();
+    if ((config.input_size() != 1) ||
+        (config.input(0).data_type() != DataType::TYPE_FP32) ||
+        (config.input(0).dims_size() != 3) || (config.input(0).dims(0) != 3)) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning image_input requires a single TYPE_FP32 input of "
+          "shape [3, height, width] for " +
+              config.name());
+    }
+    if (((image_input.mean_size() != 0) && (image_input.mean_size() != 3)) ||
+        ((image_input.std_size() != 0) && (image_input.std_size() != 3)) ||
+        std::any_of(
+            image_input.std().begin(), image_input.std().end(),
+            [](const float std) { return std == 0; })) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning image_input must specify 3 values or none for "
+          "mean, and 3 non-zero values or none for std for " +
+              config.name());
+    }
+  }
+
   // If sequence batching is specified make sure the control is
   // specified correctly.
   if (config.has_sequence_batching()) {
@@ -1219,6 +1280,108 @@ CheckAllowedModelOutput(
   return Status::Success;
 }
 
+Status
+ValidateModelPartitioning(const ModelPartitioning& partitioning)
+{
+  const uint32_t layer_count = partitioning.layer_count();
+  if (!partitioning.layer_cost().empty() &&
+      ((uint32_t)partitioning.layer_cost().size() != layer_count)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "partitioning layer_cost must have one entry for each of the " +
+            std::to_string(layer_count) + " layers");
+  }
+
+  if (partitioning.has_pipeline()) {
+    const auto& boundaries = partitioning.pipeline().stage_boundary();
+    if ((layer_count == 0) && !boundaries.empty()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning must specify layer_count when pipeline "
+          "stage_boundary is specified");
+    }
+    for (int idx = 0; idx < boundaries.size(); ++idx) {
+      if ((boundaries[idx] == 0) || (boundaries[idx] >= layer_count) ||
+          ((idx > 0) && (boundaries[idx] <= boundaries[idx - 1]))) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning pipeline stage_boundary must be in increasing "
+            "order and between 0 and layer_count " +
+                std::to_string(layer_count) + ", exclusive");
+      }
+      if (!partitioning.split_point().empty() &&
+          std::none_of(
+              partitioning.split_point().begin(),
+              partitioning.split_point().end(),
+              [&boundaries, idx](const ModelPartitioning::SplitPoint& point) {
+                return point.layer() == boundaries[idx];
+              })) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning pipeline stage_boundary " +
+                std::to_string(boundaries[idx]) + " must be a split_point");
+      }
+    }
+  }
+
+  if (partitioning.split_point().empty()) {
+    return Status::Success;
+  }
+
+  if (layer_count == 0) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "partitioning must specify layer_count when split_point is "
+        "specified");
+  }
+
+  int segment_cost_cnt = 0;
+  for (int idx = 0; idx < partitioning.split_point().size(); ++idx) {
+    const auto& split_point = partitioning.split_point(idx);
+    if (split_point.layer() >= layer_count) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning split_point layer " +
+              std::to_string(split_point.layer()) + " must be less than " +
+              "layer_count " + std::to_string(layer_count));
+    }
+    if ((idx > 0) &&
+        (split_point.layer() <= partitioning.split_point(idx - 1).layer())) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning split_point layers must be in increasing order");
+    }
+    for (const auto dim : split_point.activation_dims()) {
+      if (dim <= 0) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning split_point " + std::to_string(split_point.layer()) +
+                " must have positive activation_dims");
+      }
+    }
+    if (split_point.has_cost()) {
+      ++segment_cost_cnt;
+    }
+  }
+
+  if (segment_cost_cnt != 0) {
+    if (segment_cost_cnt != partitioning.split_point().size()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning split_point cost must be specified for all or none "
+          "of the split points");
+    }
+    if (!partitioning.layer_cost().empty()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning can not specify both layer_cost and split_point "
+          "cost");
+    }
+  }
+
+  return Status::Success;
+}
+
 Status
 ParseBoolParameter(
     const std::string& key, std::string value, bool* parsed_value)
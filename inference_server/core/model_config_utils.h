@@ -125,6 +125,13 @@ Status ValidateModelOutput(
 Status CheckAllowedModelOutput(
     const ModelOutput& io, const std::set<std::string>& allowed);
 
+/// Validate that the partitioning settings are specified correctly
+/// in a model configuration.
+/// \param partitioning The model partitioning settings.
+/// \return The error status. A non-OK status indicates the settings
+/// are not valid.
+Status ValidateModelPartitioning(const ModelPartitioning& partitioning);
+
 /// Parse the 'value' of the parameter 'key' into a boolean value.
 /// \param key The name of the parameter.
 /// \param value The value of the parameter in string.
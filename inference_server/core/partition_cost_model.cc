@@ -0,0 +1,314 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/partition_cost_model.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+
+namespace nvidia { namespace inferenceserver {
+
+PartitionCostModel::PartitionCostModel(
+    const size_t layer_count, const float segment_overhead_us)
+    : layer_count_(layer_count), segment_overhead_us_(segment_overhead_us)
+{
+}
+
+Status
+PartitionCostModel::Create(
+    const ModelPartitioning& config, const int max_batch_size,
+    std::unique_ptr<PartitionCostModel>* model)
+{
+  model->reset();
+
+  // The cost of each layer, or nullptr if the layer has no cost. A
+  // cost given for a segment is attributed to the first layer of the
+  // segment, which is exact for every segment a request can execute.
+  std::vector<const google::protobuf::RepeatedField<float>*> layer_latency;
+  if (!config.layer_cost().empty()) {
+    for (const auto& cost : config.layer_cost()) {
+      layer_latency.push_back(&cost.batch_latency_us());
+    }
+  } else if (
+      !config.split_point().empty() && config.split_point(0).has_cost()) {
+    layer_latency.resize(config.layer_count(), nullptr);
+    for (const auto& split_point : config.split_point()) {
+      layer_latency[split_point.layer()] =
+          &split_point.cost().batch_latency_us();
+    }
+  } else {
+    return Status::Success;
+  }
+
+  if (config.segment_overhead_us() < 0) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "partitioning segment_overhead_us must be non-negative");
+  }
+
+  for (size_t layer = 0; layer < layer_latency.size(); ++layer) {
+    if (layer_latency[layer] == nullptr) {
+      continue;
+    }
+    const auto& latency = *layer_latency[layer];
+    if (latency.empty()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "partitioning cost of layer " + std::to_string(layer) +
+              " must specify at least one batch_latency_us");
+    }
+    for (const auto us : latency) {
+      if (us < 0) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "partitioning cost of layer " + std::to_string(layer) +
+                " must have non-negative batch_latency_us");
+      }
+    }
+  }
+
+  const size_t layer_count = layer_latency.size();
+  std::unique_ptr<PartitionCostModel> local_model(
+      new PartitionCostModel(layer_count, config.segment_overhead_us()));
+
+  const size_t batch_sizes = std::max(1, max_batch_size);
+  local_model->prefix_us_.resize(
+      batch_sizes, std::vector<double>(layer_count + 1, 0));
+  for (size_t bs = 1; bs <= batch_sizes; ++bs) {
+    auto& prefix = local_model->prefix_us_[bs - 1];
+    for (size_t layer = 0; layer < layer_count; ++layer) {
+      if (layer_latency[layer] == nullptr) {
+        prefix[layer + 1] = prefix[layer];
+        continue;
+      }
+      const auto& latency = *layer_latency[layer];
+      const size_t cnt = latency.size();
+      double us;
+      if (bs <= cnt) {
+        us = latency.Get(bs - 1);
+      } else if (cnt == 1) {
+        us = latency.Get(0);
+      } else {
+        const double step = latency.Get(cnt - 1) - latency.Get(cnt - 2);
+        us = std::max(0.0, latency.Get(cnt - 1) + step * (bs - cnt));
+      }
+      prefix[layer + 1] = prefix[layer] + us;
+    }
+  }
+
+  *model = std::move(local_model);
+  return Status::Success;
+}
+
+double
+PartitionCostModel::SegmentCost(
+    const int64_t start, const int64_t end, const size_t batch_size) const
+{
+  const int64_t layer_count = layer_count_;
+  const size_t s = std::min(std::max(start, (int64_t)0), layer_count);
+  const size_t e = std::min(std::max(end, (int64_t)0), layer_count);
+  if ((e <= s) || (batch_size == 0)) {
+    return 0;
+  }
+
+  const auto& prefix =
+      prefix_us_[std::min(batch_size, prefix_us_.size()) - 1];
+  double cost = prefix[e] - prefix[s];
+
+  // Beyond the largest profiled batch size assume the cost grows
+  // linearly with the batch size.
+  if (batch_size > prefix_us_.size()) {
+    cost = cost * batch_size / prefix_us_.size();
+  }
+
+  return cost;
+}
+
+double
+PartitionCostModel::BatchCost(const std::map<int64_t, size_t>& points) const
+{
+  double cost = 0;
+  size_t batch_size = 0;
+  size_t segment_cnt = 0;
+  for (auto it = points.begin(); it != points.end(); ++it) {
+    batch_size += it->second;
+    auto next = std::next(it);
+    const int64_t end =
+        (next == points.end()) ? (int64_t)layer_count_ : next->first;
+    if (end > it->first) {
+      cost += SegmentCost(it->first, end, batch_size);
+      ++segment_cnt;
+    }
+  }
+
+  if (segment_cnt > 1) {
+    cost += segment_overhead_us_ * (segment_cnt - 1);
+  }
+
+  return cost;
+}
+
+double
+PartitionCostModel::QueueCost(const std::map<int64_t, size_t>& points) const
+{
+  const size_t max_batch_size = prefix_us_.size();
+  double cost = 0;
+  std::map<int64_t, size_t> batch;
+  size_t batch_size = 0;
+  for (const auto& point : points) {
+    size_t remaining = point.second;
+    while (remaining > 0) {
+      const size_t cnt = std::min(remaining, max_batch_size - batch_size);
+      batch[point.first] += cnt;
+      batch_size += cnt;
+      remaining -= cnt;
+      if (batch_size == max_batch_size) {
+        cost += BatchCost(batch);
+        batch.clear();
+        batch_size = 0;
+      }
+    }
+  }
+
+  if (batch_size != 0) {
+    cost += BatchCost(batch);
+  }
+
+  return cost;
+}
+
+void
+PartitionCostModel::AddedQueueCost(
+    const std::map<int64_t, size_t>& points,
+    std::vector<double>* added_us) const
+{
+  const size_t max_batch_size = prefix_us_.size();
+
+  // The queued requests in order of their partitioning point, as runs
+  // of requests at the same point.
+  std::vector<std::pair<int64_t, size_t>> runs(points.begin(), points.end());
+  std::vector<size_t> run_start;
+  size_t request_cnt = 0;
+  for (const auto& run : runs) {
+    run_start.push_back(request_cnt);
+    request_cnt += run.second;
+  }
+
+  // The points of the requests in ['start', 'end') of that order.
+  auto range_points = [&](const size_t start, const size_t end,
+                          std::map<int64_t, size_t>* batch) {
+    batch->clear();
+    size_t idx =
+        std::upper_bound(run_start.begin(), run_start.end(), start) -
+        run_start.begin();
+    for (idx = (idx == 0) ? 0 : idx - 1;
+         (idx < runs.size()) && (run_start[idx] < end); ++idx) {
+      const size_t lo = std::max(start, run_start[idx]);
+      const size_t hi = std::min(end, run_start[idx] + runs[idx].second);
+      if (hi > lo) {
+        (*batch)[runs[idx].first] += hi - lo;
+      }
+    }
+  };
+
+  // A request inserted after the first 'k' requests leaves the batches
+  // before batch 'k / max_batch_size' as they are, joins that batch
+  // and shifts every later request by one. 'before_us' holds the cost
+  // of the batches before each batch and 'shifted_us' the cost of the
+  // shifted batches from each batch on.
+  std::map<int64_t, size_t> batch;
+  const size_t batch_cnt =
+      (request_cnt + max_batch_size - 1) / max_batch_size;
+  std::vector<double> before_us(batch_cnt + 1, 0);
+  for (size_t b = 0; b < batch_cnt; ++b) {
+    range_points(
+        b * max_batch_size,
+        std::min((b + 1) * max_batch_size, request_cnt), &batch);
+    before_us[b + 1] = before_us[b] + BatchCost(batch);
+  }
+  std::vector<double> shifted_us(batch_cnt + 2, 0);
+  for (size_t b = batch_cnt; b >= 1; --b) {
+    const size_t start = b * max_batch_size - 1;
+    if (start < request_cnt) {
+      range_points(
+          start, std::min(start + max_batch_size, request_cnt), &batch);
+      shifted_us[b] = shifted_us[b + 1] + BatchCost(batch);
+    }
+  }
+  const double queued_us = before_us[batch_cnt];
+
+  added_us->assign(layer_count_, 0);
+  size_t run = 0;
+  size_t batch_start = SIZE_MAX;
+  std::map<int64_t, size_t> joined_batch;
+  for (size_t point = 0; point < layer_count_; ++point) {
+    // The request goes after the requests at its point or before.
+    while ((run < runs.size()) && (runs[run].first <= (int64_t)point)) {
+      ++run;
+    }
+    const size_t k = (run < runs.size()) ? run_start[run] : request_cnt;
+    const size_t b = k / max_batch_size;
+    if (b * max_batch_size != batch_start) {
+      batch_start = b * max_batch_size;
+      range_points(
+          batch_start,
+          std::min(batch_start + max_batch_size - 1, request_cnt), &batch);
+    }
+    joined_batch = batch;
+    joined_batch[point] += 1;
+    (*added_us)[point] = before_us[b] + BatchCost(joined_batch) +
+                         shifted_us[b + 1] - queued_us;
+  }
+}
+
+void
+PartitionHintRange(
+    const std::vector<double>& added_us, const double allowance,
+    const double min_share, int64_t* min_point, int64_t* max_point)
+{
+  // The local-only point is the last one, it adds no work.
+  const int64_t local_point = added_us.size();
+  *min_point = local_point;
+  *max_point = local_point;
+  if (allowance <= 0) {
+    return;
+  }
+
+  *min_point = 0;
+  while ((*min_point < local_point) && (added_us[*min_point] > allowance)) {
+    ++(*min_point);
+  }
+  *max_point = *min_point;
+  for (int64_t point = local_point - 1; point > *min_point; --point) {
+    if (added_us[point] >= min_share * allowance) {
+      *max_point = point;
+      break;
+    }
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
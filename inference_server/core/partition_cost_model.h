@@ -0,0 +1,97 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include "src/core/model_config.pb.h"
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// Estimates the server execution time of a batch whose requests start
+// at different partitioning points, from the per-layer costs in the
+// model configuration.
+class PartitionCostModel {
+ public:
+  // Create a cost model from 'config' for batches of up to
+  // 'max_batch_size'. If 'config' doesn't provide layer or segment
+  // costs then 'model' is set to nullptr.
+  static Status Create(
+      const ModelPartitioning& config, const int max_batch_size,
+      std::unique_ptr<PartitionCostModel>* model);
+
+  // Return the number of layers of the model.
+  size_t LayerCount() const { return layer_count_; }
+
+  // Return the time, in microseconds, to execute layers in the range
+  // ['start', 'end') for a batch of size 'batch_size'.
+  double SegmentCost(
+      const int64_t start, const int64_t end, const size_t batch_size) const;
+
+  // Return the time, in microseconds, to execute a batch described by
+  // 'points', a map from partitioning point to the total batch size of
+  // the requests starting at that point.
+  double BatchCost(const std::map<int64_t, size_t>& points) const;
+
+  // Return the time, in microseconds, to execute all requests described
+  // by 'points' when they are split into batches of at most the
+  // maximum batch size, grouping requests in order of their
+  // partitioning point.
+  double QueueCost(const std::map<int64_t, size_t>& points) const;
+
+  // Set 'added_us' to the time, in microseconds, that one more request
+  // adds to the 'QueueCost' of 'points' at each partitioning point in
+  // [0, LayerCount()). Takes the batches of 'points' apart once rather
+  // than once per point.
+  void AddedQueueCost(
+      const std::map<int64_t, size_t>& points,
+      std::vector<double>* added_us) const;
+
+ private:
+  PartitionCostModel(const size_t layer_count, const float segment_overhead_us);
+
+  const size_t layer_count_;
+  const double segment_overhead_us_;
+
+  // Prefix sums of the layer costs, one vector of 'layer_count_' + 1
+  // entries for each batch size starting from 1.
+  std::vector<std::vector<double>> prefix_us_;
+};
+
+// Set ['min_point', 'max_point'] to the partitioning points to
+// recommend to a client when a request may add 'allowance'
+// microseconds of work, 'added_us' being the work it adds at each
+// point as given by 'AddedQueueCost'. The range starts at the earliest
+// point within the allowance and ends at the latest that still adds
+// 'min_share' of it. Both are the local-only point, 'added_us.size()',
+// if there is no allowance.
+void PartitionHintRange(
+    const std::vector<double>& added_us, const double allowance,
+    const double min_share, int64_t* min_point, int64_t* max_point);
+
+}}  // namespace nvidia::inferenceserver
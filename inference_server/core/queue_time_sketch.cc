@@ -0,0 +1,108 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/queue_time_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+const double kLogGamma = std::log(TRITONSERVER_LOAD_STATUS_SKETCH_GAMMA);
+
+}  // namespace
+
+size_t
+QueueTimeSketch::BucketIndex(const double ms)
+{
+  if (!(ms > TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS)) {
+    return 0;
+  }
+
+  const double idx =
+      std::ceil(std::log(ms / TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS) / kLogGamma);
+  return std::min((size_t)idx, kBucketCount - 1);
+}
+
+double
+QueueTimeSketch::BucketUpperBound(const size_t idx)
+{
+  return TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS *
+         std::pow(TRITONSERVER_LOAD_STATUS_SKETCH_GAMMA, idx);
+}
+
+void
+QueueTimeSketch::Add(const double ms, const double weight)
+{
+  buckets_[BucketIndex(ms)] += weight;
+  weight_ += weight;
+}
+
+void
+QueueTimeSketch::Merge(const QueueTimeSketch& other, const double weight)
+{
+  for (size_t idx = 0; idx < kBucketCount; ++idx) {
+    buckets_[idx] += other.buckets_[idx] * weight;
+  }
+  weight_ += other.weight_ * weight;
+}
+
+void
+QueueTimeSketch::Clear()
+{
+  buckets_.fill(0);
+  weight_ = 0;
+}
+
+double
+QueueTimeSketch::Quantile(const double q) const
+{
+  if (weight_ <= 0) {
+    return 0;
+  }
+
+  // Return the middle of the bucket holding the quantile, in the
+  // logarithmic scale, which bounds the relative error by
+  // sqrt(gamma) - 1.
+  const double rank = std::min(std::max(q, 0.0), 1.0) * weight_;
+  double cumulative = 0;
+  for (size_t idx = 0; idx < kBucketCount; ++idx) {
+    cumulative += buckets_[idx];
+    if ((cumulative >= rank) && (buckets_[idx] > 0)) {
+      if (idx == 0) {
+        return TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS;
+      }
+      return BucketUpperBound(idx) /
+             std::sqrt(TRITONSERVER_LOAD_STATUS_SKETCH_GAMMA);
+    }
+  }
+
+  return BucketUpperBound(kBucketCount - 1);
+}
+
+}}  // namespace nvidia::inferenceserver
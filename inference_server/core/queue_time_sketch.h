@@ -0,0 +1,74 @@
+// Copyright (c) 2018-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <array>
+#include "src/core/tritonserver.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// A mergeable sketch of the distribution of queueing times. Times are
+// counted in logarithmically sized buckets so that any quantile is
+// returned with a relative error bounded by the bucket growth factor,
+// in constant memory. The buckets are those of 'queue_time_sketch' in
+// TRITONSERVER_LoadStatus.
+class QueueTimeSketch {
+ public:
+  static constexpr size_t kBucketCount = TRITONSERVER_LOAD_STATUS_SKETCH_BUCKETS;
+
+  QueueTimeSketch() { Clear(); }
+
+  // Add a queueing time of 'ms' milliseconds with 'weight'.
+  void Add(const double ms, const double weight = 1);
+
+  // Add the times counted in 'other', scaling their weight by
+  // 'weight'.
+  void Merge(const QueueTimeSketch& other, const double weight = 1);
+
+  void Clear();
+
+  // Return the total weight of the counted times.
+  double Weight() const { return weight_; }
+
+  // Return the 'q' quantile, 'q' in [0, 1], of the counted times in
+  // milliseconds, or 0 if no time is counted.
+  double Quantile(const double q) const;
+
+  // Return the weight of each bucket.
+  const std::array<double, kBucketCount>& Buckets() const { return buckets_; }
+
+  // Return the bucket of a queueing time of 'ms' milliseconds.
+  static size_t BucketIndex(const double ms);
+
+  // Return the largest time counted in bucket 'idx'.
+  static double BucketUpperBound(const size_t idx);
+
+ private:
+  std::array<double, kBucketCount> buckets_;
+  double weight_;
+};
+
+}}  // namespace nvidia::inferenceserver
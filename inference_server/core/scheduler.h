@@ -68,6 +68,22 @@ class Scheduler {
   // 'request' will be nullptr. If non-success is returned then the
   // caller still retains ownership of 'request'.
   virtual Status Enqueue(std::unique_ptr<InferenceRequest>& request) = 0;
+
+  // Hand queued requests over to a batch that is already executing.
+  // Only requests whose partitioning point is in the range
+  // ['min_point', 'max_point') are removed from the queue, and the
+  // total batch size of the removed requests does not exceed
+  // 'max_batch_size'. The removed requests are appended to
+  // 'requests' and ownership is transferred to the caller. Return the
+  // total batch size of the removed requests. Schedulers that do not
+  // support joining an executing batch leave 'requests' unchanged.
+  virtual size_t JoinInFlightBatch(
+      const int64_t min_point, const int64_t max_point,
+      const size_t max_batch_size,
+      std::vector<std::unique_ptr<InferenceRequest>>* requests)
+  {
+    return 0;
+  }
 };
 
 }}  // namespace nvidia::inferenceserver
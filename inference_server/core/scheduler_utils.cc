@@ -26,6 +26,7 @@
 
 #include "src/core/scheduler_utils.h"
 
+#include <algorithm>
 #include <cassert>
 #include "src/core/constants.h"
 #include "src/core/logging.h"
@@ -107,29 +108,49 @@ CompareWithRequiredEqualInputs(
 }
 
 Status
-PriorityQueue::PolicyQueue::Enqueue(std::unique_ptr<InferenceRequest>& request)
+PriorityQueue::PolicyQueue::Enqueue(
+    std::unique_ptr<InferenceRequest>& request, size_t* idx)
 {
   if ((max_queue_size_ != 0) && (Size() >= max_queue_size_)) {
     return Status(Status::Code::UNAVAILABLE, "Exceeds maximum queue size");
   }
 
-  queue_.emplace_back(std::move(request));
   auto timeout_us = default_timeout_us_;
   if (allow_timeout_override_) {
-    auto override_timeout_us = queue_.back()->TimeoutMicroseconds();
+    auto override_timeout_us = request->TimeoutMicroseconds();
     if (override_timeout_us != 0 && override_timeout_us < timeout_us) {
       timeout_us = override_timeout_us;
     }
   }
+  uint64_t timeout_timestamp_ns = 0;
   if (timeout_us != 0) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
-    timeout_timestamp_ns_.emplace_back(
-        TIMESPEC_TO_NANOS(now) + timeout_us * 1000);
-  } else {
-    timeout_timestamp_ns_.emplace_back(0);
+    timeout_timestamp_ns = TIMESPEC_TO_NANOS(now) + timeout_us * 1000;
+  }
+
+  // Place the request after all requests whose key is not larger, so
+  // requests with equal keys stay in arrival order.
+  *idx = queue_.size();
+  if (order_key_fn_ != nullptr) {
+    const uint64_t key = order_key_fn_(*request);
+    *idx = std::upper_bound(
+               queue_.begin(), queue_.end(), key,
+               [this](
+                   const uint64_t key,
+                   const std::unique_ptr<InferenceRequest>& queued) {
+                 return key < order_key_fn_(*queued);
+               }) -
+           queue_.begin();
   }
 
+  AddPoint(request->partitioning_point);
+  queue_.emplace(queue_.begin() + *idx, std::move(request));
+  timeout_timestamp_ns_.emplace(
+      timeout_timestamp_ns_.begin() +
+          std::min(*idx, timeout_timestamp_ns_.size()),
+      timeout_timestamp_ns);
+
   return Status::Success;
 }
 
@@ -189,10 +210,65 @@ PriorityQueue::PolicyQueue::Dequeue(std::unique_ptr<InferenceRequest>* request)
     *request = std::move(delayed_queue_.front());
     delayed_queue_.pop_front();
   }
+  RemovePoint((*request)->partitioning_point);
 
   return Status::Success;
 }
 
+void
+PriorityQueue::PolicyQueue::RemovePoint(const int64_t partitioning_point)
+{
+  if (point_depth_ == nullptr) {
+    return;
+  }
+  auto it = point_depth_->find(partitioning_point);
+  if (it != point_depth_->end()) {
+    if (--it->second == 0) {
+      point_depth_->erase(it);
+    }
+  }
+}
+
+size_t
+PriorityQueue::PolicyQueue::DequeueRange(
+    const size_t end_idx, const std::vector<size_t>& skipped_idx,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests)
+{
+  const size_t initial_count = requests->size();
+  const size_t unexpired_cnt = queue_.size();
+  const size_t total_cnt = Size();
+
+  std::deque<uint64_t> kept_timeout_ns;
+  std::deque<std::unique_ptr<InferenceRequest>> kept_queue;
+  std::deque<std::unique_ptr<InferenceRequest>> kept_delayed_queue;
+  auto skip_it = skipped_idx.begin();
+  for (size_t idx = 0; idx < total_cnt; ++idx) {
+    auto& request = (idx < unexpired_cnt) ? queue_[idx]
+                                          : delayed_queue_[idx - unexpired_cnt];
+    while ((skip_it != skipped_idx.end()) && (*skip_it < idx)) {
+      ++skip_it;
+    }
+    const bool skipped = (skip_it != skipped_idx.end()) && (*skip_it == idx);
+    if ((idx < end_idx) && !skipped) {
+      RemovePoint(request->partitioning_point);
+      requests->emplace_back(std::move(request));
+    } else if (idx < unexpired_cnt) {
+      kept_queue.emplace_back(std::move(request));
+      kept_timeout_ns.emplace_back(
+          (idx < timeout_timestamp_ns_.size()) ? timeout_timestamp_ns_[idx]
+                                               : 0);
+    } else {
+      kept_delayed_queue.emplace_back(std::move(request));
+    }
+  }
+
+  queue_.swap(kept_queue);
+  timeout_timestamp_ns_.swap(kept_timeout_ns);
+  delayed_queue_.swap(kept_delayed_queue);
+
+  return requests->size() - initial_count;
+}
+
 int64_t
 PriorityQueue::PolicyQueue::GetHeadPartioningPoint()
 {
@@ -217,6 +293,56 @@ PriorityQueue::PolicyQueue::GetIndexPartioningPoint(int index)
 	return point;
 }
 
+size_t
+PriorityQueue::PolicyQueue::DequeuePointRange(
+    const int64_t min_point, const int64_t max_point,
+    const size_t max_batch_size,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  const uint64_t now_nanoseconds = TIMESPEC_TO_NANOS(now);
+
+  size_t dequeued_batch_size = 0;
+  size_t kept = 0;
+  for (size_t idx = 0; idx < queue_.size(); ++idx) {
+    auto& request = queue_[idx];
+    const size_t batch_size = std::max(1U, request->BatchSize());
+    const uint64_t timeout_ns = (idx < timeout_timestamp_ns_.size())
+                                    ? timeout_timestamp_ns_[idx]
+                                    : 0;
+    // A request that timed out is left for ApplyPolicy() to reject or
+    // delay.
+    const bool timed_out =
+        (timeout_ns != 0) && (now_nanoseconds > timeout_ns);
+    if (!timed_out && (request->partitioning_point >= min_point) &&
+        (request->partitioning_point < max_point) &&
+        ((dequeued_batch_size + batch_size) <= max_batch_size)) {
+      dequeued_batch_size += batch_size;
+      RemovePoint(request->partitioning_point);
+      requests->emplace_back(std::move(request));
+    } else {
+      // Compact the remaining requests in place so that the skipped
+      // requests keep their relative order.
+      if (kept != idx) {
+        queue_[kept] = std::move(request);
+        if (kept < timeout_timestamp_ns_.size()) {
+          timeout_timestamp_ns_[kept] = timeout_ns;
+        }
+      }
+      ++kept;
+    }
+  }
+
+  queue_.erase(queue_.begin() + kept, queue_.end());
+  if (kept < timeout_timestamp_ns_.size()) {
+    timeout_timestamp_ns_.erase(
+        timeout_timestamp_ns_.begin() + kept, timeout_timestamp_ns_.end());
+  }
+
+  return dequeued_batch_size;
+}
+
 bool
 PriorityQueue::PolicyQueue::ApplyPolicy(
     size_t idx, size_t* rejected_count, size_t* rejected_batch_size)
@@ -233,6 +359,7 @@ PriorityQueue::PolicyQueue::ApplyPolicy(
           delayed_queue_.emplace_back(std::move(queue_[curr_idx]));
         } else {
           rejected_queue_.emplace_back(std::move(queue_[curr_idx]));
+          RemovePoint(rejected_queue_.back()->partitioning_point);
           *rejected_count += 1;
           *rejected_batch_size +=
               std::max(1U, rejected_queue_.back()->BatchSize());
@@ -288,6 +415,7 @@ PriorityQueue::PolicyQueue::FinalizeDequeue()
 		{
 				request = std::move(temp_queue_.back());
 				temp_queue_.pop_back();
+				AddPoint(request->partitioning_point);
 				queue_.push_front(std::move(request));
 		
 		}
@@ -349,25 +477,30 @@ PriorityQueue::PriorityQueue()
     : size_(0), front_priority_level_(0), last_priority_level_(0)
 {
   ModelQueuePolicy default_policy;
-  queues_.emplace(0, PolicyQueue(default_policy));
+  queues_.emplace(0, PolicyQueue(default_policy, nullptr, &point_depth_));
   front_priority_level_ = queues_.begin()->first;
   ResetCursor();
 }
 
 PriorityQueue::PriorityQueue(
     const ModelQueuePolicy& default_queue_policy, uint32_t priority_levels,
-    const ModelQueuePolicyMap queue_policy_map)
+    const ModelQueuePolicyMap queue_policy_map,
+    const RequestOrderKeyFn& order_key_fn)
     : size_(0), last_priority_level_(priority_levels)
 {
   if (priority_levels == 0) {
-    queues_.emplace(0, PolicyQueue(default_queue_policy));
+    queues_.emplace(
+        0, PolicyQueue(default_queue_policy, order_key_fn, &point_depth_));
   } else {
     for (uint32_t level = 1; level <= priority_levels; level++) {
       auto it = queue_policy_map.find(level);
       if (it == queue_policy_map.end()) {
-        queues_.emplace(level, PolicyQueue(default_queue_policy));
+        queues_.emplace(
+            level,
+            PolicyQueue(default_queue_policy, order_key_fn, &point_depth_));
       } else {
-        queues_.emplace(level, PolicyQueue(it->second));
+        queues_.emplace(
+            level, PolicyQueue(it->second, order_key_fn, &point_depth_));
       }
     }
   }
@@ -379,17 +512,19 @@ Status
 PriorityQueue::Enqueue(
     uint32_t priority_level, std::unique_ptr<InferenceRequest>& request)
 {
-  auto status = queues_[priority_level].Enqueue(request);
+  size_t idx = 0;
+  auto status = queues_[priority_level].Enqueue(request, &idx);
   if (status.IsOk()) {
     size_++;
     front_priority_level_ = std::min(front_priority_level_, priority_level);
     // Invalidate the pending batch cursor if the enqueued item is placed
     // within the pending batch. At the same priority level the request is
-    // guaranteed to be after pending batch if the batch hasn't reached
-    // delayed queue.
+    // after pending batch if the batch hasn't reached delayed queue and
+    // the request is not ordered before the cursor.
     if ((priority_level < pending_cursor_.curr_it_->first) ||
         ((priority_level == pending_cursor_.curr_it_->first) &&
-         (pending_cursor_.at_delayed_queue_))) {
+         (pending_cursor_.at_delayed_queue_ ||
+          (idx < pending_cursor_.queue_idx_)))) {
       pending_cursor_.valid_ = false;
     }
   }
@@ -499,6 +634,95 @@ PriorityQueue::GetIndexPartioningPoint(int index)
   }
   return partitioning;
 }
+Status
+PriorityQueue::DequeuePendingBatch(
+    std::vector<std::unique_ptr<InferenceRequest>>* requests)
+{
+  const size_t pending_batch_count = pending_cursor_.pending_batch_count_;
+  size_t dequeued_count = 0;
+  std::vector<std::unique_ptr<InferenceRequest>> pending;
+  pending.reserve(pending_batch_count);
+  std::vector<size_t> skipped_idx;
+  for (auto it = queues_.begin(); it != queues_.end(); ++it) {
+    const bool at_cursor = (it == pending_cursor_.curr_it_);
+    skipped_idx.clear();
+    for (const auto& skipped : pending_cursor_.skipped_) {
+      if (skipped.first == it->first) {
+        skipped_idx.push_back(skipped.second);
+      }
+    }
+    dequeued_count += it->second.DequeueRange(
+        at_cursor ? pending_cursor_.queue_idx_ : it->second.Size(),
+        skipped_idx, &pending);
+    if (at_cursor) {
+      break;
+    }
+  }
+
+  size_ -= dequeued_count;
+  pending_cursor_.valid_ = false;
+
+  // Group the requests by partitioning point with a counting sort,
+  // which keeps the arrival order within each group.
+  std::map<int64_t, size_t> offsets;
+  for (const auto& request : pending) {
+    offsets[request->partitioning_point]++;
+  }
+  size_t offset = requests->size();
+  for (auto& point_offset : offsets) {
+    const size_t count = point_offset.second;
+    point_offset.second = offset;
+    offset += count;
+  }
+  requests->resize(offset);
+  for (auto& request : pending) {
+    const size_t idx = offsets[request->partitioning_point]++;
+    (*requests)[idx] = std::move(request);
+  }
+
+  if (dequeued_count != pending_batch_count) {
+    return Status(
+        Status::Code::INTERNAL,
+        "dequeued " + std::to_string(dequeued_count) +
+            " requests but pending batch has " +
+            std::to_string(pending_batch_count));
+  }
+
+  return Status::Success;
+}
+
+size_t
+PriorityQueue::PointDepth(const int64_t partitioning_point)
+{
+  const auto it = point_depth_.find(partitioning_point);
+  return (it != point_depth_.end()) ? it->second : 0;
+}
+
+size_t
+PriorityQueue::DequeuePointRange(
+    const int64_t min_point, const int64_t max_point,
+    const size_t max_batch_size,
+    std::vector<std::unique_ptr<InferenceRequest>>* requests)
+{
+  size_t dequeued_batch_size = 0;
+  const size_t initial_count = requests->size();
+  for (auto& queue : queues_) {
+    if (dequeued_batch_size >= max_batch_size) {
+      break;
+    }
+    dequeued_batch_size += queue.second.DequeuePointRange(
+        min_point, max_point, max_batch_size - dequeued_batch_size, requests);
+  }
+
+  // Any removal may have taken requests out of the pending batch.
+  if (requests->size() != initial_count) {
+    size_ -= (requests->size() - initial_count);
+    pending_cursor_.valid_ = false;
+  }
+
+  return dequeued_batch_size;
+}
+
 void
 PriorityQueue::ReleaseRejectedRequests(
     std::shared_ptr<std::vector<std::deque<std::unique_ptr<InferenceRequest>>>>*
@@ -545,7 +769,8 @@ PriorityQueue::ApplyPolicyAtCursor()
     if (!(pending_cursor_.curr_it_->second.ApplyPolicy(
             pending_cursor_.queue_idx_, &rejected_count,
             &rejected_batch_size))) {
-      if (size_ > pending_cursor_.pending_batch_count_ + rejected_count) {
+      if (size_ > pending_cursor_.pending_batch_count_ +
+                      pending_cursor_.skipped_.size() + rejected_count) {
         pending_cursor_.curr_it_++;
         pending_cursor_.queue_idx_ = 0;
         continue;
@@ -562,7 +787,8 @@ PriorityQueue::ApplyPolicyAtCursor()
 void
 PriorityQueue::AdvanceCursor()
 {
-  if (pending_cursor_.pending_batch_count_ >= size_) {
+  if ((pending_cursor_.pending_batch_count_ +
+       pending_cursor_.skipped_.size()) >= size_) {
     return;
   }
 
@@ -597,4 +823,20 @@ PriorityQueue::AdvanceCursor()
        pending_cursor_.curr_it_->second.UnexpiredSize());
 }
 
+void
+PriorityQueue::SkipCursor()
+{
+  if ((pending_cursor_.pending_batch_count_ +
+       pending_cursor_.skipped_.size()) >= size_) {
+    return;
+  }
+
+  pending_cursor_.skipped_.emplace_back(
+      pending_cursor_.curr_it_->first, pending_cursor_.queue_idx_);
+  ++pending_cursor_.queue_idx_;
+  pending_cursor_.at_delayed_queue_ =
+      (pending_cursor_.queue_idx_ >
+       pending_cursor_.curr_it_->second.UnexpiredSize());
+}
+
 }}  // namespace nvidia::inferenceserver
@@ -26,6 +26,8 @@
 #pragma once
 
 #include <deque>
+#include <functional>
+#include <map>
 #include <unordered_map>
 #include "src/core/scheduler.h"
 
@@ -50,6 +52,10 @@ bool CompareWithRequiredEqualInputs(
 using ModelQueuePolicyMap =
     ::google::protobuf::Map<::google::protobuf::uint32, ModelQueuePolicy>;
 
+// Return the key that orders a request within its priority level,
+// requests with a smaller key are placed closer to the front.
+using RequestOrderKeyFn = std::function<uint64_t(const InferenceRequest&)>;
+
 class PriorityQueue {
  public:
   // Construct a queue with no priority level with default queue policy,
@@ -59,9 +65,17 @@ class PriorityQueue {
   // Construct a queue with 'priority_levels', the priority starts from 1.
   // Different priority level may follow different queue policies given by
   // 'queue_policy_map', otherwise, the 'default_queue_policy' will be used.
+  // If 'order_key_fn' is given, requests within a priority level are
+  // ordered by the key it returns, and in arrival order for equal keys.
+  // Otherwise requests are kept in arrival order.
   PriorityQueue(
       const ModelQueuePolicy& default_queue_policy, uint32_t priority_levels,
-      const ModelQueuePolicyMap queue_policy_map);
+      const ModelQueuePolicyMap queue_policy_map,
+      const RequestOrderKeyFn& order_key_fn);
+
+  // The policy queues point to the queue, it is not copied.
+  PriorityQueue(const PriorityQueue&) = delete;
+  PriorityQueue& operator=(const PriorityQueue&) = delete;
 
   // Enqueue a request with priority set to 'priority_level'. If
   // Status::Success is returned then the queue has taken ownership of
@@ -85,6 +99,25 @@ Status Enqueue_to_temp_queue(
   int64_t GetHeadPartioningPoint();
   int64_t GetIndexPartioningPoint(int index);
 
+  // Dequeue the requests whose partitioning point is in the range
+  // ['min_point', 'max_point'), in priority and then arrival order,
+  // until the total batch size of the dequeued requests would exceed
+  // 'max_batch_size'. Requests past their timeout and delayed requests
+  // are not dequeued. Requests that are skipped keep their position.
+  // Return the total batch size of the dequeued requests.
+  size_t DequeuePointRange(
+      const int64_t min_point, const int64_t max_point,
+      const size_t max_batch_size,
+      std::vector<std::unique_ptr<InferenceRequest>>* requests);
+
+  // Dequeue the requests in the pending batch, skipping the requests
+  // that were passed over by SkipCursor(). The skipped requests keep
+  // their position in the queue. The requests are appended to
+  // 'requests' grouped by partitioning point in increasing order, and
+  // in arrival order within the same partitioning point.
+  Status DequeuePendingBatch(
+      std::vector<std::unique_ptr<InferenceRequest>>* requests);
+
   void FinalizeDequeue();
   // Retrieve the requests that are rejected based on the queue policies.
   void ReleaseRejectedRequests(
@@ -99,6 +132,16 @@ Status Enqueue_to_temp_queue(
   // Is the queue is empty? Rejected requests are not included.
   bool Empty() { return Size() == 0; }
 
+  // Return the number of queued requests with 'partitioning_point'.
+  size_t PointDepth(const int64_t partitioning_point);
+
+  // Return the number of queued requests at each partitioning point.
+  // The depths are kept as requests enter and leave the queue.
+  const std::map<int64_t, size_t>& PointDepths() const
+  {
+    return point_depth_;
+  }
+
   // Reset the cursor such that it is representing an empty pending batch.
   void ResetCursor() { pending_cursor_ = Cursor(queues_.begin()); }
 
@@ -125,8 +168,17 @@ Status Enqueue_to_temp_queue(
   // queue policy. No effect if the cursor already reach the end of the queue.
   void AdvanceCursor();
 
+  // Advance the cursor without adding the request at the cursor to the
+  // pending batch. This function will not trigger the queue policy. No
+  // effect if the cursor already reach the end of the queue.
+  void SkipCursor();
+
   // Whether the cursor reaches its end,
-  bool CursorEnd() { return pending_cursor_.pending_batch_count_ == size_; }
+  bool CursorEnd()
+  {
+    return (pending_cursor_.pending_batch_count_ +
+            pending_cursor_.skipped_.size()) == size_;
+  }
 
   // Restore the cursor state to the marker.
   void SetCursorToMark() { pending_cursor_ = current_mark_; }
@@ -157,16 +209,22 @@ Status Enqueue_to_temp_queue(
     // as regular queue.
     PolicyQueue()
         : timeout_action_(ModelQueuePolicy::REJECT), default_timeout_us_(0),
-          allow_timeout_override_(false), max_queue_size_(0)
+          allow_timeout_override_(false), max_queue_size_(0),
+          point_depth_(nullptr)
     {
     }
 
-    // Construct a policy queue with given 'policy'.
-    PolicyQueue(const ModelQueuePolicy& policy)
+    // Construct a policy queue with given 'policy', ordered by
+    // 'order_key_fn' if it is set. The requests it holds are counted
+    // in 'point_depth' by partitioning point.
+    PolicyQueue(
+        const ModelQueuePolicy& policy, const RequestOrderKeyFn& order_key_fn,
+        std::map<int64_t, size_t>* point_depth)
         : timeout_action_(policy.timeout_action()),
           default_timeout_us_(policy.default_timeout_microseconds()),
           allow_timeout_override_(policy.allow_timeout_override()),
-          max_queue_size_(policy.max_queue_size())
+          max_queue_size_(policy.max_queue_size()), order_key_fn_(order_key_fn),
+          point_depth_(point_depth)
     {
     }
 
@@ -174,16 +232,34 @@ Status Enqueue_to_temp_queue(
     // Status::Success is returned then the queue has taken ownership
     // of the request object and so 'request' will be nullptr. If
     // non-success is returned then the caller still retains ownership
-    // of 'request'.
-    Status Enqueue(std::unique_ptr<InferenceRequest>& request);
+    // of 'request'. 'idx' returns the position of the request in the
+    // queue.
+    Status Enqueue(std::unique_ptr<InferenceRequest>& request, size_t* idx);
     Status Enqueue_to_temp_queue(std::unique_ptr<InferenceRequest>& request);
 
     std::string GetQueueContents();
     // Dequeue the request at the front of the queue.
     Status Dequeue(std::unique_ptr<InferenceRequest>* request);
 
+    // Dequeue the requests at index less than 'end_idx' except the
+    // ones at the indices in 'skipped_idx', which must be sorted.
+    // Return the number of requests dequeued.
+    size_t DequeueRange(
+        const size_t end_idx, const std::vector<size_t>& skipped_idx,
+        std::vector<std::unique_ptr<InferenceRequest>>* requests);
+
   int64_t GetHeadPartioningPoint();
   int64_t GetIndexPartioningPoint(int index);
+
+    // Dequeue the unexpired requests whose partitioning point is in the
+    // range ['min_point', 'max_point') while their total batch size
+    // fits in 'max_batch_size'. Requests past their timeout and delayed
+    // requests are not dequeued. Return the total batch size dequeued.
+    size_t DequeuePointRange(
+        const int64_t min_point, const int64_t max_point,
+        const size_t max_batch_size,
+        std::vector<std::unique_ptr<InferenceRequest>>* requests);
+
     // Apply the queue policy to the request at 'idx'.
     // 'rejected_count' will be incremented by the number of the newly rejected
     // requets after applying the policy.
@@ -215,18 +291,33 @@ Status Enqueue_to_temp_queue(
     // Return the number of unexpired requests in the queue
     size_t UnexpiredSize() { return queue_.size(); }
     unsigned int FinalizeDequeue();
+
    private:
+    void AddPoint(const int64_t partitioning_point)
+    {
+      if (point_depth_ != nullptr) {
+        (*point_depth_)[partitioning_point]++;
+      }
+    }
+    void RemovePoint(const int64_t partitioning_point);
+
     // Variables that define the policy for the queue
     const ModelQueuePolicy::TimeoutAction timeout_action_;
     const uint64_t default_timeout_us_;
     const bool allow_timeout_override_;
     const uint32_t max_queue_size_;
+    const RequestOrderKeyFn order_key_fn_;
 
     std::deque<uint64_t> timeout_timestamp_ns_;
     std::deque<std::unique_ptr<InferenceRequest>> queue_;
     std::deque<std::unique_ptr<InferenceRequest>> temp_queue_;
     std::deque<std::unique_ptr<InferenceRequest>> delayed_queue_;
     std::deque<std::unique_ptr<InferenceRequest>> rejected_queue_;
+
+    // The number of queued requests at each partitioning point, shared
+    // by the policy queues of a priority queue. Rejected requests are
+    // not counted.
+    std::map<int64_t, size_t>* point_depth_;
   };
   using PriorityQueues = std::map<uint32_t, PolicyQueue>;
 
@@ -243,7 +334,8 @@ Status Enqueue_to_temp_queue(
               rhs.pending_batch_closest_timeout_ns_),
           pending_batch_oldest_enqueue_time_ns_(
               rhs.pending_batch_oldest_enqueue_time_ns_),
-          pending_batch_count_(rhs.pending_batch_count_), valid_(rhs.valid_)
+          pending_batch_count_(rhs.pending_batch_count_),
+          skipped_(rhs.skipped_), valid_(rhs.valid_)
     {
     }
 
@@ -253,6 +345,9 @@ Status Enqueue_to_temp_queue(
     uint64_t pending_batch_closest_timeout_ns_;
     uint64_t pending_batch_oldest_enqueue_time_ns_;
     size_t pending_batch_count_;
+    // The priority level and queue index of the requests that the
+    // cursor passed over without adding them to the pending batch.
+    std::vector<std::pair<uint32_t, size_t>> skipped_;
     bool valid_;
   };
 
@@ -266,6 +361,10 @@ Status Enqueue_to_temp_queue(
 
   Cursor pending_cursor_;
   Cursor current_mark_;
+
+  // The number of queued requests at each partitioning point, the
+  // policy queues point to it.
+  std::map<int64_t, size_t> point_depth_;
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -39,6 +39,7 @@
 #include "src/core/backend.h"
 #include "src/core/constants.h"
 #include "src/core/cuda_utils.h"
+#include "src/core/load_telemetry.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
@@ -161,6 +162,15 @@ InferenceServer::Init()
     LOG_WARNING << status.Message();
   }
 
+  // Sampling the ingress bandwidth only feeds the load telemetry, so
+  // the server can still serve inferences without it.
+  if (!load_telemetry_interface_.empty()) {
+    status = LoadTelemetry::StartIngressSampler(load_telemetry_interface_);
+    if (!status.IsOk()) {
+      LOG_ERROR << status.Message();
+    }
+  }
+
   // Create the model manager for the repository. Unless model control
   // is disabled, all models are eagerly loaded when the manager is created.
   bool polling_enabled = (model_control_mode_ == ModelControlMode::MODE_POLL);
@@ -196,6 +206,8 @@ InferenceServer::Stop()
 
   ready_state_ = ServerReadyState::SERVER_EXITING;
 
+  LoadTelemetry::StopIngressSampler();
+
   if (model_repository_manager_ == nullptr) {
     LOG_INFO << "No server context available. Exiting immediately.";
     return Status::Success;
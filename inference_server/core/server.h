@@ -185,6 +185,16 @@ class InferenceServer {
   int32_t ExitTimeoutSeconds() const { return exit_timeout_secs_; }
   void SetExitTimeoutSeconds(int32_t s) { exit_timeout_secs_ = std::max(0, s); }
 
+  // Get / set the network interface sampled for load telemetry.
+  const std::string& LoadTelemetryInterface() const
+  {
+    return load_telemetry_interface_;
+  }
+  void SetLoadTelemetryInterface(const std::string& i)
+  {
+    load_telemetry_interface_ = i;
+  }
+
   // Get / set Tensorflow soft placement enable.
   bool TensorFlowSoftPlacementEnabled() const
   {
@@ -235,6 +245,7 @@ class InferenceServer {
   bool strict_model_config_;
   bool strict_readiness_;
   uint32_t exit_timeout_secs_;
+  std::string load_telemetry_interface_;
   uint64_t pinned_memory_pool_size_;
   std::map<int, uint64_t> cuda_memory_pool_size_;
   double min_supported_compute_capability_;
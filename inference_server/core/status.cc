@@ -58,6 +58,8 @@ Status::CodeString(const Code code)
       return "Unsupported";
     case Status::Code::ALREADY_EXISTS:
       return "Already exists";
+    case Status::Code::DEADLINE_EXCEEDED:
+      return "Deadline exceeded";
     default:
       break;
   }
@@ -83,6 +85,8 @@ TritonCodeToStatusCode(TRITONSERVER_Error_Code code)
       return Status::Code::UNSUPPORTED;
     case TRITONSERVER_ERROR_ALREADY_EXISTS:
       return Status::Code::ALREADY_EXISTS;
+    case TRITONSERVER_ERROR_DEADLINE_EXCEEDED:
+      return Status::Code::DEADLINE_EXCEEDED;
 
     default:
       break;
@@ -109,6 +113,8 @@ StatusCodeToTritonCode(Status::Code status_code)
       return TRITONSERVER_ERROR_UNSUPPORTED;
     case Status::Code::ALREADY_EXISTS:
       return TRITONSERVER_ERROR_ALREADY_EXISTS;
+    case Status::Code::DEADLINE_EXCEEDED:
+      return TRITONSERVER_ERROR_DEADLINE_EXCEEDED;
 
     default:
       break;
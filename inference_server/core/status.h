@@ -41,7 +41,8 @@ class Status {
     INVALID_ARG,
     UNAVAILABLE,
     UNSUPPORTED,
-    ALREADY_EXISTS
+    ALREADY_EXISTS,
+    DEADLINE_EXCEEDED
   };
 
  public:
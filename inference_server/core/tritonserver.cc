@@ -33,6 +33,7 @@
 #include "src/core/infer_request.h"
 #include "src/core/infer_response.h"
 #include "src/core/infer_stats.h"
+#include "src/core/load_telemetry.h"
 #include "src/core/logging.h"
 #include "src/core/metrics.h"
 #include "src/core/model_config.h"
@@ -246,6 +247,15 @@ class TritonServerOptions {
   unsigned int ExitTimeout() const { return exit_timeout_; }
   void SetExitTimeout(unsigned int t) { exit_timeout_ = t; }
 
+  const std::string& LoadTelemetryInterface() const
+  {
+    return load_telemetry_interface_;
+  }
+  void SetLoadTelemetryInterface(const std::string& i)
+  {
+    load_telemetry_interface_ = i;
+  }
+
   bool Metrics() const { return metrics_; }
   void SetMetrics(bool b) { metrics_ = b; }
 
@@ -281,6 +291,7 @@ class TritonServerOptions {
   bool metrics_;
   bool gpu_metrics_;
   unsigned int exit_timeout_;
+  std::string load_telemetry_interface_;
   uint64_t pinned_memory_pool_size_;
   std::map<int, uint64_t> cuda_memory_pool_size_;
   double min_compute_capability_;
@@ -821,6 +832,16 @@ TRITONSERVER_ServerOptionsSetExitTimeout(
   return nullptr;  // Success
 }
 
+TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetLoadTelemetryInterface(
+    TRITONSERVER_ServerOptions* options, const char* interface)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetLoadTelemetryInterface(interface);
+  return nullptr;  // Success
+}
+
 TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetLogInfo(
     TRITONSERVER_ServerOptions* options, bool log)
@@ -1083,6 +1104,49 @@ TRITONSERVER_InferenceRequestSetPoint(
   return nullptr;  // Success
 }
 
+TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetDeadlineMicroseconds(
+    TRITONSERVER_InferenceRequest* inference_request, uint64_t deadline_us)
+{
+  ni::InferenceRequest* lrequest =
+      reinterpret_cast<ni::InferenceRequest*>(inference_request);
+  lrequest->SetDeadlineMicroseconds(deadline_us);
+  return nullptr;  // Success
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputScale(
+    TRITONSERVER_InferenceRequest* inference_request, const float* scale,
+    size_t count)
+{
+  ni::InferenceRequest* lrequest =
+      reinterpret_cast<ni::InferenceRequest*>(inference_request);
+  lrequest->SetInputScale(scale, count);
+  return nullptr;  // Success
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputEncoding(
+    TRITONSERVER_InferenceRequest* inference_request, const char* encoding)
+{
+  ni::InferenceRequest* lrequest =
+      reinterpret_cast<ni::InferenceRequest*>(inference_request);
+  ni::ActivationEncoding e;
+  RETURN_IF_STATUS_ERROR(ni::ParseActivationEncoding(encoding, &e));
+  lrequest->SetInputEncoding(e);
+  return nullptr;  // Success
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestPredictedWaitMicroseconds(
+    TRITONSERVER_InferenceRequest* inference_request, uint64_t* wait_us)
+{
+  ni::InferenceRequest* lrequest =
+      reinterpret_cast<ni::InferenceRequest*>(inference_request);
+  *wait_us = lrequest->PredictedWaitMicroseconds();
+  return nullptr;  // Success
+}
+
 
 TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestAddInput(
@@ -1246,7 +1310,7 @@ TRITONSERVER_InferenceResponseInfo(
   *request_rate = lresponse->request_rate;
   *throughput = lresponse->throughput;
   *num_of_batch = lresponse->num_of_batch;
-  *queue_contents = lresponse->queue_contents;
+  *queue_contents = lresponse->QueueContents();
   *arrival_rate = lresponse->arrival_rate;
   *last_inference_start = lresponse->last_inference_start;
   *current_inference_start = lresponse->current_inference_start;
@@ -1257,6 +1321,18 @@ TRITONSERVER_InferenceResponseInfo(
   return nullptr;  // Success
 }
 
+TRITONSERVER_Error*
+TRITONSERVER_InferenceResponsePartitionHint(
+    TRITONSERVER_InferenceResponse* inference_response, int64_t* min_point,
+    int64_t* max_point)
+{
+  ni::InferenceResponse* lresponse =
+      reinterpret_cast<ni::InferenceResponse*>(inference_response);
+  *min_point = lresponse->HintMinPoint();
+  *max_point = lresponse->HintMaxPoint();
+  return nullptr;  // Success
+}
+
 TRITONSERVER_Error*
 TRITONSERVER_InferenceResponseModel(
     TRITONSERVER_InferenceResponse* inference_response, const char** model_name,
@@ -1391,6 +1467,7 @@ TRITONSERVER_ServerNew(
       loptions->MinSupportedComputeCapability());
   lserver->SetStrictReadinessEnabled(loptions->StrictReadiness());
   lserver->SetExitTimeoutSeconds(loptions->ExitTimeout());
+  lserver->SetLoadTelemetryInterface(loptions->LoadTelemetryInterface());
   lserver->SetTensorFlowSoftPlacementEnabled(
       loptions->TensorFlowSoftPlacement());
   lserver->SetTensorFlowGPUMemoryFraction(
@@ -1835,6 +1912,14 @@ TRITONSERVER_ServerMetrics(
 #endif  // TRITON_ENABLE_METRICS
 }
 
+TRITONSERVER_Error*
+TRITONSERVER_ServerLoadStatus(
+    TRITONSERVER_Server* server, TRITONSERVER_LoadStatus* status)
+{
+  ni::LoadTelemetry::Read(status);
+  return nullptr;  // Success
+}
+
 TRITONSERVER_Error*
 TRITONSERVER_ServerInferAsync(
     TRITONSERVER_Server* server,
@@ -138,7 +138,8 @@ typedef enum TRITONSERVER_errorcode_enum {
   TRITONSERVER_ERROR_INVALID_ARG,
   TRITONSERVER_ERROR_UNAVAILABLE,
   TRITONSERVER_ERROR_UNSUPPORTED,
-  TRITONSERVER_ERROR_ALREADY_EXISTS
+  TRITONSERVER_ERROR_ALREADY_EXISTS,
+  TRITONSERVER_ERROR_DEADLINE_EXCEEDED
 } TRITONSERVER_Error_Code;
 
 /// Create a new error object. The caller takes ownership of the
@@ -631,6 +632,56 @@ TRITONSERVER_EXPORT TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestSetPoint(
     TRITONSERVER_InferenceRequest* inference_request, int64_t point);
 
+/// Set the deadline for a request, in microseconds from when the
+/// request is queued by the server. The default is 0 which indicates
+/// that the request has no deadline. The deadline is used by
+/// schedulers that order requests by deadline.
+///
+/// \param inference_request The request object.
+/// \param deadline_us The deadline, in microseconds.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetDeadlineMicroseconds(
+    TRITONSERVER_InferenceRequest* inference_request, uint64_t deadline_us);
+
+/// Set the scale of an input sent in one of the transfer data types
+/// of the model. The input is multiplied by the scale when it is
+/// converted to the data type the model expects. The scale is either
+/// a single value or one value for each channel of the input.
+///
+/// \param inference_request The request object.
+/// \param scale The scale values.
+/// \param count The number of scale values.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputScale(
+    TRITONSERVER_InferenceRequest* inference_request, const float* scale,
+    size_t count);
+
+/// Set the encoding the input of a request is sent in, "raw",
+/// "sparse" or "lz". The default is "raw" which indicates that the
+/// input is sent as it is. The server decodes the input while it is
+/// collected. Only supported for a model with a single input.
+///
+/// \param inference_request The request object.
+/// \param encoding The name of the encoding.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputEncoding(
+    TRITONSERVER_InferenceRequest* inference_request, const char* encoding);
+
+/// Get the time, in microseconds, the server predicted the request
+/// would wait before executing. Only set when inference for the
+/// request failed with TRITONSERVER_ERROR_DEADLINE_EXCEEDED because
+/// the request was predicted to miss its deadline, 0 otherwise.
+///
+/// \param inference_request The request object.
+/// \param wait_us Returns the predicted wait, in microseconds.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestPredictedWaitMicroseconds(
+    TRITONSERVER_InferenceRequest* inference_request, uint64_t* wait_us);
+
 
 /// Add an input to a request.
 ///
@@ -788,6 +839,20 @@ TRITONSERVER_EXPORT TRITONSERVER_Error* TRITONSERVER_InferenceResponseError(
 TRITONSERVER_EXPORT TRITONSERVER_Error* TRITONSERVER_InferenceResponseInfo(
     TRITONSERVER_InferenceResponse* inference_response, uint64_t *queue_ns, uint64_t *infer_ns, uint32_t *queue_status, uint32_t *instance_status, int64_t *partitioning_point, double *rho, double* throughput, double *request_rate, int64_t *num_of_batch, std::string *queue_contents, std::string *arrival_rate, uint32_t *last_inference_start, uint32_t *current_inference_start, uint32_t *request_enqueue_time);
 
+/// Get the range of partitioning points the server recommends for
+/// the next request of the client that sent the request of the
+/// response. Both are -1 if the server doesn't recommend one, see
+/// 'partition_hints' in the dynamic batching configuration.
+///
+/// \param inference_response The response object.
+/// \param min_point Returns the earliest recommended point.
+/// \param max_point Returns the latest recommended point.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_InferenceResponsePartitionHint(
+    TRITONSERVER_InferenceResponse* inference_response, int64_t* min_point,
+    int64_t* max_point);
+
 /// Get model used to produce a response. The caller does not own the
 /// returned model name value and must not modify or delete it. The
 /// lifetime of all returned values extends until 'inference_response'
@@ -1122,6 +1187,17 @@ TRITONSERVER_ServerOptionsAddTensorFlowVgpuMemoryLimits(
     TRITONSERVER_ServerOptions* options, int gpu_device, int num_vgpus,
     uint64_t per_vgpu_memory_mbytes);
 
+/// Set the network interface whose receive rate is sampled to report
+/// the available ingress bandwidth in TRITONSERVER_LoadStatus. The
+/// default is an empty string which disables sampling.
+///
+/// \param options The server options object.
+/// \param interface The name of the network interface, e.g. "eno1".
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetLoadTelemetryInterface(
+    TRITONSERVER_ServerOptions* options, const char* interface);
+
 /// TRITONSERVER_Server
 ///
 /// An inference server.
@@ -1302,6 +1378,73 @@ TRITONSERVER_EXPORT TRITONSERVER_Error* TRITONSERVER_ServerUnloadModel(
 TRITONSERVER_EXPORT TRITONSERVER_Error* TRITONSERVER_ServerMetrics(
     TRITONSERVER_Server* server, TRITONSERVER_Metrics** metrics);
 
+/// The layout version of TRITONSERVER_LoadStatus. Incremented when
+/// the layout changes.
+#define TRITONSERVER_LOAD_STATUS_VERSION 4
+
+/// The number of queueing time percentiles in TRITONSERVER_LoadStatus.
+#define TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT 10
+
+/// The number of partitioning points whose queue depth is reported in
+/// TRITONSERVER_LoadStatus.
+#define TRITONSERVER_LOAD_STATUS_MAX_POINTS 64
+
+/// The buckets of the queueing time sketch in TRITONSERVER_LoadStatus.
+/// Bucket 0 counts times up to TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS
+/// milliseconds, bucket i > 0 counts times in (MIN_MS * GAMMA^(i-1),
+/// MIN_MS * GAMMA^i] and the last bucket also counts longer times.
+#define TRITONSERVER_LOAD_STATUS_SKETCH_BUCKETS 128
+#define TRITONSERVER_LOAD_STATUS_SKETCH_MIN_MS 0.1
+#define TRITONSERVER_LOAD_STATUS_SKETCH_GAMMA 1.105
+
+/// The load of the server as seen by the most recently completed
+/// batch. The layout is fixed and contains no pointers so it can be
+/// sent to clients as is. Times are wall-clock microseconds since the
+/// epoch.
+typedef struct TRITONSERVER_LoadStatus {
+  /// TRITONSERVER_LOAD_STATUS_VERSION.
+  uint32_t version;
+  /// Number of batches published since the server started.
+  uint32_t batch_count;
+  /// The time the status was read.
+  uint64_t status_us;
+  /// The time the last batch was published, 0 if none.
+  uint64_t update_us;
+  double average_interval_ms;
+  double average_throughput;
+  double average_batch_size;
+  double average_infer_ms;
+  double average_queue_ms;
+  /// The 10th, 20th, ..., 90th and 100th percentile of recent
+  /// queueing times, in milliseconds, estimated from
+  /// 'queue_time_sketch'.
+  double queue_percentile_ms[TRITONSERVER_LOAD_STATUS_PERCENTILE_COUNT];
+  /// The link capacity of the sampled network interface not used by
+  /// received traffic, in Mbps. 0 if sampling is disabled.
+  double available_ingress_mbps;
+  /// Bit i is set if a request may start at partitioning point i, the
+  /// last bit also covers the points past it. All bits are set until
+  /// a model restricts the points it can be split at.
+  uint64_t split_point_mask;
+  /// The number of queued requests at each partitioning point, as of
+  /// the last change of the queue. Requests at points past the last
+  /// entry are counted in the last entry.
+  uint32_t queue_depth[TRITONSERVER_LOAD_STATUS_MAX_POINTS];
+  /// The weight of recent queueing times in each bucket of the
+  /// sketch. Times are weighted down as they age, so the sketch
+  /// follows the current load.
+  float queue_time_sketch[TRITONSERVER_LOAD_STATUS_SKETCH_BUCKETS];
+} TRITONSERVER_LoadStatus;
+
+/// Get the current load of the server. Reading the load doesn't
+/// block the threads that update it.
+///
+/// \param server The inference server object.
+/// \param status Returns the load of the server.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_EXPORT TRITONSERVER_Error* TRITONSERVER_ServerLoadStatus(
+    TRITONSERVER_Server* server, TRITONSERVER_LoadStatus* status);
+
 /// Perform inference using the meta-data and inputs supplied by the
 /// 'inference_request'. If the function returns success, then the
 /// caller releases ownership of 'inference_request' and must not
@@ -27,8 +27,8 @@
 #include "src/servers/classification.h"
 
 #include <algorithm>
-#include <numeric>
 #include "src/servers/common.h"
+#include "src/servers/topk_indices.h"
 
 namespace nvidia { namespace inferenceserver {
 
@@ -43,13 +43,10 @@ AddClassResults(
 {
   const T* probs = reinterpret_cast<const T*>(base);
 
-  std::vector<size_t> idx(element_cnt);
-  iota(idx.begin(), idx.end(), 0);
-  sort(idx.begin(), idx.end(), [&probs](size_t i1, size_t i2) {
-    return probs[i1] > probs[i2];
-  });
-
   const size_t class_cnt = std::min(element_cnt, (size_t)req_class_cnt);
+  std::vector<size_t> idx;
+  TopkIndices(probs, element_cnt, class_cnt, &idx);
+
   for (size_t k = 0; k < class_cnt; ++k) {
     class_strs->push_back(
         std::to_string(probs[idx[k]]) + ":" + std::to_string(idx[k]));
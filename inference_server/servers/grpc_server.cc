@@ -142,6 +142,8 @@ GrpcStatusUtil::CodeToStatus(TRITONSERVER_Error_Code code)
       return grpc::StatusCode::UNIMPLEMENTED;
     case TRITONSERVER_ERROR_ALREADY_EXISTS:
       return grpc::StatusCode::ALREADY_EXISTS;
+    case TRITONSERVER_ERROR_DEADLINE_EXCEEDED:
+      return grpc::StatusCode::DEADLINE_EXCEEDED;
   }
 
   return grpc::StatusCode::UNKNOWN;
@@ -34,7 +34,11 @@
 #include <google/protobuf/util/json_util.h>
 #include <re2/re2.h>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <thread>
 #include "src/core/constants.h"
 #include "src/core/logging.h"
@@ -42,14 +46,16 @@
 #include "src/servers/classification.h"
 #include "src/servers/common.h"
 #include <numeric>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #define TRITONJSON_STATUSTYPE TRITONSERVER_Error*
 #define TRITONJSON_STATUSRETURN(M) \
   return TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, (M).c_str())
 #define TRITONJSON_STATUSSUCCESS nullptr
 #include "src/core/json.h"
 
+extern "C" {
+#include <b64/cencode.h>
+}
+
 #ifdef TRITON_ENABLE_GPU
 extern "C" {
 #include <b64/cdecode.h>
@@ -653,6 +659,72 @@ EVBufferAddErrorJson(evbuffer* buffer, TRITONSERVER_Error* err)
   evbuffer_add(buffer, buffer_json.Base(), buffer_json.Size());
 }
 
+// Return true if the load changed enough since 'previous' that a
+// client streaming the load should be told before its next periodic
+// update.
+bool
+LoadStatusChanged(
+    const TRITONSERVER_LoadStatus& previous,
+    const TRITONSERVER_LoadStatus& current)
+{
+  static constexpr double kChangeRatio = 0.1;
+  auto changed = [](const double a, const double b) {
+    return std::fabs(a - b) > kChangeRatio * std::max(std::fabs(a), std::fabs(b));
+  };
+
+  return changed(previous.average_queue_ms, current.average_queue_ms) ||
+         changed(
+             previous.queue_percentile_ms[8], current.queue_percentile_ms[8]) ||
+         changed(previous.average_throughput, current.average_throughput) ||
+         changed(
+             previous.available_ingress_mbps,
+             current.available_ingress_mbps) ||
+         !std::equal(
+             std::begin(previous.queue_depth), std::end(previous.queue_depth),
+             std::begin(current.queue_depth));
+}
+
+// Add 'status' to 'buffer' as a server-sent event. The data of the
+// event is the base64 encoded TRITONSERVER_LoadStatus, the same bytes
+// returned by GET /v2/load.
+void
+EVBufferAddLoadEvent(evbuffer* buffer, const TRITONSERVER_LoadStatus& status)
+{
+  // base64 output is 4/3 of the input plus padding and the line
+  // breaks libb64 inserts every 72 characters, which are stripped
+  // below since they would end the event data.
+  std::vector<char> encoded(2 * sizeof(status) + 4);
+  base64_encodestate state;
+  base64_init_encodestate(&state);
+  int len = base64_encode_block(
+      reinterpret_cast<const char*>(&status), sizeof(status), encoded.data(),
+      &state);
+  len += base64_encode_blockend(encoded.data() + len, &state);
+  const auto end =
+      std::remove(encoded.begin(), encoded.begin() + len, '\n');
+
+  static const char kEventPrefix[] = "event: load\ndata: ";
+  evbuffer_add(buffer, kEventPrefix, sizeof(kEventPrefix) - 1);
+  evbuffer_add(buffer, encoded.data(), end - encoded.begin());
+  evbuffer_add(buffer, "\n\n", 2);
+}
+
+void
+EVBufferAddDeadlineErrorJson(
+    evbuffer* buffer, TRITONSERVER_Error* err, const uint64_t wait_us)
+{
+  const char* message = TRITONSERVER_ErrorMessage(err);
+
+  TritonJson::Value response(TritonJson::ValueType::OBJECT);
+  response.AddStringRef("error", message, strlen(message));
+  response.AddUInt("predicted_wait_us", wait_us);
+
+  TritonJson::WriteBuffer buffer_json;
+  response.Write(&buffer_json);
+
+  evbuffer_add(buffer, buffer_json.Base(), buffer_json.Size());
+}
+
 TRITONSERVER_Error*
 CheckBinaryInputData(
     TritonJson::Value& request_input, bool* is_binary, size_t* byte_size)
@@ -885,10 +957,11 @@ class HTTPAPIServer :
       const std::shared_ptr<TRITONSERVER_Server>& server,
       nvidia::inferenceserver::TraceManager* trace_manager,
       const std::shared_ptr<SharedMemoryManager>& shm_manager,
-      const int32_t port, const int thread_cnt)
+      RequestLog* request_log, const int32_t port, const int thread_cnt)
       : HTTPServerImpl(port, thread_cnt), server_(server),
         trace_manager_(trace_manager), shm_manager_(shm_manager),
-        allocator_(nullptr), server_regex_(R"(/v2(?:/health/(live|ready))?)"),
+        request_log_(request_log), allocator_(nullptr),
+        server_regex_(R"(/v2(?:/health/(live|ready))?)"),
         model_regex_(
             R"(/v2/models/([^/]+)(?:/versions/([0-9]+))?(?:/(infer|ready|config|stats))?)"),
         modelcontrol_regex_(
@@ -896,7 +969,8 @@ class HTTPAPIServer :
         systemsharedmemory_regex_(
             R"(/v2/systemsharedmemory(?:/region/([^/]+))?/(status|register|unregister))"),
         cudasharedmemory_regex_(
-            R"(/v2/cudasharedmemory(?:/region/([^/]+))?/(status|register|unregister))")
+            R"(/v2/cudasharedmemory(?:/region/([^/]+))?/(status|register|unregister))"),
+        load_stream_(new LoadStream())
   {
     // FIXME, don't cache server metadata. The http endpoint should
     // not be deciding that server metadata will not change during
@@ -926,6 +1000,15 @@ class HTTPAPIServer :
   
   ~HTTPAPIServer()
   {
+    {
+      std::lock_guard<std::mutex> lock(load_stream_->mu_);
+      load_stream_->exit_ = true;
+    }
+    load_stream_->cv_.notify_all();
+    if (load_stream_thread_.joinable()) {
+      load_stream_thread_.join();
+    }
+
     if (server_metadata_err_ != nullptr) {
       TRITONSERVER_ErrorDelete(server_metadata_err_);
     }
@@ -981,7 +1064,7 @@ class HTTPAPIServer :
   // send the response.
   class InferRequestClass {
    public:
-    explicit InferRequestClass(evhtp_request_t* req);
+    InferRequestClass(TRITONSERVER_Server* server, evhtp_request_t* req);
     evhtp_request_t* EvHtpRequest() const { return req_; }
 
     static void InferRequestComplete(
@@ -997,6 +1080,10 @@ class HTTPAPIServer :
     uint64_t trace_id_;
 #endif  // TRITON_ENABLE_TRACING
 
+    // The log that the response is recorded in, nullptr if requests
+    // are not logged.
+    RequestLog* request_log_;
+
     AllocPayload alloc_payload_;
 
     // Data that cannot be used directly from the HTTP body is first
@@ -1004,8 +1091,8 @@ class HTTPAPIServer :
     // lifetime of the request.
     std::list<std::vector<char>> serialized_data_;
 
-    std::string final_log;
    private:
+    TRITONSERVER_Server* server_;
     evhtp_request_t* req_;
     evthr_t* thread_;
   };
@@ -1025,6 +1112,8 @@ class HTTPAPIServer :
   void Handle(evhtp_request_t* req) override;
   void HandleServerHealth(evhtp_request_t* req, const std::string& kind);
   void HandleServerMetadata(evhtp_request_t* req);
+  void HandleServerLoad(evhtp_request_t* req);
+  void HandleServerLoadStream(evhtp_request_t* req);
   void HandleModelReady(
       evhtp_request_t* req, const std::string& model_name,
       const std::string& model_version_str);
@@ -1060,6 +1149,47 @@ class HTTPAPIServer :
   static void OKReplyCallback(evthr_t* thr, void* arg, void* shared);
   static void BADReplyCallback(evthr_t* thr, void* arg, void* shared);
 
+  //
+  // LoadSubscriber
+  //
+  // A client streaming the server load. The load is pushed every
+  // 'interval_us_', or after 'min_interval_us_' if it changed
+  // significantly.
+  struct LoadStream;
+  struct LoadSubscriber {
+    std::weak_ptr<LoadStream> stream_;
+    evhtp_request_t* req_;
+    evthr_t* thread_;
+    uint64_t interval_us_;
+    uint64_t min_interval_us_;
+
+    // Only accessed by the load stream thread.
+    uint64_t last_push_us_;
+    TRITONSERVER_LoadStatus last_status_;
+
+    // Only accessed by the evhtp thread of 'req_'.
+    bool closed_;
+  };
+
+  // The clients streaming the server load. Shared with the requests
+  // of the clients since they may outlive the server.
+  struct LoadStream {
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::list<std::shared_ptr<LoadSubscriber>> subscribers_;
+    bool exit_ = false;
+  };
+
+  // An update pushed to a subscriber from its evhtp thread.
+  struct LoadEvent {
+    std::shared_ptr<LoadSubscriber> subscriber_;
+    TRITONSERVER_LoadStatus status_;
+  };
+
+  void LoadStreamThread();
+  static void LoadEventCallback(evthr_t* thr, void* arg, void* shared);
+  static evhtp_res LoadStreamFini(evhtp_request_t* req, void* arg);
+
   std::shared_ptr<TRITONSERVER_Server> server_;
 
   // Storing server metadata as it is consistent during server running
@@ -1068,6 +1198,7 @@ class HTTPAPIServer :
 
   TraceManager* trace_manager_;
   std::shared_ptr<SharedMemoryManager> shm_manager_;
+  RequestLog* request_log_;
 
   // The allocator that will be used to allocate buffers for the
   // inference result tensors.
@@ -1078,7 +1209,10 @@ class HTTPAPIServer :
   re2::RE2 systemsharedmemory_regex_;
   re2::RE2 cudasharedmemory_regex_;
 
-  
+  // Clients streaming the server load and the thread pushing it to
+  // them. The thread is started by the first subscription.
+  std::shared_ptr<LoadStream> load_stream_;
+  std::thread load_stream_thread_;
   };
 
 TRITONSERVER_Error*
@@ -1235,6 +1369,14 @@ HTTPAPIServer::Handle(evhtp_request_t* req)
     // server metadata
     HandleServerMetadata(req);
     return;
+  } else if (std::string(req->uri->path->full) == "/v2/load") {
+    // server load
+    HandleServerLoad(req);
+    return;
+  } else if (std::string(req->uri->path->full) == "/v2/load/stream") {
+    // server load updates
+    HandleServerLoadStream(req);
+    return;
   } else if (RE2::FullMatch(
                  std::string(req->uri->path->full), server_regex_, &rest)) {
     // server health
@@ -1605,6 +1747,183 @@ HTTPAPIServer::HandleServerMetadata(evhtp_request_t* req)
   }
 }
 
+void
+HTTPAPIServer::HandleServerLoad(evhtp_request_t* req)
+{
+  if (req->method != htp_method_GET) {
+    evhtp_send_reply(req, EVHTP_RES_METHNALLOWED);
+    return;
+  }
+
+  // The load is sent as the raw TRITONSERVER_LoadStatus so that
+  // polling it doesn't cost a JSON serialization on either side.
+  TRITONSERVER_LoadStatus load_status;
+  TRITONSERVER_Error* err =
+      TRITONSERVER_ServerLoadStatus(server_.get(), &load_status);
+  if (err == nullptr) {
+    evhtp_headers_add_header(
+        req->headers_out,
+        evhtp_header_new("Content-Type", "application/octet-stream", 1, 1));
+    evbuffer_add(req->buffer_out, &load_status, sizeof(load_status));
+    evhtp_send_reply(req, EVHTP_RES_OK);
+  } else {
+    evhtp_headers_add_header(
+        req->headers_out,
+        evhtp_header_new("Content-Type", "application/json", 1, 1));
+    EVBufferAddErrorJson(req->buffer_out, err);
+    evhtp_send_reply(req, EVHTP_RES_BADREQ);
+    TRITONSERVER_ErrorDelete(err);
+  }
+}
+
+void
+HTTPAPIServer::HandleServerLoadStream(evhtp_request_t* req)
+{
+  if (req->method != htp_method_GET) {
+    evhtp_send_reply(req, EVHTP_RES_METHNALLOWED);
+    return;
+  }
+
+  // 'interval_ms' is the period of the updates, 'min_interval_ms' the
+  // shortest time between updates sent because the load changed.
+  uint64_t interval_ms = 1000;
+  uint64_t min_interval_ms = 50;
+  TRITONSERVER_Error* err = nullptr;
+  for (const auto& param : std::vector<std::pair<const char*, uint64_t*>>{
+           {"interval_ms", &interval_ms},
+           {"min_interval_ms", &min_interval_ms}}) {
+    const char* value = (req->uri->query == nullptr)
+                            ? nullptr
+                            : evhtp_kv_find(req->uri->query, param.first);
+    if (value == nullptr) {
+      continue;
+    }
+
+    char* end = nullptr;
+    *param.second = strtoull(value, &end, 10);
+    if ((end == value) || (*end != '\0') || (*param.second == 0)) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("'") + param.first + "' must be a positive integer")
+              .c_str());
+      break;
+    }
+  }
+
+  if (err != nullptr) {
+    evhtp_headers_add_header(
+        req->headers_out,
+        evhtp_header_new("Content-Type", "application/json", 1, 1));
+    EVBufferAddErrorJson(req->buffer_out, err);
+    evhtp_send_reply(req, EVHTP_RES_BADREQ);
+    TRITONSERVER_ErrorDelete(err);
+    return;
+  }
+
+  std::shared_ptr<LoadSubscriber> subscriber(new LoadSubscriber());
+  subscriber->stream_ = load_stream_;
+  subscriber->req_ = req;
+  subscriber->thread_ = evhtp_request_get_connection(req)->thread;
+  subscriber->interval_us_ = interval_ms * 1000;
+  subscriber->min_interval_us_ = std::min(min_interval_ms, interval_ms) * 1000;
+  subscriber->last_push_us_ = 0;
+  subscriber->closed_ = false;
+
+  evhtp_headers_add_header(
+      req->headers_out,
+      evhtp_header_new("Content-Type", "text/event-stream", 1, 1));
+  evhtp_headers_add_header(
+      req->headers_out, evhtp_header_new("Cache-Control", "no-cache", 1, 1));
+  // The hook owns a reference so the subscriber outlives the request.
+  evhtp_request_set_hook(
+      req, evhtp_hook_on_request_fini, (evhtp_hook)LoadStreamFini,
+      new std::shared_ptr<LoadSubscriber>(subscriber));
+  evhtp_send_reply_chunk_start(req, EVHTP_RES_OK);
+
+  {
+    std::lock_guard<std::mutex> lock(load_stream_->mu_);
+    load_stream_->subscribers_.emplace_back(std::move(subscriber));
+    if (!load_stream_thread_.joinable()) {
+      load_stream_thread_ = std::thread([this]() { LoadStreamThread(); });
+    }
+  }
+  load_stream_->cv_.notify_all();
+}
+
+void
+HTTPAPIServer::LoadStreamThread()
+{
+  std::unique_lock<std::mutex> lock(load_stream_->mu_);
+  while (!load_stream_->exit_) {
+    if (load_stream_->subscribers_.empty()) {
+      load_stream_->cv_.wait(lock);
+      continue;
+    }
+
+    TRITONSERVER_LoadStatus status;
+    LOG_TRITONSERVER_ERROR(
+        TRITONSERVER_ServerLoadStatus(server_.get(), &status),
+        "reading server load");
+
+    // Once 'min_interval_us_' has passed, each subscriber is checked
+    // for a changed load every 'min_interval_us_'.
+    uint64_t wait_us = UINT64_MAX;
+    for (const auto& subscriber : load_stream_->subscribers_) {
+      const uint64_t elapsed_us = status.status_us - subscriber->last_push_us_;
+      if ((elapsed_us >= subscriber->interval_us_) ||
+          ((elapsed_us >= subscriber->min_interval_us_) &&
+           LoadStatusChanged(subscriber->last_status_, status))) {
+        subscriber->last_push_us_ = status.status_us;
+        subscriber->last_status_ = status;
+        evthr_defer(
+            subscriber->thread_, LoadEventCallback,
+            new LoadEvent{subscriber, status});
+        wait_us = std::min(wait_us, subscriber->min_interval_us_);
+      } else if (elapsed_us < subscriber->min_interval_us_) {
+        wait_us =
+            std::min(wait_us, subscriber->min_interval_us_ - elapsed_us);
+      } else {
+        wait_us = std::min(
+            wait_us, std::min(
+                         subscriber->min_interval_us_,
+                         subscriber->interval_us_ - elapsed_us));
+      }
+    }
+
+    load_stream_->cv_.wait_for(lock, std::chrono::microseconds(wait_us));
+  }
+}
+
+void
+HTTPAPIServer::LoadEventCallback(evthr_t* thr, void* arg, void* shared)
+{
+  std::unique_ptr<LoadEvent> event(reinterpret_cast<LoadEvent*>(arg));
+  if (event->subscriber_->closed_) {
+    return;
+  }
+
+  evbuffer* buffer = evbuffer_new();
+  EVBufferAddLoadEvent(buffer, event->status_);
+  evhtp_send_reply_chunk(event->subscriber_->req_, buffer);
+  evbuffer_free(buffer);
+}
+
+evhtp_res
+HTTPAPIServer::LoadStreamFini(evhtp_request_t* req, void* arg)
+{
+  std::unique_ptr<std::shared_ptr<LoadSubscriber>> subscriber(
+      reinterpret_cast<std::shared_ptr<LoadSubscriber>*>(arg));
+  (*subscriber)->closed_ = true;
+
+  auto stream = (*subscriber)->stream_.lock();
+  if (stream != nullptr) {
+    std::lock_guard<std::mutex> lock(stream->mu_);
+    stream->subscribers_.remove(*subscriber);
+  }
+
+  return EVHTP_RES_OK;
+}
+
 void
 HTTPAPIServer::HandleSystemSharedMemory(
     evhtp_request_t* req, const std::string& region_name,
@@ -1953,6 +2272,41 @@ HTTPAPIServer::EVBufferToInput(
       }
     }
 
+    {
+      TritonJson::Value deadline_json;
+      if (params_json.Find("deadline", &deadline_json)) {
+        uint64_t d;
+        RETURN_IF_ERR(deadline_json.AsUInt(&d));
+        RETURN_IF_ERR(
+            TRITONSERVER_InferenceRequestSetDeadlineMicroseconds(irequest, d));
+      }
+    }
+
+    {
+      TritonJson::Value scale_json;
+      if (params_json.Find("scale", &scale_json)) {
+        std::vector<float> scale(scale_json.ArraySize());
+        for (size_t i = 0; i < scale.size(); i++) {
+          double v;
+          RETURN_IF_ERR(scale_json.IndexAsDouble(i, &v));
+          scale[i] = v;
+        }
+        RETURN_IF_ERR(TRITONSERVER_InferenceRequestSetInputScale(
+            irequest, scale.data(), scale.size()));
+      }
+    }
+
+    {
+      TritonJson::Value encoding_json;
+      if (params_json.Find("encoding", &encoding_json)) {
+        const char* encoding;
+        size_t encoding_len;
+        RETURN_IF_ERR(encoding_json.AsString(&encoding, &encoding_len));
+        RETURN_IF_ERR(TRITONSERVER_InferenceRequestSetInputEncoding(
+            irequest, std::string(encoding, encoding_len).c_str()));
+      }
+    }
+
 
 
   }
@@ -2220,12 +2574,13 @@ HTTPAPIServer::HandleInfer(
   if (err == nullptr) {
     connection_paused = true;
     std::unique_ptr<InferRequestClass> infer_request(
-        new InferRequestClass(req));
+        new InferRequestClass(server_.get(), req));
 //XXX
 #ifdef TRITON_ENABLE_TRACING
     infer_request->trace_manager_ = trace_manager_;
     infer_request->trace_id_ = trace_id;
 #endif  // TRITON_ENABLE_TRACING
+    infer_request->request_log_ = request_log_;
 
     // Find Inference-Header-Content-Length in header. If missing set to 0
     size_t header_length = 0;
@@ -2260,8 +2615,20 @@ HTTPAPIServer::HandleInfer(
 
   if (err != nullptr) {
     LOG_VERBOSE(1) << "Infer failed: " << TRITONSERVER_ErrorMessage(err);
-    EVBufferAddErrorJson(req->buffer_out, err);
-    evhtp_send_reply(req, EVHTP_RES_BADREQ);
+    if (TRITONSERVER_ErrorCode(err) == TRITONSERVER_ERROR_DEADLINE_EXCEEDED) {
+      // The request was rejected before queuing, tell the client how
+      // long it would have waited so it can run the request elsewhere.
+      uint64_t wait_us = 0;
+      LOG_TRITONSERVER_ERROR(
+          TRITONSERVER_InferenceRequestPredictedWaitMicroseconds(
+              irequest, &wait_us),
+          "getting predicted wait");
+      EVBufferAddDeadlineErrorJson(req->buffer_out, err, wait_us);
+      evhtp_send_reply(req, EVHTP_RES_SERVUNAVAIL);
+    } else {
+      EVBufferAddErrorJson(req->buffer_out, err);
+      evhtp_send_reply(req, EVHTP_RES_BADREQ);
+    }
     if (connection_paused) {
       evhtp_request_resume(req);
     }
@@ -2322,8 +2689,9 @@ HTTPAPIServer::BADReplyCallback(evthr_t* thr, void* arg, void* shared)
   delete infer_request;
 }
 
-HTTPAPIServer::InferRequestClass::InferRequestClass(evhtp_request_t* req)
-    : req_(req)
+HTTPAPIServer::InferRequestClass::InferRequestClass(
+    TRITONSERVER_Server* server, evhtp_request_t* req)
+    : request_log_(nullptr), server_(server), req_(req)
 {
   evhtp_connection_t* htpconn = evhtp_request_get_connection(req);
   thread_ = htpconn->thread;
@@ -2435,44 +2803,25 @@ HTTPAPIServer::InferRequestClass::FinalizeResponse(
  
    
   TritonJson::Value response_json(TritonJson::ValueType::OBJECT);
-  std::string comma(","); 
-  std::string log;
- log  = std::to_string(partitioning_point) + comma +
-	  std::to_string(infer_ns/1000) + comma + std::to_string(queue_ns/1000) + comma +
-	  std::to_string(last_batch_size) + comma + std::to_string(last_partitioning_point) +comma +
-	  std::to_string(num_of_batch) + "\n";
-   //final_log =log;
-   //
- 
- 
- //XXX SERVER profiling
-/* 
-  std::ofstream fp_logging("/logging/newdata", std::ios::app);
- fp_logging << std::to_string(partitioning_point) << "," <<std::to_string((double)queue_ns/1000.0) << " ," <<  std::to_string((double)infer_ns/1000.0) << " ," << num_of_batch << std::endl;; 
- fp_logging.close(); 
-*/
 
-/* 
- std::string logging = "/logging/newdata";
-  std::ofstream fp_logging;
- fp_logging.open(logging, std::ios_base::app);
-if (fp_logging.is_open()){
-*/
- /*    
-  fp_logging << partitioning_point << "," <<  infer_ns/1000 << "," << queue_ns/1000 << "," << last_batch_size << "," << last_partitioning_point << ","<< rho<< "," << throughput << "," << request_rate << "," << num_of_batch << std::endl;
-    fp_logging.close();
+  if (request_log_ != nullptr) {
+    RequestLog::Record record;
+    record.timestamp_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    record.partitioning_point = partitioning_point;
+    record.queue_ns = queue_ns;
+    record.infer_ns = infer_ns;
+    record.last_batch_size = last_batch_size;
+    record.last_partitioning_point = last_partitioning_point;
+    record.num_of_batch = num_of_batch;
+    record.rho = rho;
+    record.throughput = throughput;
+    record.request_rate = request_rate;
+    request_log_->Append(record);
   }
-  */
-  /*
-    std::ofstream fp("/logging/last_batch_size", std::ios::app);
-    if(!fp)
-    {
-	    std::cout <<" File queue status fail" << std::endl;
-    }
-    fp << queue_contents;
-    fp.close();
-*/
-  
+
   const char* request_id;
   RETURN_IF_ERR(TRITONSERVER_InferenceResponseId(response, &request_id));
   if ((request_id != nullptr) && (request_id[0] != '\0')) {
@@ -2490,126 +2839,19 @@ if (fp_logging.is_open()){
 	//{
 //		layer_length = 48;
 //	}
-	int   nShmId3;
-	void *pShmSendBuffer3;
-
-	nShmId3 = shmget((key_t)6652, 10,  IPC_CREAT | 0600);
-
-	pShmSendBuffer3 = shmat(nShmId3, NULL, SHM_RDONLY);
-	
-	if(pShmSendBuffer3 == (void *) -1){
-		printf( " 6652 Shared Memory Buffer Create Failed...\n");
-		std::cout << errno << std::endl;
-	}
-	std::string result3((char*)pShmSendBuffer3);
-	
-	//std::string result3("0000000000");
-/*
-	int   nShmId;
-	void *pShmSendBuffer;
-
-	nShmId = shmget((key_t)7777, 500, IPC_CREAT | 0666);
-
-	pShmSendBuffer = shmat(nShmId, NULL, SHM_RDONLY);
-	
-	if(pShmSendBuffer == (void *) -1){
-		printf( " 7777 Shared Memory Buffer Create Failed...\n");
-		std::cout << errno << std::endl;
-	}
-	std::string result((char*)pShmSendBuffer);
-
-        size_t pos = 0;
-        std::string split_queue_status;
-        std::string delimiter1 = "\n";
-	while ((pos = result.find(delimiter1)) != std::string::npos) {
-            split_queue_status = result.substr(0, pos);
-            //std::string strtoken(queue_status);
-            result.erase(0, pos + delimiter1.length());
-        }
-	
-	int nShmId2 = shmget((key_t)2819, 500, IPC_CREAT | 0666);
-	void *pShmSendBuffer2;
-	pShmSendBuffer2 = shmat(nShmId2, NULL, SHM_RDONLY);
-	if(pShmSendBuffer2 == (void *) -1){
-		printf( "2819 Shared Memory Buffer Create Failed...\n");
-		std::cout << errno << std::endl;
-	}
-	 result  = (char*)pShmSendBuffer2;
-
-	        pos = 0;
-        std::string split_arrival_rate;
-	while ((pos = result.find(delimiter1)) != std::string::npos) {
-            split_arrival_rate = result.substr(0, pos);
-            //std::string strtoken(queue_status);
-            result.erase(0, pos + delimiter1.length());
-        }
- */
-	//int stringlength = split_arrival_rate.length() - (split_arrival_rate.length()-layer_length*2-1);	
-	//split_arrival_rate = split_arrival_rate.substr(0, stringlength);
-//	std::vector<int> temp = parseStrToIntVec(split_arrival_rate);
-	//int arrival_rate_sum = std::accumulate(temp.begin(), temp.end(), 0);
-//	std::vector<int> temp2 = parseStrToIntVec(split_queue_status);
-/*	if(throughput > arrival_rate_sum)
-	{
-		throughput = arrival_rate_sum;
-	}
-*/
-	//std::cout << "arrival rate " << arrival_rate_sum << " throughput " <<  throughput  << " batch " << num_of_batch <<  " queue ms " << queue_ns/1000000 << "infer ms " << infer_ns/1000000  << std::endl;
-
-/*
-	std::chrono::system_clock::time_point current_time = std::chrono::system_clock::now();
-
-       uint64_t ret = std::chrono::duration_cast<std::chrono::milliseconds>(current_time.time_since_epoch()).count();
-	std::string logging = "/logging/newdatalast";
-  std::ofstream fp_logging;
- fp_logging.open(logging, std::ios_base::app);
-if (fp_logging.is_open()){
-
-	fp_logging << ret << ","
-		   << partitioning_point << ","
-		   //<< std::accumulate(temp.begin(), temp.end(), 0)  << ","
-		   << rho << ","
-		   //<< queue_contents.length()/2 << "," 
-		   << throughput << ","
-		   << num_of_batch << ","
-		   << queue_ns/1000000 << ","
-		   << infer_ns/1000000 << std::endl;
-}
-fp_logging.close();
-*/
-	/*std::cout << std::accumulate(temp.begin(), temp.end(), 0)  << ","
-		   << rho << ","
-		   << queue_contents.length()/2 << "," 
-		   << throughput << ","
-		   << num_of_batch << ","
-		   << queue_ns/1000000 << ","
-		   << infer_ns/1000000 << std::endl;
-*/
-//	std::string return_arrival_rate = "";
-//	return_arrival_rate = std::to_string(temp[0]);
-//	for(int i = 1; i < layer_length ; i++)
-//	{
-//		return_arrival_rate += "," + std::to_string(temp[i]);
-//	}	
-//	split_arrival_rate = return_arrival_rate ;
-//	shmdt(pShmSendBuffer2);
- //	shmdt(pShmSendBuffer);
- 	shmdt(pShmSendBuffer3);
-	//shmctl(nShmId, IPC_RMID, NULL);
-	//shmctl(nShmId2, IPC_RMID, NULL);
+  // Clients read the available ingress bandwidth of the server from
+  // the model version.
+  TRITONSERVER_LoadStatus load_status;
+  RETURN_IF_ERR(TRITONSERVER_ServerLoadStatus(server_, &load_status));
 
 //	std::cout << "arrival rate in http " << split_arrival_rate << std::endl;
   RETURN_IF_ERR(response_json.AddString(
-      "model_version", result3));
+      "model_version",
+      std::to_string((int64_t)load_status.available_ingress_mbps)));
       //"model_version", std::move(std::to_string(model_version))));
   RETURN_IF_ERR(response_json.AddString(
       "queue_ns", std::move(std::to_string(queue_ns))));
 
-if( queue_ns > 10000000) 
-  std::cout << partitioning_point <<  " queue_ns " << queue_ns << "                <<<<<<<<<<<<<<<<<<" << std::endl;
-  else
-
-  std::cout << partitioning_point <<  " queue_ns " << queue_ns  << std::endl;
   RETURN_IF_ERR(response_json.AddString(
       "infer_ns", std::move(std::to_string(infer_ns))));
   RETURN_IF_ERR(response_json.AddString(
@@ -2631,6 +2873,17 @@ if( queue_ns > 10000000)
   RETURN_IF_ERR(response_json.AddString(
       "average_queue_ms", std::to_string(current_inference_start)));
 
+  // The range of partitioning points recommended for the next request
+  // of the client, if the scheduler recommends one.
+  int64_t hint_min_point = -1;
+  int64_t hint_max_point = -1;
+  RETURN_IF_ERR(TRITONSERVER_InferenceResponsePartitionHint(
+      response, &hint_min_point, &hint_max_point));
+  if (hint_min_point >= 0) {
+    RETURN_IF_ERR(response_json.AddInt("hint_min_point", hint_min_point));
+    RETURN_IF_ERR(response_json.AddInt("hint_max_point", hint_max_point));
+  }
+
   
 /* 
   RETURN_IF_ERR(response_json.AddString(
@@ -2835,11 +3088,12 @@ TRITONSERVER_Error*
 HTTPServer::CreateAPIServer(
     const std::shared_ptr<TRITONSERVER_Server>& server,
     nvidia::inferenceserver::TraceManager* trace_manager,
-    const std::shared_ptr<SharedMemoryManager>& shm_manager, const int32_t port,
-    const int thread_cnt, std::unique_ptr<HTTPServer>* http_server)
+    const std::shared_ptr<SharedMemoryManager>& shm_manager,
+    RequestLog* request_log, const int32_t port, const int thread_cnt,
+    std::unique_ptr<HTTPServer>* http_server)
 {
-  http_server->reset(
-      new HTTPAPIServer(server, trace_manager, shm_manager, port, thread_cnt));
+  http_server->reset(new HTTPAPIServer(
+      server, trace_manager, shm_manager, request_log, port, thread_cnt));
 
   const std::string addr = "0.0.0.0:" + std::to_string(port);
   LOG_INFO << "Started HTTPService at " << addr;
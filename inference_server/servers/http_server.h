@@ -29,6 +29,7 @@
 #include <memory>
 #include <string>
 #include "src/core/tritonserver.h"
+#include "src/servers/request_log.h"
 #include "src/servers/shared_memory_manager.h"
 #include "src/servers/tracer.h"
 
@@ -40,7 +41,8 @@ class HTTPServer {
       const std::shared_ptr<TRITONSERVER_Server>& server,
       nvidia::inferenceserver::TraceManager* trace_manager,
       const std::shared_ptr<SharedMemoryManager>& smb_manager,
-      const int32_t port, const int thread_cnt,
+      nvidia::inferenceserver::RequestLog* request_log, const int32_t port,
+      const int thread_cnt,
       std::unique_ptr<HTTPServer>* http_server);
 
   static TRITONSERVER_Error* CreateMetricsServer(
@@ -111,6 +111,11 @@ int grpc_infer_allocation_pool_size_ = 8;
 #if defined(TRITON_ENABLE_HTTP)
 // The number of threads to initialize for the HTTP front-end.
 int http_thread_cnt_ = 8;
+
+// The file that completed HTTP inference requests are logged to. No
+// requests are logged if empty.
+std::string request_log_filepath_;
+std::unique_ptr<nvidia::inferenceserver::RequestLog> request_log_;
 #endif  // TRITON_ENABLE_HTTP
 
 // Command-line options
@@ -131,6 +136,7 @@ enum OptionId {
   OPTION_ALLOW_HTTP,
   OPTION_HTTP_PORT,
   OPTION_HTTP_THREAD_COUNT,
+  OPTION_REQUEST_LOG_FILEPATH,
 #endif  // TRITON_ENABLE_HTTP
 #if defined(TRITON_ENABLE_GRPC)
   OPTION_ALLOW_GRPC,
@@ -154,6 +160,7 @@ enum OptionId {
   OPTION_CUDA_MEMORY_POOL_BYTE_SIZE,
   OPTION_MIN_SUPPORTED_COMPUTE_CAPABILITY,
   OPTION_EXIT_TIMEOUT_SECS,
+  OPTION_LOAD_TELEMETRY_INTERFACE,
   OPTION_TF_ALLOW_SOFT_PLACEMENT,
   OPTION_TF_GPU_MEMORY_FRACTION,
   OPTION_TF_ADD_VGPU,
@@ -218,6 +225,10 @@ std::vector<Option> options_
        "The port for the server to listen on for HTTP requests."},
       {OPTION_HTTP_THREAD_COUNT, "http-thread-count",
        "Number of threads handling HTTP requests."},
+      {OPTION_REQUEST_LOG_FILEPATH, "request-log-file",
+       "Append a binary record of every completed HTTP inference request to "
+       "this file. Use request_log_to_csv to convert the file to CSV. By "
+       "default requests are not logged."},
 #endif  // TRITON_ENABLE_HTTP
 #if defined(TRITON_ENABLE_GRPC)
       {OPTION_ALLOW_GRPC, "allow-grpc",
@@ -292,6 +303,10 @@ std::vector<Option> options_
        "Timeout (in seconds) when exiting to wait for in-flight inferences to "
        "finish. After the timeout expires the server exits even if inferences "
        "are still in flight."},
+      {OPTION_LOAD_TELEMETRY_INTERFACE, "load-telemetry-interface",
+       "The network interface whose receive rate is sampled to report the "
+       "available ingress bandwidth on the /v2/load endpoint. By default no "
+       "interface is sampled and the available bandwidth is reported as 0."},
       {OPTION_TF_ALLOW_SOFT_PLACEMENT, "tf-allow-soft-placement",
        "Instruct TensorFlow to use CPU implementation of an operation when "
        "a GPU implementation is not available."},
@@ -399,10 +414,18 @@ StartHttpService(
     const std::shared_ptr<nvidia::inferenceserver::SharedMemoryManager>&
         shm_manager)
 {
-  TRITONSERVER_Error* err =
-      nvidia::inferenceserver::HTTPServer::CreateAPIServer(
-          server, trace_manager, shm_manager, http_port_, http_thread_cnt_,
-          service);
+  TRITONSERVER_Error* err = nullptr;
+  if (!request_log_filepath_.empty()) {
+    nvidia::inferenceserver::RequestLog* request_log = nullptr;
+    err = nvidia::inferenceserver::RequestLog::Create(
+        &request_log, request_log_filepath_);
+    request_log_.reset(request_log);
+  }
+  if (err == nullptr) {
+    err = nvidia::inferenceserver::HTTPServer::CreateAPIServer(
+        server, trace_manager, shm_manager, request_log_.get(), http_port_,
+        http_thread_cnt_, service);
+  }
   if (err == nullptr) {
     err = (*service)->Start();
   }
@@ -495,6 +518,10 @@ StopEndpoints()
 
     http_service_.reset();
   }
+
+  // The HTTP service no longer appends to the request log so it can
+  // be flushed and closed.
+  request_log_.reset();
 #endif  // TRITON_ENABLE_HTTP
 
 #ifdef TRITON_ENABLE_GRPC
@@ -761,6 +788,7 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
   std::list<VgpuOption> tf_vgpus;
   std::list<std::pair<int, uint64_t>> cuda_pools;
   int32_t exit_timeout_secs = 30;
+  std::string load_telemetry_interface;
   int32_t repository_poll_secs = repository_poll_secs_;
   int64_t pinned_memory_pool_byte_size = 1 << 28;
 
@@ -773,6 +801,7 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
 #if defined(TRITON_ENABLE_HTTP)
   int32_t http_port = http_port_;
   int32_t http_thread_cnt = http_thread_cnt_;
+  std::string request_log_filepath = request_log_filepath_;
 #endif  // TRITON_ENABLE_HTTP
 
 #if defined(TRITON_ENABLE_GRPC)
@@ -856,6 +885,9 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
       case OPTION_HTTP_THREAD_COUNT:
         http_thread_cnt = ParseIntOption(optarg);
         break;
+      case OPTION_REQUEST_LOG_FILEPATH:
+        request_log_filepath = optarg;
+        break;
 #endif  // TRITON_ENABLE_HTTP
 
 #if defined(TRITON_ENABLE_GRPC)
@@ -929,6 +961,9 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
       case OPTION_EXIT_TIMEOUT_SECS:
         exit_timeout_secs = ParseIntOption(optarg);
         break;
+      case OPTION_LOAD_TELEMETRY_INTERFACE:
+        load_telemetry_interface = optarg;
+        break;
 
       case OPTION_TF_ALLOW_SOFT_PLACEMENT:
         tf_allow_soft_placement = ParseBoolOption(optarg);
@@ -966,6 +1001,7 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
 #if defined(TRITON_ENABLE_HTTP)
   http_port_ = http_port;
   http_thread_cnt_ = http_thread_cnt;
+  request_log_filepath_ = request_log_filepath;
 #endif  // TRITON_ENABLE_HTTP
 
 #if defined(TRITON_ENABLE_GRPC)
@@ -1037,6 +1073,10 @@ Parse(TRITONSERVER_ServerOptions** server_options, int argc, char** argv)
       TRITONSERVER_ServerOptionsSetExitTimeout(
           loptions, std::max(0, exit_timeout_secs)),
       "setting exit timeout");
+  FAIL_IF_ERR(
+      TRITONSERVER_ServerOptionsSetLoadTelemetryInterface(
+          loptions, load_telemetry_interface.c_str()),
+      "setting load telemetry interface");
 
 #ifdef TRITON_ENABLE_LOGGING
   FAIL_IF_ERR(
@@ -0,0 +1,243 @@
+// Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/servers/request_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// Interval at which the flush thread drains the rings.
+constexpr std::chrono::milliseconds FLUSH_INTERVAL(100);
+
+std::atomic<uint64_t> next_log_id_(1);
+
+// Ring of the calling thread and the id of the log that owns it. The
+// id, not the log address, is compared so that a ring is never reused
+// by a log created at the address of a destroyed one.
+thread_local uint64_t thread_ring_log_id_ = 0;
+thread_local void* thread_ring_ = nullptr;
+
+TRITONSERVER_Error*
+WriteFully(const int fd, const char* base, size_t byte_size)
+{
+  while (byte_size > 0) {
+    ssize_t n = write(fd, base, byte_size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("failed writing request log: ") + strerror(errno))
+              .c_str());
+    }
+    base += n;
+    byte_size -= n;
+  }
+
+  return nullptr;  // success
+}
+
+}  // namespace
+
+constexpr char RequestLog::MAGIC[8];
+constexpr uint32_t RequestLog::VERSION;
+constexpr size_t RequestLog::RING_CAPACITY;
+
+TRITONSERVER_Error*
+RequestLog::Create(RequestLog** log, const std::string& filepath)
+{
+  if (filepath.empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "request log requires a non-empty file path");
+  }
+
+  int fd = open(filepath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("failed creating request log '") + filepath +
+         "': " + strerror(errno))
+            .c_str());
+  }
+
+  struct stat st;
+  TRITONSERVER_Error* err = nullptr;
+  if (fstat(fd, &st) != 0) {
+    err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed reading request log '") + filepath +
+         "': " + strerror(errno))
+            .c_str());
+  } else if (st.st_size == 0) {
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.record_size = sizeof(Record);
+    err = WriteFully(
+        fd, reinterpret_cast<const char*>(&header), sizeof(header));
+  } else {
+    // Appending to an existing log is only possible if its records
+    // have the same layout.
+    Header header;
+    if ((pread(fd, &header, sizeof(header), 0) != sizeof(header)) ||
+        (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != VERSION) ||
+        (header.record_size != sizeof(Record))) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("existing file '") + filepath +
+           "' is not a compatible request log")
+              .c_str());
+    }
+  }
+
+  if (err != nullptr) {
+    close(fd);
+    return err;
+  }
+
+  LOG_INFO << "Configure request log: " << filepath;
+  *log = new RequestLog(fd);
+
+  return nullptr;  // success
+}
+
+RequestLog::RequestLog(const int fd)
+    : fd_(fd), id_(next_log_id_++), dropped_cnt_(0), exiting_(false)
+{
+  flush_thread_ = std::thread([this] { FlushThread(); });
+}
+
+RequestLog::~RequestLog()
+{
+  {
+    std::lock_guard<std::mutex> lk(flush_mu_);
+    exiting_ = true;
+  }
+  flush_cv_.notify_all();
+  flush_thread_.join();
+
+  const uint64_t dropped_cnt = DroppedCount();
+  if (dropped_cnt > 0) {
+    LOG_WARNING << "request log dropped " << dropped_cnt << " records";
+  }
+
+  close(fd_);
+}
+
+RequestLog::Ring*
+RequestLog::ThreadRing()
+{
+  if (thread_ring_log_id_ != id_) {
+    std::unique_ptr<Ring> ring(new Ring());
+    thread_ring_ = ring.get();
+    thread_ring_log_id_ = id_;
+
+    std::lock_guard<std::mutex> lk(rings_mu_);
+    rings_.emplace_back(std::move(ring));
+  }
+
+  return reinterpret_cast<Ring*>(thread_ring_);
+}
+
+void
+RequestLog::Append(const Record& record)
+{
+  Ring* ring = ThreadRing();
+
+  const uint64_t head = ring->head_.load(std::memory_order_relaxed);
+  if ((head - ring->tail_.load(std::memory_order_acquire)) >= RING_CAPACITY) {
+    dropped_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ring->records_[head % RING_CAPACITY] = record;
+  ring->head_.store(head + 1, std::memory_order_release);
+}
+
+void
+RequestLog::Drain(std::vector<Record>* records)
+{
+  std::lock_guard<std::mutex> lk(rings_mu_);
+  for (auto& ring : rings_) {
+    const uint64_t tail = ring->tail_.load(std::memory_order_relaxed);
+    const uint64_t head = ring->head_.load(std::memory_order_acquire);
+    for (uint64_t idx = tail; idx < head; ++idx) {
+      records->push_back(ring->records_[idx % RING_CAPACITY]);
+    }
+    ring->tail_.store(head, std::memory_order_release);
+  }
+}
+
+void
+RequestLog::WriteRecords(const std::vector<Record>& records)
+{
+  if (records.empty()) {
+    return;
+  }
+
+  TRITONSERVER_Error* err = WriteFully(
+      fd_, reinterpret_cast<const char*>(records.data()),
+      records.size() * sizeof(Record));
+  if (err != nullptr) {
+    LOG_TRITONSERVER_ERROR(err, "failed writing request log");
+  }
+}
+
+void
+RequestLog::FlushThread()
+{
+  std::vector<Record> records;
+  records.reserve(RING_CAPACITY);
+
+  bool exiting = false;
+  while (!exiting) {
+    {
+      std::unique_lock<std::mutex> lk(flush_mu_);
+      flush_cv_.wait_for(lk, FLUSH_INTERVAL, [this] { return exiting_; });
+      exiting = exiting_;
+    }
+
+    // On exit the appending threads have stopped, so a final drain
+    // picks up every remaining record.
+    records.clear();
+    Drain(&records);
+    WriteRecords(records);
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
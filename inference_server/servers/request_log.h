@@ -0,0 +1,126 @@
+// Copyright (c) 2019-2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/core/tritonserver.h"
+
+namespace nvidia { namespace inferenceserver {
+
+//
+// Binary log of completed inference requests. Records are appended
+// by the HTTP worker threads into per-thread lock-free rings and a
+// background thread writes them to the log file in large sequential
+// chunks, so logging adds no syscalls or formatting to the response
+// path. Use request_log_to_csv to convert a log file to CSV.
+//
+class RequestLog {
+ public:
+  // The file starts with a header followed by an array of
+  // fixed-size records.
+  static constexpr char MAGIC[8] = {'T', 'R', 'T', 'R', 'Q', 'L', 'O', 'G'};
+  static constexpr uint32_t VERSION = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+  };
+
+  struct Record {
+    // Wall-clock time the response was finalized, in microseconds
+    // since epoch.
+    uint64_t timestamp_us;
+    int64_t partitioning_point;
+    uint64_t queue_ns;
+    uint64_t infer_ns;
+    uint32_t last_batch_size;
+    uint32_t last_partitioning_point;
+    int64_t num_of_batch;
+    double rho;
+    double throughput;
+    double request_rate;
+  };
+
+  // Number of records each thread can have pending before further
+  // records from that thread are dropped.
+  static constexpr size_t RING_CAPACITY = 8192;
+
+  // Create a request log that appends to 'filepath'. An existing
+  // file must have been written by a compatible request log.
+  static TRITONSERVER_Error* Create(
+      RequestLog** log, const std::string& filepath);
+
+  // Flush all pending records and close the file.
+  ~RequestLog();
+
+  // Append a record to the log. Never blocks; if the ring of the
+  // calling thread is full the record is dropped and counted.
+  void Append(const Record& record);
+
+  // Return the number of records dropped because a ring was full.
+  uint64_t DroppedCount() const
+  {
+    return dropped_cnt_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Single-producer single-consumer ring owned by one appending
+  // thread and drained by the flush thread.
+  struct Ring {
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    Record records_[RING_CAPACITY];
+  };
+
+  RequestLog(const int fd);
+
+  Ring* ThreadRing();
+  void Drain(std::vector<Record>* records);
+  void WriteRecords(const std::vector<Record>& records);
+  void FlushThread();
+
+  const int fd_;
+  const uint64_t id_;
+
+  std::mutex rings_mu_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+
+  std::atomic<uint64_t> dropped_cnt_;
+
+  std::mutex flush_mu_;
+  std::condition_variable flush_cv_;
+  bool exiting_;
+  std::thread flush_thread_;
+};
+
+}}  // namespace nvidia::inferenceserver
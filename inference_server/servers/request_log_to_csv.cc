@@ -0,0 +1,151 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "src/servers/request_log.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+void
+Usage(char** argv, const std::string& msg = std::string())
+{
+  if (!msg.empty()) {
+    std::cerr << msg << std::endl;
+  }
+
+  std::cerr << "Usage: " << argv[0] << " [options] <request log file>"
+            << std::endl;
+  std::cerr << "\t-o <file> Write the CSV to a file instead of stdout"
+            << std::endl;
+  std::cerr << "\t-H Omit the CSV column header" << std::endl;
+
+  exit(1);
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string output_path;
+  bool column_header = true;
+
+  // Parse commandline...
+  int opt;
+  while ((opt = getopt(argc, argv, "o:H")) != -1) {
+    switch (opt) {
+      case 'o':
+        output_path = optarg;
+        break;
+      case 'H':
+        column_header = false;
+        break;
+      case '?':
+        Usage(argv);
+        break;
+    }
+  }
+
+  if (optind != (argc - 1)) {
+    Usage(argv, "exactly one request log file must be specified");
+  }
+
+  const std::string input_path(argv[optind]);
+  std::ifstream input(input_path, std::ios::binary);
+  if (!input) {
+    std::cerr << "error: failed to open " << input_path << std::endl;
+    exit(1);
+  }
+
+  ni::RequestLog::Header header;
+  if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      (memcmp(header.magic, ni::RequestLog::MAGIC, sizeof(header.magic)) !=
+       0)) {
+    std::cerr << "error: " << input_path << " is not a request log"
+              << std::endl;
+    exit(1);
+  }
+  if ((header.version != ni::RequestLog::VERSION) ||
+      (header.record_size != sizeof(ni::RequestLog::Record))) {
+    std::cerr << "error: " << input_path << " has unsupported version "
+              << header.version << " (record size " << header.record_size
+              << ")" << std::endl;
+    exit(1);
+  }
+
+  std::ofstream output_file;
+  if (!output_path.empty()) {
+    output_file.open(output_path);
+    if (!output_file) {
+      std::cerr << "error: failed to open " << output_path << std::endl;
+      exit(1);
+    }
+  }
+  std::ostream& output = output_path.empty() ? std::cout : output_file;
+
+  if (column_header) {
+    output << "timestamp_us,partitioning_point,infer_us,queue_us,"
+              "last_batch_size,last_partitioning_point,rho,throughput,"
+              "request_rate,num_of_batch\n";
+  }
+
+  // Read the records in large chunks, the log can hold millions of
+  // them.
+  std::vector<ni::RequestLog::Record> records(
+      ni::RequestLog::RING_CAPACITY);
+  size_t record_cnt = 0;
+  while (input) {
+    input.read(
+        reinterpret_cast<char*>(records.data()),
+        records.size() * sizeof(ni::RequestLog::Record));
+    const size_t cnt = input.gcount() / sizeof(ni::RequestLog::Record);
+    for (size_t i = 0; i < cnt; ++i) {
+      const ni::RequestLog::Record& r = records[i];
+      output << r.timestamp_us << ',' << r.partitioning_point << ','
+             << r.infer_ns / 1000 << ',' << r.queue_ns / 1000 << ','
+             << r.last_batch_size << ',' << r.last_partitioning_point << ','
+             << r.rho << ',' << r.throughput << ',' << r.request_rate << ','
+             << r.num_of_batch << '\n';
+    }
+    record_cnt += cnt;
+  }
+
+  if ((input.gcount() % sizeof(ni::RequestLog::Record)) != 0) {
+    std::cerr << "warning: ignoring truncated record at end of "
+              << input_path << std::endl;
+  }
+
+  std::cerr << "converted " << record_cnt << " records" << std::endl;
+
+  return 0;
+}
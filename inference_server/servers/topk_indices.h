@@ -0,0 +1,102 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace nvidia { namespace inferenceserver {
+
+// The number of elements tested at once against the smallest of the
+// top classes found so far.
+constexpr size_t kSelectBlock = 16;
+
+// Return true if any of the kSelectBlock 'values' is larger than
+// 'threshold'. The test has no branches, so it is vectorized by the
+// compiler.
+template <typename T>
+bool
+AnyLarger(const T* values, const T threshold)
+{
+  int larger = 0;
+  for (size_t j = 0; j < kSelectBlock; ++j) {
+    larger |= (values[j] > threshold);
+  }
+  return larger != 0;
+}
+
+// Set 'idx' to the indices of the 'class_cnt' largest of the
+// 'element_cnt' values at 'probs', largest first and the lower index
+// first among equal values. A block of values is only looked at one
+// by one if one of them is larger than the smallest of the top classes
+// found so far, once the top classes are found most blocks are passed
+// over with a single vectorized test.
+template <typename T>
+void
+TopkIndices(
+    const T* probs, const size_t element_cnt, const size_t class_cnt,
+    std::vector<size_t>* idx)
+{
+  idx->clear();
+  if (class_cnt == 0) {
+    return;
+  }
+  idx->reserve(class_cnt + 1);
+
+  // Insert 'i' into the top classes, kept sorted largest first.
+  auto insert = [&probs, &class_cnt, idx](const size_t i) {
+    auto pos = std::upper_bound(
+        idx->begin(), idx->end(), i, [&probs](size_t i1, size_t i2) {
+          return probs[i1] > probs[i2];
+        });
+    idx->insert(pos, i);
+    if (idx->size() > class_cnt) {
+      idx->pop_back();
+    }
+  };
+
+  size_t i = 0;
+  for (; (i < element_cnt) && (idx->size() < class_cnt); ++i) {
+    insert(i);
+  }
+  for (; (i + kSelectBlock) <= element_cnt; i += kSelectBlock) {
+    if (AnyLarger(probs + i, probs[idx->back()])) {
+      for (size_t j = 0; j < kSelectBlock; ++j) {
+        if (probs[i + j] > probs[idx->back()]) {
+          insert(i + j);
+        }
+      }
+    }
+  }
+  for (; i < element_cnt; ++i) {
+    if (probs[i] > probs[idx->back()]) {
+      insert(i);
+    }
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
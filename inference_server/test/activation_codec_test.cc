@@ -0,0 +1,257 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "src/core/activation_codec.h"
+
+// The client's encoder, in client/src.
+#include "activation_codec.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+// An activation of 'element_count' elements of 'element_size' bytes
+// where each element is zero with probability 'zero_fraction', as
+// after a ReLU, and otherwise random.
+std::vector<uint8_t>
+Activation(
+    const size_t element_count, const size_t element_size,
+    const double zero_fraction, std::mt19937* rng)
+{
+  std::bernoulli_distribution zero(zero_fraction);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> activation(element_count * element_size, 0);
+  for (size_t e = 0; e < element_count; ++e) {
+    if (zero(*rng)) {
+      continue;
+    }
+    for (size_t b = 0; b < element_size; ++b) {
+      activation[e * element_size + b] = byte(*rng);
+    }
+    // A random element may come out all zero bytes.
+    activation[e * element_size] |= 1;
+  }
+  return activation;
+}
+
+ni::Status
+Decode(
+    const ni::ActivationEncoding encoding, const std::vector<uint8_t>& encoded,
+    const size_t element_size, std::vector<uint8_t>* decoded)
+{
+  return ni::DecodeActivation(
+      encoding, reinterpret_cast<const char*>(encoded.data()), encoded.size(),
+      element_size, reinterpret_cast<char*>(decoded->data()),
+      decoded->size());
+}
+
+TEST(ActivationCodecTest, SparseRoundTrip)
+{
+  std::mt19937 rng(0);
+  for (const size_t element_size : {1, 2, 4}) {
+    for (const size_t element_count : {1, 7, 8, 9, 1000, 4099}) {
+      for (const double zero_fraction : {0.0, 0.6, 1.0}) {
+        const std::vector<uint8_t> activation =
+            Activation(element_count, element_size, zero_fraction, &rng);
+        std::vector<uint8_t> encoded;
+        encode_sparse(
+            activation.data(), activation.size(), element_size, encoded);
+
+        std::vector<uint8_t> decoded(activation.size(), 0xff);
+        ni::Status status = Decode(
+            ni::ActivationEncoding::SPARSE, encoded, element_size, &decoded);
+        EXPECT_TRUE(status.IsOk()) << status.AsString();
+        EXPECT_EQ(activation, decoded)
+            << element_count << " elements of " << element_size << " bytes";
+      }
+    }
+  }
+}
+
+TEST(ActivationCodecTest, LZRoundTrip)
+{
+  std::mt19937 rng(0);
+  std::vector<std::vector<uint8_t>> activations;
+  activations.push_back(std::vector<uint8_t>(1, 7));
+  activations.push_back(std::vector<uint8_t>(100000, 0));
+  // Incompressible, and past the 64 KB an offset reaches.
+  activations.push_back(Activation(200000, 1, 0.0, &rng));
+  activations.push_back(Activation(50000, 4, 0.6, &rng));
+  // Short periods make the matches overlap the bytes they produce.
+  for (const size_t period : {1, 3, 5, 17}) {
+    std::vector<uint8_t> activation(10000);
+    for (size_t i = 0; i < activation.size(); ++i) {
+      activation[i] = (i % period) * 31;
+    }
+    activations.push_back(activation);
+  }
+
+  for (const auto& activation : activations) {
+    std::vector<uint8_t> encoded;
+    encode_lz(activation.data(), activation.size(), encoded);
+
+    std::vector<uint8_t> decoded(activation.size(), 0xff);
+    ni::Status status =
+        Decode(ni::ActivationEncoding::LZ, encoded, 1, &decoded);
+    EXPECT_TRUE(status.IsOk()) << status.AsString();
+    EXPECT_EQ(activation, decoded) << activation.size() << " bytes";
+  }
+}
+
+TEST(ActivationCodecTest, SparseTruncated)
+{
+  std::mt19937 rng(1);
+  const std::vector<uint8_t> activation = Activation(1000, 4, 0.6, &rng);
+  std::vector<uint8_t> encoded;
+  encode_sparse(activation.data(), activation.size(), 4, encoded);
+
+  // Each prefix loses values or part of the bitmap.
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    const std::vector<uint8_t> truncated(
+        encoded.begin(), encoded.begin() + size);
+    std::vector<uint8_t> decoded(activation.size());
+    EXPECT_FALSE(
+        Decode(ni::ActivationEncoding::SPARSE, truncated, 4, &decoded).IsOk())
+        << size << " of " << encoded.size() << " bytes";
+  }
+}
+
+TEST(ActivationCodecTest, SparseCorrupt)
+{
+  std::mt19937 rng(2);
+  const std::vector<uint8_t> activation = Activation(1001, 4, 0.6, &rng);
+  std::vector<uint8_t> encoded;
+  encode_sparse(activation.data(), activation.size(), 4, encoded);
+  const size_t bitmap_byte_size = (1001 + 7) / 8;
+
+  std::vector<uint8_t> decoded(activation.size());
+
+  // A value the bitmap doesn't set.
+  std::vector<uint8_t> extra_value(encoded);
+  extra_value.insert(extra_value.end(), 4, 1);
+  EXPECT_FALSE(
+      Decode(ni::ActivationEncoding::SPARSE, extra_value, 4, &decoded).IsOk());
+
+  // A bit set with no value for it.
+  std::vector<uint8_t> extra_bit(encoded);
+  for (size_t byte = 0; byte < bitmap_byte_size - 1; ++byte) {
+    if (extra_bit[byte] != 0xff) {
+      extra_bit[byte] |= ~extra_bit[byte] & -(~extra_bit[byte]);
+      break;
+    }
+  }
+  EXPECT_FALSE(
+      Decode(ni::ActivationEncoding::SPARSE, extra_bit, 4, &decoded).IsOk());
+
+  // A bit past the last element, in the padding of the bitmap.
+  std::vector<uint8_t> padding_bit(encoded);
+  padding_bit[bitmap_byte_size - 1] |= 0x80;
+  padding_bit.insert(padding_bit.end(), 4, 1);
+  EXPECT_FALSE(
+      Decode(ni::ActivationEncoding::SPARSE, padding_bit, 4, &decoded).IsOk());
+
+  // A size that isn't whole elements.
+  std::vector<uint8_t> partial(activation.size() - 1);
+  EXPECT_FALSE(
+      Decode(ni::ActivationEncoding::SPARSE, encoded, 4, &partial).IsOk());
+}
+
+TEST(ActivationCodecTest, LZTruncated)
+{
+  std::mt19937 rng(3);
+  const std::vector<uint8_t> activation = Activation(2000, 4, 0.6, &rng);
+  std::vector<uint8_t> encoded;
+  encode_lz(activation.data(), activation.size(), encoded);
+
+  // Each prefix decodes to fewer bytes, if it decodes at all.
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    const std::vector<uint8_t> truncated(
+        encoded.begin(), encoded.begin() + size);
+    std::vector<uint8_t> decoded(activation.size());
+    EXPECT_FALSE(
+        Decode(ni::ActivationEncoding::LZ, truncated, 1, &decoded).IsOk())
+        << size << " of " << encoded.size() << " bytes";
+  }
+
+  // The whole activation into too small or too large an output.
+  for (const size_t size : {activation.size() - 1, activation.size() + 1}) {
+    std::vector<uint8_t> decoded(size);
+    EXPECT_FALSE(
+        Decode(ni::ActivationEncoding::LZ, encoded, 1, &decoded).IsOk());
+  }
+}
+
+TEST(ActivationCodecTest, LZCorrupt)
+{
+  std::vector<uint8_t> decoded(64);
+
+  // A match before the start of the output, or at offset 0.
+  const std::vector<uint8_t> far_offset = {0x10, 'a', 0x05, 0x00, 0x00};
+  EXPECT_FALSE(Decode(ni::ActivationEncoding::LZ, far_offset, 1, &decoded)
+                   .IsOk());
+  const std::vector<uint8_t> zero_offset = {0x10, 'a', 0x00, 0x00, 0x00};
+  EXPECT_FALSE(Decode(ni::ActivationEncoding::LZ, zero_offset, 1, &decoded)
+                   .IsOk());
+
+  // A literal length running past the input.
+  const std::vector<uint8_t> long_literal = {0xf0, 0xff, 0xff};
+  EXPECT_FALSE(Decode(ni::ActivationEncoding::LZ, long_literal, 1, &decoded)
+                   .IsOk());
+
+  // A match running past the output.
+  const std::vector<uint8_t> long_match = {0x1f, 'a', 0x01, 0x00, 0xff,
+                                           0x00, 0x00};
+  EXPECT_FALSE(Decode(ni::ActivationEncoding::LZ, long_match, 1, &decoded)
+                   .IsOk());
+
+  // Any flipped byte of a valid stream is either rejected or decodes
+  // within the output.
+  std::mt19937 rng(4);
+  const std::vector<uint8_t> activation = Activation(1000, 4, 0.6, &rng);
+  std::vector<uint8_t> encoded;
+  encode_lz(activation.data(), activation.size(), encoded);
+  std::uniform_int_distribution<int> byte(1, 255);
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    std::vector<uint8_t> corrupt(encoded);
+    corrupt[i] ^= byte(rng);
+    std::vector<uint8_t> output(activation.size());
+    Decode(ni::ActivationEncoding::LZ, corrupt, 1, &output);
+  }
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
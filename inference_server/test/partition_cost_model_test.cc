@@ -0,0 +1,217 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "src/core/partition_cost_model.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+constexpr size_t kLayerCount = 20;
+
+// A cost model of 'kLayerCount' layers whose cost grows sublinearly
+// with the batch size, profiled up to 'max_batch_size'.
+std::unique_ptr<ni::PartitionCostModel>
+CreateModel(const int max_batch_size, std::mt19937* rng)
+{
+  std::uniform_real_distribution<float> dist(10, 500);
+  ni::ModelPartitioning config;
+  for (size_t layer = 0; layer < kLayerCount; ++layer) {
+    auto* cost = config.add_layer_cost();
+    const float us = dist(*rng);
+    for (int bs = 1; bs <= max_batch_size; ++bs) {
+      cost->add_batch_latency_us(us * (1 + 0.3f * (bs - 1)));
+    }
+  }
+  config.set_segment_overhead_us(40);
+
+  std::unique_ptr<ni::PartitionCostModel> model;
+  EXPECT_TRUE(
+      ni::PartitionCostModel::Create(config, max_batch_size, &model).IsOk());
+  return model;
+}
+
+// The added cost at each point by computing the cost of the queue
+// with the request and without it.
+std::vector<double>
+JoinedQueueCost(
+    const ni::PartitionCostModel& model,
+    const std::map<int64_t, size_t>& points)
+{
+  const double queued_us = model.QueueCost(points);
+  std::vector<double> added_us;
+  for (size_t point = 0; point < model.LayerCount(); ++point) {
+    std::map<int64_t, size_t> joined(points);
+    joined[point] += 1;
+    added_us.push_back(model.QueueCost(joined) - queued_us);
+  }
+  return added_us;
+}
+
+void
+ExpectSameAsJoined(
+    const ni::PartitionCostModel& model,
+    const std::map<int64_t, size_t>& points)
+{
+  std::vector<double> added_us;
+  model.AddedQueueCost(points, &added_us);
+  const std::vector<double> expected_us = JoinedQueueCost(model, points);
+  ASSERT_EQ(added_us.size(), expected_us.size());
+  for (size_t point = 0; point < added_us.size(); ++point) {
+    EXPECT_NEAR(added_us[point], expected_us[point], 1e-6)
+        << "point " << point;
+  }
+}
+
+TEST(PartitionCostModelTest, AddedQueueCostEmptyQueue)
+{
+  std::mt19937 rng(0);
+  auto model = CreateModel(8, &rng);
+  ExpectSameAsJoined(*model, {});
+}
+
+TEST(PartitionCostModelTest, AddedQueueCostRandomQueue)
+{
+  std::mt19937 rng(1);
+  for (const int max_batch_size : {1, 2, 4, 8, 16}) {
+    auto model = CreateModel(max_batch_size, &rng);
+    std::uniform_int_distribution<int64_t> point_dist(0, kLayerCount - 1);
+    std::uniform_int_distribution<size_t> depth_dist(1, 6);
+    for (size_t trial = 0; trial < 50; ++trial) {
+      std::map<int64_t, size_t> points;
+      const size_t point_cnt = trial % 8;
+      for (size_t i = 0; i < point_cnt; ++i) {
+        points[point_dist(rng)] += depth_dist(rng);
+      }
+      ExpectSameAsJoined(*model, points);
+    }
+  }
+}
+
+TEST(PartitionCostModelTest, AddedQueueCostFullBatches)
+{
+  // The queue fills whole batches, a request at any point starts a
+  // batch of its own or shifts the last one.
+  std::mt19937 rng(2);
+  auto model = CreateModel(4, &rng);
+  ExpectSameAsJoined(*model, {{0, 4}, {5, 4}});
+  ExpectSameAsJoined(*model, {{3, 3}, {kLayerCount - 1, 5}});
+}
+
+TEST(PartitionHintRangeTest, NoAllowance)
+{
+  const std::vector<double> added_us{50, 40, 30, 20, 10};
+  int64_t min_point, max_point;
+  ni::PartitionHintRange(added_us, 0, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 5);
+  EXPECT_EQ(max_point, 5);
+  ni::PartitionHintRange(added_us, -10, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 5);
+  EXPECT_EQ(max_point, 5);
+}
+
+TEST(PartitionHintRangeTest, EarliestWithinAllowance)
+{
+  const std::vector<double> added_us{50, 40, 30, 20, 10};
+  int64_t min_point, max_point;
+
+  // Point 2 is the first within the allowance and point 4 the latest
+  // that adds a quarter of it.
+  ni::PartitionHintRange(added_us, 35, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 2);
+  EXPECT_EQ(max_point, 4);
+
+  // Point 4 adds less than the share, the range ends at point 3.
+  ni::PartitionHintRange(added_us, 45, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 1);
+  EXPECT_EQ(max_point, 3);
+
+  // Every point is within the allowance.
+  ni::PartitionHintRange(added_us, 100, 0.1, &min_point, &max_point);
+  EXPECT_EQ(min_point, 0);
+  EXPECT_EQ(max_point, 4);
+}
+
+TEST(PartitionHintRangeTest, NoPointWithinAllowance)
+{
+  // Only the local-only point is within a small allowance.
+  const std::vector<double> added_us{50, 40, 30};
+  int64_t min_point, max_point;
+  ni::PartitionHintRange(added_us, 5, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 3);
+  EXPECT_EQ(max_point, 3);
+}
+
+TEST(PartitionHintRangeTest, NoLaterPointWithShare)
+{
+  // The points after the first within the allowance add too little, the
+  // range is that point alone.
+  const std::vector<double> added_us{50, 30, 1, 1};
+  int64_t min_point, max_point;
+  ni::PartitionHintRange(added_us, 35, 0.25, &min_point, &max_point);
+  EXPECT_EQ(min_point, 1);
+  EXPECT_EQ(max_point, 1);
+}
+
+TEST(PartitionHintRangeTest, RangeWithinPoints)
+{
+  // The range is ordered and within the points for any allowance.
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> dist(0, 100);
+  for (size_t trial = 0; trial < 200; ++trial) {
+    std::vector<double> added_us(1 + trial % 30);
+    for (auto& us : added_us) {
+      us = dist(rng);
+    }
+    const double allowance = dist(rng) - 20;
+    int64_t min_point, max_point;
+    ni::PartitionHintRange(added_us, allowance, 0.25, &min_point, &max_point);
+    EXPECT_LE(0, min_point);
+    EXPECT_LE(min_point, max_point);
+    EXPECT_LE(max_point, (int64_t)added_us.size());
+    if (min_point < (int64_t)added_us.size()) {
+      EXPECT_LE(added_us[min_point], allowance);
+    }
+    for (int64_t point = 0; point < min_point; ++point) {
+      EXPECT_GT(added_us[point], allowance);
+    }
+  }
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "src/servers/topk_indices.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+// The indices of the 'class_cnt' largest 'values' by a full sort,
+// largest first and the lower index first among equal values.
+template <typename T>
+std::vector<size_t>
+SortedTopk(const std::vector<T>& values, const size_t class_cnt)
+{
+  std::vector<size_t> idx(values.size());
+  std::iota(idx.begin(), idx.end(), 0);
+  std::stable_sort(idx.begin(), idx.end(), [&values](size_t i1, size_t i2) {
+    return values[i1] > values[i2];
+  });
+  idx.resize(class_cnt);
+  return idx;
+}
+
+template <typename T>
+void
+ExpectSameAsSort(const std::vector<T>& values, const size_t class_cnt)
+{
+  std::vector<size_t> idx;
+  ni::TopkIndices(values.data(), values.size(), class_cnt, &idx);
+  EXPECT_EQ(idx, SortedTopk(values, class_cnt))
+      << "element_cnt " << values.size() << ", class_cnt " << class_cnt;
+}
+
+TEST(TopkIndicesTest, NoClass)
+{
+  std::vector<float> values{3, 1, 2};
+  std::vector<size_t> idx{7};
+  ni::TopkIndices(values.data(), values.size(), 0, &idx);
+  EXPECT_TRUE(idx.empty());
+}
+
+TEST(TopkIndicesTest, RandomFloat)
+{
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(0, 1);
+  // Sizes around the block size, and the size of the ImageNet output.
+  for (const size_t element_cnt : {1, 5, 15, 16, 17, 33, 100, 1000}) {
+    std::vector<float> values(element_cnt);
+    for (auto& v : values) {
+      v = dist(rng);
+    }
+    for (const size_t class_cnt : {1, 2, 5, 16, 20}) {
+      ExpectSameAsSort(values, std::min(class_cnt, element_cnt));
+    }
+    ExpectSameAsSort(values, element_cnt);
+  }
+}
+
+TEST(TopkIndicesTest, Ties)
+{
+  // Few distinct values, so most of the top classes tie.
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int32_t> dist(0, 3);
+  for (const size_t element_cnt : {16, 47, 1000}) {
+    std::vector<int32_t> values(element_cnt);
+    for (auto& v : values) {
+      v = dist(rng);
+    }
+    for (const size_t class_cnt : {1, 5, 17}) {
+      ExpectSameAsSort(values, std::min(class_cnt, element_cnt));
+    }
+  }
+
+  std::vector<uint8_t> same(100, 9);
+  ExpectSameAsSort(same, 5);
+}
+
+TEST(TopkIndicesTest, Ascending)
+{
+  // Every value is larger than the top classes found before it.
+  std::vector<double> values(100);
+  std::iota(values.begin(), values.end(), -50.0);
+  ExpectSameAsSort(values, 5);
+  std::reverse(values.begin(), values.end());
+  ExpectSameAsSort(values, 5);
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
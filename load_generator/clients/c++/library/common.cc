@@ -128,6 +128,7 @@ InferInput::Reset()
 {
   bufs_.clear();
   buf_byte_sizes_.clear();
+  buf_ready_.clear();
   str_bufs_.clear();
   bufs_idx_ = 0;
   byte_size_ = 0;
@@ -143,11 +144,19 @@ InferInput::AppendRaw(const std::vector<uint8_t>& input)
 
 Error
 InferInput::AppendRaw(const uint8_t* input, size_t input_byte_size)
+{
+  return AppendRaw(input, input_byte_size, nullptr);
+}
+
+Error
+InferInput::AppendRaw(
+    const uint8_t* input, size_t input_byte_size, ReadyFn ready)
 {
   byte_size_ += input_byte_size;
 
   bufs_.push_back(input);
   buf_byte_sizes_.push_back(input_byte_size);
+  buf_ready_.push_back(ready);
   io_type_ = RAW;
 
   return Error::Success;
@@ -228,7 +237,10 @@ InferInput::GetNext(
 
   while ((bufs_idx_ < bufs_.size()) && (size > 0)) {
     const size_t buf_byte_size = buf_byte_sizes_[bufs_idx_];
-    const size_t csz = (std::min)(buf_byte_size - buf_pos_, size);
+    size_t csz = (std::min)(buf_byte_size - buf_pos_, size);
+    if ((csz > 0) && (buf_ready_[bufs_idx_] != nullptr)) {
+      csz = (std::min)(csz, buf_ready_[bufs_idx_](buf_pos_));
+    }
     if (csz > 0) {
       const uint8_t* input_ptr = bufs_[bufs_idx_] + buf_pos_;
       std::copy(input_ptr, input_ptr + csz, buf);
@@ -253,14 +265,35 @@ InferInput::GetNext(
 Error
 InferInput::GetNext(
     const uint8_t** buf, size_t* input_bytes, bool* end_of_input)
+{
+  ReadyFn ready;
+  GetNext(buf, input_bytes, &ready, end_of_input);
+
+  // The whole buffer is returned so wait until all of it is written.
+  if (ready != nullptr) {
+    size_t offset = 0;
+    while (offset < *input_bytes) {
+      offset += ready(offset);
+    }
+  }
+
+  return Error::Success;
+}
+
+Error
+InferInput::GetNext(
+    const uint8_t** buf, size_t* input_bytes, ReadyFn* ready,
+    bool* end_of_input)
 {
   if (bufs_idx_ < bufs_.size()) {
     *buf = bufs_[bufs_idx_];
     *input_bytes = buf_byte_sizes_[bufs_idx_];
+    *ready = buf_ready_[bufs_idx_];
     bufs_idx_++;
   } else {
     *buf = nullptr;
     *input_bytes = 0;
+    *ready = nullptr;
   }
   *end_of_input = (bufs_idx_ >= bufs_.size());
 
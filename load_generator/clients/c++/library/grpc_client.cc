@@ -100,6 +100,8 @@ class InferResultGrpc : public InferResult {
    
   Error ModelQueueNs(std::string* queuens) const override;
   Error ModelInferNs(std::string* inferns) const override;
+  Error PredictedWait(uint64_t* wait_us) const override;
+  Error PartitionHint(int64_t* min_point, int64_t* max_point) const override;
   
 
   
@@ -180,6 +182,18 @@ InferResultGrpc::ModelInferNs(std::string* inferns) const
   return Error::Success;
 }
 
+Error
+InferResultGrpc::PredictedWait(uint64_t* wait_us) const
+{
+  return Error("predicted wait is not supported by GRPC protocol");
+}
+
+Error
+InferResultGrpc::PartitionHint(int64_t* min_point, int64_t* max_point) const
+{
+  return Error("partition hint is not supported by GRPC protocol");
+}
+
 
 Error
 InferResultGrpc::Id(std::string* id) const
@@ -132,8 +132,11 @@ class HttpInferRequest : public InferRequest {
       const InferOptions& options, const std::vector<InferInput*>& inputs,
       const std::vector<const InferRequestedOutput*>& outputs);
 
-  // Adds the input data to be delivered to the server
-  Error AddInput(uint8_t* buf, size_t byte_size);
+  // Adds the input data to be delivered to the server. 'ready', if
+  // set, waits until a part of 'buf' is written.
+  Error AddInput(
+      uint8_t* buf, size_t byte_size,
+      InferInput::ReadyFn ready = nullptr);
 
   // Copy into 'buf' up to 'size' bytes of input data. Return the
   // actual amount copied in 'input_bytes'.
@@ -162,8 +165,14 @@ class HttpInferRequest : public InferRequest {
   // Buffer that accumulates the response body.
   std::unique_ptr<std::string> infer_response_buffer_;
 
-  // The pointers to the input data.
-  std::queue<std::pair<uint8_t*, size_t>> data_buffers_;
+  // The input data and how much of it is sent.
+  struct DataBuffer {
+    uint8_t* buf_;
+    size_t byte_size_;
+    size_t sent_;
+    InferInput::ReadyFn ready_;
+  };
+  std::queue<DataBuffer> data_buffers_;
 
   size_t response_json_size_;
 };
@@ -223,7 +232,9 @@ HttpInferRequest::PrepareRequestJson(
       "id", options.request_id_.c_str(), options.request_id_.size());
 
   if ((options.sequence_id_ != 0) || (options.priority_ != 0) ||
-      (options.timeout_ != 0) || (options.partitioning_point_ != -1)) {
+      (options.timeout_ != 0) || (options.partitioning_point_ != -1) ||
+      (options.deadline_ != 0) || !options.input_scale_.empty() ||
+      !options.input_encoding_.empty()) {
     TritonJson::Value parameters_json(
         *request_json, TritonJson::ValueType::OBJECT);
     {
@@ -245,6 +256,25 @@ HttpInferRequest::PrepareRequestJson(
         parameters_json.AddUInt("point", options.partitioning_point_);
       }
 
+      if (options.deadline_ != 0) {
+        parameters_json.AddUInt("deadline", options.deadline_);
+      }
+
+      if (!options.input_scale_.empty()) {
+        TritonJson::Value scale_json(
+            *request_json, TritonJson::ValueType::ARRAY);
+        for (const auto scale : options.input_scale_) {
+          scale_json.AppendDouble(scale);
+        }
+        parameters_json.Add("scale", std::move(scale_json));
+      }
+
+      if (!options.input_encoding_.empty()) {
+        parameters_json.AddStringRef(
+            "encoding", options.input_encoding_.c_str(),
+            options.input_encoding_.size());
+      }
+
 
     }
 
@@ -345,9 +375,10 @@ HttpInferRequest::PrepareRequestJson(
 }
 
 Error
-HttpInferRequest::AddInput(uint8_t* buf, size_t byte_size)
+HttpInferRequest::AddInput(
+    uint8_t* buf, size_t byte_size, InferInput::ReadyFn ready)
 {
-  data_buffers_.push(std::pair<uint8_t*, size_t>(buf, byte_size));
+  data_buffers_.push(DataBuffer{buf, byte_size, 0, ready});
   total_input_byte_size_ += byte_size;
   return Error::Success;
 }
@@ -362,20 +393,29 @@ HttpInferRequest::GetNextInput(uint8_t* buf, size_t size, size_t* input_bytes)
   }
 
   while (!data_buffers_.empty() && size > 0) {
-    const size_t csz = (std::min)(data_buffers_.front().second, size);
-    if (csz > 0) {
-      const uint8_t* input_ptr = data_buffers_.front().first;
-      std::copy(input_ptr, input_ptr + csz, buf);
-      size -= csz;
-      buf += csz;
-      *input_bytes += csz;
-
-
-      data_buffers_.front().first += csz;
-      data_buffers_.front().second -= csz;
-      if (data_buffers_.front().second == 0) {
-        data_buffers_.pop();
-      }
+    DataBuffer& data = data_buffers_.front();
+    size_t csz = (std::min)(data.byte_size_ - data.sent_, size);
+    // Send only the part of a buffer that is written. The rest is sent
+    // by the next call, once curl sent this part, so the transfer
+    // overlaps with the writing of the buffer.
+    bool partial = false;
+    if ((csz > 0) && (data.ready_ != nullptr)) {
+      const size_t ready = data.ready_(data.sent_);
+      partial = (ready < csz);
+      csz = (std::min)(csz, ready);
+    }
+    const uint8_t* input_ptr = data.buf_ + data.sent_;
+    std::copy(input_ptr, input_ptr + csz, buf);
+    size -= csz;
+    buf += csz;
+    *input_bytes += csz;
+
+    data.sent_ += csz;
+    if (data.sent_ == data.byte_size_) {
+      data_buffers_.pop();
+    }
+    if (partial) {
+      break;
     }
   }
 
@@ -401,6 +441,8 @@ class InferResultHttp : public InferResult {
   
   Error ModelQueueNs(std::string* queuens) const override;
   Error ModelInferNs(std::string* inferns) const override;
+  Error PredictedWait(uint64_t* wait_us) const override;
+  Error PartitionHint(int64_t* min_point, int64_t* max_point) const override;
   
   Error Id(std::string* id) const override;
   Error Shape(const std::string& output_name, std::vector<int64_t>* shape)
@@ -511,6 +553,37 @@ InferResultHttp::ModelInferNs(std::string* inferns) const
   return Error::Success;
 }
 
+Error
+InferResultHttp::PredictedWait(uint64_t* wait_us) const
+{
+  // Only present in the error response of a rejected request, so
+  // don't check 'status_'.
+  Error err = response_json_.MemberAsUInt("predicted_wait_us", wait_us);
+  if (!err.IsOk()) {
+    return Error("predicted wait was not returned in the response");
+  }
+
+  return Error::Success;
+}
+
+Error
+InferResultHttp::PartitionHint(int64_t* min_point, int64_t* max_point) const
+{
+  if (!status_.IsOk()) {
+    return status_;
+  }
+
+  Error err = response_json_.MemberAsInt("hint_min_point", min_point);
+  if (err.IsOk()) {
+    err = response_json_.MemberAsInt("hint_max_point", max_point);
+  }
+  if (!err.IsOk()) {
+    return Error("partition hint was not returned in the response");
+  }
+
+  return Error::Success;
+}
+
 
 
 Error
@@ -1305,9 +1378,10 @@ InferenceServerHttpClient::PreRunProcessing(
       while (!end_of_input) {
         const uint8_t* buf;
         size_t buf_size;
-        this_input->GetNext(&buf, &buf_size, &end_of_input);
+        InferInput::ReadyFn ready;
+        this_input->GetNext(&buf, &buf_size, &ready, &end_of_input);
         if (buf != nullptr) {
-          http_request->AddInput(const_cast<uint8_t*>(buf), buf_size);
+          http_request->AddInput(const_cast<uint8_t*>(buf), buf_size, ready);
         }
       }
     }
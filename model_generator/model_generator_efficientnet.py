@@ -6,6 +6,7 @@ import numpy as np
 from PIL import Image
 from efficientnet_pytorch import EfficientNet
 from torchvision import transforms
+from segments import script_segments, split_points
 
 target_models = ["b{}".format(x) for x in range(0, 7)]
 
@@ -73,6 +74,10 @@ for target_model in target_models:
     clientModel.eval()
     serverModel = ServerModel().cuda()
     serverModel.eval()
+    # Precompiled segments between the split points of the server model.
+    server_points = split_points(serverModel.layers)
+    serverModel.segments = script_segments(serverModel.layers, server_points)
+    print('split points:', server_points)
 
     tfms = transforms.Compose([transforms.Resize((224,224)), transforms.ToTensor(),
                                transforms.Normalize([0.485, 0.456, 0.406], [0.229, 0.224, 0.225]),])
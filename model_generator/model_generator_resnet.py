@@ -5,6 +5,7 @@ import torch
 import numpy as np
 from PIL import Image
 from torchvision import transforms
+from segments import script_segments, split_points
 import torchvision
 model = torchvision.models.resnet50(pretrained=True)
 k = torch.rand(1,3,224,224).cuda()
@@ -68,6 +69,10 @@ clientModel = ClientModel().cuda()
 clientModel.eval()
 serverModel = ServerModel().cuda()
 serverModel.eval()
+# Precompiled segments between the split points of the server model.
+server_points = split_points(serverModel.layers)
+serverModel.segments = script_segments(serverModel.layers, server_points)
+print('split points:', server_points)
 
 tfms = transforms.Compose([transforms.Resize((224,224)), transforms.ToTensor(),
                            transforms.Normalize([0.485, 0.456, 0.406], [0.229, 0.224, 0.225]),])
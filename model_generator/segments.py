@@ -0,0 +1,33 @@
+import torch
+
+
+# Layers that only rescale or reshape their input. Splitting right before
+# one of them transfers as much data as splitting right after the layer it
+# follows, so they are kept in the segment of that layer.
+PASS_THROUGH_LAYERS = (torch.nn.ReLU, torch.nn.ReLU6, torch.nn.SiLU,
+                       torch.nn.Hardswish, torch.nn.Dropout,
+                       torch.nn.BatchNorm2d, torch.nn.Flatten,
+                       torch.nn.Identity)
+
+
+def split_points(layers):
+    # The layers a request can start at on the server: the first layer and
+    # every layer that is not a pass-through layer. The server must be
+    # configured with these split points.
+    return [i for i, layer in enumerate(layers)
+            if i == 0 or not isinstance(layer, PASS_THROUGH_LAYERS)]
+
+
+def script_segments(layers, points):
+    # One frozen TorchScript module for each segment of 'layers' between
+    # consecutive split points, and from the last split point to the end.
+    # The server looks the segments up by name, '<start>_<end>'.
+    bounds = sorted(points) + [len(layers)]
+    segments = torch.nn.ModuleDict()
+    for start, end in zip(bounds[:-1], bounds[1:]):
+        segment = torch.nn.Sequential(*layers[start:end]).eval()
+        segment = torch.jit.freeze(torch.jit.script(segment))
+        if hasattr(torch.jit, 'optimize_for_inference'):
+            segment = torch.jit.optimize_for_inference(segment)
+        segments['{}_{}'.format(start, end)] = segment
+    return segments